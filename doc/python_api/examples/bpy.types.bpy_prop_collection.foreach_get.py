@@ -8,3 +8,16 @@ collection.foreach_get(attr, some_seq)
 # Python equivalent
 for i in range(len(seq)):
     some_seq[i] = getattr(collection[i], attr)
+
+"""
+A numpy array of the matching type is filled without converting each value,
+which makes this the fastest way to read large amounts of data.
+"""
+
+import bpy
+import numpy as np
+
+mesh = bpy.context.object.data
+co = np.empty(len(mesh.vertices) * 3, dtype=np.float32)
+mesh.vertices.foreach_get("co", co)
+co = co.reshape(-1, 3)
@@ -234,6 +234,7 @@ else:
         "bmesh.geometry",
         "bpy.app",
         "bpy.app.handlers",
+        "bpy.app.memory",
         "bpy.app.timers",
         "bpy.app.translations",
         "bpy.context",
@@ -1982,6 +1983,7 @@ def write_rst_importable_modules(basepath):
         "bpy.app.handlers": "Application Handlers",
         "bpy.app.translations": "Application Translations",
         "bpy.app.icons": "Application Icons",
+        "bpy.app.memory": "Application Memory",
         "bpy.app.timers": "Application Timers",
         "bpy.props": "Property Definitions",
         "idprop.types": "ID Property Access",
@@ -0,0 +1,1101 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#  include "util/util_windows.h"
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include "graph/node.h"
+
+#include "render/attribute.h"
+#include "render/background.h"
+#include "render/camera.h"
+#include "render/film.h"
+#include "render/graph.h"
+#include "render/integrator.h"
+#include "render/light.h"
+#include "render/mesh.h"
+#include "render/nodes.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/shader.h"
+
+#include "subd/subd_dice.h"
+
+#include "util/util_foreach.h"
+#include "util/util_map.h"
+#include "util/util_path.h"
+#include "util/util_string.h"
+#include "util/util_vector.h"
+
+#include "app/cycles_binary.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* File Layout
+ *
+ * The header is followed by a list of records, each starting with its type. Nodes are stored as
+ * their type name, name and the sockets that don't have the default value, with the value of
+ * each socket prefixed by its size. Nodes refer to shaders and geometry by their index in the
+ * order they were written. */
+
+#define BINARY_SCENE_VERSION 1
+
+static const char binary_scene_magic[8] = {'C', 'Y', 'C', 'L', 'E', 'S', 'B', '\0'};
+
+struct BinarySceneHeader {
+  char magic[8];
+  uint32_t version;
+  /* Sizes of types stored in native layout, files written by a build with a different layout
+   * can not be read. */
+  uint32_t float3_size;
+  uint32_t subd_face_size;
+  uint32_t pad;
+};
+
+enum BinaryRecordType {
+  BINARY_RECORD_END = 0,
+  BINARY_RECORD_SHADER,
+  BINARY_RECORD_FILM,
+  BINARY_RECORD_INTEGRATOR,
+  BINARY_RECORD_CAMERA,
+  BINARY_RECORD_BACKGROUND,
+  BINARY_RECORD_MESH,
+  BINARY_RECORD_OBJECT,
+  BINARY_RECORD_LIGHT,
+};
+
+static void binary_scene_header_init(BinarySceneHeader *header)
+{
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, binary_scene_magic, sizeof(header->magic));
+  header->version = BINARY_SCENE_VERSION;
+  header->float3_size = sizeof(float3);
+  header->subd_face_size = sizeof(Mesh::SubdFace);
+}
+
+/* Default shaders are not created by the file, records of them modify the existing shader. */
+static void binary_default_shaders(Scene *scene, Shader *shaders[5])
+{
+  shaders[0] = scene->default_surface;
+  shaders[1] = scene->default_volume;
+  shaders[2] = scene->default_light;
+  shaders[3] = scene->default_background;
+  shaders[4] = scene->default_empty;
+}
+
+/* Memory Mapped File */
+
+class BinaryMappedFile {
+ public:
+  explicit BinaryMappedFile(const string &filepath) : data(NULL), size(0)
+  {
+#ifdef _WIN32
+    mapping = NULL;
+    file = CreateFileW(string_to_wstring(filepath).c_str(),
+                       GENERIC_READ,
+                       FILE_SHARE_READ,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                       NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+      return;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+      return;
+    }
+
+    mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+      return;
+    }
+
+    data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data) {
+      size = (size_t)file_size.QuadPart;
+    }
+#else
+    fd = open(filepath.c_str(), O_RDONLY);
+    if (fd == -1) {
+      return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      return;
+    }
+
+    void *mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      return;
+    }
+
+    /* The file is read front to back exactly once. */
+    posix_madvise(mapped, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    data = (const uint8_t *)mapped;
+    size = st.st_size;
+#endif
+  }
+
+  ~BinaryMappedFile()
+  {
+#ifdef _WIN32
+    if (data) {
+      UnmapViewOfFile(data);
+    }
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+      CloseHandle(file);
+    }
+#else
+    if (data) {
+      munmap((void *)data, size);
+    }
+    if (fd != -1) {
+      close(fd);
+    }
+#endif
+  }
+
+  const uint8_t *data;
+  size_t size;
+
+ private:
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE mapping;
+#else
+  int fd;
+#endif
+};
+
+/* Writer */
+
+struct BinaryWriter {
+  vector<uint8_t> data;
+  map<const Node *, int> node_ids;
+
+  void write(const void *ptr, size_t size)
+  {
+    const uint8_t *bytes = (const uint8_t *)ptr;
+    data.insert(data.end(), bytes, bytes + size);
+  }
+
+  template<typename T> void write_value(const T &value)
+  {
+    write(&value, sizeof(T));
+  }
+
+  void write_string(const string &str)
+  {
+    write_value<uint32_t>(str.size());
+    write(str.data(), str.size());
+  }
+
+  /* Blocks are prefixed with their size, so that readers can check it. */
+  size_t begin_block()
+  {
+    const size_t offset = data.size();
+    write_value<uint64_t>(0);
+    return offset;
+  }
+
+  void end_block(size_t offset)
+  {
+    const uint64_t size = data.size() - offset - sizeof(uint64_t);
+    memcpy(&data[offset], &size, sizeof(size));
+  }
+
+  void add_node(const Node *node)
+  {
+    const int id = node_ids.size();
+    node_ids[node] = id;
+  }
+
+  int node_id(const Node *node) const
+  {
+    map<const Node *, int>::const_iterator it = node_ids.find(node);
+    return (it != node_ids.end()) ? it->second : -1;
+  }
+};
+
+template<typename T> static void binary_write_array(BinaryWriter &writer, const array<T> &value)
+{
+  writer.write_value<uint64_t>(value.size());
+  writer.write(value.data(), sizeof(T) * value.size());
+}
+
+template<typename T>
+static void binary_write_socket_array(BinaryWriter &writer, const array<T> &value)
+{
+  writer.write(value.data(), sizeof(T) * value.size());
+}
+
+static void binary_write_node(BinaryWriter &writer, Node *node)
+{
+  writer.write_string(node->type->name.string());
+  writer.write_string(node->name.string());
+
+  foreach (const SocketType &socket, node->type->inputs) {
+    if (socket.type == SocketType::CLOSURE || socket.type == SocketType::UNDEFINED) {
+      continue;
+    }
+    if (socket.flags & SocketType::INTERNAL) {
+      continue;
+    }
+    if (node->has_default_value(socket)) {
+      continue;
+    }
+
+    writer.write_string(socket.name.string());
+    writer.write_value<uint8_t>(socket.type);
+    const size_t block = writer.begin_block();
+
+    switch (socket.type) {
+      case SocketType::BOOLEAN:
+        writer.write_value<uint8_t>(node->get_bool(socket));
+        break;
+      case SocketType::FLOAT:
+        writer.write_value(node->get_float(socket));
+        break;
+      case SocketType::INT:
+      case SocketType::ENUM:
+        writer.write_value(node->get_int(socket));
+        break;
+      case SocketType::UINT:
+        writer.write_value(node->get_uint(socket));
+        break;
+      case SocketType::COLOR:
+      case SocketType::VECTOR:
+      case SocketType::POINT:
+      case SocketType::NORMAL:
+        writer.write_value(node->get_float3(socket));
+        break;
+      case SocketType::POINT2:
+        writer.write_value(node->get_float2(socket));
+        break;
+      case SocketType::STRING:
+        writer.write_string(node->get_string(socket).string());
+        break;
+      case SocketType::TRANSFORM:
+        writer.write_value(node->get_transform(socket));
+        break;
+      case SocketType::NODE:
+        writer.write_value<int32_t>(writer.node_id(node->get_node(socket)));
+        break;
+      case SocketType::BOOLEAN_ARRAY:
+        binary_write_socket_array(writer, node->get_bool_array(socket));
+        break;
+      case SocketType::FLOAT_ARRAY:
+        binary_write_socket_array(writer, node->get_float_array(socket));
+        break;
+      case SocketType::INT_ARRAY:
+        binary_write_socket_array(writer, node->get_int_array(socket));
+        break;
+      case SocketType::COLOR_ARRAY:
+      case SocketType::VECTOR_ARRAY:
+      case SocketType::POINT_ARRAY:
+      case SocketType::NORMAL_ARRAY:
+        binary_write_socket_array(writer, node->get_float3_array(socket));
+        break;
+      case SocketType::POINT2_ARRAY:
+        binary_write_socket_array(writer, node->get_float2_array(socket));
+        break;
+      case SocketType::STRING_ARRAY: {
+        const array<ustring> &value = node->get_string_array(socket);
+        for (size_t i = 0; i < value.size(); i++) {
+          writer.write_string(value[i].string());
+        }
+        break;
+      }
+      case SocketType::TRANSFORM_ARRAY:
+        binary_write_socket_array(writer, node->get_transform_array(socket));
+        break;
+      case SocketType::NODE_ARRAY: {
+        const array<Node *> &value = node->get_node_array(socket);
+        for (size_t i = 0; i < value.size(); i++) {
+          writer.write_value<int32_t>(writer.node_id(value[i]));
+        }
+        break;
+      }
+      case SocketType::CLOSURE:
+      case SocketType::UNDEFINED:
+        break;
+    }
+
+    writer.end_block(block);
+  }
+
+  /* Empty socket name terminates the list. */
+  writer.write_string(string());
+}
+
+static void binary_write_shader(BinaryWriter &writer, Shader *shader, int default_index)
+{
+  writer.write_value<int32_t>(default_index);
+  binary_write_node(writer, shader);
+  writer.add_node(shader);
+
+  /* Graph nodes, referenced by their index in the links. */
+  vector<ShaderNode *> nodes;
+  map<ShaderNode *, int> node_index;
+
+  if (shader->graph) {
+    foreach (ShaderNode *node, shader->graph->nodes) {
+      if (node->special_type == SHADER_SPECIAL_TYPE_OSL || node->type->create == NULL) {
+        fprintf(stderr,
+                "Shader node \"%s\" can't be written to binary scene files, skipping.\n",
+                node->type->name.c_str());
+        continue;
+      }
+
+      node_index[node] = nodes.size();
+      nodes.push_back(node);
+    }
+  }
+
+  writer.write_value<uint32_t>(nodes.size());
+  foreach (ShaderNode *node, nodes) {
+    binary_write_node(writer, node);
+  }
+
+  /* Links. */
+  vector<ShaderInput *> links;
+  foreach (ShaderNode *node, nodes) {
+    foreach (ShaderInput *input, node->inputs) {
+      if (input->link && node_index.find(input->link->parent) != node_index.end()) {
+        links.push_back(input);
+      }
+    }
+  }
+
+  writer.write_value<uint32_t>(links.size());
+  foreach (ShaderInput *input, links) {
+    writer.write_value<int32_t>(node_index[input->link->parent]);
+    writer.write_string(input->link->name().string());
+    writer.write_value<int32_t>(node_index[input->parent]);
+    writer.write_string(input->name().string());
+  }
+}
+
+static void binary_write_attributes(BinaryWriter &writer, const AttributeSet &attributes)
+{
+  /* Voxel attributes only store an image handle, volumes are not supported. */
+  uint32_t num_attributes = 0;
+  foreach (const Attribute &attr, attributes.attributes) {
+    num_attributes += (attr.element != ATTR_ELEMENT_VOXEL);
+  }
+
+  writer.write_value<uint32_t>(num_attributes);
+  foreach (const Attribute &attr, attributes.attributes) {
+    if (attr.element == ATTR_ELEMENT_VOXEL) {
+      continue;
+    }
+
+    writer.write_string(attr.name.string());
+    writer.write_value<int32_t>(attr.std);
+    writer.write_value<uint8_t>(attr.type.basetype);
+    writer.write_value<uint8_t>(attr.type.aggregate);
+    writer.write_value<uint8_t>(attr.type.vecsemantics);
+    writer.write_value<int32_t>(attr.type.arraylen);
+    writer.write_value<int32_t>(attr.element);
+    writer.write_value<uint32_t>(attr.flags);
+    writer.write_value<uint64_t>(attr.buffer.size());
+    writer.write(attr.buffer.data(), attr.buffer.size());
+  }
+}
+
+static void binary_write_mesh(BinaryWriter &writer, Mesh *mesh)
+{
+  binary_write_node(writer, mesh);
+  writer.add_node(mesh);
+
+  writer.write_value<uint32_t>(mesh->used_shaders.size());
+  foreach (Shader *shader, mesh->used_shaders) {
+    writer.write_value<int32_t>(writer.node_id(shader));
+  }
+
+  writer.write_value<int32_t>(mesh->subdivision_type);
+  binary_write_array(writer, mesh->subd_faces);
+  binary_write_array(writer, mesh->subd_face_corners);
+  binary_write_array(writer, mesh->subd_creases);
+  writer.write_value<int32_t>(mesh->num_ngons);
+
+  writer.write_value<uint8_t>(mesh->subd_params != NULL);
+  if (mesh->subd_params) {
+    writer.write_value(mesh->subd_params->dicing_rate);
+    writer.write_value<int32_t>(mesh->subd_params->max_level);
+    writer.write_value(mesh->subd_params->objecttoworld);
+  }
+
+  binary_write_attributes(writer, mesh->attributes);
+  binary_write_attributes(writer, mesh->subd_attributes);
+}
+
+/* Reader */
+
+struct BinaryReader {
+  BinaryReader(const uint8_t *data, size_t size) : data(data), end(data + size)
+  {
+  }
+
+  const uint8_t *data;
+  const uint8_t *end;
+  vector<Node *> nodes;
+  string error;
+
+  bool ok() const
+  {
+    return error.empty();
+  }
+
+  void set_error(const string &message)
+  {
+    if (error.empty()) {
+      error = message;
+    }
+  }
+
+  /* Check that num elements of the given size fit in the remaining data, before allocating
+   * memory for them. */
+  bool check_size(uint64_t num, size_t element_size)
+  {
+    if (ok() && num > (uint64_t)(end - data) / element_size) {
+      set_error("unexpected end of file");
+    }
+    return ok();
+  }
+
+  bool read(void *ptr, size_t size)
+  {
+    if (!check_size(size, 1)) {
+      return false;
+    }
+    if (size) {
+      memcpy(ptr, data, size);
+      data += size;
+    }
+    return true;
+  }
+
+  template<typename T> T read_value()
+  {
+    T value = T();
+    read(&value, sizeof(T));
+    return value;
+  }
+
+  string read_string()
+  {
+    const uint32_t size = read_value<uint32_t>();
+    if (!check_size(size, 1)) {
+      return string();
+    }
+
+    string str((const char *)data, size);
+    data += size;
+    return str;
+  }
+
+  Node *node(int id, const NodeType *type)
+  {
+    if (id < 0 || id >= (int)nodes.size()) {
+      return NULL;
+    }
+    return nodes[id]->is_a(type) ? nodes[id] : NULL;
+  }
+};
+
+template<typename T> static void binary_read_array(BinaryReader &reader, array<T> &value)
+{
+  const uint64_t num = reader.read_value<uint64_t>();
+  if (!reader.check_size(num, sizeof(T))) {
+    return;
+  }
+
+  value.resize(num);
+  reader.read(value.data(), sizeof(T) * num);
+}
+
+template<typename T>
+static void binary_read_socket_array(BinaryReader &reader,
+                                     Node *node,
+                                     const SocketType &socket,
+                                     size_t size)
+{
+  if (size % sizeof(T) != 0) {
+    reader.set_error(string_printf("invalid size of socket \"%s\"", socket.name.c_str()));
+    return;
+  }
+
+  array<T> value;
+  value.resize(size / sizeof(T));
+  if (reader.read(value.data(), size)) {
+    node->set(socket, value);
+  }
+}
+
+static void binary_read_socket(BinaryReader &reader,
+                               Node *node,
+                               const SocketType &socket,
+                               size_t size)
+{
+  const uint8_t *block_end = reader.data + size;
+
+  switch (socket.type) {
+    case SocketType::BOOLEAN:
+      node->set(socket, reader.read_value<uint8_t>() != 0);
+      break;
+    case SocketType::FLOAT:
+      node->set(socket, reader.read_value<float>());
+      break;
+    case SocketType::INT:
+    case SocketType::ENUM:
+      node->set(socket, reader.read_value<int>());
+      break;
+    case SocketType::UINT:
+      node->set(socket, reader.read_value<uint>());
+      break;
+    case SocketType::COLOR:
+    case SocketType::VECTOR:
+    case SocketType::POINT:
+    case SocketType::NORMAL:
+      node->set(socket, reader.read_value<float3>());
+      break;
+    case SocketType::POINT2:
+      node->set(socket, reader.read_value<float2>());
+      break;
+    case SocketType::STRING:
+      node->set(socket, ustring(reader.read_string()));
+      break;
+    case SocketType::TRANSFORM:
+      node->set(socket, reader.read_value<Transform>());
+      break;
+    case SocketType::NODE:
+      node->set(socket, reader.node(reader.read_value<int32_t>(), *(socket.node_type)));
+      break;
+    case SocketType::BOOLEAN_ARRAY:
+      binary_read_socket_array<bool>(reader, node, socket, size);
+      break;
+    case SocketType::FLOAT_ARRAY:
+      binary_read_socket_array<float>(reader, node, socket, size);
+      break;
+    case SocketType::INT_ARRAY:
+      binary_read_socket_array<int>(reader, node, socket, size);
+      break;
+    case SocketType::COLOR_ARRAY:
+    case SocketType::VECTOR_ARRAY:
+    case SocketType::POINT_ARRAY:
+    case SocketType::NORMAL_ARRAY:
+      binary_read_socket_array<float3>(reader, node, socket, size);
+      break;
+    case SocketType::POINT2_ARRAY:
+      binary_read_socket_array<float2>(reader, node, socket, size);
+      break;
+    case SocketType::STRING_ARRAY: {
+      vector<ustring> strings;
+      while (reader.ok() && reader.data < block_end) {
+        strings.push_back(ustring(reader.read_string()));
+      }
+
+      array<ustring> value;
+      value.resize(strings.size());
+      for (size_t i = 0; i < strings.size(); i++) {
+        value[i] = strings[i];
+      }
+      node->set(socket, value);
+      break;
+    }
+    case SocketType::TRANSFORM_ARRAY:
+      binary_read_socket_array<Transform>(reader, node, socket, size);
+      break;
+    case SocketType::NODE_ARRAY: {
+      array<Node *> value;
+      value.resize(size / sizeof(int32_t));
+      for (size_t i = 0; i < value.size(); i++) {
+        value[i] = reader.node(reader.read_value<int32_t>(), *(socket.node_type));
+      }
+      node->set(socket, value);
+      break;
+    }
+    case SocketType::CLOSURE:
+    case SocketType::UNDEFINED:
+      break;
+  }
+
+  if (reader.ok() && reader.data != block_end) {
+    reader.set_error(string_printf("invalid size of socket \"%s\"", socket.name.c_str()));
+  }
+}
+
+static const NodeType *binary_read_node_type(BinaryReader &reader)
+{
+  const string name = reader.read_string();
+  if (!reader.ok()) {
+    return NULL;
+  }
+
+  const NodeType *type = NodeType::find(ustring(name));
+  if (type == NULL) {
+    reader.set_error(string_printf("unknown node type \"%s\"", name.c_str()));
+  }
+  return type;
+}
+
+/* Read name and sockets of a node, after its type. */
+static void binary_read_node(BinaryReader &reader, Node *node)
+{
+  node->name = ustring(reader.read_string());
+
+  while (reader.ok()) {
+    const string socket_name = reader.read_string();
+    if (socket_name.empty()) {
+      break;
+    }
+
+    const SocketType::Type socket_type = (SocketType::Type)reader.read_value<uint8_t>();
+    const uint64_t size = reader.read_value<uint64_t>();
+    if (!reader.check_size(size, 1)) {
+      break;
+    }
+
+    const SocketType *socket = node->type->find_input(ustring(socket_name));
+    if (socket == NULL || socket->type != socket_type) {
+      fprintf(stderr,
+              "Unknown socket \"%s\" on \"%s\", skipping.\n",
+              socket_name.c_str(),
+              node->type->name.c_str());
+      reader.data += size;
+      continue;
+    }
+
+    binary_read_socket(reader, node, *socket, size);
+  }
+}
+
+static void binary_read_scene_node(BinaryReader &reader, Node *node)
+{
+  const NodeType *type = binary_read_node_type(reader);
+  if (reader.ok() && type != node->type) {
+    reader.set_error(string_printf("expected \"%s\" node", node->type->name.c_str()));
+    return;
+  }
+
+  binary_read_node(reader, node);
+}
+
+template<typename T> static T *binary_read_new_node(BinaryReader &reader)
+{
+  T *node = new T();
+  binary_read_scene_node(reader, node);
+
+  if (!reader.ok()) {
+    delete node;
+    return NULL;
+  }
+  return node;
+}
+
+static ShaderGraph *binary_read_shader_graph(BinaryReader &reader)
+{
+  const uint32_t num_nodes = reader.read_value<uint32_t>();
+  if (num_nodes == 0) {
+    return NULL;
+  }
+
+  ShaderGraph *graph = new ShaderGraph();
+  vector<ShaderNode *> nodes;
+
+  for (uint32_t i = 0; i < num_nodes && reader.ok(); i++) {
+    const NodeType *node_type = binary_read_node_type(reader);
+    if (!reader.ok()) {
+      break;
+    }
+
+    ShaderNode *snode;
+    if (node_type == graph->output()->type) {
+      snode = graph->output();
+    }
+    else if (node_type->type == NodeType::SHADER && node_type->create != NULL) {
+      snode = graph->add((ShaderNode *)node_type->create(node_type));
+    }
+    else {
+      reader.set_error(string_printf("invalid shader node \"%s\"", node_type->name.c_str()));
+      break;
+    }
+
+    binary_read_node(reader, snode);
+    nodes.push_back(snode);
+  }
+
+  const uint32_t num_links = reader.read_value<uint32_t>();
+
+  for (uint32_t i = 0; i < num_links && reader.ok(); i++) {
+    const int from_index = reader.read_value<int32_t>();
+    const ustring from_socket_name(reader.read_string());
+    const int to_index = reader.read_value<int32_t>();
+    const ustring to_socket_name(reader.read_string());
+
+    if (!reader.ok()) {
+      break;
+    }
+    if (from_index < 0 || from_index >= (int)nodes.size() || to_index < 0 ||
+        to_index >= (int)nodes.size()) {
+      reader.set_error("invalid shader node link");
+      break;
+    }
+
+    ShaderOutput *output = nodes[from_index]->output(from_socket_name);
+    ShaderInput *input = nodes[to_index]->input(to_socket_name);
+
+    if (output == NULL || input == NULL) {
+      reader.set_error(string_printf("invalid shader node link from \"%s\" to \"%s\"",
+                                     from_socket_name.c_str(),
+                                     to_socket_name.c_str()));
+      break;
+    }
+
+    graph->connect(output, input);
+  }
+
+  if (!reader.ok()) {
+    delete graph;
+    return NULL;
+  }
+
+  return graph;
+}
+
+static void binary_read_shader(BinaryReader &reader, Scene *scene)
+{
+  Shader *default_shaders[5];
+  binary_default_shaders(scene, default_shaders);
+
+  const int default_index = reader.read_value<int32_t>();
+  if (default_index >= 5) {
+    reader.set_error("invalid default shader");
+    return;
+  }
+
+  Shader *shader = (default_index >= 0) ? default_shaders[default_index] : new Shader();
+  binary_read_scene_node(reader, shader);
+
+  ShaderGraph *graph = binary_read_shader_graph(reader);
+
+  if (!reader.ok()) {
+    if (default_index < 0) {
+      delete shader;
+    }
+    return;
+  }
+
+  if (graph) {
+    shader->set_graph(graph);
+  }
+  shader->tag_update(scene);
+
+  if (default_index < 0) {
+    scene->shaders.push_back(shader);
+  }
+  reader.nodes.push_back(shader);
+}
+
+static void binary_read_attributes(BinaryReader &reader, AttributeSet &attributes)
+{
+  const uint32_t num_attributes = reader.read_value<uint32_t>();
+
+  for (uint32_t i = 0; i < num_attributes && reader.ok(); i++) {
+    const ustring name(reader.read_string());
+    const AttributeStandard std = (AttributeStandard)reader.read_value<int32_t>();
+    const uint8_t basetype = reader.read_value<uint8_t>();
+    const uint8_t aggregate = reader.read_value<uint8_t>();
+    const uint8_t vecsemantics = reader.read_value<uint8_t>();
+    const int arraylen = reader.read_value<int32_t>();
+    const AttributeElement element = (AttributeElement)reader.read_value<int32_t>();
+    const uint flags = reader.read_value<uint32_t>();
+    const uint64_t size = reader.read_value<uint64_t>();
+
+    if (!reader.check_size(size, 1)) {
+      break;
+    }
+
+    const TypeDesc type((TypeDesc::BASETYPE)basetype,
+                        (TypeDesc::AGGREGATE)aggregate,
+                        (TypeDesc::VECSEMANTICS)vecsemantics,
+                        arraylen);
+
+    Attribute *attr = attributes.add(name, type, element);
+    attr->std = std;
+    attr->flags = flags;
+    attr->buffer.resize(size);
+    reader.read(attr->data(), size);
+  }
+}
+
+static void binary_read_mesh(BinaryReader &reader, Scene *scene)
+{
+  Mesh *mesh = binary_read_new_node<Mesh>(reader);
+  if (mesh == NULL) {
+    return;
+  }
+
+  const uint32_t num_used_shaders = reader.read_value<uint32_t>();
+  for (uint32_t i = 0; i < num_used_shaders && reader.ok(); i++) {
+    Node *shader = reader.node(reader.read_value<int32_t>(), Shader::node_type);
+    mesh->used_shaders.push_back(shader ? static_cast<Shader *>(shader) :
+                                          scene->default_surface);
+  }
+
+  /* Subdivision data is set before the attributes, which are sized from it. */
+  mesh->subdivision_type = (Mesh::SubdivisionType)reader.read_value<int32_t>();
+  binary_read_array(reader, mesh->subd_faces);
+  binary_read_array(reader, mesh->subd_face_corners);
+  binary_read_array(reader, mesh->subd_creases);
+  mesh->num_ngons = reader.read_value<int32_t>();
+
+  if (reader.read_value<uint8_t>()) {
+    mesh->subd_params = new SubdParams(mesh);
+    mesh->subd_params->dicing_rate = reader.read_value<float>();
+    mesh->subd_params->max_level = reader.read_value<int32_t>();
+    mesh->subd_params->objecttoworld = reader.read_value<Transform>();
+  }
+
+  binary_read_attributes(reader, mesh->attributes);
+  binary_read_attributes(reader, mesh->subd_attributes);
+
+  if (!reader.ok()) {
+    delete mesh;
+    return;
+  }
+
+  scene->geometry.push_back(mesh);
+  reader.nodes.push_back(mesh);
+}
+
+static void binary_read_object(BinaryReader &reader, Scene *scene)
+{
+  Object *object = binary_read_new_node<Object>(reader);
+  if (object == NULL) {
+    return;
+  }
+
+  if (object->geometry == NULL) {
+    fprintf(stderr, "Object \"%s\" without geometry, skipping.\n", object->name.c_str());
+    delete object;
+    return;
+  }
+
+  scene->objects.push_back(object);
+}
+
+static void binary_read_camera(BinaryReader &reader, Scene *scene)
+{
+  Camera *cam = scene->camera;
+
+  cam->width = reader.read_value<int32_t>();
+  cam->height = reader.read_value<int32_t>();
+  cam->full_width = cam->width;
+  cam->full_height = cam->height;
+
+  binary_read_scene_node(reader, cam);
+
+  cam->need_update = true;
+  cam->update(scene);
+}
+
+/* File */
+
+bool binary_is_scene_file(const char *filepath)
+{
+  FILE *f = path_fopen(filepath, "rb");
+  if (f == NULL) {
+    return false;
+  }
+
+  char magic[sizeof(binary_scene_magic)];
+  const bool is_scene = fread(magic, sizeof(magic), 1, f) == 1 &&
+                        memcmp(magic, binary_scene_magic, sizeof(magic)) == 0;
+
+  fclose(f);
+  return is_scene;
+}
+
+bool binary_read_file(Scene *scene, const char *filepath)
+{
+  BinaryMappedFile file(filepath);
+
+  if (file.data == NULL) {
+    fprintf(stderr, "%s read error: failed to open file\n", filepath);
+    return false;
+  }
+
+  BinaryReader reader(file.data, file.size);
+
+  BinarySceneHeader header, expected_header;
+  binary_scene_header_init(&expected_header);
+
+  if (!reader.read(&header, sizeof(header)) ||
+      memcmp(header.magic, expected_header.magic, sizeof(header.magic)) != 0) {
+    reader.set_error("not a binary scene file");
+  }
+  else if (header.version != expected_header.version) {
+    reader.set_error(string_printf("unsupported version %u", header.version));
+  }
+  else if (header.float3_size != expected_header.float3_size ||
+           header.subd_face_size != expected_header.subd_face_size) {
+    reader.set_error("file was written by an incompatible build");
+  }
+
+  while (reader.ok()) {
+    const uint32_t record = reader.read_value<uint32_t>();
+    if (!reader.ok() || record == BINARY_RECORD_END) {
+      break;
+    }
+
+    switch (record) {
+      case BINARY_RECORD_SHADER:
+        binary_read_shader(reader, scene);
+        break;
+      case BINARY_RECORD_FILM:
+        binary_read_scene_node(reader, scene->film);
+        break;
+      case BINARY_RECORD_INTEGRATOR:
+        binary_read_scene_node(reader, scene->integrator);
+        break;
+      case BINARY_RECORD_CAMERA:
+        binary_read_camera(reader, scene);
+        break;
+      case BINARY_RECORD_BACKGROUND:
+        binary_read_scene_node(reader, scene->background);
+        break;
+      case BINARY_RECORD_MESH:
+        binary_read_mesh(reader, scene);
+        break;
+      case BINARY_RECORD_OBJECT:
+        binary_read_object(reader, scene);
+        break;
+      case BINARY_RECORD_LIGHT: {
+        Light *light = binary_read_new_node<Light>(reader);
+        if (light) {
+          scene->lights.push_back(light);
+        }
+        break;
+      }
+      default:
+        reader.set_error(string_printf("unknown record type %u", record));
+        break;
+    }
+  }
+
+  if (!reader.ok()) {
+    fprintf(stderr, "%s read error: %s\n", filepath, reader.error.c_str());
+    return false;
+  }
+
+  scene->params.bvh_type = SceneParams::BVH_STATIC;
+
+  return true;
+}
+
+bool binary_write_file(Scene *scene, const char *filepath)
+{
+  BinaryWriter writer;
+
+  BinarySceneHeader header;
+  binary_scene_header_init(&header);
+  writer.write_value(header);
+
+  /* Shaders first, they are referenced by all other nodes. */
+  Shader *default_shaders[5];
+  binary_default_shaders(scene, default_shaders);
+
+  foreach (Shader *shader, scene->shaders) {
+    int default_index = -1;
+    for (int i = 0; i < 5; i++) {
+      if (shader == default_shaders[i]) {
+        default_index = i;
+      }
+    }
+
+    writer.write_value<uint32_t>(BINARY_RECORD_SHADER);
+    binary_write_shader(writer, shader, default_index);
+  }
+
+  writer.write_value<uint32_t>(BINARY_RECORD_FILM);
+  binary_write_node(writer, scene->film);
+
+  writer.write_value<uint32_t>(BINARY_RECORD_INTEGRATOR);
+  binary_write_node(writer, scene->integrator);
+
+  writer.write_value<uint32_t>(BINARY_RECORD_CAMERA);
+  writer.write_value<int32_t>(scene->camera->width);
+  writer.write_value<int32_t>(scene->camera->height);
+  binary_write_node(writer, scene->camera);
+
+  writer.write_value<uint32_t>(BINARY_RECORD_BACKGROUND);
+  binary_write_node(writer, scene->background);
+
+  foreach (Geometry *geom, scene->geometry) {
+    if (geom->type != Geometry::MESH) {
+      fprintf(stderr,
+              "Geometry \"%s\" can't be written to binary scene files, skipping.\n",
+              geom->name.c_str());
+      continue;
+    }
+
+    writer.write_value<uint32_t>(BINARY_RECORD_MESH);
+    binary_write_mesh(writer, static_cast<Mesh *>(geom));
+  }
+
+  foreach (Object *object, scene->objects) {
+    if (writer.node_id(object->geometry) == -1) {
+      continue;
+    }
+
+    writer.write_value<uint32_t>(BINARY_RECORD_OBJECT);
+    binary_write_node(writer, object);
+  }
+
+  foreach (Light *light, scene->lights) {
+    writer.write_value<uint32_t>(BINARY_RECORD_LIGHT);
+    binary_write_node(writer, light);
+  }
+
+  writer.write_value<uint32_t>(BINARY_RECORD_END);
+
+  if (!path_write_binary(filepath, writer.data)) {
+    fprintf(stderr, "%s write error: failed to write file\n", filepath);
+    return false;
+  }
+
+  return true;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CYCLES_BINARY_H__
+#define __CYCLES_BINARY_H__
+
+CCL_NAMESPACE_BEGIN
+
+class Scene;
+
+/* Binary scene files store the same scene data as the XML files, with node sockets and
+ * geometry arrays in native memory layout, so loading is mostly copying from a memory mapped
+ * file. They are only meant to be read by the build that wrote them, image file paths are
+ * stored as they were resolved when writing. */
+
+bool binary_is_scene_file(const char *filepath);
+bool binary_read_file(Scene *scene, const char *filepath);
+bool binary_write_file(Scene *scene, const char *filepath);
+
+CCL_NAMESPACE_END
+
+#endif /* __CYCLES_BINARY_H__ */
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include "app/cycles_output.h"
+
+#include "util/util_foreach.h"
+#include "util/util_half.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+TiledOutput::TiledOutput()
+    : width(0), height(0), full_x(0), full_y(0), tile_size(make_int2(0, 0)), pixel_bytes(0)
+{
+}
+
+TiledOutput::~TiledOutput()
+{
+  close();
+}
+
+bool TiledOutput::supported(const string &filepath)
+{
+  return filepath.size() > 4 && string_iequals(filepath.substr(filepath.size() - 4), ".exr");
+}
+
+bool TiledOutput::open(const string &filepath_, const BufferParams &params, int2 tile_size_)
+{
+  close();
+
+  filepath = filepath_;
+  width = params.width;
+  height = params.height;
+  full_x = params.full_x;
+  full_y = params.full_y;
+  tile_size = make_int2(min(tile_size_.x, width), min(tile_size_.y, height));
+
+  /* Channels of all named passes, unnamed ones are only used to compute other passes. */
+  std::vector<std::string> channelnames;
+  std::vector<TypeDesc> channelformats;
+  int alpha_channel = -1;
+
+  passes.clear();
+  pixel_bytes = 0;
+
+  foreach (const Pass &pass, params.passes) {
+    if (pass.name.empty()) {
+      continue;
+    }
+
+    OutputPass output_pass;
+    output_pass.pass = pass;
+    output_pass.components = get_pass_read_components(pass);
+    output_pass.storage = get_pass_storage_type(pass);
+    output_pass.offset = pixel_bytes;
+
+    TypeDesc format = TypeDesc::FLOAT;
+    if (output_pass.storage == PASS_STORAGE_HALF) {
+      format = TypeDesc::HALF;
+    }
+    else if (output_pass.storage == PASS_STORAGE_UINT) {
+      format = TypeDesc::UINT32;
+    }
+
+    const char *channel_ids = (output_pass.storage == PASS_STORAGE_HALF) ? "RGBA" : "XYZW";
+
+    for (int c = 0; c < output_pass.components; c++) {
+      /* Combined pass is stored in the default layer, for readers without layer support. */
+      if (pass.type == PASS_COMBINED) {
+        channelnames.push_back(string(1, channel_ids[c]));
+        if (c == 3) {
+          alpha_channel = channelnames.size() - 1;
+        }
+      }
+      else {
+        channelnames.push_back(string(pass.name.c_str()) + "." + channel_ids[c]);
+      }
+
+      channelformats.push_back(format);
+      pixel_bytes += format.size();
+    }
+
+    passes.push_back(output_pass);
+  }
+
+  if (passes.empty()) {
+    fprintf(stderr, "No named passes to write to %s.\n", filepath.c_str());
+    return false;
+  }
+
+  ImageSpec spec(width, height, channelnames.size(), TypeDesc::FLOAT);
+  spec.channelnames = channelnames;
+  spec.channelformats = channelformats;
+  spec.alpha_channel = alpha_channel;
+  spec.tile_width = tile_size.x;
+  spec.tile_height = tile_size.y;
+  spec.attribute("compression", "zip");
+  /* Tiles are written in the order they finish rendering. */
+  spec.attribute("openexr:lineOrder", "randomY");
+
+  out = unique_ptr<ImageOutput>(ImageOutput::create(filepath));
+  if (!out) {
+    fprintf(stderr, "Failed to create output for %s.\n", filepath.c_str());
+    return false;
+  }
+
+  if (!out->supports("tiles") || !out->open(filepath, spec)) {
+    fprintf(stderr,
+            "Failed to open %s for tiled writing: %s\n",
+            filepath.c_str(),
+            out->geterror().c_str());
+    out.reset();
+    return false;
+  }
+
+  return true;
+}
+
+void TiledOutput::write_tile(RenderTile &rtile, float exposure)
+{
+  RenderBuffers *buffers = rtile.buffers;
+
+  if (!out || !buffers->copy_from_device()) {
+    return;
+  }
+
+  const int x = rtile.x - full_x;
+  const int y = rtile.y - full_y;
+  const int w = rtile.w;
+  const int h = rtile.h;
+
+  /* Rows in the file are counted from the top. */
+  const int file_y = height - (y + h);
+
+  vector<vector<float>> pass_pixels(passes.size());
+  for (size_t i = 0; i < passes.size(); i++) {
+    const OutputPass &output_pass = passes[i];
+    pass_pixels[i].resize(w * h * output_pass.components, 0.0f);
+
+    buffers->get_pass_rect(output_pass.pass.name.c_str(),
+                           exposure,
+                           rtile.sample,
+                           output_pass.components,
+                           pass_pixels[i].data());
+  }
+
+  /* Copy into all file tiles covered by the render tile. */
+  const int num_tiles_x = divide_up(width, tile_size.x);
+
+  for (int ty = file_y / tile_size.y; ty <= (file_y + h - 1) / tile_size.y; ty++) {
+    for (int tx = x / tile_size.x; tx <= (x + w - 1) / tile_size.x; tx++) {
+      const int tile_x = tx * tile_size.x;
+      const int tile_y = ty * tile_size.y;
+      const int x0 = max(x, tile_x);
+      const int x1 = min(x + w, tile_x + tile_size.x);
+      const int y0 = max(file_y, tile_y);
+      const int y1 = min(file_y + h, tile_y + tile_size.y);
+
+      FileTile &file_tile = file_tiles[ty * num_tiles_x + tx];
+      if (file_tile.pixels.empty()) {
+        file_tile.pixels.resize(tile_size.x * tile_size.y * pixel_bytes, 0);
+        file_tile.num_written = 0;
+      }
+
+      for (size_t i = 0; i < passes.size(); i++) {
+        const OutputPass &output_pass = passes[i];
+        const int components = output_pass.components;
+
+        for (int fy = y0; fy < y1; fy++) {
+          /* Flip back to the row in the render tile. */
+          const int row = (file_y + h - 1) - fy;
+          const float *in = pass_pixels[i].data() + (row * w + (x0 - x)) * components;
+          uchar *pixel = file_tile.pixels.data() +
+                         ((fy - tile_y) * tile_size.x + (x0 - tile_x)) * pixel_bytes +
+                         output_pass.offset;
+
+          for (int fx = x0; fx < x1; fx++, pixel += pixel_bytes) {
+            uchar *channel = pixel;
+
+            for (int c = 0; c < components; c++, in++) {
+              if (output_pass.storage == PASS_STORAGE_HALF) {
+                const half value = float_to_half(*in);
+                memcpy(channel, &value, sizeof(value));
+                channel += sizeof(value);
+              }
+              else if (output_pass.storage == PASS_STORAGE_UINT) {
+                const uint value = (uint)max(*in, 0.0f);
+                memcpy(channel, &value, sizeof(value));
+                channel += sizeof(value);
+              }
+              else {
+                memcpy(channel, in, sizeof(float));
+                channel += sizeof(float);
+              }
+            }
+          }
+        }
+      }
+
+      file_tile.num_written += (x1 - x0) * (y1 - y0);
+
+      /* Tiles at the right and bottom border may be partial. */
+      const int tile_w = min(tile_size.x, width - tile_x);
+      const int tile_h = min(tile_size.y, height - tile_y);
+
+      if (file_tile.num_written == tile_w * tile_h) {
+        write_file_tile(tile_x, tile_y, file_tile);
+        file_tiles.erase(ty * num_tiles_x + tx);
+      }
+    }
+  }
+}
+
+void TiledOutput::write_file_tile(int x, int y, FileTile &file_tile)
+{
+  if (!out->write_tile(x, y, 0, TypeDesc::UNKNOWN, file_tile.pixels.data())) {
+    fprintf(stderr, "Failed to write tile to %s: %s\n", filepath.c_str(), out->geterror().c_str());
+  }
+}
+
+bool TiledOutput::close()
+{
+  if (!out) {
+    return true;
+  }
+
+  /* Write tiles that were not finished, for cancelled renders. */
+  const int num_tiles_x = divide_up(width, tile_size.x);
+
+  for (map<int, FileTile>::iterator it = file_tiles.begin(); it != file_tiles.end(); it++) {
+    write_file_tile((it->first % num_tiles_x) * tile_size.x,
+                    (it->first / num_tiles_x) * tile_size.y,
+                    it->second);
+  }
+  file_tiles.clear();
+
+  const bool success = out->close();
+  if (!success) {
+    fprintf(stderr, "Failed to write %s: %s\n", filepath.c_str(), out->geterror().c_str());
+  }
+
+  out.reset();
+  return success;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CYCLES_OUTPUT_H__
+#define __CYCLES_OUTPUT_H__
+
+#include "render/buffers.h"
+
+#include "util/util_image.h"
+#include "util/util_map.h"
+#include "util/util_string.h"
+#include "util/util_unique_ptr.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Tiled Output
+ *
+ * Writes render tiles to a tiled multichannel EXR file as they are finished, so the render
+ * buffers of a tile can be freed right away and the full frame is never in memory. Every named
+ * pass gets its own channels, stored with the precision from get_pass_storage_type().
+ *
+ * Render tiles are counted from the bottom of the image and file tiles from the top, so a render
+ * tile may cover parts of multiple file tiles. File tiles are kept in memory until all their
+ * pixels were written. */
+
+class TiledOutput {
+ public:
+  TiledOutput();
+  ~TiledOutput();
+
+  static bool supported(const string &filepath);
+
+  bool open(const string &filepath, const BufferParams &params, int2 tile_size);
+  void write_tile(RenderTile &rtile, float exposure);
+  bool close();
+
+ protected:
+  struct OutputPass {
+    Pass pass;
+    int components;
+    PassStorageType storage;
+    int offset;
+  };
+
+  struct FileTile {
+    vector<uchar> pixels;
+    int num_written;
+  };
+
+  void write_file_tile(int x, int y, FileTile &file_tile);
+
+  unique_ptr<ImageOutput> out;
+  string filepath;
+  int width, height;
+  int full_x, full_y;
+  int2 tile_size;
+
+  vector<OutputPass> passes;
+  size_t pixel_bytes;
+  map<int, FileTile> file_tiles;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __CYCLES_OUTPUT_H__ */
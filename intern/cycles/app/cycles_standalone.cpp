@@ -19,13 +19,17 @@
 #include "device/device.h"
 #include "render/buffers.h"
 #include "render/camera.h"
+#include "render/film.h"
 #include "render/integrator.h"
 #include "render/scene.h"
 #include "render/session.h"
+#include "render/stats.h"
 
 #include "util/util_args.h"
+#include "util/util_debug.h"
 #include "util/util_foreach.h"
 #include "util/util_function.h"
+#include "util/util_guarded_allocator.h"
 #include "util/util_image.h"
 #include "util/util_logging.h"
 #include "util/util_path.h"
@@ -40,6 +44,8 @@
 #  include "util/util_view.h"
 #endif
 
+#include "app/cycles_binary.h"
+#include "app/cycles_output.h"
 #include "app/cycles_xml.h"
 
 CCL_NAMESPACE_BEGIN
@@ -54,6 +60,13 @@ struct Options {
   bool quiet;
   bool show_help, interactive, pause;
   string output_path;
+  string pass_names;
+  vector<Pass> passes;
+  bool use_tiled_output;
+  TiledOutput tiled_output;
+  string export_binary_path;
+  bool benchmark;
+  double load_time;
 } options;
 
 static void session_print(const string &str)
@@ -113,6 +126,11 @@ static bool write_render(const uchar *pixels, int w, int h, int channels)
   return true;
 }
 
+static void write_render_tile(RenderTile &rtile)
+{
+  options.tiled_output.write_tile(rtile, options.scene->film->exposure);
+}
+
 static BufferParams &session_buffer_params()
 {
   static BufferParams buffer_params;
@@ -120,6 +138,7 @@ static BufferParams &session_buffer_params()
   buffer_params.height = options.height;
   buffer_params.full_width = options.width;
   buffer_params.full_height = options.height;
+  buffer_params.passes = options.passes;
 
   return buffer_params;
 }
@@ -128,8 +147,30 @@ static void scene_init()
 {
   options.scene = new Scene(options.scene_params, options.session->device);
 
-  /* Read XML */
-  xml_read_file(options.scene, options.filepath.c_str());
+  if (options.benchmark) {
+    options.scene->enable_update_stats();
+  }
+
+  /* Read scene */
+  const double load_start = time_dt();
+
+  if (binary_is_scene_file(options.filepath.c_str())) {
+    if (!binary_read_file(options.scene, options.filepath.c_str())) {
+      exit(EXIT_FAILURE);
+    }
+  }
+  else {
+    xml_read_file(options.scene, options.filepath.c_str());
+  }
+
+  options.load_time = time_dt() - load_start;
+
+  if (!options.export_binary_path.empty()) {
+    if (!binary_write_file(options.scene, options.export_binary_path.c_str())) {
+      exit(EXIT_FAILURE);
+    }
+    printf("Wrote binary scene %s\n", options.export_binary_path.c_str());
+  }
 
   /* Camera width/height override? */
   if (!(options.width == 0 || options.height == 0)) {
@@ -143,13 +184,23 @@ static void scene_init()
 
   /* Calculate Viewplane */
   options.scene->camera->compute_auto_viewplane();
+
+  options.scene->film->tag_passes_update(options.scene, options.passes);
+  options.scene->film->tag_update(options.scene);
 }
 
 static void session_init()
 {
-  options.session_params.write_render_cb = write_render;
+  if (!options.use_tiled_output) {
+    options.session_params.write_render_cb = write_render;
+  }
   options.session = new Session(options.session_params);
 
+  if (options.use_tiled_output) {
+    /* Tiles are written as they finish, so only tiles in flight need render buffers. */
+    options.session->write_render_tile_cb = function_bind(&write_render_tile, _1);
+  }
+
   if (options.session_params.background && !options.quiet)
     options.session->progress.set_update_callback(function_bind(&session_print_status));
 #ifdef WITH_CYCLES_STANDALONE_GUI
@@ -161,6 +212,12 @@ static void session_init()
   scene_init();
   options.session->scene = options.scene;
 
+  if (options.use_tiled_output &&
+      !options.tiled_output.open(
+          options.output_path, session_buffer_params(), options.session_params.tile_size)) {
+    exit(EXIT_FAILURE);
+  }
+
   options.session->reset(session_buffer_params(), options.session_params.samples);
   options.session->start();
 }
@@ -172,12 +229,63 @@ static void session_exit()
     options.session = NULL;
   }
 
+  if (options.use_tiled_output) {
+    options.tiled_output.close();
+  }
+
   if (options.session_params.background && !options.quiet) {
     session_print("Finished Rendering.");
     printf("\n");
   }
 }
 
+/* Sum of update times, of entries containing the name when given. */
+static double benchmark_update_time(const UpdateTimeStats &stats, const char *name = NULL)
+{
+  double time = 0.0;
+  foreach (const NamedTimeEntry &entry, stats.times.entries) {
+    if (name == NULL || entry.name.find(name) != string::npos) {
+      time += entry.time;
+    }
+  }
+  return time;
+}
+
+static void benchmark_print()
+{
+  Session *session = options.session;
+  SceneUpdateStats *update_stats = session->scene->update_stats;
+
+  double total_time, render_time;
+  session->progress.get_time(total_time, render_time);
+
+  const int samples = (int)(options.session_params.samples * session->progress.get_progress() +
+                            0.5f);
+  const double pixel_samples = (double)samples * options.width * options.height;
+
+  printf("\nBenchmark:\n");
+  printf("  %-24s%.3f s\n", "Scene load", options.load_time);
+  printf("  %-24s%.3f s\n", "Scene update", benchmark_update_time(update_stats->scene));
+  printf("  %-24s%.3f s\n", "BVH build", benchmark_update_time(update_stats->geometry, "BVH"));
+  printf("  %-24s%.3f s\n", "Render", render_time);
+  printf("  %-24s%.3f s\n", "Total", total_time + options.load_time);
+  printf("  %-24s%d\n", "Samples", samples);
+  if (render_time > 0.0) {
+    printf("  %-24s%.3f\n", "Samples per second", samples / render_time);
+    printf("  %-24s%.3f M\n", "Pixel samples per second", pixel_samples / render_time * 1e-6);
+  }
+  printf("  %-24s%s\n",
+         "Peak memory",
+         string_human_readable_size(util_guarded_get_mem_peak()).c_str());
+  printf("  %-24s%s\n",
+         "Peak device memory",
+         string_human_readable_size(session->stats.mem_peak).c_str());
+
+  RenderStats stats;
+  session->collect_statistics(&stats);
+  printf("\n%s\n", stats.full_report().c_str());
+}
+
 #ifdef WITH_CYCLES_STANDALONE_GUI
 static void display_info(Progress &progress)
 {
@@ -370,6 +478,9 @@ static void options_parse(int argc, const char **argv)
   options.filepath = "";
   options.session = NULL;
   options.quiet = false;
+  options.benchmark = false;
+  options.load_time = 0.0;
+  options.use_tiled_output = false;
 
   /* device names */
   string device_names = "";
@@ -390,7 +501,7 @@ static void options_parse(int argc, const char **argv)
 
   /* parse options */
   ArgParse ap;
-  bool help = false, debug = false, version = false;
+  bool help = false, debug = false, version = false, ray_packets = false;
   int verbosity = 1;
 
   ap.options("Usage: cycles [options] file.xml",
@@ -417,6 +528,10 @@ static void options_parse(int argc, const char **argv)
              "--output %s",
              &options.output_path,
              "File path to write output image",
+             "--passes %s",
+             &options.pass_names,
+             "Comma separated list of passes to write besides combined, with names as in the pass "
+             "types of XML files. Only for EXR output in background mode",
              "--threads %d",
              &options.session_params.threads,
              "CPU Rendering Threads",
@@ -432,9 +547,19 @@ static void options_parse(int argc, const char **argv)
              "--tile-height %d",
              &options.session_params.tile_size.y,
              "Tile height in pixels",
+             "--export-binary %s",
+             &options.export_binary_path,
+             "Write the scene to a binary scene file, which loads faster than XML",
+             "--benchmark",
+             &options.benchmark,
+             "Render the given number of samples in background and print timing and memory "
+             "statistics",
              "--list-devices",
              &list,
              "List information about all available devices",
+             "--ray-packets",
+             &ray_packets,
+             "Trace camera rays as packets on the CPU, with the BVH2 layout",
 #ifdef WITH_CYCLES_LOGGING
              "--debug",
              &debug,
@@ -462,6 +587,8 @@ static void options_parse(int argc, const char **argv)
     util_logging_verbosity_set(verbosity);
   }
 
+  DebugFlags().cpu.ray_packets = ray_packets;
+
   if (list) {
     vector<DeviceInfo> devices = Device::available_devices();
     printf("Devices:\n");
@@ -493,8 +620,49 @@ static void options_parse(int argc, const char **argv)
   options.session_params.background = true;
 #endif
 
+  if (options.benchmark) {
+    options.session_params.background = true;
+    options.session_params.use_profiling = true;
+    options.quiet = true;
+  }
+
+  /* Passes, named by their type. */
+  options.passes.clear();
+  Pass::add(PASS_COMBINED, options.passes, "Combined");
+
+  vector<string> pass_names;
+  string_split(pass_names, options.pass_names, ", ");
+
+  const NodeEnum *pass_types = Pass::node_type->find_input(ustring("type"))->enum_values;
+  foreach (const string &pass_name, pass_names) {
+    if (!pass_types->exists(ustring(pass_name))) {
+      fprintf(stderr, "Unknown pass: %s\n", pass_name.c_str());
+      exit(EXIT_FAILURE);
+    }
+
+    const PassType type = (PassType)(*pass_types)[ustring(pass_name)];
+    if (type == PASS_CRYPTOMATTE || type == PASS_AOV_COLOR || type == PASS_AOV_VALUE ||
+        type == PASS_ADAPTIVE_AUX_BUFFER || type == PASS_BAKE_PRIMITIVE ||
+        type == PASS_BAKE_DIFFERENTIAL) {
+      fprintf(stderr, "Pass can not be written from the command line: %s\n", pass_name.c_str());
+      exit(EXIT_FAILURE);
+    }
+
+    Pass::add(type, options.passes, pass_name.c_str());
+  }
+
+  /* Write finished tiles to EXR files in background, so the full frame does not need to be in
+   * memory. This needs tiles to be rendered with all samples at once. */
+  options.use_tiled_output = options.session_params.background &&
+                             TiledOutput::supported(options.output_path);
+
+  if (pass_names.size() && !options.use_tiled_output) {
+    fprintf(stderr, "Passes can only be written to EXR files in background mode\n");
+    exit(EXIT_FAILURE);
+  }
+
   /* Use progressive rendering */
-  options.session_params.progressive = true;
+  options.session_params.progressive = !options.use_tiled_output;
 
   /* find matching device */
   DeviceType device_type = Device::type_from_string(devicename.c_str());
@@ -550,6 +718,9 @@ int main(int argc, const char **argv)
 #endif
     session_init();
     options.session->wait();
+    if (options.benchmark) {
+      benchmark_print();
+    }
     session_exit();
 #ifdef WITH_CYCLES_STANDALONE_GUI
   }
@@ -57,6 +57,7 @@ enum_displacement_methods = (
 enum_bvh_layouts = (
     ('BVH2', "BVH2", "", 1),
     ('EMBREE', "Embree", "", 4),
+    ('BVH2_COMPRESSED', "BVH2 Compressed", "BVH2 with quantized bounds, using less memory at the cost of some performance", 8),
 )
 
 enum_bvh_types = (
@@ -397,6 +398,25 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         min=0.0, max=1.0,
         default=0.01,
     )
+    use_light_tree: BoolProperty(
+        name="Light Tree",
+        description="Choose lights for each shading point by their estimated contribution, using a light tree. "
+        "Reduces noise in scenes with many lights, not used when sampling all lights",
+        default=False,
+    )
+    use_path_guiding: BoolProperty(
+        name="Path Guiding",
+        description="Learn where indirect light comes from in the first samples and guide bounces towards it. "
+        "Reduces noise for difficult indirect lighting, only for Path Tracing on the CPU. "
+        "Final renders are progressively refined",
+        default=False,
+    )
+    path_guiding_training_samples: IntProperty(
+        name="Training Samples",
+        description="Number of samples used to learn the distribution of light for path guiding",
+        min=1, max=1024,
+        default=64,
+    )
 
     use_adaptive_sampling: BoolProperty(
         name="Use Adaptive Sampling",
@@ -800,6 +820,21 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         items=enum_texture_limit
     )
 
+    use_texture_cache: BoolProperty(
+        name="Texture Cache",
+        description="Read image textures on demand from disk instead of loading them fully into memory, "
+        "only image tiles and MIP levels that are needed are kept in memory (CPU only). "
+        "Tiled and mipmapped .tx files are recommended",
+        default=False,
+    )
+
+    texture_cache_size: IntProperty(
+        name="Texture Cache Size",
+        description="Maximum amount of memory used by the texture cache, in megabytes",
+        default=1024,
+        min=64, max=65536,
+    )
+
     ao_bounces: IntProperty(
         name="AO Bounces",
         default=0,
@@ -832,6 +867,11 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default='EMBREE',
     )
     debug_use_cpu_split_kernel: BoolProperty(name="Split Kernel", default=False)
+    debug_use_cpu_ray_packets: BoolProperty(
+        name="Ray Packets",
+        description="Trace camera rays of neighboring pixels together, only with the BVH2 layout",
+        default=False,
+    )
 
     debug_use_cuda_adaptive_compile: BoolProperty(name="Adaptive Compile", default=False)
     debug_use_cuda_split_kernel: BoolProperty(name="Split Kernel", default=False)
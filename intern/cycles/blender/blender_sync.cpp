@@ -317,6 +317,9 @@ void BlenderSync::sync_integrator()
   integrator->sample_all_lights_direct = get_boolean(cscene, "sample_all_lights_direct");
   integrator->sample_all_lights_indirect = get_boolean(cscene, "sample_all_lights_indirect");
   integrator->light_sampling_threshold = get_float(cscene, "light_sampling_threshold");
+  integrator->use_light_tree = get_boolean(cscene, "use_light_tree");
+  integrator->use_path_guiding = get_boolean(cscene, "use_path_guiding");
+  integrator->path_guiding_training_samples = get_int(cscene, "path_guiding_training_samples");
 
   if (RNA_boolean_get(&cscene, "use_adaptive_sampling")) {
     integrator->sampling_pattern = SAMPLING_PATTERN_PMJ;
@@ -369,6 +372,10 @@ void BlenderSync::sync_integrator()
     integrator->ao_bounces = 0;
   }
 
+  if (integrator->use_light_tree_sampling() != previntegrator.use_light_tree_sampling()) {
+    scene->light_manager->tag_update(scene);
+  }
+
   if (integrator->modified(previntegrator))
     integrator->tag_update(scene);
 }
@@ -805,6 +812,9 @@ SceneParams BlenderSync::get_scene_params(BL::Scene &b_scene, bool background)
     params.texture_limit = 0;
   }
 
+  params.texture_cache.use_cache = get_boolean(cscene, "use_texture_cache");
+  params.texture_cache.cache_size = get_int(cscene, "texture_cache_size");
+
   params.bvh_layout = DebugFlags().cpu.bvh_layout;
 
   params.background = background;
@@ -929,6 +939,11 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine &b_engine,
   BL::RenderSettings b_r = b_scene.render();
   params.progressive_refine = b_engine.is_preview() ||
                               get_boolean(cscene, "use_progressive_refine");
+  /* Path guiding learns from samples of the whole image before rendering the rest. */
+  if (get_boolean(cscene, "use_path_guiding") && params.device.type == DEVICE_CPU &&
+      get_enum(cscene, "progressive") == Integrator::PATH) {
+    params.progressive_refine = true;
+  }
   if (b_r.use_save_buffers())
     params.progressive_refine = false;
 
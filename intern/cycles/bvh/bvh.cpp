@@ -22,6 +22,7 @@
 #include "render/object.h"
 
 #include "bvh/bvh2.h"
+#include "bvh/bvh2_compressed.h"
 #include "bvh/bvh_build.h"
 #include "bvh/bvh_embree.h"
 #include "bvh/bvh_node.h"
@@ -46,6 +47,8 @@ const char *bvh_layout_name(BVHLayout layout)
       return "EMBREE";
     case BVH_LAYOUT_OPTIX:
       return "OPTIX";
+    case BVH_LAYOUT_BVH2_COMPRESSED:
+      return "BVH2_COMPRESSED";
     case BVH_LAYOUT_ALL:
       return "ALL";
   }
@@ -104,6 +107,8 @@ BVH *BVH::create(const BVHParams &params,
   switch (params.bvh_layout) {
     case BVH_LAYOUT_BVH2:
       return new BVH2(params, geometry, objects);
+    case BVH_LAYOUT_BVH2_COMPRESSED:
+      return new BVH2Compressed(params, geometry, objects);
     case BVH_LAYOUT_EMBREE:
 #ifdef WITH_EMBREE
       return new BVHEmbree(params, geometry, objects, device);
@@ -332,6 +337,10 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
     }
   }
 
+  /* Compressed nodes have a different size and store multiple leaves per element. */
+  const bool use_compressed = (params.bvh_layout == BVH_LAYOUT_BVH2_COMPRESSED);
+  const int leaves_per_node = (use_compressed) ? BVH_COMPRESSED_LEAVES_PER_NODE : 1;
+
   /* track offsets of instanced BVH data in global array */
   size_t prim_offset = pack.prim_index.size();
   size_t nodes_offset = nodes_size;
@@ -470,6 +479,10 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
         int4 data = leaf_nodes_offset[i];
         data.x += prim_offset;
         data.y += prim_offset;
+        if (use_compressed) {
+          data.z += prim_offset;
+          data.w += prim_offset;
+        }
         pack_leaf_nodes[pack_leaf_nodes_offset] = data;
         for (int j = 1; j < BVH_NODE_LEAF_SIZE; ++j) {
           pack_leaf_nodes[pack_leaf_nodes_offset + j] = leaf_nodes_offset[i + j];
@@ -484,7 +497,11 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 
       for (size_t i = 0, j = 0; i < bvh_nodes_size; j++) {
         size_t nsize, nsize_bbox;
-        if (bvh_nodes[i].x & PATH_RAY_NODE_UNALIGNED) {
+        if (use_compressed) {
+          nsize = BVH_COMPRESSED_NODE_SIZE;
+          nsize_bbox = 0;
+        }
+        else if (bvh_nodes[i].x & PATH_RAY_NODE_UNALIGNED) {
           nsize = BVH_UNALIGNED_NODE_SIZE;
           nsize_bbox = 0;
         }
@@ -497,8 +514,8 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 
         /* Modify offsets into arrays */
         int4 data = bvh_nodes[i + nsize_bbox];
-        data.z += (data.z < 0) ? -noffset_leaf : noffset;
-        data.w += (data.w < 0) ? -noffset_leaf : noffset;
+        data.z += (data.z < 0) ? -noffset_leaf * leaves_per_node : noffset;
+        data.w += (data.w < 0) ? -noffset_leaf * leaves_per_node : noffset;
         pack_nodes[pack_nodes_offset + nsize_bbox] = data;
 
         /* Usually this copies nothing, but we better
@@ -0,0 +1,325 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bvh/bvh2_compressed.h"
+
+#include "render/mesh.h"
+#include "render/object.h"
+
+#include "bvh/bvh_node.h"
+
+#include "util/util_logging.h"
+#include "util/util_math.h"
+#include "util/util_string.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Quantized Bounds */
+
+static const int BVH_QUANTIZED_MAX = 255;
+/* Biased exponents, avoiding denormal and infinite steps. */
+static const int BVH_QUANTIZED_MIN_EXPONENT = 1;
+static const int BVH_QUANTIZED_MAX_EXPONENT = 254;
+
+static bool quantize_axis(
+    float origin, float step, float bmin, float bmax, uchar *r_min, uchar *r_max)
+{
+  /* Round outwards, and then correct for float rounding of the division, so that the planes
+   * computed from the quantized values always contain the original bounds. */
+  int qmin = clamp((int)floorf((bmin - origin) / step), 0, BVH_QUANTIZED_MAX);
+  while (qmin > 0 && origin + (float)qmin * step > bmin) {
+    qmin--;
+  }
+
+  int qmax = clamp((int)ceilf((bmax - origin) / step), qmin, BVH_QUANTIZED_MAX + 1);
+  while (qmax <= BVH_QUANTIZED_MAX && origin + (float)qmax * step < bmax) {
+    qmax++;
+  }
+
+  if (qmax > BVH_QUANTIZED_MAX) {
+    return false;
+  }
+
+  *r_min = (uchar)qmin;
+  *r_max = (uchar)qmax;
+  return true;
+}
+
+BVHQuantizedBounds BVHQuantizedBounds::quantize(const BoundBox &bounds0, const BoundBox &bounds1)
+{
+  BoundBox child_bounds[2] = {bounds0, bounds1};
+
+  BoundBox bounds = BoundBox::empty;
+  for (int child = 0; child < 2; child++) {
+    if (child_bounds[child].valid()) {
+      bounds.grow(child_bounds[child]);
+    }
+  }
+  if (!bounds.valid()) {
+    bounds = BoundBox(make_float3(0.0f, 0.0f, 0.0f));
+  }
+
+  /* Empty children, for example leaves without primitives after refit, become a point. */
+  for (int child = 0; child < 2; child++) {
+    if (!child_bounds[child].valid()) {
+      child_bounds[child] = BoundBox(bounds.min);
+    }
+  }
+
+  BVHQuantizedBounds qbounds;
+  qbounds.origin = bounds.min;
+
+  for (int axis = 0; axis < 3; axis++) {
+    /* Smallest power of two step with which the quantized range covers the node bounds. */
+    int exponent;
+    frexpf((bounds.max[axis] - bounds.min[axis]) / BVH_QUANTIZED_MAX, &exponent);
+    exponent = clamp(exponent + 127, BVH_QUANTIZED_MIN_EXPONENT, BVH_QUANTIZED_MAX_EXPONENT);
+
+    for (;; exponent++) {
+      qbounds.exponent[axis] = (uchar)exponent;
+      const float step = qbounds.step(axis);
+
+      bool ok = true;
+      for (int child = 0; child < 2 && ok; child++) {
+        ok = quantize_axis(qbounds.origin[axis],
+                           step,
+                           child_bounds[child].min[axis],
+                           child_bounds[child].max[axis],
+                           &qbounds.min[child][axis],
+                           &qbounds.max[child][axis]);
+      }
+
+      /* Rounding may require a bigger step in rare cases. */
+      if (ok || exponent >= BVH_QUANTIZED_MAX_EXPONENT) {
+        assert(ok);
+        break;
+      }
+    }
+  }
+
+  return qbounds;
+}
+
+BoundBox BVHQuantizedBounds::dequantize(int child) const
+{
+  /* Must match bvh_compressed_node_intersect(). */
+  const float3 step3 = make_float3(step(0), step(1), step(2));
+  const float3 qmin = make_float3(min[child][0], min[child][1], min[child][2]);
+  const float3 qmax = make_float3(max[child][0], max[child][1], max[child][2]);
+  return BoundBox(origin + qmin * step3, origin + qmax * step3);
+}
+
+/* BVH2 Compressed */
+
+BVH2Compressed::BVH2Compressed(const BVHParams &params_,
+                               const vector<Geometry *> &geometry_,
+                               const vector<Object *> &objects_)
+    : BVH2(params_, geometry_, objects_)
+{
+  params.use_unaligned_nodes = false;
+}
+
+void BVH2Compressed::pack_compressed_leaf(int idx, int prim_start, int prim_end)
+{
+  int4 &data = pack.leaf_nodes[idx / BVH_COMPRESSED_LEAVES_PER_NODE];
+  const int offset = (idx % BVH_COMPRESSED_LEAVES_PER_NODE) * 2;
+  data[offset + 0] = prim_start;
+  data[offset + 1] = prim_end;
+}
+
+void BVH2Compressed::pack_compressed_node(int idx,
+                                          const BoundBox &b0,
+                                          const BoundBox &b1,
+                                          int c0,
+                                          int c1,
+                                          uint visibility0,
+                                          uint visibility1)
+{
+  assert(idx + BVH_COMPRESSED_NODE_SIZE <= pack.nodes.size());
+
+  const BVHQuantizedBounds qbounds = BVHQuantizedBounds::quantize(b0, b1);
+
+  int planes[3];
+  for (int axis = 0; axis < 3; axis++) {
+    planes[axis] = (int)(qbounds.min[0][axis] | (qbounds.min[1][axis] << 8) |
+                         (qbounds.max[0][axis] << 16) | ((uint)qbounds.max[1][axis] << 24));
+  }
+
+  int4 data[BVH_COMPRESSED_NODE_SIZE] = {
+      make_int4(
+          visibility0 & ~PATH_RAY_NODE_UNALIGNED, visibility1 & ~PATH_RAY_NODE_UNALIGNED, c0, c1),
+      make_int4(__float_as_int(qbounds.origin.x),
+                __float_as_int(qbounds.origin.y),
+                __float_as_int(qbounds.origin.z),
+                qbounds.exponent[0] | (qbounds.exponent[1] << 8) | (qbounds.exponent[2] << 16)),
+      make_int4(planes[0], planes[1], planes[2], 0),
+  };
+
+  memcpy(&pack.nodes[idx], data, sizeof(int4) * BVH_COMPRESSED_NODE_SIZE);
+}
+
+void BVH2Compressed::pack_nodes(const BVHNode *root)
+{
+  const size_t num_nodes = root->getSubtreeSize(BVH_STAT_NODE_COUNT);
+  const size_t num_leaf_nodes = root->getSubtreeSize(BVH_STAT_LEAF_COUNT);
+  assert(num_leaf_nodes <= num_nodes);
+  /* A single leaf gets an inner node as parent, so traversal always starts at an inner node
+   * and leaves never need to store their own visibility. */
+  const size_t num_inner_nodes = (root->is_leaf()) ? 1 : num_nodes - num_leaf_nodes;
+  const size_t node_size = num_inner_nodes * BVH_COMPRESSED_NODE_SIZE;
+  const size_t leaf_nodes_size = divide_up(num_leaf_nodes, BVH_COMPRESSED_LEAVES_PER_NODE);
+
+  /* Resize arrays */
+  pack.nodes.clear();
+  pack.leaf_nodes.clear();
+  /* For top level BVH, first merge existing BVH's so we know the offsets. */
+  if (params.top_level) {
+    pack_instances(node_size, leaf_nodes_size);
+  }
+  else {
+    pack.nodes.resize(node_size);
+    pack.leaf_nodes.resize(leaf_nodes_size);
+  }
+
+  /* Unused half of the last leaf is an empty range. */
+  if (num_leaf_nodes % BVH_COMPRESSED_LEAVES_PER_NODE) {
+    pack_compressed_leaf(num_leaf_nodes, 0, 0);
+  }
+
+  int nextNodeIdx = 0, nextLeafNodeIdx = 0;
+
+  vector<BVHStackEntry> stack;
+  stack.reserve(BVHParams::MAX_DEPTH * 2);
+
+  if (root->is_leaf()) {
+    BVHStackEntry e(root, nextLeafNodeIdx++);
+    pack_compressed_node(0,
+                         root->bounds,
+                         root->bounds,
+                         e.encodeIdx(),
+                         e.encodeIdx(),
+                         root->visibility,
+                         0);
+    stack.push_back(e);
+    nextNodeIdx += BVH_COMPRESSED_NODE_SIZE;
+  }
+  else {
+    stack.push_back(BVHStackEntry(root, nextNodeIdx));
+    nextNodeIdx += BVH_COMPRESSED_NODE_SIZE;
+  }
+
+  while (stack.size()) {
+    BVHStackEntry e = stack.back();
+    stack.pop_back();
+
+    if (e.node->is_leaf()) {
+      /* leaf node */
+      const LeafNode *leaf = reinterpret_cast<const LeafNode *>(e.node);
+      if (leaf->num_triangles() == 1 && pack.prim_index[leaf->lo] == -1) {
+        /* object */
+        pack_compressed_leaf(e.idx, ~(leaf->lo), 0);
+      }
+      else {
+        /* triangle */
+        pack_compressed_leaf(e.idx, leaf->lo, leaf->hi);
+      }
+    }
+    else {
+      /* inner node */
+      int idx[2];
+      for (int i = 0; i < 2; ++i) {
+        if (e.node->get_child(i)->is_leaf()) {
+          idx[i] = nextLeafNodeIdx++;
+        }
+        else {
+          idx[i] = nextNodeIdx;
+          nextNodeIdx += BVH_COMPRESSED_NODE_SIZE;
+        }
+      }
+
+      stack.push_back(BVHStackEntry(e.node->get_child(0), idx[0]));
+      stack.push_back(BVHStackEntry(e.node->get_child(1), idx[1]));
+
+      const BVHStackEntry &e0 = stack[stack.size() - 2];
+      const BVHStackEntry &e1 = stack[stack.size() - 1];
+      pack_compressed_node(e.idx,
+                           e0.node->bounds,
+                           e1.node->bounds,
+                           e0.encodeIdx(),
+                           e1.encodeIdx(),
+                           e0.node->visibility,
+                           e1.node->visibility);
+    }
+  }
+  assert(node_size == nextNodeIdx);
+  assert(num_leaf_nodes == nextLeafNodeIdx);
+
+  VLOG(2) << "Compressed BVH nodes memory: "
+          << string_human_readable_size((node_size + leaf_nodes_size) * sizeof(int4))
+          << ", uncompressed would be "
+          << string_human_readable_size(((num_nodes - num_leaf_nodes) * BVH_NODE_SIZE +
+                                         num_leaf_nodes * BVH_NODE_LEAF_SIZE) *
+                                        sizeof(int4));
+
+  pack.root_index = 0;
+}
+
+void BVH2Compressed::refit_nodes()
+{
+  assert(!params.top_level);
+
+  BoundBox bbox = BoundBox::empty;
+  uint visibility = 0;
+  refit_compressed_node(0, false, bbox, visibility);
+}
+
+void BVH2Compressed::refit_compressed_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
+{
+  if (leaf) {
+    /* refit leaf node */
+    const int4 &data = pack.leaf_nodes[idx / BVH_COMPRESSED_LEAVES_PER_NODE];
+    const int offset = (idx % BVH_COMPRESSED_LEAVES_PER_NODE) * 2;
+
+    BVH::refit_primitives(data[offset + 0], data[offset + 1], bbox, visibility);
+  }
+  else {
+    assert(idx + BVH_COMPRESSED_NODE_SIZE <= pack.nodes.size());
+
+    const int4 *data = &pack.nodes[idx];
+    const int c0 = data[0].z;
+    const int c1 = data[0].w;
+    /* refit inner node, set bbox from children */
+    BoundBox bbox0 = BoundBox::empty, bbox1 = BoundBox::empty;
+    uint visibility0 = 0, visibility1 = 0;
+
+    refit_compressed_node((c0 < 0) ? -c0 - 1 : c0, (c0 < 0), bbox0, visibility0);
+    if (c1 == c0) {
+      /* Root node of a single leaf, second child is never visited. */
+      bbox1 = bbox0;
+    }
+    else {
+      refit_compressed_node((c1 < 0) ? -c1 - 1 : c1, (c1 < 0), bbox1, visibility1);
+    }
+
+    pack_compressed_node(idx, bbox0, bbox1, c0, c1, visibility0, visibility1);
+
+    bbox.grow(bbox0);
+    bbox.grow(bbox1);
+    visibility = visibility0 | visibility1;
+  }
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BVH2_COMPRESSED_H__
+#define __BVH2_COMPRESSED_H__
+
+#include "bvh/bvh2.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_math.h"
+#include "util/util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+#define BVH_COMPRESSED_NODE_SIZE 3
+/* Number of leaves stored in one int4. */
+#define BVH_COMPRESSED_LEAVES_PER_NODE 2
+
+/* Quantized bounds of the two children of a node.
+ *
+ * Child bounds are stored as 8 bit offsets from the minimum of the node bounds, in steps of a
+ * power of two per axis. With power of two steps the dequantized planes are computed exactly
+ * the same in the kernel as here, so they can be made conservative. */
+
+struct BVHQuantizedBounds {
+  float3 origin;
+  /* Biased float exponent of the step size per axis. */
+  uchar exponent[3];
+  /* Per child and axis. */
+  uchar min[2][3];
+  uchar max[2][3];
+
+  static BVHQuantizedBounds quantize(const BoundBox &bounds0, const BoundBox &bounds1);
+
+  float step(int axis) const
+  {
+    return __uint_as_float((uint)exponent[axis] << 23);
+  }
+
+  BoundBox dequantize(int child) const;
+};
+
+/* BVH2 Compressed
+ *
+ * BVH2 with quantized child bounds, which makes inner nodes 3 instead of 4 int4, and leaves
+ * which only store the primitive range, two per int4. Visibility of leaves is stored in the
+ * parent node and the primitive type is looked up from the primitive. Unaligned nodes are not
+ * supported, so hair uses aligned bounds. Only supported on the CPU. */
+
+class BVH2Compressed : public BVH2 {
+ protected:
+  /* constructor */
+  friend class BVH;
+  BVH2Compressed(const BVHParams &params,
+                 const vector<Geometry *> &geometry,
+                 const vector<Object *> &objects);
+
+  /* pack */
+  void pack_nodes(const BVHNode *root) override;
+
+  void pack_compressed_leaf(int idx, int prim_start, int prim_end);
+  void pack_compressed_node(int idx,
+                            const BoundBox &b0,
+                            const BoundBox &b1,
+                            int c0,
+                            int c1,
+                            uint visibility0,
+                            uint visibility1);
+
+  /* refit */
+  void refit_nodes() override;
+  void refit_compressed_node(int idx, bool leaf, BoundBox &bbox, uint &visibility);
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __BVH2_COMPRESSED_H__ */
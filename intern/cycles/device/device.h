@@ -37,6 +37,8 @@ CCL_NAMESPACE_BEGIN
 class BVH;
 class Progress;
 class RenderTile;
+class TextureCache;
+struct KernelPathGuiding;
 
 /* Device Types */
 
@@ -371,6 +373,16 @@ class Device {
     return NULL;
   }
 
+  /* texture cache for images read on demand, only for CPU device */
+  virtual void set_texture_cache(TextureCache * /*texture_cache*/)
+  {
+  }
+
+  /* learned distribution for path guiding, only for CPU device */
+  virtual void set_path_guiding(KernelPathGuiding * /*path_guiding*/)
+  {
+  }
+
   /* Device specific pointer for BVH creation. Currently only used by Embree. */
   virtual void *bvh_device() const
   {
@@ -192,10 +192,13 @@ class CPUDevice : public Device {
 #endif
 
   bool use_split_kernel;
+  bool use_ray_packets;
 
   DeviceRequestedFeatures requested_features;
 
   KernelFunctions<void (*)(KernelGlobals *, float *, int, int, int, int, int)> path_trace_kernel;
+  KernelFunctions<void (*)(KernelGlobals *, float *, int, int, int, int, int, int)>
+      path_trace_packet_kernel;
   KernelFunctions<void (*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)>
       convert_to_half_float_kernel;
   KernelFunctions<void (*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)>
@@ -282,6 +285,7 @@ class CPUDevice : public Device {
         texture_info(this, "__texture_info", MEM_GLOBAL),
 #define REGISTER_KERNEL(name) name##_kernel(KERNEL_FUNCTIONS(name))
         REGISTER_KERNEL(path_trace),
+        REGISTER_KERNEL(path_trace_packet),
         REGISTER_KERNEL(convert_to_half_float),
         REGISTER_KERNEL(convert_to_byte),
         REGISTER_KERNEL(shader),
@@ -309,6 +313,8 @@ class CPUDevice : public Device {
 #ifdef WITH_OSL
     kernel_globals.osl = &osl_globals;
 #endif
+    kernel_globals.texture_cache = NULL;
+    kernel_globals.path_guiding = NULL;
 #ifdef WITH_EMBREE
     embree_device = rtcNewDevice("verbose=0");
 #endif
@@ -316,6 +322,10 @@ class CPUDevice : public Device {
     if (use_split_kernel) {
       VLOG(1) << "Will be using split kernel.";
     }
+    use_ray_packets = DebugFlags().cpu.ray_packets;
+    if (use_ray_packets) {
+      VLOG(1) << "Will be using ray packets for camera rays.";
+    }
     need_texture_info = false;
 
 #define REGISTER_SPLIT_KERNEL(name) \
@@ -363,7 +373,7 @@ class CPUDevice : public Device {
 
   virtual BVHLayoutMask get_bvh_layout_mask() const override
   {
-    BVHLayoutMask bvh_layout_mask = BVH_LAYOUT_BVH2;
+    BVHLayoutMask bvh_layout_mask = BVH_LAYOUT_BVH2 | BVH_LAYOUT_BVH2_COMPRESSED;
 #ifdef WITH_EMBREE
     bvh_layout_mask |= BVH_LAYOUT_EMBREE;
 #endif /* WITH_EMBREE */
@@ -537,6 +547,16 @@ class CPUDevice : public Device {
 #endif
   }
 
+  virtual void set_texture_cache(TextureCache *texture_cache) override
+  {
+    kernel_globals.texture_cache = texture_cache;
+  }
+
+  virtual void set_path_guiding(KernelPathGuiding *path_guiding) override
+  {
+    kernel_globals.path_guiding = path_guiding;
+  }
+
   void *bvh_device() const override
   {
 #ifdef WITH_EMBREE
@@ -932,7 +952,14 @@ class CPUDevice : public Device {
           break;
       }
 
-      if (tile.task == RenderTile::PATH_TRACE) {
+      if (tile.task == RenderTile::PATH_TRACE && use_ray_packets && !use_coverage) {
+        /* Rows of pixels, so neighboring camera rays can be traced together. */
+        for (int y = tile.y; y < tile.y + tile.h; y++) {
+          path_trace_packet_kernel()(
+              kg, render_buffer, sample, tile.x, y, tile.w, tile.offset, tile.stride);
+        }
+      }
+      else if (tile.task == RenderTile::PATH_TRACE) {
         for (int y = tile.y; y < tile.y + tile.h; y++) {
           for (int x = tile.x; x < tile.x + tile.w; x++) {
             if (use_coverage) {
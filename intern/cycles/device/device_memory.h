@@ -325,7 +325,7 @@ template<typename T> class device_only_memory : public device_memory {
 template<typename T> class device_vector : public device_memory {
  public:
   device_vector(Device *device, const char *name, MemoryType type)
-      : device_memory(device, name, type)
+      : device_memory(device, name, type), modified(false)
   {
     data_type = device_type_traits<T>::data_type;
     data_elements = device_type_traits<T>::num_elements;
@@ -347,6 +347,7 @@ template<typename T> class device_vector : public device_memory {
       device_free();
       host_free();
       host_pointer = host_alloc(sizeof(T) * new_size);
+      modified = true;
       assert(device_pointer == 0);
     }
 
@@ -375,6 +376,7 @@ template<typename T> class device_vector : public device_memory {
       device_free();
       host_free();
       host_pointer = new_ptr;
+      modified = true;
       assert(device_pointer == 0);
     }
 
@@ -397,6 +399,7 @@ template<typename T> class device_vector : public device_memory {
     data_height = 0;
     data_depth = 0;
     host_pointer = from.steal_pointer();
+    modified = true;
     assert(device_pointer == 0);
   }
 
@@ -411,6 +414,7 @@ template<typename T> class device_vector : public device_memory {
     data_height = 0;
     data_depth = 0;
     host_pointer = 0;
+    modified = false;
     assert(device_pointer == 0);
   }
 
@@ -419,6 +423,18 @@ template<typename T> class device_vector : public device_memory {
     return data_size;
   }
 
+  /* Modification tracking, for arrays that are only partially updated on the host and where
+   * the copy to the device can be skipped when nothing changed. Reallocation tags as modified. */
+  void tag_modified()
+  {
+    modified = true;
+  }
+
+  bool is_modified() const
+  {
+    return modified;
+  }
+
   T *data()
   {
     return (T *)host_pointer;
@@ -433,6 +449,14 @@ template<typename T> class device_vector : public device_memory {
   void copy_to_device()
   {
     device_copy_to();
+    modified = false;
+  }
+
+  void copy_to_device_if_modified()
+  {
+    if (modified) {
+      copy_to_device();
+    }
   }
 
   void copy_from_device()
@@ -455,6 +479,8 @@ template<typename T> class device_vector : public device_memory {
   {
     return width * ((height == 0) ? 1 : height) * ((depth == 0) ? 1 : depth);
   }
+
+  bool modified;
 };
 
 /* Pixel Memory
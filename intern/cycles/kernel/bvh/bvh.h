@@ -129,6 +129,12 @@ CCL_NAMESPACE_BEGIN
 #    endif
 #  endif /* __VOLUME_RECORD_ALL__ */
 
+/* Packet BVH traversal */
+
+#  if defined(__BVH_PACKET__)
+#    include "kernel/bvh/bvh_packet.h"
+#  endif
+
 #  undef BVH_FEATURE
 #  undef BVH_NAME_JOIN
 #  undef BVH_NAME_EVAL
@@ -236,6 +242,56 @@ ccl_device_intersect bool scene_intersect(KernelGlobals *kg,
 #endif   /* __KERNEL_OPTIX__ */
 }
 
+#ifdef __BVH_PACKET__
+/* Intersect up to BVH_PACKET_SIZE coherent rays with the same visibility, returns the mask of
+ * rays that hit something. Packet traversal is used for the BVH2 layout without motion blur,
+ * otherwise the rays are traced one by one. */
+ccl_device_intersect int scene_intersect_packet(KernelGlobals *kg,
+                                                const Ray *rays,
+                                                const int num_rays,
+                                                const uint visibility,
+                                                Intersection *isects)
+{
+  PROFILING_INIT(kg, PROFILING_INTERSECT);
+
+  kernel_assert(num_rays <= BVH_PACKET_SIZE);
+
+  int ray_mask = 0;
+  int num_valid_rays = 0;
+  for (int i = 0; i < num_rays; i++) {
+    if (scene_intersect_valid(&rays[i])) {
+      ray_mask |= (1 << i);
+      num_valid_rays++;
+    }
+    else {
+      isects[i].t = rays[i].t;
+      isects[i].prim = PRIM_NONE;
+      isects[i].object = OBJECT_NONE;
+    }
+  }
+
+  if (num_valid_rays > 1 && kernel_data.bvh.bvh_layout == BVH_LAYOUT_BVH2 &&
+      !kernel_data.bvh.have_motion) {
+    bvh_intersect_packet(kg, rays, ray_mask, isects, visibility);
+  }
+  else {
+    for (int i = 0; i < num_rays; i++) {
+      if (ray_mask & (1 << i)) {
+        scene_intersect(kg, &rays[i], visibility, &isects[i]);
+      }
+    }
+  }
+
+  int hit_mask = 0;
+  for (int i = 0; i < num_rays; i++) {
+    if ((ray_mask & (1 << i)) && isects[i].prim != PRIM_NONE) {
+      hit_mask |= (1 << i);
+    }
+  }
+  return hit_mask;
+}
+#endif /* __BVH_PACKET__ */
+
 #ifdef __BVH_LOCAL__
 ccl_device_intersect bool scene_intersect_local(KernelGlobals *kg,
                                                 const Ray *ray,
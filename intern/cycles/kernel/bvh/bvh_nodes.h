@@ -28,6 +28,59 @@ ccl_device_forceinline Transform bvh_unaligned_node_fetch_space(KernelGlobals *k
   return space;
 }
 
+#ifdef __BVH_COMPRESSED__
+/* Compressed node: child bounds are stored as 8 bit offsets from the node bounds minimum, in
+ * steps of a power of two scale per axis. Both are constructed so that the dequantized bounds
+ * are exactly representable and conservative, see BVH2Compressed. */
+ccl_device_forceinline int bvh_compressed_node_intersect(KernelGlobals *kg,
+                                                         const float3 P,
+                                                         const float3 idir,
+                                                         const float t,
+                                                         const int node_addr,
+                                                         const uint visibility,
+                                                         float dist[2])
+{
+  float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr + 0);
+  float4 origin = kernel_tex_fetch(__bvh_nodes, node_addr + 1);
+  float4 qnodes = kernel_tex_fetch(__bvh_nodes, node_addr + 2);
+
+  /* Scale is stored as biased float exponents. */
+  const uint exponents = __float_as_uint(origin.w);
+  const float scale_x = __uint_as_float((exponents & 0xff) << 23);
+  const float scale_y = __uint_as_float(((exponents >> 8) & 0xff) << 23);
+  const float scale_z = __uint_as_float(((exponents >> 16) & 0xff) << 23);
+
+  /* Bytes per axis are child 0 min, child 1 min, child 0 max, child 1 max. */
+  const uint qx = __float_as_uint(qnodes.x);
+  const uint qy = __float_as_uint(qnodes.y);
+  const uint qz = __float_as_uint(qnodes.z);
+
+  float c0lox = (origin.x + (float)(qx & 0xff) * scale_x - P.x) * idir.x;
+  float c0hix = (origin.x + (float)((qx >> 16) & 0xff) * scale_x - P.x) * idir.x;
+  float c0loy = (origin.y + (float)(qy & 0xff) * scale_y - P.y) * idir.y;
+  float c0hiy = (origin.y + (float)((qy >> 16) & 0xff) * scale_y - P.y) * idir.y;
+  float c0loz = (origin.z + (float)(qz & 0xff) * scale_z - P.z) * idir.z;
+  float c0hiz = (origin.z + (float)((qz >> 16) & 0xff) * scale_z - P.z) * idir.z;
+  float c0min = max4(0.0f, min(c0lox, c0hix), min(c0loy, c0hiy), min(c0loz, c0hiz));
+  float c0max = min4(t, max(c0lox, c0hix), max(c0loy, c0hiy), max(c0loz, c0hiz));
+
+  float c1lox = (origin.x + (float)((qx >> 8) & 0xff) * scale_x - P.x) * idir.x;
+  float c1hix = (origin.x + (float)(qx >> 24) * scale_x - P.x) * idir.x;
+  float c1loy = (origin.y + (float)((qy >> 8) & 0xff) * scale_y - P.y) * idir.y;
+  float c1hiy = (origin.y + (float)(qy >> 24) * scale_y - P.y) * idir.y;
+  float c1loz = (origin.z + (float)((qz >> 8) & 0xff) * scale_z - P.z) * idir.z;
+  float c1hiz = (origin.z + (float)(qz >> 24) * scale_z - P.z) * idir.z;
+  float c1min = max4(0.0f, min(c1lox, c1hix), min(c1loy, c1hiy), min(c1loz, c1hiz));
+  float c1max = min4(t, max(c1lox, c1hix), max(c1loy, c1hiy), max(c1loz, c1hiz));
+
+  dist[0] = c0min;
+  dist[1] = c1min;
+
+  return (((c0max >= c0min) && (__float_as_uint(cnodes.x) & visibility)) ? 1 : 0) |
+         (((c1max >= c1min) && (__float_as_uint(cnodes.y) & visibility)) ? 2 : 0);
+}
+#endif /* __BVH_COMPRESSED__ */
+
 ccl_device_forceinline int bvh_aligned_node_intersect(KernelGlobals *kg,
                                                       const float3 P,
                                                       const float3 idir,
@@ -36,6 +89,11 @@ ccl_device_forceinline int bvh_aligned_node_intersect(KernelGlobals *kg,
                                                       const uint visibility,
                                                       float dist[2])
 {
+#ifdef __BVH_COMPRESSED__
+  if (kernel_data.bvh.bvh_layout == BVH_LAYOUT_BVH2_COMPRESSED) {
+    return bvh_compressed_node_intersect(kg, P, idir, t, node_addr, visibility, dist);
+  }
+#endif
 
   /* fetch node data */
 #ifdef __VISIBILITY_FLAG__
@@ -151,3 +209,27 @@ ccl_device_forceinline int bvh_node_intersect(KernelGlobals *kg,
     return bvh_aligned_node_intersect(kg, P, idir, t, node_addr, visibility, dist);
   }
 }
+
+/* Fetch leaf node, returns first and one past last primitive address and primitive type. For
+ * object instances the first address is the negative object primitive index minus one. */
+ccl_device_forceinline int4 bvh_leaf_node_fetch(KernelGlobals *kg, const int leaf_addr)
+{
+#ifdef __BVH_COMPRESSED__
+  if (kernel_data.bvh.bvh_layout == BVH_LAYOUT_BVH2_COMPRESSED) {
+    /* Two leaves per element, without visibility and type which are found elsewhere. */
+    float4 leaves = kernel_tex_fetch(__bvh_leaf_nodes, leaf_addr >> 1);
+    const int prim_addr = __float_as_int((leaf_addr & 1) ? leaves.z : leaves.x);
+    const int prim_addr2 = __float_as_int((leaf_addr & 1) ? leaves.w : leaves.y);
+    const int type = (prim_addr >= 0 && prim_addr < prim_addr2) ?
+                         kernel_tex_fetch(__prim_type, prim_addr) :
+                         0;
+    return make_int4(prim_addr, prim_addr2, 0, type);
+  }
+#endif
+
+  float4 leaf = kernel_tex_fetch(__bvh_leaf_nodes, leaf_addr);
+  return make_int4(__float_as_int(leaf.x),
+                   __float_as_int(leaf.y),
+                   __float_as_int(leaf.z),
+                   __float_as_int(leaf.w));
+}
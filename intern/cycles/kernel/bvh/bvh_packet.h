@@ -0,0 +1,384 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Packet BVH traversal
+ *
+ * Traverses a packet of coherent rays, such as camera rays of neighboring pixels, through the
+ * BVH2 layout together. Nodes are visited once for all rays that may hit them, with the node
+ * bounds tested against all rays of the packet at once. Each node on the stack carries the mask
+ * of rays that entered it, primitives are tested per ray.
+ *
+ * Only closest hit queries without motion blur are supported, other cases are handled by
+ * scene_intersect_packet() with single ray traversal. */
+
+#define BVH_PACKET_SIZE 4
+
+typedef struct BVHRayPacket {
+  /* Origin and inverse direction per axis, in the space of the current instance. */
+  float4 P[3];
+  float4 idir[3];
+  float4 t;
+
+  /* Same per ray, for primitive intersection. */
+  float3 ray_P[BVH_PACKET_SIZE];
+  float3 ray_dir[BVH_PACKET_SIZE];
+  float3 ray_idir[BVH_PACKET_SIZE];
+} BVHRayPacket;
+
+ccl_device_forceinline int bvh_packet_mask(const int4 &hit)
+{
+  return ((hit.x != 0) ? 1 : 0) | ((hit.y != 0) ? 2 : 0) | ((hit.z != 0) ? 4 : 0) |
+         ((hit.w != 0) ? 8 : 0);
+}
+
+ccl_device_forceinline void bvh_packet_update_ray(BVHRayPacket *packet, const int i)
+{
+  packet->P[0][i] = packet->ray_P[i].x;
+  packet->P[1][i] = packet->ray_P[i].y;
+  packet->P[2][i] = packet->ray_P[i].z;
+  packet->idir[0][i] = packet->ray_idir[i].x;
+  packet->idir[1][i] = packet->ray_idir[i].y;
+  packet->idir[2][i] = packet->ray_idir[i].z;
+}
+
+/* Test both children of an aligned node against all rays, returns the mask of rays hitting
+ * each child and the nearest entry distance of those rays. */
+ccl_device_forceinline void bvh_aligned_node_intersect_packet(KernelGlobals *kg,
+                                                              const BVHRayPacket *packet,
+                                                              const int node_addr,
+                                                              const uint visibility,
+                                                              const int ray_mask,
+                                                              int child_mask[2],
+                                                              float dist[2])
+{
+  float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr + 0);
+  float4 node0 = kernel_tex_fetch(__bvh_nodes, node_addr + 1);
+  float4 node1 = kernel_tex_fetch(__bvh_nodes, node_addr + 2);
+  float4 node2 = kernel_tex_fetch(__bvh_nodes, node_addr + 3);
+
+  const float4 zero = make_float4(0.0f);
+
+  float4 c0lox = (make_float4(node0.x) - packet->P[0]) * packet->idir[0];
+  float4 c0hix = (make_float4(node0.z) - packet->P[0]) * packet->idir[0];
+  float4 c0loy = (make_float4(node1.x) - packet->P[1]) * packet->idir[1];
+  float4 c0hiy = (make_float4(node1.z) - packet->P[1]) * packet->idir[1];
+  float4 c0loz = (make_float4(node2.x) - packet->P[2]) * packet->idir[2];
+  float4 c0hiz = (make_float4(node2.z) - packet->P[2]) * packet->idir[2];
+  float4 c0min = max(max(zero, min(c0lox, c0hix)), max(min(c0loy, c0hiy), min(c0loz, c0hiz)));
+  float4 c0max = min(min(packet->t, max(c0lox, c0hix)),
+                     min(max(c0loy, c0hiy), max(c0loz, c0hiz)));
+
+  float4 c1lox = (make_float4(node0.y) - packet->P[0]) * packet->idir[0];
+  float4 c1hix = (make_float4(node0.w) - packet->P[0]) * packet->idir[0];
+  float4 c1loy = (make_float4(node1.y) - packet->P[1]) * packet->idir[1];
+  float4 c1hiy = (make_float4(node1.w) - packet->P[1]) * packet->idir[1];
+  float4 c1loz = (make_float4(node2.y) - packet->P[2]) * packet->idir[2];
+  float4 c1hiz = (make_float4(node2.w) - packet->P[2]) * packet->idir[2];
+  float4 c1min = max(max(zero, min(c1lox, c1hix)), max(min(c1loy, c1hiy), min(c1loz, c1hiz)));
+  float4 c1max = min(min(packet->t, max(c1lox, c1hix)),
+                     min(max(c1loy, c1hiy), max(c1loz, c1hiz)));
+
+  child_mask[0] = (__float_as_uint(cnodes.x) & visibility) ?
+                      bvh_packet_mask(c0max >= c0min) & ray_mask :
+                      0;
+  child_mask[1] = (__float_as_uint(cnodes.y) & visibility) ?
+                      bvh_packet_mask(c1max >= c1min) & ray_mask :
+                      0;
+
+  dist[0] = FLT_MAX;
+  dist[1] = FLT_MAX;
+  for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+    if (child_mask[0] & (1 << i)) {
+      dist[0] = min(dist[0], c0min[i]);
+    }
+    if (child_mask[1] & (1 << i)) {
+      dist[1] = min(dist[1], c1min[i]);
+    }
+  }
+}
+
+ccl_device_forceinline void bvh_node_intersect_packet(KernelGlobals *kg,
+                                                      const BVHRayPacket *packet,
+                                                      const int node_addr,
+                                                      const uint visibility,
+                                                      const int ray_mask,
+                                                      int child_mask[2],
+                                                      float dist[2])
+{
+#ifdef __HAIR__
+  float4 node = kernel_tex_fetch(__bvh_nodes, node_addr);
+  if (__float_as_uint(node.x) & PATH_RAY_NODE_UNALIGNED) {
+    /* Oriented bounds of hair are tested per ray. */
+    child_mask[0] = 0;
+    child_mask[1] = 0;
+    dist[0] = FLT_MAX;
+    dist[1] = FLT_MAX;
+
+    for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+      if (ray_mask & (1 << i)) {
+        float ray_dist[2];
+        const int mask = bvh_unaligned_node_intersect(kg,
+                                                      packet->ray_P[i],
+                                                      packet->ray_dir[i],
+                                                      packet->ray_idir[i],
+                                                      packet->t[i],
+                                                      node_addr,
+                                                      visibility,
+                                                      ray_dist);
+        if (mask & 1) {
+          child_mask[0] |= (1 << i);
+          dist[0] = min(dist[0], ray_dist[0]);
+        }
+        if (mask & 2) {
+          child_mask[1] |= (1 << i);
+          dist[1] = min(dist[1], ray_dist[1]);
+        }
+      }
+    }
+    return;
+  }
+#endif /* __HAIR__ */
+
+  bvh_aligned_node_intersect_packet(kg, packet, node_addr, visibility, ray_mask, child_mask, dist);
+}
+
+ccl_device_noinline void bvh_intersect_packet(KernelGlobals *kg,
+                                              const Ray *rays,
+                                              const int ray_mask_init,
+                                              Intersection *isects,
+                                              const uint visibility)
+{
+  kernel_assert(kernel_data.bvh.bvh_layout == BVH_LAYOUT_BVH2);
+  kernel_assert(!(visibility & PATH_RAY_SHADOW_OPAQUE));
+
+  /* Traversal stack, with mask of rays per node. */
+  int traversal_stack[BVH_STACK_SIZE];
+  int mask_stack[BVH_STACK_SIZE];
+  traversal_stack[0] = ENTRYPOINT_SENTINEL;
+  mask_stack[0] = 0;
+
+  int stack_ptr = 0;
+  int node_addr = kernel_data.bvh.root;
+  int ray_mask = ray_mask_init;
+  int object = OBJECT_NONE;
+
+  int first_ray = 0;
+  while (!(ray_mask_init & (1 << first_ray))) {
+    first_ray++;
+  }
+
+  BVHRayPacket packet;
+  for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+    /* Unused lanes are copies of a used ray, so that they stay finite. */
+    const Ray *ray = (ray_mask_init & (1 << i)) ? &rays[i] : &rays[first_ray];
+
+    packet.ray_P[i] = ray->P;
+    packet.ray_dir[i] = bvh_clamp_direction(ray->D);
+    packet.ray_idir[i] = bvh_inverse_direction(packet.ray_dir[i]);
+    bvh_packet_update_ray(&packet, i);
+    packet.t[i] = ray->t;
+
+    isects[i].t = ray->t;
+    isects[i].u = 0.0f;
+    isects[i].v = 0.0f;
+    isects[i].prim = PRIM_NONE;
+    isects[i].object = OBJECT_NONE;
+#ifdef __KERNEL_DEBUG__
+    isects[i].num_traversed_nodes = 0;
+    isects[i].num_traversed_instances = 0;
+    isects[i].num_intersections = 0;
+#endif
+  }
+
+  /* traversal loop */
+  do {
+    do {
+      /* traverse internal nodes */
+      while (node_addr >= 0 && node_addr != ENTRYPOINT_SENTINEL) {
+        int child_mask[2];
+        float dist[2];
+        float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr + 0);
+
+        bvh_node_intersect_packet(kg, &packet, node_addr, visibility, ray_mask, child_mask, dist);
+
+        int node_addr_child0 = __float_as_int(cnodes.z);
+        int node_addr_child1 = __float_as_int(cnodes.w);
+
+        if (child_mask[0] && child_mask[1]) {
+          /* Both children were intersected, push the farther one. */
+          int mask_child0 = child_mask[0];
+          int mask_child1 = child_mask[1];
+          if (dist[1] < dist[0]) {
+            int tmp = node_addr_child0;
+            node_addr_child0 = node_addr_child1;
+            node_addr_child1 = tmp;
+            mask_child0 = child_mask[1];
+            mask_child1 = child_mask[0];
+          }
+
+          ++stack_ptr;
+          kernel_assert(stack_ptr < BVH_STACK_SIZE);
+          traversal_stack[stack_ptr] = node_addr_child1;
+          mask_stack[stack_ptr] = mask_child1;
+
+          node_addr = node_addr_child0;
+          ray_mask = mask_child0;
+        }
+        else if (child_mask[0]) {
+          node_addr = node_addr_child0;
+          ray_mask = child_mask[0];
+        }
+        else if (child_mask[1]) {
+          node_addr = node_addr_child1;
+          ray_mask = child_mask[1];
+        }
+        else {
+          /* Neither child was intersected. */
+          node_addr = traversal_stack[stack_ptr];
+          ray_mask = mask_stack[stack_ptr];
+          --stack_ptr;
+        }
+
+#ifdef __KERNEL_DEBUG__
+        for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+          isects[i].num_traversed_nodes++;
+        }
+#endif
+      }
+
+      /* if node is leaf, fetch triangle list */
+      if (node_addr < 0) {
+        const int4 leaf = bvh_leaf_node_fetch(kg, -node_addr - 1);
+        int prim_addr = leaf.x;
+
+        if (prim_addr >= 0) {
+          const int prim_addr2 = leaf.y;
+          const uint type = leaf.w;
+          const int leaf_mask = ray_mask;
+
+          /* pop */
+          node_addr = traversal_stack[stack_ptr];
+          ray_mask = mask_stack[stack_ptr];
+          --stack_ptr;
+
+          /* Primitive intersection, primitives in the outer loop so that their data is only
+           * fetched into the cache once for all rays. */
+          for (; prim_addr < prim_addr2; prim_addr++) {
+            const uint prim_type = kernel_tex_fetch(__prim_type, prim_addr);
+            kernel_assert((prim_type & PRIMITIVE_ALL) == (type & PRIMITIVE_ALL));
+
+            for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+              if (!(leaf_mask & (1 << i))) {
+                continue;
+              }
+
+#ifdef __KERNEL_DEBUG__
+              isects[i].num_intersections++;
+#endif
+
+              switch (type & PRIMITIVE_ALL) {
+                case PRIMITIVE_TRIANGLE: {
+                  triangle_intersect(kg,
+                                     &isects[i],
+                                     packet.ray_P[i],
+                                     packet.ray_dir[i],
+                                     visibility,
+                                     object,
+                                     prim_addr);
+                  break;
+                }
+#ifdef __HAIR__
+                case PRIMITIVE_CURVE_THICK:
+                case PRIMITIVE_CURVE_RIBBON: {
+                  curve_intersect(kg,
+                                  &isects[i],
+                                  packet.ray_P[i],
+                                  packet.ray_dir[i],
+                                  visibility,
+                                  object,
+                                  prim_addr,
+                                  rays[i].time,
+                                  prim_type);
+                  break;
+                }
+#endif /* __HAIR__ */
+              }
+            }
+          }
+
+          for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+            if (leaf_mask & (1 << i)) {
+              packet.t[i] = isects[i].t;
+            }
+          }
+        }
+        else {
+          /* instance push, for all rays that entered the instance */
+          object = kernel_tex_fetch(__prim_object, -prim_addr - 1);
+
+          for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+            if (ray_mask & (1 << i)) {
+              isects[i].t = bvh_instance_push(kg,
+                                              object,
+                                              &rays[i],
+                                              &packet.ray_P[i],
+                                              &packet.ray_dir[i],
+                                              &packet.ray_idir[i],
+                                              isects[i].t);
+              packet.t[i] = isects[i].t;
+              bvh_packet_update_ray(&packet, i);
+
+#ifdef __KERNEL_DEBUG__
+              isects[i].num_traversed_instances++;
+#endif
+            }
+          }
+
+          ++stack_ptr;
+          kernel_assert(stack_ptr < BVH_STACK_SIZE);
+          traversal_stack[stack_ptr] = ENTRYPOINT_SENTINEL;
+          mask_stack[stack_ptr] = ray_mask;
+
+          node_addr = kernel_tex_fetch(__object_node, object);
+        }
+      }
+    } while (node_addr != ENTRYPOINT_SENTINEL);
+
+    if (stack_ptr >= 0) {
+      kernel_assert(object != OBJECT_NONE);
+
+      /* instance pop, the mask was restored along with the sentinel */
+      for (int i = 0; i < BVH_PACKET_SIZE; i++) {
+        if (ray_mask & (1 << i)) {
+          isects[i].t = bvh_instance_pop(kg,
+                                         object,
+                                         &rays[i],
+                                         &packet.ray_P[i],
+                                         &packet.ray_dir[i],
+                                         &packet.ray_idir[i],
+                                         isects[i].t);
+          packet.t[i] = isects[i].t;
+          bvh_packet_update_ray(&packet, i);
+        }
+      }
+
+      object = OBJECT_NONE;
+      node_addr = traversal_stack[stack_ptr];
+      ray_mask = mask_stack[stack_ptr];
+      --stack_ptr;
+    }
+  } while (node_addr != ENTRYPOINT_SENTINEL);
+}
@@ -123,12 +123,12 @@ ccl_device_noinline bool BVH_FUNCTION_FULL_NAME(BVH)(KernelGlobals *kg,
 
       /* if node is leaf, fetch triangle list */
       if (node_addr < 0) {
-        float4 leaf = kernel_tex_fetch(__bvh_leaf_nodes, (-node_addr - 1));
-        int prim_addr = __float_as_int(leaf.x);
+        const int4 leaf = bvh_leaf_node_fetch(kg, -node_addr - 1);
+        int prim_addr = leaf.x;
 
         if (prim_addr >= 0) {
-          const int prim_addr2 = __float_as_int(leaf.y);
-          const uint type = __float_as_int(leaf.w);
+          const int prim_addr2 = leaf.y;
+          const uint type = leaf.w;
 
           /* pop */
           node_addr = traversal_stack[stack_ptr];
@@ -535,6 +535,19 @@ ccl_device_inline void path_radiance_accum_shadowcatcher(PathRadiance *L,
 }
 #endif
 
+/* Sum of all radiance accumulated so far, before splitting into passes. */
+ccl_device_inline float3 path_radiance_total(const PathRadiance *L)
+{
+#ifdef __PASSES__
+  if (L->use_light_pass) {
+    return L->emission + L->direct_emission + L->indirect + L->direct_diffuse + L->direct_glossy +
+           L->direct_transmission + L->direct_volume;
+  }
+#endif
+
+  return L->emission;
+}
+
 ccl_device_inline void path_radiance_sum_indirect(PathRadiance *L)
 {
 #ifdef __PASSES__
@@ -49,6 +49,7 @@ typedef unordered_map<float, float> CoverageMap;
 
 struct Intersection;
 struct VolumeStep;
+class TextureCache;
 
 typedef struct KernelGlobals {
 #  define KERNEL_TEX(type, name) texture<type> name;
@@ -78,6 +79,12 @@ typedef struct KernelGlobals {
   CoverageMap *coverage_material;
   CoverageMap *coverage_asset;
 
+  /* Images read on demand, NULL when not used. */
+  TextureCache *texture_cache;
+
+  /* Learned radiance distribution for path guiding, NULL when not used. */
+  KernelPathGuiding *path_guiding;
+
   /* split kernel */
   SplitData split_data;
   SplitParams split_param_data;
@@ -15,6 +15,7 @@
  */
 
 #include "kernel_light_background.h"
+#include "kernel_light_tree.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -37,8 +38,13 @@ typedef struct LightSample {
 
 /* Regular Light */
 
-ccl_device_inline bool lamp_light_sample(
-    KernelGlobals *kg, int lamp, float randu, float randv, float3 P, LightSample *ls)
+ccl_device_inline bool lamp_light_sample(KernelGlobals *kg,
+                                         int lamp,
+                                         float randu,
+                                         float randv,
+                                         float3 P,
+                                         float pdf_select,
+                                         LightSample *ls)
 {
   const ccl_global KernelLight *klight = &kernel_tex_fetch(__lights, lamp);
   LightType type = (LightType)klight->type;
@@ -153,11 +159,20 @@ ccl_device_inline bool lamp_light_sample(
     }
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= pdf_select;
 
   return (ls->pdf > 0.0f);
 }
 
+/* Probability of choosing the lamp when sampling one light for shading point P. */
+ccl_device_inline float lamp_light_select_pdf(KernelGlobals *kg, int lamp, float3 P)
+{
+  if (kernel_data.integrator.use_light_tree) {
+    return light_tree_lamp_pdf(kg, P, lamp);
+  }
+  return kernel_data.integrator.pdf_lights;
+}
+
 ccl_device bool lamp_light_eval(
     KernelGlobals *kg, int lamp, float3 P, float3 D, float t, LightSample *ls)
 {
@@ -291,7 +306,7 @@ ccl_device bool lamp_light_eval(
     return false;
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= lamp_light_select_pdf(kg, lamp, P);
 
   return true;
 }
@@ -328,12 +343,11 @@ ccl_device_inline bool triangle_world_space_vertices(
   return has_motion;
 }
 
-ccl_device_inline float triangle_light_pdf_area(KernelGlobals *kg,
-                                                const float3 Ng,
+ccl_device_inline float triangle_light_pdf_area(const float3 Ng,
                                                 const float3 I,
-                                                float t)
+                                                float t,
+                                                float pdf)
 {
-  float pdf = kernel_data.integrator.pdf_triangles;
   float cos_pi = fabsf(dot(Ng, I));
 
   if (cos_pi == 0.0f)
@@ -351,6 +365,19 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
   float3 V[3];
   bool has_motion = triangle_world_space_vertices(kg, sd->object, sd->prim, sd->time, V);
 
+  /* sd contains the point on the light source
+   * calculate Px, the point that we're shading */
+  const float3 Px = sd->P + sd->I * t;
+
+  /* Probability of choosing the triangle divided by its area. */
+  float pdf_triangles = kernel_data.integrator.pdf_triangles;
+  if (kernel_data.integrator.use_light_tree) {
+    pdf_triangles = light_tree_triangle_pdf(kg, Px, sd->object, sd->prim);
+    if (pdf_triangles == 0.0f) {
+      return 0.0f;
+    }
+  }
+
   const float3 e0 = V[1] - V[0];
   const float3 e1 = V[2] - V[0];
   const float3 e2 = V[2] - V[1];
@@ -359,9 +386,6 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
   const float distance_to_plane = fabsf(dot(N, sd->I * t)) / dot(N, N);
 
   if (longest_edge_squared > distance_to_plane * distance_to_plane) {
-    /* sd contains the point on the light source
-     * calculate Px, the point that we're shading */
-    const float3 Px = sd->P + sd->I * t;
     const float3 v0_p = V[0] - Px;
     const float3 v1_p = V[1] - Px;
     const float3 v2_p = V[2] - Px;
@@ -389,12 +413,12 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
       else {
         area = 0.5f * len(N);
       }
-      const float pdf = area * kernel_data.integrator.pdf_triangles;
+      const float pdf = area * pdf_triangles;
       return pdf / solid_angle;
     }
   }
   else {
-    float pdf = triangle_light_pdf_area(kg, sd->Ng, sd->I, t);
+    float pdf = triangle_light_pdf_area(sd->Ng, sd->I, t, pdf_triangles);
     if (has_motion) {
       const float area = 0.5f * len(N);
       if (UNLIKELY(area == 0.0f)) {
@@ -418,7 +442,8 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg,
                                                   float randv,
                                                   float time,
                                                   LightSample *ls,
-                                                  const float3 P)
+                                                  const float3 P,
+                                                  float pdf_triangles)
 {
   /* A naive heuristic to decide between costly solid angle sampling
    * and simple area sampling, comparing the distance to the triangle plane
@@ -542,7 +567,7 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg,
         triangle_world_space_vertices(kg, object, prim, -1.0f, V);
         area = triangle_area(V[0], V[1], V[2]);
       }
-      const float pdf = area * kernel_data.integrator.pdf_triangles;
+      const float pdf = area * pdf_triangles;
       ls->pdf = pdf / solid_angle;
     }
   }
@@ -564,7 +589,7 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg,
     ls->P = u * V[0] + v * V[1] + t * V[2];
     /* compute incoming direction, distance and pdf */
     ls->D = normalize_len(ls->P - P, &ls->t);
-    ls->pdf = triangle_light_pdf_area(kg, ls->Ng, -ls->D, ls->t);
+    ls->pdf = triangle_light_pdf_area(ls->Ng, -ls->D, ls->t, pdf_triangles);
     if (has_motion && area != 0.0f) {
       /* scale the PDF.
        * area = the area the sample was taken from
@@ -632,9 +657,26 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
                                       int bounce,
                                       LightSample *ls)
 {
+  /* Probability of choosing the lamp, or the triangle divided by its area. */
+  float pdf_select = kernel_data.integrator.pdf_lights;
+
   if (lamp < 0) {
     /* sample index */
-    int index = light_distribution_sample(kg, &randu);
+    int index;
+
+    if (kernel_data.integrator.use_light_tree) {
+      const int emitter = light_tree_sample(kg, P, &randu, &pdf_select);
+      if (emitter == -1) {
+        return false;
+      }
+      const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(__light_tree_emitters,
+                                                                            emitter);
+      index = kemitter->distribution_index;
+      pdf_select *= (kemitter->inv_area != 0.0f) ? kemitter->inv_area : 1.0f;
+    }
+    else {
+      index = light_distribution_sample(kg, &randu);
+    }
 
     /* fetch light data */
     const ccl_global KernelLightDistribution *kdistribution = &kernel_tex_fetch(
@@ -645,7 +687,11 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
       int object = kdistribution->mesh_light.object_id;
       int shader_flag = kdistribution->mesh_light.shader_flag;
 
-      triangle_light_sample(kg, prim, object, randu, randv, time, ls, P);
+      if (!kernel_data.integrator.use_light_tree) {
+        pdf_select = kernel_data.integrator.pdf_triangles;
+      }
+
+      triangle_light_sample(kg, prim, object, randu, randv, time, ls, P, pdf_select);
       ls->shader |= shader_flag;
       return (ls->pdf > 0.0f);
     }
@@ -657,7 +703,7 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
     return false;
   }
 
-  return lamp_light_sample(kg, lamp, randu, randv, P, ls);
+  return lamp_light_sample(kg, lamp, randu, randv, P, pdf_select, ls);
 }
 
 ccl_device_inline int light_select_num_samples(KernelGlobals *kg, int index)
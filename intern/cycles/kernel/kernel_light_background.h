@@ -400,6 +400,15 @@ background_light_sample(KernelGlobals *kg, float3 P, float randu, float randv, f
   return D;
 }
 
+/* Probability of choosing the background light when sampling one light. */
+ccl_device_inline float background_light_select_pdf(KernelGlobals *kg)
+{
+  if (kernel_data.integrator.use_light_tree) {
+    return kernel_data.integrator.light_tree_infinite_pdf;
+  }
+  return kernel_data.integrator.pdf_lights;
+}
+
 ccl_device float background_light_pdf(KernelGlobals *kg, float3 P, float3 direction)
 {
   float portal_method_pdf = kernel_data.background.portal_weight;
@@ -424,7 +433,7 @@ ccl_device float background_light_pdf(KernelGlobals *kg, float3 P, float3 direct
   float pdf_fac = (portal_method_pdf + sun_method_pdf + map_method_pdf);
   if (pdf_fac == 0.0f) {
     /* Use uniform as a fallback if we can't use any strategy. */
-    return kernel_data.integrator.pdf_lights / M_4PI_F;
+    return background_light_select_pdf(kg) / M_4PI_F;
   }
 
   pdf_fac = 1.0f / pdf_fac;
@@ -440,7 +449,7 @@ ccl_device float background_light_pdf(KernelGlobals *kg, float3 P, float3 direct
     pdf += background_map_pdf(kg, direction) * map_method_pdf;
   }
 
-  return pdf * kernel_data.integrator.pdf_lights;
+  return pdf * background_light_select_pdf(kg);
 }
 
 #endif
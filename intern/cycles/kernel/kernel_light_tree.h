@@ -0,0 +1,232 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree
+ *
+ * Emitters are selected by descending the tree, choosing a child with probability proportional
+ * to its importance for the shading point, see "Importance Sampling of Many Lights with Adaptive
+ * Tree Splitting" by Conty and Kulla. Inside a leaf emitters are chosen proportional to their
+ * energy. Importance only depends on the shading position, so the probability of choosing an
+ * emitter can be computed again when a light is hit by a BSDF ray, for MIS.
+ *
+ * Distant and background lights have no position, they are chosen with a fixed probability
+ * before the tree is used. */
+
+/* Importance of the node for the shading point P. */
+ccl_device float light_tree_node_importance(const float3 P,
+                                            const ccl_global KernelLightTreeNode *knode)
+{
+  if (knode->energy == 0.0f) {
+    return 0.0f;
+  }
+
+  const float3 bbox_min = make_float3(knode->bbox_min[0], knode->bbox_min[1], knode->bbox_min[2]);
+  const float3 bbox_max = make_float3(knode->bbox_max[0], knode->bbox_max[1], knode->bbox_max[2]);
+  const float3 centroid = 0.5f * (bbox_min + bbox_max);
+  const float radius_sq = 0.25f * len_squared(bbox_max - bbox_min);
+
+  float distance;
+  const float3 D = normalize_len(P - centroid, &distance);
+  const float distance_sq = distance * distance;
+
+  if (distance_sq <= radius_sq) {
+    /* Point is inside of the bounding sphere, any orientation is possible. */
+    return knode->energy / max(radius_sq, 1e-8f);
+  }
+
+  /* Angle between the cone axis and the direction to the point, reduced by the angles
+   * covered by the cone and by the bounding sphere as seen from the point. */
+  const float3 axis = make_float3(knode->axis[0], knode->axis[1], knode->axis[2]);
+  const float theta = fast_acosf(clamp(dot(axis, D), -1.0f, 1.0f));
+  const float theta_u = fast_asinf(sqrtf(radius_sq / distance_sq));
+  const float theta_prime = max(theta - knode->theta_o - theta_u, 0.0f);
+
+  if (theta_prime >= knode->theta_e) {
+    return 0.0f;
+  }
+
+  return knode->energy * fast_cosf(theta_prime) / max(distance_sq, 1e-8f);
+}
+
+ccl_device_inline float light_tree_rescale_random(float r)
+{
+  /* Keep reused random number in [0, 1) despite float rounding. */
+  return min(r, 0.99999994f);
+}
+
+/* Choose an emitter for shading point P, returns index in __light_tree_emitters or -1 if there
+ * is no emitter which could illuminate the point. randu is rescaled to be reused for sampling a
+ * point on the emitter. */
+ccl_device int light_tree_sample(KernelGlobals *kg, const float3 P, float *randu, float *pdf)
+{
+  const int num_infinite = kernel_data.integrator.num_light_tree_infinite;
+  float r = *randu;
+
+  if (num_infinite > 0) {
+    const float pdf_infinite = kernel_data.integrator.light_tree_infinite_pdf;
+    const float infinite_total = pdf_infinite * num_infinite;
+
+    if (r < infinite_total) {
+      const int i = min((int)(r / pdf_infinite), num_infinite - 1);
+      *randu = light_tree_rescale_random((r - i * pdf_infinite) / pdf_infinite);
+      *pdf = pdf_infinite;
+      return kernel_data.integrator.num_light_tree_emitters + i;
+    }
+
+    r = light_tree_rescale_random((r - infinite_total) / (1.0f - infinite_total));
+  }
+
+  if (kernel_data.integrator.num_light_tree_emitters == 0) {
+    return -1;
+  }
+
+  float node_pdf = kernel_data.integrator.light_tree_pdf;
+  int node_index = 0;
+  const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, 0);
+
+  while (knode->num_emitters == 0) {
+    const int left_index = node_index + 1;
+    const int right_index = knode->child;
+    const ccl_global KernelLightTreeNode *kleft = &kernel_tex_fetch(__light_tree_nodes,
+                                                                    left_index);
+    const ccl_global KernelLightTreeNode *kright = &kernel_tex_fetch(__light_tree_nodes,
+                                                                     right_index);
+    const float importance_left = light_tree_node_importance(P, kleft);
+    const float importance_right = light_tree_node_importance(P, kright);
+    const float importance_total = importance_left + importance_right;
+
+    if (importance_total == 0.0f) {
+      return -1;
+    }
+
+    const float prob_left = importance_left / importance_total;
+
+    if (r < prob_left) {
+      r = light_tree_rescale_random(r / prob_left);
+      node_pdf *= prob_left;
+      node_index = left_index;
+      knode = kleft;
+    }
+    else {
+      r = light_tree_rescale_random((r - prob_left) / (1.0f - prob_left));
+      node_pdf *= 1.0f - prob_left;
+      node_index = right_index;
+      knode = kright;
+    }
+  }
+
+  /* Choose emitter in the leaf proportional to energy. */
+  const float target = r * knode->energy;
+  float energy_sum = 0.0f;
+
+  for (int i = 0; i < knode->num_emitters; i++) {
+    const int emitter = knode->child + i;
+    const float energy = kernel_tex_fetch(__light_tree_emitters, emitter).energy;
+
+    if (energy == 0.0f) {
+      continue;
+    }
+
+    if (target < energy_sum + energy || i == knode->num_emitters - 1) {
+      *randu = light_tree_rescale_random(max(target - energy_sum, 0.0f) / energy);
+      *pdf = node_pdf * energy / knode->energy;
+      return emitter;
+    }
+
+    energy_sum += energy;
+  }
+
+  return -1;
+}
+
+/* Probability of light_tree_sample() choosing the emitter for shading point P. */
+ccl_device float light_tree_emitter_pdf(KernelGlobals *kg, const float3 P, int emitter)
+{
+  const ccl_global KernelLightTreeEmitter *kemitter = &kernel_tex_fetch(__light_tree_emitters,
+                                                                        emitter);
+
+  if (kemitter->leaf == -1) {
+    return kernel_data.integrator.light_tree_infinite_pdf;
+  }
+
+  int node_index = kemitter->leaf;
+  const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, node_index);
+
+  if (knode->energy == 0.0f) {
+    return 0.0f;
+  }
+
+  float pdf = kernel_data.integrator.light_tree_pdf * kemitter->energy / knode->energy;
+
+  /* Walk up to the root, multiplying probabilities of choosing the branch containing the
+   * emitter at every inner node. */
+  while (knode->parent != -1) {
+    const int parent_index = knode->parent;
+    const ccl_global KernelLightTreeNode *kparent = &kernel_tex_fetch(__light_tree_nodes,
+                                                                      parent_index);
+    const int left_index = parent_index + 1;
+    const int sibling_index = (node_index == left_index) ? kparent->child : left_index;
+    const ccl_global KernelLightTreeNode *ksibling = &kernel_tex_fetch(__light_tree_nodes,
+                                                                       sibling_index);
+    const float importance = light_tree_node_importance(P, knode);
+    const float importance_total = importance + light_tree_node_importance(P, ksibling);
+
+    if (importance == 0.0f) {
+      return 0.0f;
+    }
+
+    pdf *= importance / importance_total;
+    node_index = parent_index;
+    knode = kparent;
+  }
+
+  return pdf;
+}
+
+ccl_device_inline float light_tree_lamp_pdf(KernelGlobals *kg, const float3 P, int lamp)
+{
+  const int emitter = kernel_tex_fetch(__light_tree_lamp_emitter, lamp);
+  return (emitter == -1) ? 0.0f : light_tree_emitter_pdf(kg, P, emitter);
+}
+
+/* Probability of choosing the triangle divided by its area, which is what pdf_triangles is
+ * without the light tree. */
+ccl_device_inline float light_tree_triangle_pdf(KernelGlobals *kg,
+                                                const float3 P,
+                                                int object,
+                                                int prim)
+{
+  const int triangle_offset = kernel_tex_fetch(__light_tree_object_lookup, object * 2);
+
+  if (triangle_offset == -1) {
+    return 0.0f;
+  }
+
+  const int prim_offset = kernel_tex_fetch(__light_tree_object_lookup, object * 2 + 1);
+  const int emitter = kernel_tex_fetch(__light_tree_triangle_emitter,
+                                       triangle_offset + prim - prim_offset);
+
+  if (emitter == -1) {
+    return 0.0f;
+  }
+
+  return light_tree_emitter_pdf(kg, P, emitter) *
+         kernel_tex_fetch(__light_tree_emitters, emitter).inv_area;
+}
+
+CCL_NAMESPACE_END
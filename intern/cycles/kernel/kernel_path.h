@@ -54,6 +54,24 @@
 
 CCL_NAMESPACE_BEGIN
 
+ccl_device_forceinline void kernel_path_scene_intersect_debug(ccl_addr_space PathState *state,
+                                                              Intersection *isect,
+                                                              PathRadiance *L)
+{
+#ifdef __KERNEL_DEBUG__
+  if (state->flag & PATH_RAY_CAMERA) {
+    L->debug_data.num_bvh_traversed_nodes += isect->num_traversed_nodes;
+    L->debug_data.num_bvh_traversed_instances += isect->num_traversed_instances;
+    L->debug_data.num_bvh_intersections += isect->num_intersections;
+  }
+  L->debug_data.num_ray_bounces++;
+#else
+  (void)state;
+  (void)isect;
+  (void)L;
+#endif /* __KERNEL_DEBUG__ */
+}
+
 ccl_device_forceinline bool kernel_path_scene_intersect(KernelGlobals *kg,
                                                         ccl_addr_space PathState *state,
                                                         Ray *ray,
@@ -71,14 +89,7 @@ ccl_device_forceinline bool kernel_path_scene_intersect(KernelGlobals *kg,
 
   bool hit = scene_intersect(kg, ray, visibility, isect);
 
-#ifdef __KERNEL_DEBUG__
-  if (state->flag & PATH_RAY_CAMERA) {
-    L->debug_data.num_bvh_traversed_nodes += isect->num_traversed_nodes;
-    L->debug_data.num_bvh_traversed_instances += isect->num_traversed_instances;
-    L->debug_data.num_bvh_intersections += isect->num_intersections;
-  }
-  L->debug_data.num_ray_bounces++;
-#endif /* __KERNEL_DEBUG__ */
+  kernel_path_scene_intersect_debug(state, isect, L);
 
   return hit;
 }
@@ -178,6 +189,13 @@ ccl_device_forceinline VolumeIntegrateResult kernel_path_volume(KernelGlobals *k
   bool direct = (state->flag & PATH_RAY_CAMERA) != 0;
   bool decoupled = kernel_volume_use_decoupled(kg, step_size, direct, sampling_method);
 
+#      ifdef __VOLUME_MAJORANT__
+  /* Tracking through the majorant grid replaces decoupled ray marching. */
+  if (volume_stack_majorant_object(kg, state->volume_stack) != OBJECT_NONE) {
+    decoupled = false;
+  }
+#      endif
+
   if (decoupled) {
     /* cache steps along volume for repeated sampling */
     VolumeSegment volume_segment;
@@ -512,13 +530,19 @@ ccl_device_forceinline void kernel_path_integrate(KernelGlobals *kg,
                                                   Ray *ray,
                                                   PathRadiance *L,
                                                   ccl_global float *buffer,
-                                                  ShaderData *emission_sd)
+                                                  ShaderData *emission_sd,
+                                                  Intersection *camera_isect)
 {
   PROFILING_INIT(kg, PROFILING_PATH_INTEGRATE);
 
   /* Shader data memory used for both volumes and surfaces, saves stack space. */
   ShaderData sd;
 
+#  ifdef __PATH_GUIDING__
+  PathGuidingRecord guiding_record;
+  path_guiding_record_init(&guiding_record);
+#  endif
+
 #  ifdef __SUBSURFACE__
   SubsurfaceIndirectRays ss_indirect;
   kernel_path_subsurface_init_indirect(&ss_indirect);
@@ -530,7 +554,18 @@ ccl_device_forceinline void kernel_path_integrate(KernelGlobals *kg,
     for (;;) {
       /* Find intersection with objects in scene. */
       Intersection isect;
-      bool hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+      bool hit;
+
+      if (camera_isect != NULL) {
+        /* Camera ray was already traced as part of a packet. */
+        isect = *camera_isect;
+        hit = (isect.prim != PRIM_NONE);
+        camera_isect = NULL;
+        kernel_path_scene_intersect_debug(state, &isect, L);
+      }
+      else {
+        hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+      }
 
       /* Find intersection with lamps and compute emission for MIS. */
       kernel_path_lamp_emission(kg, state, ray, throughput, &isect, &sd, L);
@@ -624,8 +659,17 @@ ccl_device_forceinline void kernel_path_integrate(KernelGlobals *kg,
       /* compute direct lighting and next bounce */
       if (!kernel_path_surface_bounce(kg, &sd, &throughput, state, &L->state, ray))
         break;
+
+#  ifdef __PATH_GUIDING__
+      path_guiding_record_vertex(kg, &guiding_record, &sd, state, ray, throughput, L);
+#  endif
     }
 
+#  ifdef __PATH_GUIDING__
+    /* Add radiance of the path to the training data. */
+    path_guiding_record_splat(kg, &guiding_record, L);
+#  endif
+
 #  ifdef __SUBSURFACE__
     /* Trace indirect subsurface rays by restarting the loop. this uses less
      * stack memory than invoking kernel_path_indirect.
@@ -689,11 +733,105 @@ ccl_device void kernel_path_trace(
 #  endif
 
   /* Integrate. */
-  kernel_path_integrate(kg, &state, throughput, &ray, &L, buffer, emission_sd);
+  kernel_path_integrate(kg, &state, throughput, &ray, &L, buffer, emission_sd, NULL);
 
   kernel_write_result(kg, buffer, sample, &L);
 }
 
+#  ifdef __BVH_PACKET__
+/* Path trace a row of pixels, with camera rays of neighboring pixels traced as packets. */
+ccl_device void kernel_path_trace_packet(KernelGlobals *kg,
+                                         ccl_global float *buffer,
+                                         int sample,
+                                         int x,
+                                         int y,
+                                         int num_pixels,
+                                         int offset,
+                                         int stride)
+{
+  const int pass_stride = kernel_data.film.pass_stride;
+
+  ShaderDataTinyStorage emission_sd_storage;
+  ShaderData *emission_sd = AS_SHADER_DATA(&emission_sd_storage);
+
+  for (int packet_x = x; packet_x < x + num_pixels; packet_x += BVH_PACKET_SIZE) {
+    const int packet_end = min(packet_x + BVH_PACKET_SIZE, x + num_pixels);
+
+    Ray rays[BVH_PACKET_SIZE];
+    PathState states[BVH_PACKET_SIZE];
+    ccl_global float *buffers[BVH_PACKET_SIZE];
+    int num_rays = 0;
+
+    {
+      PROFILING_INIT(kg, PROFILING_RAY_SETUP);
+
+      for (int px = packet_x; px < packet_end; px++) {
+        ccl_global float *pixel_buffer = buffer + (offset + px + y * stride) * pass_stride;
+
+        if (kernel_data.film.pass_adaptive_aux_buffer) {
+          ccl_global float4 *aux = (ccl_global float4 *)(pixel_buffer +
+                                                         kernel_data.film.pass_adaptive_aux_buffer);
+          if ((*aux).w > 0.0f) {
+            continue;
+          }
+        }
+
+        /* Initialize random numbers and sample ray. */
+        uint rng_hash;
+        kernel_path_trace_setup(kg, sample, px, y, &rng_hash, &rays[num_rays]);
+
+        if (rays[num_rays].t == 0.0f) {
+          continue;
+        }
+
+        path_state_init(kg, emission_sd, &states[num_rays], rng_hash, sample, &rays[num_rays]);
+        buffers[num_rays] = pixel_buffer;
+        num_rays++;
+      }
+    }
+
+    if (num_rays == 0) {
+      continue;
+    }
+
+    /* Trace camera rays together. These normally all have the same visibility, any that
+     * differ are traced on their own when integrating. */
+    const uint visibility = path_state_ray_visibility(kg, &states[0]);
+    Ray packet_rays[BVH_PACKET_SIZE];
+    int packet_index[BVH_PACKET_SIZE];
+    int num_packet_rays = 0;
+
+    for (int i = 0; i < num_rays; i++) {
+      packet_index[i] = -1;
+      if (path_state_ray_visibility(kg, &states[i]) == visibility &&
+          !path_state_ao_bounce(kg, &states[i])) {
+        packet_rays[num_packet_rays] = rays[i];
+        packet_index[i] = num_packet_rays++;
+      }
+    }
+
+    Intersection packet_isects[BVH_PACKET_SIZE];
+    scene_intersect_packet(kg, packet_rays, num_packet_rays, visibility, packet_isects);
+
+    /* Integrate. */
+    for (int i = 0; i < num_rays; i++) {
+      float3 throughput = make_float3(1.0f, 1.0f, 1.0f);
+
+      PathRadiance L;
+      path_radiance_init(kg, &L);
+
+      Intersection *camera_isect = (packet_index[i] != -1) ? &packet_isects[packet_index[i]] :
+                                                             NULL;
+
+      kernel_path_integrate(
+          kg, &states[i], throughput, &rays[i], &L, buffers[i], emission_sd, camera_isect);
+
+      kernel_write_result(kg, buffers[i], sample, &L);
+    }
+  }
+}
+#  endif /* __BVH_PACKET__ */
+
 #endif /* __SPLIT_KERNEL__ */
 
 CCL_NAMESPACE_END
@@ -95,7 +95,16 @@ ccl_device_forceinline void kernel_branched_path_volume(KernelGlobals *kg,
 
 #      ifdef __VOLUME_DECOUPLED__
   /* decoupled ray marching only supported on CPU */
-  if (kernel_data.integrator.volume_decoupled) {
+  bool decoupled = kernel_data.integrator.volume_decoupled;
+
+#        ifdef __VOLUME_MAJORANT__
+  /* tracking through the majorant grid replaces decoupled ray marching */
+  if (volume_stack_majorant_object(kg, state->volume_stack) != OBJECT_NONE) {
+    decoupled = false;
+  }
+#        endif
+
+  if (decoupled) {
     /* cache steps along volume for repeated sampling */
     VolumeSegment volume_segment;
 
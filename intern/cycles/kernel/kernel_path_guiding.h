@@ -0,0 +1,247 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/util_atomic.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Path Guiding
+ *
+ * Surface bounces sample directions from a mix of the BSDF and a distribution of incident
+ * radiance learned in the first samples, with the mixture pdf used for MIS with light sampling.
+ * The distribution is a directional histogram per cell of a regular grid over the scene, built
+ * on the host from radiance recorded along the paths of the training samples. */
+
+#ifdef __PATH_GUIDING__
+
+ccl_device_inline int path_guiding_cell(const KernelPathGuiding *guiding, float3 P)
+{
+  const float3 cell = (P - guiding->bounds_min) * guiding->inv_cell_size;
+  const int x = clamp((int)cell.x, 0, guiding->resolution[0] - 1);
+  const int y = clamp((int)cell.y, 0, guiding->resolution[1] - 1);
+  const int z = clamp((int)cell.z, 0, guiding->resolution[2] - 1);
+
+  return x + guiding->resolution[0] * (y + guiding->resolution[1] * z);
+}
+
+ccl_device_inline int path_guiding_bin(float3 D)
+{
+  const float phi = atan2f(D.y, D.x);
+  const int theta_bin = clamp(
+      (int)((D.z + 1.0f) * (0.5f * PATH_GUIDING_THETA_BINS)), 0, PATH_GUIDING_THETA_BINS - 1);
+  const int phi_bin = clamp((int)((phi + M_PI_F) * (PATH_GUIDING_PHI_BINS * M_1_2PI_F)),
+                            0,
+                            PATH_GUIDING_PHI_BINS - 1);
+
+  return theta_bin * PATH_GUIDING_PHI_BINS + phi_bin;
+}
+
+/* Uniformly distributed direction inside of a bin. */
+ccl_device_inline float3 path_guiding_bin_direction(int bin, float randu, float randv)
+{
+  /* Stay away from bin edges, where precision issues could map the direction to the
+   * neighboring bin with a different pdf. */
+  randu = clamp(randu, 1e-4f, 1.0f - 1e-4f);
+  randv = clamp(randv, 1e-4f, 1.0f - 1e-4f);
+
+  const int theta_bin = bin / PATH_GUIDING_PHI_BINS;
+  const int phi_bin = bin - theta_bin * PATH_GUIDING_PHI_BINS;
+
+  const float z = (theta_bin + randu) * (2.0f / PATH_GUIDING_THETA_BINS) - 1.0f;
+  const float r = safe_sqrtf(1.0f - z * z);
+  const float phi = (phi_bin + randv) * (M_2PI_F / PATH_GUIDING_PHI_BINS) - M_PI_F;
+
+  return make_float3(r * cosf(phi), r * sinf(phi), z);
+}
+
+ccl_device_inline bool path_guiding_closure_supported(ClosureType type)
+{
+  /* Singular closures can not be mixed with a continuous distribution, and transmission is
+   * left to BSDF sampling. */
+  return CLOSURE_IS_BSDF_DIFFUSE(type) ||
+         (CLOSURE_IS_BSDF_GLOSSY(type) && !CLOSURE_IS_BSDF_SINGULAR(type) &&
+          type != CLOSURE_BSDF_HAIR_REFLECTION_ID && type != CLOSURE_BSDF_HAIR_PRINCIPLED_ID);
+}
+
+/* Probability of sampling from the guiding distribution at the shading point, zero when
+ * guiding is not used there. Must give the same result for BSDF sampling and evaluation. */
+ccl_device_inline float path_guiding_probability(KernelGlobals *kg,
+                                                 const ShaderData *sd,
+                                                 int *cell)
+{
+  const KernelPathGuiding *guiding = kg->path_guiding;
+
+  if (guiding == NULL || guiding->mix_probability == 0.0f || (sd->flag & SD_BSSRDF)) {
+    return 0.0f;
+  }
+
+  for (int i = 0; i < sd->num_closure; i++) {
+    const ShaderClosure *sc = &sd->closure[i];
+
+    if (CLOSURE_IS_BSDF(sc->type) && !path_guiding_closure_supported(sc->type)) {
+      return 0.0f;
+    }
+  }
+
+  *cell = path_guiding_cell(guiding, sd->P);
+
+  if (guiding->cdf[*cell * (PATH_GUIDING_BINS + 1) + PATH_GUIDING_BINS] == 0.0f) {
+    return 0.0f;
+  }
+
+  return guiding->mix_probability;
+}
+
+ccl_device_inline float path_guiding_pdf(KernelGlobals *kg, int cell, float3 D)
+{
+  const float *cdf = kg->path_guiding->cdf + cell * (PATH_GUIDING_BINS + 1);
+  const int bin = path_guiding_bin(D);
+
+  return (cdf[bin + 1] - cdf[bin]) * (PATH_GUIDING_BINS / M_4PI_F);
+}
+
+ccl_device_inline float3 path_guiding_sample(
+    KernelGlobals *kg, int cell, float randu, float randv, float *pdf)
+{
+  const float *cdf = kg->path_guiding->cdf + cell * (PATH_GUIDING_BINS + 1);
+
+  /* Find bin with cdf[bin] <= randu < cdf[bin + 1]. */
+  int first = 0;
+  int len = PATH_GUIDING_BINS;
+
+  while (len > 0) {
+    const int half_len = len >> 1;
+    const int middle = first + half_len;
+
+    if (randu < cdf[middle + 1]) {
+      len = half_len;
+    }
+    else {
+      first = middle + 1;
+      len = len - half_len - 1;
+    }
+  }
+
+  const int bin = min(first, PATH_GUIDING_BINS - 1);
+  const float bin_pdf = cdf[bin + 1] - cdf[bin];
+
+  /* Rescale to reuse for the direction inside of the bin. */
+  randu = (bin_pdf > 0.0f) ? (randu - cdf[bin]) / bin_pdf : 0.5f;
+
+  *pdf = bin_pdf * (PATH_GUIDING_BINS / M_4PI_F);
+  return path_guiding_bin_direction(bin, randu, randv);
+}
+
+/* Pdf of the mix of BSDF and guiding distribution, for MIS with light sampling. */
+ccl_device_inline float path_guiding_mix_pdf(KernelGlobals *kg,
+                                             const ShaderData *sd,
+                                             float3 omega_in,
+                                             float bsdf_pdf)
+{
+  int cell;
+  const float guiding_probability = path_guiding_probability(kg, sd, &cell);
+
+  if (guiding_probability == 0.0f) {
+    return bsdf_pdf;
+  }
+
+  return guiding_probability * path_guiding_pdf(kg, cell, omega_in) +
+         (1.0f - guiding_probability) * bsdf_pdf;
+}
+
+/* Training
+ *
+ * The incident radiance along a sampled direction is only known when the path is done, so path
+ * vertices are recorded with the radiance accumulated so far and the throughput after the
+ * bounce. The radiance added after the vertex divided by that throughput is an estimate of the
+ * incident radiance, which divided by the sampling pdf is added to the bin of the direction. */
+
+typedef struct PathGuidingVertex {
+  float3 L;
+  float3 throughput;
+  float pdf;
+  int cell;
+  int bin;
+} PathGuidingVertex;
+
+typedef struct PathGuidingRecord {
+  PathGuidingVertex vertex[PATH_GUIDING_MAX_VERTICES];
+  int num_vertices;
+} PathGuidingRecord;
+
+ccl_device_inline void path_guiding_record_init(PathGuidingRecord *record)
+{
+  record->num_vertices = 0;
+}
+
+ccl_device_inline void path_guiding_record_vertex(KernelGlobals *kg,
+                                                  PathGuidingRecord *record,
+                                                  const ShaderData *sd,
+                                                  const PathState *state,
+                                                  const Ray *ray,
+                                                  float3 throughput,
+                                                  PathRadiance *L)
+{
+  const KernelPathGuiding *guiding = kg->path_guiding;
+
+  if (guiding == NULL || guiding->training == NULL ||
+      record->num_vertices == PATH_GUIDING_MAX_VERTICES) {
+    return;
+  }
+
+  /* Only bounces off surfaces with a continuous pdf. */
+  if (!(sd->flag & SD_BSDF) || (state->flag & (PATH_RAY_TRANSPARENT | PATH_RAY_SINGULAR))) {
+    return;
+  }
+
+  PathGuidingVertex *vertex = &record->vertex[record->num_vertices++];
+  vertex->L = path_radiance_total(L);
+  vertex->throughput = throughput;
+  vertex->pdf = state->ray_pdf;
+  vertex->cell = path_guiding_cell(guiding, sd->P);
+  vertex->bin = path_guiding_bin(ray->D);
+}
+
+ccl_device_inline void path_guiding_record_splat(KernelGlobals *kg,
+                                                 PathGuidingRecord *record,
+                                                 PathRadiance *L)
+{
+  if (record->num_vertices == 0) {
+    return;
+  }
+
+  float *training = kg->path_guiding->training;
+  const float3 L_total = path_radiance_total(L);
+
+  for (int i = 0; i < record->num_vertices; i++) {
+    const PathGuidingVertex *vertex = &record->vertex[i];
+    float *cell_training = training + vertex->cell * (PATH_GUIDING_BINS + 1);
+
+    const float3 L_incident = safe_divide_color(L_total - vertex->L, vertex->throughput);
+    const float weight = linear_rgb_to_gray(kg, L_incident) / vertex->pdf;
+
+    if (weight > 0.0f && isfinite_safe(weight)) {
+      atomic_add_and_fetch_float(&cell_training[vertex->bin], weight);
+    }
+    atomic_add_and_fetch_float(&cell_training[PATH_GUIDING_BINS], 1.0f);
+  }
+
+  record->num_vertices = 0;
+}
+
+#endif /* __PATH_GUIDING__ */
+
+CCL_NAMESPACE_END
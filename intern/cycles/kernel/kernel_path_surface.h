@@ -287,8 +287,28 @@ ccl_device bool kernel_path_surface_bounce(KernelGlobals *kg,
     path_state_rng_2D(kg, state, PRNG_BSDF_U, &bsdf_u, &bsdf_v);
     int label;
 
-    label = shader_bsdf_sample(
-        kg, sd, bsdf_u, bsdf_v, &bsdf_eval, &bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+#ifdef __PATH_GUIDING__
+    int guiding_cell;
+    const float guiding_probability = path_guiding_probability(kg, sd, &guiding_cell);
+
+    if (guiding_probability > 0.0f) {
+      label = shader_bsdf_sample_guided(kg,
+                                        sd,
+                                        guiding_cell,
+                                        guiding_probability,
+                                        bsdf_u,
+                                        bsdf_v,
+                                        &bsdf_eval,
+                                        &bsdf_omega_in,
+                                        &bsdf_domega_in,
+                                        &bsdf_pdf);
+    }
+    else
+#endif
+    {
+      label = shader_bsdf_sample(
+          kg, sd, bsdf_u, bsdf_v, &bsdf_eval, &bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+    }
 
     if (bsdf_pdf == 0.0f || bsdf_eval_is_zero(&bsdf_eval))
       return false;
@@ -32,6 +32,10 @@
 
 #include "kernel/svm/svm.h"
 
+#ifdef __PATH_GUIDING__
+#  include "kernel/kernel_path_guiding.h"
+#endif
+
 CCL_NAMESPACE_BEGIN
 
 /* ShaderData setup from incoming ray */
@@ -629,6 +633,10 @@ ccl_device_inline
     float pdf;
     _shader_bsdf_multi_eval(kg, sd, omega_in, &pdf, NULL, eval, 0.0f, 0.0f);
     if (use_mis) {
+#ifdef __PATH_GUIDING__
+      /* Match the pdf of BSDF sampling mixed with path guiding. */
+      pdf = path_guiding_mix_pdf(kg, sd, omega_in, pdf);
+#endif
       float weight = power_heuristic(light_pdf, pdf);
       bsdf_eval_mis(eval, weight);
     }
@@ -774,6 +782,76 @@ ccl_device_inline int shader_bsdf_sample(KernelGlobals *kg,
   return label;
 }
 
+#ifdef __PATH_GUIDING__
+/* Sample a direction from the mix of the BSDF and the path guiding distribution, with
+ * guiding_probability from path_guiding_probability(). The returned pdf is the mixture pdf. */
+ccl_device int shader_bsdf_sample_guided(KernelGlobals *kg,
+                                         ShaderData *sd,
+                                         int guiding_cell,
+                                         float guiding_probability,
+                                         float randu,
+                                         float randv,
+                                         BsdfEval *bsdf_eval,
+                                         float3 *omega_in,
+                                         differential3 *domega_in,
+                                         float *pdf)
+{
+  int label;
+  float bsdf_pdf, guiding_pdf;
+
+  if (randu < guiding_probability) {
+    /* Sample guiding distribution and evaluate all closures. */
+    randu /= guiding_probability;
+    *omega_in = path_guiding_sample(kg, guiding_cell, randu, randv, &guiding_pdf);
+
+    const float cos_NO = dot(sd->Ng, *omega_in);
+    if (guiding_pdf == 0.0f || cos_NO == 0.0f) {
+      *pdf = 0.0f;
+      return LABEL_NONE;
+    }
+
+    PROFILING_INIT(kg, PROFILING_CLOSURE_EVAL);
+
+    bsdf_eval_init(bsdf_eval,
+                   NBUILTIN_CLOSURES,
+                   make_float3(0.0f, 0.0f, 0.0f),
+                   kernel_data.film.use_light_pass);
+    _shader_bsdf_multi_eval(kg, sd, *omega_in, &bsdf_pdf, NULL, bsdf_eval, 0.0f, 0.0f);
+
+    /* Count the bounce as diffuse if there is any diffuse closure. */
+    label = (cos_NO > 0.0f) ? LABEL_REFLECT : LABEL_TRANSMIT;
+    label |= LABEL_GLOSSY;
+    for (int i = 0; i < sd->num_closure; i++) {
+      if (CLOSURE_IS_BSDF_DIFFUSE(sd->closure[i].type)) {
+        label = (label & ~LABEL_GLOSSY) | LABEL_DIFFUSE;
+        break;
+      }
+    }
+
+#  ifdef __RAY_DIFFERENTIALS__
+    /* Same approximation as for diffuse BSDF sampling. */
+    domega_in->dx = (2.0f * dot(sd->N, sd->dI.dx)) * sd->N - sd->dI.dx;
+    domega_in->dy = (2.0f * dot(sd->N, sd->dI.dy)) * sd->N - sd->dI.dy;
+#  endif
+  }
+  else {
+    /* Sample BSDF and look up guiding distribution. */
+    randu = (randu - guiding_probability) / (1.0f - guiding_probability);
+    label = shader_bsdf_sample(kg, sd, randu, randv, bsdf_eval, omega_in, domega_in, &bsdf_pdf);
+
+    if (bsdf_pdf == 0.0f) {
+      *pdf = 0.0f;
+      return label;
+    }
+
+    guiding_pdf = path_guiding_pdf(kg, guiding_cell, *omega_in);
+  }
+
+  *pdf = guiding_probability * guiding_pdf + (1.0f - guiding_probability) * bsdf_pdf;
+  return label;
+}
+#endif /* __PATH_GUIDING__ */
+
 ccl_device int shader_bsdf_sample_closure(KernelGlobals *kg,
                                           ShaderData *sd,
                                           const ShaderClosure *sc,
@@ -36,6 +36,10 @@ KERNEL_TEX(Transform, __object_motion_pass)
 KERNEL_TEX(DecomposedTransform, __object_motion)
 KERNEL_TEX(uint, __object_flag)
 KERNEL_TEX(float, __object_volume_step)
+KERNEL_TEX(KernelVolumeMajorant, __object_volume_majorant)
+
+/* volumes */
+KERNEL_TEX(float, __volume_majorant)
 
 /* cameras */
 KERNEL_TEX(DecomposedTransform, __camera_motion)
@@ -66,6 +70,11 @@ KERNEL_TEX(KernelLightDistribution, __light_distribution)
 KERNEL_TEX(KernelLight, __lights)
 KERNEL_TEX(float2, __light_background_marginal_cdf)
 KERNEL_TEX(float2, __light_background_conditional_cdf)
+KERNEL_TEX(KernelLightTreeNode, __light_tree_nodes)
+KERNEL_TEX(KernelLightTreeEmitter, __light_tree_emitters)
+KERNEL_TEX(int, __light_tree_lamp_emitter)
+KERNEL_TEX(int, __light_tree_object_lookup)
+KERNEL_TEX(int, __light_tree_triangle_emitter)
 
 /* particles */
 KERNEL_TEX(KernelParticle, __particles)
@@ -128,6 +128,10 @@ CCL_NAMESPACE_BEGIN
 #  endif
 #  define __VOLUME_DECOUPLED__
 #  define __VOLUME_RECORD_ALL__
+#  define __BVH_COMPRESSED__
+#  define __BVH_PACKET__
+#  define __PATH_GUIDING__
+#  define __VOLUME_MAJORANT__
 #endif /* __KERNEL_CPU__ */
 
 #ifdef __KERNEL_CUDA__
@@ -1387,9 +1391,16 @@ typedef struct KernelIntegrator {
 
   int start_sample;
 
+  /* light tree */
+  int use_light_tree;
+  int num_light_tree_emitters;
+  int num_light_tree_infinite;
+  float light_tree_pdf;
+  float light_tree_infinite_pdf;
+
   int max_closures;
 
-  int pad1, pad2;
+  int pad1;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
 
@@ -1399,6 +1410,8 @@ typedef enum KernelBVHLayout {
   BVH_LAYOUT_BVH2 = (1 << 0),
   BVH_LAYOUT_EMBREE = (1 << 1),
   BVH_LAYOUT_OPTIX = (1 << 2),
+  /* BVH2 with quantized child bounds and compact leaves, CPU only. */
+  BVH_LAYOUT_BVH2_COMPRESSED = (1 << 3),
 
   /* Default BVH layout to use for CPU. */
   BVH_LAYOUT_AUTO = BVH_LAYOUT_EMBREE,
@@ -1486,6 +1499,18 @@ typedef struct KernelObject {
 } KernelObject;
 static_assert_align(KernelObject, 16);
 
+/* Coarse grid with an upper bound of the extinction coefficient per cell, used for tracking
+ * through heterogeneous volumes without ray marching. */
+typedef struct KernelVolumeMajorant {
+  /* World space to grid cell coordinates. */
+  Transform tfm;
+
+  /* Offset into the majorant values, -1 if the object has no majorant grid. */
+  int offset;
+  int resolution[3];
+} KernelVolumeMajorant;
+static_assert_align(KernelVolumeMajorant, 16);
+
 typedef struct KernelSpotLight {
   float radius;
   float invarea;
@@ -1548,6 +1573,38 @@ typedef struct KernelLightDistribution {
 } KernelLightDistribution;
 static_assert_align(KernelLightDistribution, 16);
 
+typedef struct KernelLightTreeNode {
+  /* Spatial bounds. */
+  float bbox_min[3];
+  /* Total energy of emitters in the node. */
+  float energy;
+  float bbox_max[3];
+  /* Index of the parent node, -1 for the root. */
+  int parent;
+  /* Orientation bounds: cone around axis containing all emitter normals, and the angle around
+   * the normals in which light is emitted. */
+  float axis[3];
+  float theta_o;
+  float theta_e;
+  /* For inner nodes index of the second child, first child directly follows the node.
+   * For leaves index of the first emitter. */
+  int child;
+  /* Zero for inner nodes. */
+  int num_emitters;
+  int pad;
+} KernelLightTreeNode;
+static_assert_align(KernelLightTreeNode, 16);
+
+typedef struct KernelLightTreeEmitter {
+  float energy;
+  /* Inverse of triangle area, zero for lamps. */
+  float inv_area;
+  int distribution_index;
+  /* Leaf node containing the emitter, -1 for distant and background lights. */
+  int leaf;
+} KernelLightTreeEmitter;
+static_assert_align(KernelLightTreeEmitter, 16);
+
 typedef struct KernelParticle {
   int index;
   float age;
@@ -1703,6 +1760,38 @@ typedef struct WorkTile {
 #define NUM_PMJ_SAMPLES 64 * 64
 #define NUM_PMJ_PATTERNS 48
 
+/* Path Guiding
+ *
+ * Distribution of incident radiance learned while rendering, stored per cell of a regular grid
+ * over the scene as a histogram over directions. Directions are binned with an equal area
+ * mapping, uniform in cos(theta) and phi, so all bins have the same solid angle. */
+
+#define PATH_GUIDING_THETA_BINS 8
+#define PATH_GUIDING_PHI_BINS 16
+#define PATH_GUIDING_BINS (PATH_GUIDING_THETA_BINS * PATH_GUIDING_PHI_BINS)
+/* Number of path vertices per path that are recorded for training. */
+#define PATH_GUIDING_MAX_VERTICES 8
+
+#ifdef __KERNEL_CPU__
+typedef struct KernelPathGuiding {
+  float3 bounds_min;
+  float3 inv_cell_size;
+  int resolution[3];
+
+  /* Probability of sampling a direction from the guiding distribution instead of the BSDF,
+   * zero until a distribution was learned. */
+  float mix_probability;
+
+  /* Cumulative distribution over bins per cell, PATH_GUIDING_BINS + 1 values each. The last
+   * value is zero for cells without a distribution. */
+  const float *cdf;
+
+  /* Accumulated radiance of training paths per cell and bin, followed by the number of
+   * recorded path vertices in the cell. NULL when not learning. */
+  float *training;
+} KernelPathGuiding;
+#endif
+
 CCL_NAMESPACE_END
 
 #endif /*  __KERNEL_TYPES_H__ */
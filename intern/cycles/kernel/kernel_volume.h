@@ -172,6 +172,134 @@ ccl_device int volume_stack_sampling_method(KernelGlobals *kg, VolumeStack *stac
   return method;
 }
 
+#  ifdef __VOLUME_MAJORANT__
+/* Majorant Grid
+ *
+ * Objects with a majorant grid are rendered with unbiased tracking instead of ray marching, when
+ * they are the only volume along the ray. Collisions are sampled proportional to the majorant of
+ * the grid cells the ray passes through, so time is only spent where there is density. */
+
+typedef struct VolumeMajorantIterator {
+  int offset;
+  int resolution[3];
+  int cell[3];
+  int step[3];
+  float t_next[3];
+  float t_delta[3];
+  float t;
+  float t_end;
+} VolumeMajorantIterator;
+
+ccl_device_inline int volume_stack_majorant_object(KernelGlobals *kg,
+                                                   ccl_addr_space VolumeStack *stack)
+{
+  const int object = stack[0].object;
+
+  if (object == OBJECT_NONE || stack[1].shader != SHADER_NONE) {
+    return OBJECT_NONE;
+  }
+
+  return (kernel_tex_fetch(__object_volume_majorant, object).offset != -1) ? object : OBJECT_NONE;
+}
+
+/* Set up traversal of the grid cells along the ray, returns false if the ray misses the grid. */
+ccl_device bool kernel_volume_majorant_init(KernelGlobals *kg,
+                                            int object,
+                                            const Ray *ray,
+                                            VolumeMajorantIterator *iter)
+{
+  const KernelVolumeMajorant majorant = kernel_tex_fetch(__object_volume_majorant, object);
+  const float3 P = transform_point(&majorant.tfm, ray->P);
+  const float3 D = transform_direction(&majorant.tfm, ray->D);
+  const float ray_P[3] = {P.x, P.y, P.z};
+  const float ray_D[3] = {D.x, D.y, D.z};
+
+  /* Clip ray to grid bounds. */
+  float t_enter = 0.0f;
+  float t_exit = ray->t;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float res = (float)majorant.resolution[axis];
+
+    if (ray_D[axis] == 0.0f) {
+      if (!(ray_P[axis] >= 0.0f && ray_P[axis] < res)) {
+        return false;
+      }
+    }
+    else {
+      const float inv_D = 1.0f / ray_D[axis];
+      const float t0 = -ray_P[axis] * inv_D;
+      const float t1 = (res - ray_P[axis]) * inv_D;
+      t_enter = max(t_enter, min(t0, t1));
+      t_exit = min(t_exit, max(t0, t1));
+    }
+  }
+
+  if (!(t_enter < t_exit)) {
+    return false;
+  }
+
+  iter->offset = majorant.offset;
+  iter->t = t_enter;
+  iter->t_end = t_exit;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const int res = majorant.resolution[axis];
+    const float cell_P = ray_P[axis] + ray_D[axis] * t_enter;
+    const int cell = clamp((int)floorf(cell_P), 0, res - 1);
+
+    iter->resolution[axis] = res;
+    iter->cell[axis] = cell;
+
+    if (ray_D[axis] == 0.0f) {
+      iter->step[axis] = 0;
+      iter->t_next[axis] = FLT_MAX;
+      iter->t_delta[axis] = FLT_MAX;
+    }
+    else {
+      const float inv_D = 1.0f / ray_D[axis];
+      iter->step[axis] = (ray_D[axis] > 0.0f) ? 1 : -1;
+      iter->t_next[axis] = (cell + (ray_D[axis] > 0.0f) - ray_P[axis]) * inv_D;
+      iter->t_delta[axis] = fabsf(inv_D);
+    }
+  }
+
+  return true;
+}
+
+/* Advance to the next cell, returns the segment of the ray inside of it and its majorant. */
+ccl_device bool kernel_volume_majorant_next(KernelGlobals *kg,
+                                            VolumeMajorantIterator *iter,
+                                            float *t0,
+                                            float *t1,
+                                            float *sigma_majorant)
+{
+  if (iter->t >= iter->t_end) {
+    return false;
+  }
+
+  int axis = (iter->t_next[0] < iter->t_next[1]) ? 0 : 1;
+  axis = (iter->t_next[2] < iter->t_next[axis]) ? 2 : axis;
+
+  const int index = iter->cell[0] +
+                    iter->resolution[0] * (iter->cell[1] + iter->resolution[1] * iter->cell[2]);
+
+  *t0 = iter->t;
+  *t1 = min(iter->t_next[axis], iter->t_end);
+  *sigma_majorant = kernel_tex_fetch(__volume_majorant, iter->offset + index);
+
+  iter->t = *t1;
+  iter->t_next[axis] += iter->t_delta[axis];
+  iter->cell[axis] += iter->step[axis];
+
+  if (iter->cell[axis] < 0 || iter->cell[axis] >= iter->resolution[axis]) {
+    iter->t = iter->t_end;
+  }
+
+  return true;
+}
+#  endif /* __VOLUME_MAJORANT__ */
+
 ccl_device_inline void kernel_volume_step_init(KernelGlobals *kg,
                                                ccl_addr_space PathState *state,
                                                const float object_step_size,
@@ -272,6 +400,61 @@ ccl_device void kernel_volume_shadow_heterogeneous(KernelGlobals *kg,
   *throughput = tp;
 }
 
+#  ifdef __VOLUME_MAJORANT__
+/* ratio tracking through the majorant grid: multiply by the probability of a null collision
+ * at each tentative collision, with russian roulette once most light is blocked */
+ccl_device void kernel_volume_shadow_majorant(KernelGlobals *kg,
+                                              ccl_addr_space PathState *state,
+                                              Ray *ray,
+                                              ShaderData *sd,
+                                              float3 *throughput,
+                                              const int object)
+{
+  VolumeMajorantIterator iter;
+  if (!kernel_volume_majorant_init(kg, object, ray, &iter)) {
+    return;
+  }
+
+  float3 transmittance = make_float3(1.0f, 1.0f, 1.0f);
+  uint lcg_state = lcg_state_init_addrspace(state, 0x3a5c79d1);
+  int steps = kernel_data.integrator.volume_max_steps;
+
+  float t0, t1, sigma_majorant;
+  while (steps > 0 && kernel_volume_majorant_next(kg, &iter, &t0, &t1, &sigma_majorant)) {
+    if (sigma_majorant == 0.0f) {
+      continue;
+    }
+
+    for (float t = t0; steps > 0; steps--) {
+      t -= logf(1.0f - lcg_step_float_addrspace(&lcg_state)) / sigma_majorant;
+      if (t >= t1) {
+        break;
+      }
+
+      float3 sigma_t = make_float3(0.0f, 0.0f, 0.0f);
+      if (!volume_shader_extinction_sample(kg, sd, state, ray->P + ray->D * t, &sigma_t)) {
+        continue;
+      }
+
+      /* Clamped in case the majorant is exceeded, which would make this biased. */
+      transmittance *= max(make_float3(1.0f, 1.0f, 1.0f) - sigma_t / sigma_majorant,
+                           make_float3(0.0f, 0.0f, 0.0f));
+
+      const float probability = max3(transmittance);
+      if (probability < 0.2f) {
+        if (lcg_step_float_addrspace(&lcg_state) >= probability) {
+          *throughput = make_float3(0.0f, 0.0f, 0.0f);
+          return;
+        }
+        transmittance /= probability;
+      }
+    }
+  }
+
+  *throughput *= transmittance;
+}
+#  endif /* __VOLUME_MAJORANT__ */
+
 /* get the volume attenuation over line segment defined by ray, with the
  * assumption that there are no surfaces blocking light between the endpoints */
 ccl_device_noinline void kernel_volume_shadow(KernelGlobals *kg,
@@ -282,6 +465,14 @@ ccl_device_noinline void kernel_volume_shadow(KernelGlobals *kg,
 {
   shader_setup_from_volume(kg, shadow_sd, ray);
 
+#  ifdef __VOLUME_MAJORANT__
+  const int majorant_object = volume_stack_majorant_object(kg, state->volume_stack);
+  if (majorant_object != OBJECT_NONE) {
+    kernel_volume_shadow_majorant(kg, state, ray, shadow_sd, throughput, majorant_object);
+    return;
+  }
+#  endif
+
   float step_size = volume_stack_step_size(kg, state->volume_stack);
   if (step_size != FLT_MAX)
     kernel_volume_shadow_heterogeneous(kg, state, ray, shadow_sd, throughput, step_size);
@@ -688,6 +879,110 @@ kernel_volume_integrate_heterogeneous_distance(KernelGlobals *kg,
   return VOLUME_PATH_ATTENUATED;
 }
 
+#  ifdef __VOLUME_MAJORANT__
+/* weighted delta tracking through the majorant grid, as in:
+ * "Spectral and Decomposition Tracking for Rendering Heterogeneous Volumes".
+ * Peter Kutz, Ralf Habel, Yining Karl Li, Jan Novak. SIGGRAPH 2017.
+ *
+ * at each tentative collision the path is absorbed, scatters or continues with probabilities
+ * proportional to the throughput weighted coefficients, which handles chromatic media without
+ * picking a color channel. emission is estimated at every collision. */
+ccl_device VolumeIntegrateResult kernel_volume_integrate_majorant(KernelGlobals *kg,
+                                                                  ccl_addr_space PathState *state,
+                                                                  Ray *ray,
+                                                                  ShaderData *sd,
+                                                                  PathRadiance *L,
+                                                                  ccl_addr_space float3 *throughput,
+                                                                  const int object)
+{
+  VolumeMajorantIterator iter;
+  if (!kernel_volume_majorant_init(kg, object, ray, &iter)) {
+    return VOLUME_PATH_ATTENUATED;
+  }
+
+  float3 tp = *throughput;
+  const float3 zero = make_float3(0.0f, 0.0f, 0.0f);
+
+  /* first distance and event are stratified, following ones use a random sequence */
+  float xi = path_state_rng_1D(kg, state, PRNG_SCATTER_DISTANCE);
+  float rphase = path_state_rng_1D(kg, state, PRNG_PHASE_CHANNEL);
+  uint lcg_state = lcg_state_init_addrspace(state, 0x1f9b6a3d);
+  int steps = kernel_data.integrator.volume_max_steps;
+
+  float t0, t1, sigma_majorant;
+  while (steps > 0 && kernel_volume_majorant_next(kg, &iter, &t0, &t1, &sigma_majorant)) {
+    if (sigma_majorant == 0.0f) {
+      continue;
+    }
+
+    for (float t = t0; steps > 0; steps--) {
+      t -= logf(1.0f - xi) / sigma_majorant;
+      xi = lcg_step_float_addrspace(&lcg_state);
+      if (t >= t1) {
+        break;
+      }
+
+      VolumeShaderCoefficients coeff ccl_optional_struct_init;
+      if (!volume_shader_sample(kg, sd, state, ray->P + ray->D * t, &coeff)) {
+        continue;
+      }
+
+      const int closure_flag = sd->flag;
+
+      /* collision estimate of emission */
+      if (L && (closure_flag & SD_EMISSION)) {
+        path_radiance_accum_emission(kg, L, state, tp, coeff.emission / sigma_majorant);
+      }
+
+      if (!(closure_flag & SD_EXTINCTION)) {
+        continue;
+      }
+
+      /* null coefficient clamped in case the majorant is exceeded, which would make this
+       * biased */
+      const float3 sigma_s = (closure_flag & SD_SCATTER) ? coeff.sigma_s : zero;
+      const float3 sigma_a = max(coeff.sigma_t - sigma_s, zero);
+      const float3 sigma_n = max(make_float3(sigma_majorant, sigma_majorant, sigma_majorant) -
+                                     coeff.sigma_t,
+                                 zero);
+
+      const float weight_a = average(tp * sigma_a);
+      const float weight_s = average(tp * sigma_s);
+      const float weight_n = average(tp * sigma_n);
+      const float weight_sum = weight_a + weight_s + weight_n;
+
+      if (!(weight_sum > 0.0f)) {
+        *throughput = zero;
+        return VOLUME_PATH_ATTENUATED;
+      }
+
+      const float r = rphase * weight_sum;
+      rphase = lcg_step_float_addrspace(&lcg_state);
+
+      if (r < weight_s) {
+        /* scattering, shader data is set up for sampling the phase function */
+        sd->P = ray->P + ray->D * t;
+        *throughput = tp * sigma_s * (weight_sum / (sigma_majorant * weight_s));
+        return VOLUME_PATH_SCATTERED;
+      }
+      else if (r < weight_s + weight_n) {
+        /* null collision */
+        tp *= sigma_n * (weight_sum / (sigma_majorant * weight_n));
+      }
+      else {
+        /* absorption */
+        *throughput = zero;
+        return VOLUME_PATH_ATTENUATED;
+      }
+    }
+  }
+
+  *throughput = tp;
+
+  return VOLUME_PATH_ATTENUATED;
+}
+#  endif /* __VOLUME_MAJORANT__ */
+
 /* get the volume attenuation and emission over line segment defined by
  * ray, with the assumption that there are no surfaces blocking light
  * between the endpoints. distance sampling is used to decide if we will
@@ -703,6 +998,13 @@ kernel_volume_integrate(KernelGlobals *kg,
 {
   shader_setup_from_volume(kg, sd, ray);
 
+#  ifdef __VOLUME_MAJORANT__
+  const int majorant_object = volume_stack_majorant_object(kg, state->volume_stack);
+  if (majorant_object != OBJECT_NONE) {
+    return kernel_volume_integrate_majorant(kg, state, ray, sd, L, throughput, majorant_object);
+  }
+#  endif
+
   if (step_size != FLT_MAX)
     return kernel_volume_integrate_heterogeneous_distance(
         kg, state, ray, sd, L, throughput, step_size);
@@ -22,6 +22,8 @@
 #  include <nanovdb/util/SampleFromVoxels.h>
 #endif
 
+#include "util/util_texture_cache.h"
+
 CCL_NAMESPACE_BEGIN
 
 /* Make template functions private so symbols don't conflict between kernels with different
@@ -513,6 +515,10 @@ template<typename T> struct NanoVDBInterpolator {
 
 ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, float y)
 {
+  if (kg->texture_cache && kg->texture_cache->has_image(id)) {
+    return kg->texture_cache->lookup(id, x, y, make_float2(0.0f, 0.0f), make_float2(0.0f, 0.0f));
+  }
+
   const TextureInfo &info = kernel_tex_fetch(__texture_info, id);
 
   switch (info.data_type) {
@@ -539,6 +545,18 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, fl
   }
 }
 
+/* Lookup with texture coordinate derivatives, only images in the texture cache are filtered
+ * with them. */
+ccl_device float4
+kernel_tex_image_interp_diff(KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy)
+{
+  if (kg->texture_cache && kg->texture_cache->has_image(id)) {
+    return kg->texture_cache->lookup(id, x, y, dx, dy);
+  }
+
+  return kernel_tex_image_interp(kg, id, x, y);
+}
+
 ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals *kg,
                                              int id,
                                              float3 P,
@@ -16,14 +16,15 @@
 
 CCL_NAMESPACE_BEGIN
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint flags)
+ccl_device float4 svm_image_texture(
+    KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy, uint flags)
 {
   if (id == -1) {
     return make_float4(
         TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
   }
 
-  float4 r = kernel_tex_image_interp(kg, id, x, y);
+  float4 r = kernel_tex_image_interp_diff(kg, id, x, y, dx, dy);
   const float alpha = r.w;
 
   if ((flags & NODE_IMAGE_ALPHA_UNASSOCIATE) && alpha != 1.0f && alpha != 0.0f) {
@@ -38,6 +39,35 @@ ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y,
   return r;
 }
 
+/* Texture coordinate derivatives from the UV attribute the image is mapped with. */
+ccl_device void svm_image_uv_differentials(
+    KernelGlobals *kg, ShaderData *sd, uint attr_id, float2 *dx, float2 *dy)
+{
+  *dx = make_float2(0.0f, 0.0f);
+  *dy = make_float2(0.0f, 0.0f);
+
+#ifdef __RAY_DIFFERENTIALS__
+  if (sd->object == OBJECT_NONE) {
+    return;
+  }
+
+  const AttributeDescriptor desc = find_attribute(kg, sd, attr_id);
+  if (desc.offset == ATTR_STD_NOT_FOUND) {
+    return;
+  }
+
+  if (desc.type == NODE_ATTR_FLOAT2) {
+    primitive_surface_attribute_float2(kg, sd, desc, dx, dy);
+  }
+  else if (desc.type == NODE_ATTR_FLOAT3) {
+    float3 dx3, dy3;
+    primitive_surface_attribute_float3(kg, sd, desc, &dx3, &dy3);
+    *dx = make_float2(dx3.x, dx3.y);
+    *dy = make_float2(dy3.x, dy3.y);
+  }
+#endif
+}
+
 /* Remap coordnate from 0..1 box to -1..-1 */
 ccl_device_inline float3 texco_remap_square(float3 co)
 {
@@ -51,6 +81,16 @@ ccl_device void svm_node_tex_image(
 
   svm_unpack_node_uchar4(node.z, &co_offset, &out_offset, &alpha_offset, &flags);
 
+  float2 tex_dx, tex_dy;
+  if (flags & NODE_IMAGE_DIFFERENTIALS) {
+    uint4 diff_node = read_node(kg, offset);
+    svm_image_uv_differentials(kg, sd, diff_node.x, &tex_dx, &tex_dy);
+  }
+  else {
+    tex_dx = make_float2(0.0f, 0.0f);
+    tex_dy = make_float2(0.0f, 0.0f);
+  }
+
   float3 co = stack_load_float3(stack, co_offset);
   float2 tex_co;
   if (node.w == NODE_IMAGE_PROJ_SPHERE) {
@@ -108,7 +148,7 @@ ccl_device void svm_node_tex_image(
     id = -num_nodes;
   }
 
-  float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, flags);
+  float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, tex_dx, tex_dy, flags);
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -194,19 +234,20 @@ ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float
   uint id = node.y;
 
   float4 f = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+  const float2 no_diff = make_float2(0.0f, 0.0f);
 
   /* Map so that no textures are flipped, rotation is somewhat arbitrary. */
   if (weight.x > 0.0f) {
     float2 uv = make_float2((signed_N.x < 0.0f) ? 1.0f - co.y : co.y, co.z);
-    f += weight.x * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.x * svm_image_texture(kg, id, uv.x, uv.y, no_diff, no_diff, flags);
   }
   if (weight.y > 0.0f) {
     float2 uv = make_float2((signed_N.y > 0.0f) ? 1.0f - co.x : co.x, co.z);
-    f += weight.y * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.y * svm_image_texture(kg, id, uv.x, uv.y, no_diff, no_diff, flags);
   }
   if (weight.z > 0.0f) {
     float2 uv = make_float2((signed_N.z > 0.0f) ? 1.0f - co.y : co.y, co.x);
-    f += weight.z * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.z * svm_image_texture(kg, id, uv.x, uv.y, no_diff, no_diff, flags);
   }
 
   if (stack_valid(out_offset))
@@ -236,7 +277,8 @@ ccl_device void svm_node_tex_environment(KernelGlobals *kg,
   else
     uv = direction_to_mirrorball(co);
 
-  float4 f = svm_image_texture(kg, id, uv.x, uv.y, flags);
+  const float2 no_diff = make_float2(0.0f, 0.0f);
+  float4 f = svm_image_texture(kg, id, uv.x, uv.y, no_diff, no_diff, flags);
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
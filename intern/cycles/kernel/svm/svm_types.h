@@ -475,6 +475,8 @@ typedef enum NodeImageProjection {
 typedef enum NodeImageFlags {
   NODE_IMAGE_COMPRESS_AS_SRGB = 1,
   NODE_IMAGE_ALPHA_UNASSOCIATE = 2,
+  /* Extra node with UV attribute for texture coordinate derivatives follows. */
+  NODE_IMAGE_DIFFERENTIALS = 4,
 } NodeImageFlags;
 
 typedef enum NodeEnvironmentProjection {
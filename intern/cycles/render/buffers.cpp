@@ -105,6 +105,51 @@ int BufferParams::get_denoising_prefiltered_offset()
   return offset;
 }
 
+/* Pass Storage */
+
+int get_pass_read_components(const Pass &pass)
+{
+  switch (pass.type) {
+    case PASS_COMBINED:
+    case PASS_MOTION:
+    case PASS_CRYPTOMATTE:
+      return 4;
+    default:
+      /* Other passes with 4 components only use the alpha channel for padding or weights. */
+      return (pass.components == 4) ? 3 : pass.components;
+  }
+}
+
+PassStorageType get_pass_storage_type(const Pass &pass)
+{
+  switch (pass.type) {
+    case PASS_COMBINED:
+    case PASS_EMISSION:
+    case PASS_BACKGROUND:
+    case PASS_AO:
+    case PASS_SHADOW:
+    case PASS_DIFFUSE_DIRECT:
+    case PASS_DIFFUSE_INDIRECT:
+    case PASS_DIFFUSE_COLOR:
+    case PASS_GLOSSY_DIRECT:
+    case PASS_GLOSSY_INDIRECT:
+    case PASS_GLOSSY_COLOR:
+    case PASS_TRANSMISSION_DIRECT:
+    case PASS_TRANSMISSION_INDIRECT:
+    case PASS_TRANSMISSION_COLOR:
+    case PASS_VOLUME_DIRECT:
+    case PASS_VOLUME_INDIRECT:
+    case PASS_AOV_COLOR:
+      return PASS_STORAGE_HALF;
+    case PASS_OBJECT_ID:
+    case PASS_MATERIAL_ID:
+      /* Not filtered, so these contain the exact index of the first sample. */
+      return PASS_STORAGE_UINT;
+    default:
+      return PASS_STORAGE_FLOAT;
+  }
+}
+
 /* Render Buffer Task */
 
 RenderTile::RenderTile()
@@ -69,6 +69,22 @@ class BufferParams {
   int get_denoising_prefiltered_offset();
 };
 
+/* Pass Storage
+ *
+ * Render buffers always accumulate in float, but once a tile is finished many passes do not need
+ * that precision. Colors can be stored as half float and IDs as unsigned int, while depth,
+ * vectors and cryptomatte need full float. */
+
+typedef enum PassStorageType {
+  PASS_STORAGE_FLOAT,
+  PASS_STORAGE_HALF,
+  PASS_STORAGE_UINT,
+} PassStorageType;
+
+/* Number of components of the pass as read with RenderBuffers::get_pass_rect(). */
+int get_pass_read_components(const Pass &pass);
+PassStorageType get_pass_storage_type(const Pass &pass);
+
 /* Render Buffers */
 
 class RenderBuffers {
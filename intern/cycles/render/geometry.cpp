@@ -41,6 +41,7 @@
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -60,7 +61,9 @@ Geometry::Geometry(const NodeType *node_type, const Type type)
     : Node(node_type), type(type), attributes(this, ATTR_PRIM_GEOMETRY)
 {
   need_update = true;
-  need_update_rebuild = false;
+  /* Not packed into any arrays or BVH yet. */
+  need_update_rebuild = true;
+  need_update_packed = true;
 
   transform_applied = false;
   transform_negative_scaled = false;
@@ -516,6 +519,7 @@ static void update_attribute_element_offset(Geometry *geom,
                                             size_t &attr_uchar4_offset,
                                             Attribute *mattr,
                                             AttributePrimitive prim,
+                                            bool copy_data,
                                             TypeDesc &type,
                                             AttributeDescriptor &desc)
 {
@@ -541,8 +545,11 @@ static void update_attribute_element_offset(Geometry *geom,
       offset = attr_uchar4_offset;
 
       assert(attr_uchar4.size() >= offset + size);
-      for (size_t k = 0; k < size; k++) {
-        attr_uchar4[offset + k] = data[k];
+      if (copy_data) {
+        for (size_t k = 0; k < size; k++) {
+          attr_uchar4[offset + k] = data[k];
+        }
+        attr_uchar4.tag_modified();
       }
       attr_uchar4_offset += size;
     }
@@ -551,8 +558,11 @@ static void update_attribute_element_offset(Geometry *geom,
       offset = attr_float_offset;
 
       assert(attr_float.size() >= offset + size);
-      for (size_t k = 0; k < size; k++) {
-        attr_float[offset + k] = data[k];
+      if (copy_data) {
+        for (size_t k = 0; k < size; k++) {
+          attr_float[offset + k] = data[k];
+        }
+        attr_float.tag_modified();
       }
       attr_float_offset += size;
     }
@@ -561,8 +571,11 @@ static void update_attribute_element_offset(Geometry *geom,
       offset = attr_float2_offset;
 
       assert(attr_float2.size() >= offset + size);
-      for (size_t k = 0; k < size; k++) {
-        attr_float2[offset + k] = data[k];
+      if (copy_data) {
+        for (size_t k = 0; k < size; k++) {
+          attr_float2[offset + k] = data[k];
+        }
+        attr_float2.tag_modified();
       }
       attr_float2_offset += size;
     }
@@ -571,8 +584,11 @@ static void update_attribute_element_offset(Geometry *geom,
       offset = attr_float3_offset;
 
       assert(attr_float3.size() >= offset + size * 3);
-      for (size_t k = 0; k < size * 3; k++) {
-        attr_float3[offset + k] = (&tfm->x)[k];
+      if (copy_data) {
+        for (size_t k = 0; k < size * 3; k++) {
+          attr_float3[offset + k] = (&tfm->x)[k];
+        }
+        attr_float3.tag_modified();
       }
       attr_float3_offset += size * 3;
     }
@@ -581,8 +597,11 @@ static void update_attribute_element_offset(Geometry *geom,
       offset = attr_float3_offset;
 
       assert(attr_float3.size() >= offset + size);
-      for (size_t k = 0; k < size; k++) {
-        attr_float3[offset + k] = data[k];
+      if (copy_data) {
+        for (size_t k = 0; k < size; k++) {
+          attr_float3[offset + k] = data[k];
+        }
+        attr_float3.tag_modified();
       }
       attr_float3_offset += size;
     }
@@ -633,6 +652,7 @@ static void update_attribute_element_offset(Geometry *geom,
 void GeometryManager::device_update_attributes(Device *device,
                                                DeviceScene *dscene,
                                                Scene *scene,
+                                               bool in_place,
                                                Progress &progress)
 {
   progress.set_status("Updating Mesh", "Computing attributes");
@@ -658,11 +678,15 @@ void GeometryManager::device_update_attributes(Device *device,
 
   /* Pre-allocate attributes to avoid arrays re-allocation which would
    * take 2x of overall attribute memory usage.
+   *
+   * The offsets after each geometry are recorded, if none changed since the last update the
+   * attributes are at the same place and only those of modified geometry need to be copied.
    */
   size_t attr_float_size = 0;
   size_t attr_float2_size = 0;
   size_t attr_float3_size = 0;
   size_t attr_uchar4_size = 0;
+  vector<size_t> attribute_sizes(scene->geometry.size() * 4);
   for (size_t i = 0; i < scene->geometry.size(); i++) {
     Geometry *geom = scene->geometry[i];
     AttributeRequestSet &attributes = geom_attributes[i];
@@ -690,8 +714,20 @@ void GeometryManager::device_update_attributes(Device *device,
                                       &attr_uchar4_size);
       }
     }
+
+    attribute_sizes[i * 4 + 0] = attr_float_size;
+    attribute_sizes[i * 4 + 1] = attr_float2_size;
+    attribute_sizes[i * 4 + 2] = attr_float3_size;
+    attribute_sizes[i * 4 + 3] = attr_uchar4_size;
   }
 
+  in_place = in_place && attribute_sizes == packed_attribute_sizes &&
+             attr_float_size == dscene->attributes_float.size() &&
+             attr_float2_size == dscene->attributes_float2.size() &&
+             attr_float3_size == dscene->attributes_float3.size() &&
+             attr_uchar4_size == dscene->attributes_uchar4.size();
+  packed_attribute_sizes.swap(attribute_sizes);
+
   dscene->attributes_float.alloc(attr_float_size);
   dscene->attributes_float2.alloc(attr_float2_size);
   dscene->attributes_float3.alloc(attr_float3_size);
@@ -706,6 +742,8 @@ void GeometryManager::device_update_attributes(Device *device,
   for (size_t i = 0; i < scene->geometry.size(); i++) {
     Geometry *geom = scene->geometry[i];
     AttributeRequestSet &attributes = geom_attributes[i];
+    /* Offsets are always needed for the attribute maps. */
+    const bool copy_data = !in_place || geom->need_update_packed;
 
     /* todo: we now store std and name attributes from requests even if
      * they actually refer to the same mesh attributes, optimize */
@@ -722,6 +760,7 @@ void GeometryManager::device_update_attributes(Device *device,
                                       attr_uchar4_offset,
                                       attr,
                                       ATTR_PRIM_GEOMETRY,
+                                      copy_data,
                                       req.type,
                                       req.desc);
 
@@ -740,6 +779,7 @@ void GeometryManager::device_update_attributes(Device *device,
                                         attr_uchar4_offset,
                                         subd_attr,
                                         ATTR_PRIM_SUBD,
+                                        copy_data,
                                         req.subd_type,
                                         req.subd_desc);
       }
@@ -762,16 +802,16 @@ void GeometryManager::device_update_attributes(Device *device,
   progress.set_status("Updating Mesh", "Copying Attributes to device");
 
   if (dscene->attributes_float.size()) {
-    dscene->attributes_float.copy_to_device();
+    dscene->attributes_float.copy_to_device_if_modified();
   }
   if (dscene->attributes_float2.size()) {
-    dscene->attributes_float2.copy_to_device();
+    dscene->attributes_float2.copy_to_device_if_modified();
   }
   if (dscene->attributes_float3.size()) {
-    dscene->attributes_float3.copy_to_device();
+    dscene->attributes_float3.copy_to_device_if_modified();
   }
   if (dscene->attributes_uchar4.size()) {
-    dscene->attributes_uchar4.copy_to_device();
+    dscene->attributes_uchar4.copy_to_device_if_modified();
   }
 
   if (progress.get_cancel())
@@ -842,8 +882,65 @@ void GeometryManager::mesh_calc_offset(Scene *scene)
   }
 }
 
-void GeometryManager::device_update_mesh(
-    Device *, DeviceScene *dscene, Scene *scene, bool for_displacement, Progress &progress)
+bool GeometryManager::can_update_in_place(DeviceScene *dscene, Scene *scene)
+{
+  if (packed_geometry != scene->geometry) {
+    return false;
+  }
+
+  size_t vert_size = 0;
+  size_t tri_size = 0;
+
+  size_t curve_key_size = 0;
+  size_t curve_size = 0;
+
+  foreach (Geometry *geom, scene->geometry) {
+    if (geom->need_update_packed && geom->need_update_rebuild) {
+      return false;
+    }
+
+    if (geom->type == Geometry::MESH || geom->type == Geometry::VOLUME) {
+      Mesh *mesh = static_cast<Mesh *>(geom);
+
+      /* Tessellation and displacement modify the mesh, these are always fully repacked. */
+      if (mesh->need_update_packed && (mesh->subdivision_type != Mesh::SUBDIVISION_NONE ||
+                                       mesh->has_true_displacement())) {
+        return false;
+      }
+
+      /* Offsets from the last update must still be valid, which is the case when the size of
+       * all geometry is unchanged. */
+      if (mesh->vert_offset != vert_size || mesh->prim_offset != tri_size) {
+        return false;
+      }
+
+      vert_size += mesh->verts.size();
+      tri_size += mesh->num_triangles();
+    }
+    else if (geom->type == Geometry::HAIR) {
+      Hair *hair = static_cast<Hair *>(geom);
+
+      if (hair->curvekey_offset != curve_key_size || hair->prim_offset != curve_size) {
+        return false;
+      }
+
+      curve_key_size += hair->curve_keys.size();
+      curve_size += hair->num_curves();
+    }
+  }
+
+  /* Normals are only packed along with triangles, and curve keys along with curves. */
+  return tri_size == dscene->tri_shader.size() && curve_size == dscene->curves.size() &&
+         (tri_size == 0 || vert_size == dscene->tri_vnormal.size()) &&
+         (curve_size == 0 || curve_key_size == dscene->curve_keys.size());
+}
+
+void GeometryManager::device_update_mesh(Device *,
+                                         DeviceScene *dscene,
+                                         Scene *scene,
+                                         bool for_displacement,
+                                         bool in_place,
+                                         Progress &progress)
 {
   /* Count. */
   size_t vert_size = 0;
@@ -919,8 +1016,13 @@ void GeometryManager::device_update_mesh(
     foreach (Geometry *geom, scene->geometry) {
       if (geom->type == Geometry::MESH || geom->type == Geometry::VOLUME) {
         Mesh *mesh = static_cast<Mesh *>(geom);
-        mesh->pack_shaders(scene, &tri_shader[mesh->prim_offset]);
-        mesh->pack_normals(&vnormal[mesh->vert_offset]);
+        if (!in_place || mesh->need_update_packed) {
+          mesh->pack_shaders(scene, &tri_shader[mesh->prim_offset]);
+          mesh->pack_normals(&vnormal[mesh->vert_offset]);
+          dscene->tri_shader.tag_modified();
+          dscene->tri_vnormal.tag_modified();
+        }
+        /* Always packed, the triangle to primitive mapping changes with the scene BVH. */
         mesh->pack_verts(tri_prim_index,
                          &tri_vindex[mesh->prim_offset],
                          &tri_patch[mesh->prim_offset],
@@ -935,8 +1037,8 @@ void GeometryManager::device_update_mesh(
     /* vertex coordinates */
     progress.set_status("Updating Mesh", "Copying Mesh to device");
 
-    dscene->tri_shader.copy_to_device();
-    dscene->tri_vnormal.copy_to_device();
+    dscene->tri_shader.copy_to_device_if_modified();
+    dscene->tri_vnormal.copy_to_device_if_modified();
     dscene->tri_vindex.copy_to_device();
     dscene->tri_patch.copy_to_device();
     dscene->tri_patch_uv.copy_to_device();
@@ -949,22 +1051,25 @@ void GeometryManager::device_update_mesh(
     float4 *curves = dscene->curves.alloc(curve_size);
 
     foreach (Geometry *geom, scene->geometry) {
-      if (geom->type == Geometry::HAIR) {
+      if (geom->type == Geometry::HAIR && (!in_place || geom->need_update_packed)) {
         Hair *hair = static_cast<Hair *>(geom);
         hair->pack_curves(scene,
                           &curve_keys[hair->curvekey_offset],
                           &curves[hair->prim_offset],
                           hair->curvekey_offset);
+        dscene->curve_keys.tag_modified();
+        dscene->curves.tag_modified();
         if (progress.get_cancel())
           return;
       }
     }
 
-    dscene->curve_keys.copy_to_device();
-    dscene->curves.copy_to_device();
+    dscene->curve_keys.copy_to_device_if_modified();
+    dscene->curves.copy_to_device_if_modified();
   }
 
-  if (patch_size != 0) {
+  /* Meshes with patches are not updated in place, so the patches are unchanged then. */
+  if (patch_size != 0 && !in_place) {
     progress.set_status("Updating Mesh", "Copying Patches to device");
 
     uint *patch_data = dscene->patches.alloc(patch_size);
@@ -1006,6 +1111,11 @@ void GeometryManager::device_update_mesh(
     }
     dscene->prim_tri_verts.copy_to_device();
   }
+  else {
+    foreach (Geometry *geom, scene->geometry) {
+      geom->need_update_packed = false;
+    }
+  }
 }
 
 void GeometryManager::device_update_bvh(Device *device,
@@ -1250,6 +1360,10 @@ void GeometryManager::device_update(Device *device,
           geom->need_update = true;
       }
 
+      if (geom->need_update) {
+        geom->need_update_packed = true;
+      }
+
       if (geom->need_update && (geom->type == Geometry::MESH || geom->type == Geometry::VOLUME)) {
         Mesh *mesh = static_cast<Mesh *>(geom);
 
@@ -1297,6 +1411,11 @@ void GeometryManager::device_update(Device *device,
       }
 
       Mesh *mesh = static_cast<Mesh *>(geom);
+      if (mesh->subdivision_type == Mesh::SUBDIVISION_NONE && mesh->subd_dice_cache) {
+        delete mesh->subd_dice_cache;
+        mesh->subd_dice_cache = NULL;
+      }
+
       if (mesh->subdivision_type != Mesh::SUBDIVISION_NONE && mesh->num_subd_verts == 0 &&
           mesh->subd_params) {
         string msg = "Tessellating ";
@@ -1310,8 +1429,17 @@ void GeometryManager::device_update(Device *device,
 
         mesh->subd_params->camera = dicing_camera;
         DiagSplit dsplit(*mesh->subd_params);
+        const double tessellate_start_time = time_dt();
         mesh->tessellate(&dsplit);
 
+        if (scene->update_stats) {
+          scene->update_stats->geometry.times.add_entry(
+              {string_printf("  tessellate %s%s",
+                             mesh->name.c_str(),
+                             dsplit.get_used_dice_cache() ? " (cached)" : ""),
+               time_dt() - tessellate_start_time});
+        }
+
         i++;
 
         if (progress.get_cancel())
@@ -1334,8 +1462,20 @@ void GeometryManager::device_update(Device *device,
     scene->object_manager->device_update_flags(device, dscene, scene, progress, false);
   }
 
-  /* Device update. */
-  device_free(device, dscene);
+  /* Device update. When only geometry data changed, for example vertices of deforming meshes,
+   * the packed arrays are kept and only ranges of modified geometry are updated. The scene BVH
+   * is still rebuilt, object BVHs are refit. */
+  const bool in_place = !true_displacement_used && total_tess_needed == 0 &&
+                        can_update_in_place(dscene, scene);
+  packed_geometry.clear();
+
+  if (in_place) {
+    VLOG(1) << "Updating geometry arrays in place.";
+    device_free_bvh(device, dscene);
+  }
+  else {
+    device_free(device, dscene);
+  }
 
   mesh_calc_offset(scene);
   if (true_displacement_used) {
@@ -1345,7 +1485,7 @@ void GeometryManager::device_update(Device *device,
             {"device_update (displacement: copy meshes to device)", time});
       }
     });
-    device_update_mesh(device, dscene, scene, true, progress);
+    device_update_mesh(device, dscene, scene, true, false, progress);
   }
   if (progress.get_cancel())
     return;
@@ -1356,7 +1496,7 @@ void GeometryManager::device_update(Device *device,
         scene->update_stats->geometry.times.add_entry({"device_update (attributes)", time});
       }
     });
-    device_update_attributes(device, dscene, scene, progress);
+    device_update_attributes(device, dscene, scene, in_place, progress);
     if (progress.get_cancel())
       return;
   }
@@ -1403,7 +1543,7 @@ void GeometryManager::device_update(Device *device,
     });
     device_free(device, dscene);
 
-    device_update_attributes(device, dscene, scene, progress);
+    device_update_attributes(device, dscene, scene, false, progress);
     if (progress.get_cancel())
       return;
   }
@@ -1473,11 +1613,12 @@ void GeometryManager::device_update(Device *device,
             {"device_update (copy meshes to device)", time});
       }
     });
-    device_update_mesh(device, dscene, scene, false, progress);
+    device_update_mesh(device, dscene, scene, false, in_place, progress);
     if (progress.get_cancel())
       return;
   }
 
+  packed_geometry = scene->geometry;
   need_update = false;
 
   if (true_displacement_used) {
@@ -1491,7 +1632,7 @@ void GeometryManager::device_update(Device *device,
   }
 }
 
-void GeometryManager::device_free(Device *device, DeviceScene *dscene)
+void GeometryManager::device_free_bvh(Device *, DeviceScene *dscene)
 {
 #ifdef WITH_EMBREE
   if (dscene->data.bvh.scene) {
@@ -1511,6 +1652,15 @@ void GeometryManager::device_free(Device *device, DeviceScene *dscene)
   dscene->prim_index.free();
   dscene->prim_object.free();
   dscene->prim_time.free();
+
+  /* Signal for shaders like displacement not to do ray tracing. */
+  dscene->data.bvh.bvh_layout = BVH_LAYOUT_NONE;
+}
+
+void GeometryManager::device_free(Device *device, DeviceScene *dscene)
+{
+  device_free_bvh(device, dscene);
+
   dscene->tri_shader.free();
   dscene->tri_vnormal.free();
   dscene->tri_vindex.free();
@@ -1525,8 +1675,8 @@ void GeometryManager::device_free(Device *device, DeviceScene *dscene)
   dscene->attributes_float3.free();
   dscene->attributes_uchar4.free();
 
-  /* Signal for shaders like displacement not to do ray tracing. */
-  dscene->data.bvh.bvh_layout = BVH_LAYOUT_NONE;
+  packed_geometry.clear();
+  packed_attribute_sizes.clear();
 
 #ifdef WITH_OSL
   OSLGlobals *og = (OSLGlobals *)device->osl_memory();
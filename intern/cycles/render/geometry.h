@@ -90,6 +90,9 @@ class Geometry : public Node {
   /* Update Flags */
   bool need_update;
   bool need_update_rebuild;
+  /* Data in the packed device arrays is out of date. Unlike need_update this is only cleared
+   * once the arrays have been packed, after the BVH build. */
+  bool need_update_packed;
 
   /* Constructor/Destructor */
   explicit Geometry(const NodeType *node_type, const Type type);
@@ -182,24 +185,35 @@ class GeometryManager {
   /* Compute verts/triangles/curves offsets in global arrays. */
   void mesh_calc_offset(Scene *scene);
 
+  /* Test if only geometry data changed since the last update, so that the packed arrays can be
+   * updated in place for the modified geometry, rather than repacked from scratch. */
+  bool can_update_in_place(DeviceScene *dscene, Scene *scene);
+
   void device_update_object(Device *device, DeviceScene *dscene, Scene *scene, Progress &progress);
 
   void device_update_mesh(Device *device,
                           DeviceScene *dscene,
                           Scene *scene,
                           bool for_displacement,
+                          bool in_place,
                           Progress &progress);
 
   void device_update_attributes(Device *device,
                                 DeviceScene *dscene,
                                 Scene *scene,
+                                bool in_place,
                                 Progress &progress);
 
   void device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress &progress);
+  void device_free_bvh(Device *device, DeviceScene *dscene);
 
   void device_update_displacement_images(Device *device, Scene *scene, Progress &progress);
 
   void device_update_volume_images(Device *device, Scene *scene, Progress &progress);
+
+  /* Geometry and per geometry attribute sizes in the packed arrays, as of the last update. */
+  vector<Geometry *> packed_geometry;
+  vector<size_t> packed_attribute_sizes;
 };
 
 CCL_NAMESPACE_END
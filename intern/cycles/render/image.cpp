@@ -300,16 +300,34 @@ ImageManager::ImageManager(const DeviceInfo &info)
 {
   need_update = true;
   osl_texture_system = NULL;
+  texture_cache = NULL;
   animation_frame = 0;
 
   /* Set image limits */
   has_half_images = info.has_half_images;
+  /* Lookups go through the CPU kernel, not possible on other devices. */
+  has_texture_cache = (info.type == DEVICE_CPU);
 }
 
 ImageManager::~ImageManager()
 {
   for (size_t slot = 0; slot < images.size(); slot++)
     assert(!images[slot]);
+
+  delete texture_cache;
+}
+
+void ImageManager::set_texture_cache_params(const TextureCacheParams &params)
+{
+  /* Images are expected to be loaded again after changing parameters. */
+  delete texture_cache;
+  texture_cache = NULL;
+
+  if (params.use_cache && has_texture_cache) {
+    texture_cache = new TextureCache(params);
+  }
+
+  need_update = true;
 }
 
 void ImageManager::set_osl_texture_system(void *texture_system)
@@ -646,6 +664,31 @@ bool ImageManager::file_load_image(Image *img, int texture_limit)
   return true;
 }
 
+bool ImageManager::texture_cache_add_image(Image *img, int slot)
+{
+  /* Only image files which need no conversion except for sRGB to linear, which is done in the
+   * kernel. Other images are loaded into memory as usual. */
+  const ustring filepath = img->loader->osl_filepath();
+  if (filepath.empty() || img->params.animated || img->metadata.depth > 1) {
+    return false;
+  }
+
+  const ustring colorspace = img->metadata.colorspace;
+  if (!(colorspace == u_colorspace_raw || colorspace == u_colorspace_srgb)) {
+    return false;
+  }
+
+  /* The texture system always associates alpha. */
+  const int channels = img->metadata.channels;
+  if (!(channels == 1 || channels == 3 || image_associate_alpha(img))) {
+    return false;
+  }
+
+  thread_scoped_lock device_lock(device_mutex);
+  return texture_cache->add_image(
+      slot, filepath.string(), img->params.interpolation, img->params.extension);
+}
+
 void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Progress *progress)
 {
   if (progress->get_cancel()) {
@@ -676,8 +719,19 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
   img->mem->info.use_transform_3d = img->metadata.use_transform_3d;
   img->mem->info.transform_3d = img->metadata.transform_3d;
 
+  if (texture_cache) {
+    thread_scoped_lock device_lock(device_mutex);
+    texture_cache->remove_image(slot);
+  }
+
   /* Create new texture. */
-  if (type == IMAGE_DATA_TYPE_FLOAT4) {
+  if (texture_cache && texture_cache_add_image(img, slot)) {
+    /* Pixels are read on demand by the texture cache, the device only gets a placeholder. */
+    thread_scoped_lock device_lock(device_mutex);
+    void *pixels = img->mem->alloc(1, 1);
+    memset(pixels, 0, img->mem->memory_elements_size(1));
+  }
+  else if (type == IMAGE_DATA_TYPE_FLOAT4) {
     if (!file_load_image<TypeDesc::FLOAT, float>(img, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
@@ -803,6 +857,11 @@ void ImageManager::device_free_image(Device *, int slot)
     delete img->mem;
   }
 
+  if (texture_cache) {
+    thread_scoped_lock device_lock(device_mutex);
+    texture_cache->remove_image(slot);
+  }
+
   delete img->loader;
   delete img;
   images[slot] = NULL;
@@ -820,6 +879,8 @@ void ImageManager::device_update(Device *device, Scene *scene, Progress &progres
     }
   });
 
+  device->set_texture_cache(texture_cache);
+
   TaskPool pool;
   for (size_t slot = 0; slot < images.size(); slot++) {
     Image *img = images[slot];
@@ -886,6 +947,8 @@ void ImageManager::device_free(Device *device)
     device_free_image(device, slot);
   }
   images.clear();
+
+  device->set_texture_cache(NULL);
 }
 
 void ImageManager::collect_statistics(RenderStats *stats)
@@ -894,6 +957,11 @@ void ImageManager::collect_statistics(RenderStats *stats)
     stats->image.textures.add_entry(
         NamedSizeEntry(image->loader->name(), image->mem->memory_size()));
   }
+
+  if (texture_cache) {
+    stats->image.has_texture_cache = true;
+    texture_cache->collect_statistics(&stats->image.texture_cache);
+  }
 }
 
 CCL_NAMESPACE_END
@@ -22,6 +22,7 @@
 #include "render/colorspace.h"
 
 #include "util/util_string.h"
+#include "util/util_texture_cache.h"
 #include "util/util_thread.h"
 #include "util/util_transform.h"
 #include "util/util_unique_ptr.h"
@@ -187,6 +188,13 @@ class ImageManager {
   void set_osl_texture_system(void *texture_system);
   bool set_animation_frame_update(int frame);
 
+  /* Read image files on demand instead of loading them, only supported on the CPU. */
+  void set_texture_cache_params(const TextureCacheParams &params);
+  bool use_texture_cache() const
+  {
+    return texture_cache != NULL;
+  }
+
   void collect_statistics(RenderStats *stats);
 
   bool need_update;
@@ -210,6 +218,7 @@ class ImageManager {
 
  private:
   bool has_half_images;
+  bool has_texture_cache;
 
   thread_mutex device_mutex;
   thread_mutex images_mutex;
@@ -217,6 +226,7 @@ class ImageManager {
 
   vector<Image *> images;
   void *osl_texture_system;
+  TextureCache *texture_cache;
 
   int add_image_slot(ImageLoader *loader, const ImageParams &params, const bool builtin);
   void add_image_user(int slot);
@@ -227,6 +237,7 @@ class ImageManager {
   template<TypeDesc::BASETYPE FileFormat, typename StorageType>
   bool file_load_image(Image *img, int texture_limit);
 
+  bool texture_cache_add_image(Image *img, int slot);
   void device_load_image(Device *device, Scene *scene, int slot, Progress *progress);
   void device_free_image(Device *device, int slot);
 
@@ -79,6 +79,10 @@ NODE_DEFINE(Integrator)
   SOCKET_BOOLEAN(sample_all_lights_direct, "Sample All Lights Direct", true);
   SOCKET_BOOLEAN(sample_all_lights_indirect, "Sample All Lights Indirect", true);
   SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.05f);
+  SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
+
+  SOCKET_BOOLEAN(use_path_guiding, "Use Path Guiding", false);
+  SOCKET_INT(path_guiding_training_samples, "Path Guiding Training Samples", 64);
 
   static NodeEnum method_enum;
   method_enum.insert("path", PATH);
@@ -278,6 +282,19 @@ bool Integrator::modified(const Integrator &integrator)
   return !Node::equals(integrator);
 }
 
+bool Integrator::use_light_tree_sampling() const
+{
+  if (method == BRANCHED_PATH && (sample_all_lights_direct || sample_all_lights_indirect)) {
+    return false;
+  }
+  return use_light_tree;
+}
+
+bool Integrator::use_path_guiding_sampling() const
+{
+  return method == PATH && use_path_guiding;
+}
+
 void Integrator::tag_update(Scene *scene)
 {
   foreach (Shader *shader, scene->shaders) {
@@ -74,6 +74,10 @@ class Integrator : public Node {
   bool sample_all_lights_direct;
   bool sample_all_lights_indirect;
   float light_sampling_threshold;
+  bool use_light_tree;
+
+  bool use_path_guiding;
+  int path_guiding_training_samples;
 
   int adaptive_min_samples;
   float adaptive_threshold;
@@ -99,6 +103,12 @@ class Integrator : public Node {
 
   bool modified(const Integrator &integrator);
   void tag_update(Scene *scene);
+
+  /* Light tree is not used when sampling all lights, which relies on uniform light selection. */
+  bool use_light_tree_sampling() const;
+
+  /* Path guiding is only implemented for path tracing. */
+  bool use_path_guiding_sampling() const;
 };
 
 CCL_NAMESPACE_END
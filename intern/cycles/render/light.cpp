@@ -20,6 +20,7 @@
 #include "render/film.h"
 #include "render/graph.h"
 #include "render/integrator.h"
+#include "render/light_tree.h"
 #include "render/mesh.h"
 #include "render/nodes.h"
 #include "render/object.h"
@@ -528,6 +529,266 @@ void LightManager::device_update_distribution(Device *,
   }
 }
 
+static float light_tree_shader_energy(Shader *shader)
+{
+  /* Use constant emission as estimate, textured emission is assumed to be of unit strength. */
+  float3 emission;
+  if (shader->is_constant_emission(&emission)) {
+    return fabsf(average(emission));
+  }
+  return 1.0f;
+}
+
+void LightManager::device_update_tree(DeviceScene *dscene, Scene *scene, Progress &progress)
+{
+  KernelIntegrator *kintegrator = &dscene->data.integrator;
+
+  dscene->light_tree_nodes.free();
+  dscene->light_tree_emitters.free();
+  dscene->light_tree_lamp_emitter.free();
+  dscene->light_tree_object_lookup.free();
+  dscene->light_tree_triangle_emitter.free();
+
+  kintegrator->use_light_tree = false;
+  kintegrator->num_light_tree_emitters = 0;
+  kintegrator->num_light_tree_infinite = 0;
+  kintegrator->light_tree_pdf = 0.0f;
+  kintegrator->light_tree_infinite_pdf = 0.0f;
+
+  if (!kintegrator->use_direct_light || !scene->integrator->use_light_tree_sampling()) {
+    return;
+  }
+
+  progress.set_status("Updating Lights", "Building light tree");
+
+  /* Collect emitters, in the same order as the light distribution. Triangles are stored by
+   * distribution index in the triangle table until the tree has been built. */
+  vector<LightTreePrimitive> primitives;
+  vector<int> infinite_lights;
+  vector<int> object_lookup(scene->objects.size() * 2, -1);
+  vector<int> triangle_emitter;
+  int distribution_index = 0;
+
+  for (size_t j = 0; j < scene->objects.size(); j++) {
+    if (progress.get_cancel())
+      return;
+
+    Object *object = scene->objects[j];
+    if (!object_usable_as_light(object)) {
+      continue;
+    }
+
+    Mesh *mesh = static_cast<Mesh *>(object->geometry);
+    bool transform_applied = mesh->transform_applied;
+    Transform tfm = object->tfm;
+    size_t mesh_num_triangles = mesh->num_triangles();
+
+    object_lookup[j * 2] = triangle_emitter.size();
+    object_lookup[j * 2 + 1] = mesh->prim_offset;
+    triangle_emitter.resize(triangle_emitter.size() + mesh_num_triangles, -1);
+
+    for (size_t i = 0; i < mesh_num_triangles; i++) {
+      int shader_index = mesh->shader[i];
+      Shader *shader = (shader_index < mesh->used_shaders.size()) ?
+                           mesh->used_shaders[shader_index] :
+                           scene->default_surface;
+
+      if (!(shader->use_mis && shader->has_surface_emission)) {
+        continue;
+      }
+
+      const int index = distribution_index++;
+
+      Mesh::Triangle t = mesh->get_triangle(i);
+      if (!t.valid(&mesh->verts[0])) {
+        continue;
+      }
+      float3 p1 = mesh->verts[t.v[0]];
+      float3 p2 = mesh->verts[t.v[1]];
+      float3 p3 = mesh->verts[t.v[2]];
+
+      if (!transform_applied) {
+        p1 = transform_point(&tfm, p1);
+        p2 = transform_point(&tfm, p2);
+        p3 = transform_point(&tfm, p3);
+      }
+
+      const float area = triangle_area(p1, p2, p3);
+      if (area == 0.0f) {
+        continue;
+      }
+
+      /* Mesh lights emit from both sides. */
+      LightTreePrimitive prim;
+      prim.bbox = BoundBox(p1);
+      prim.bbox.grow(p2);
+      prim.bbox.grow(p3);
+      prim.cone = LightTreeCone::omnidirectional();
+      prim.energy = M_PI_F * area * light_tree_shader_energy(shader);
+      prim.inv_area = 1.0f / area;
+      prim.distribution_index = index;
+
+      triangle_emitter[object_lookup[j * 2] + i] = index;
+      primitives.push_back(prim);
+    }
+  }
+
+  vector<int> lamp_emitter;
+
+  foreach (Light *light, scene->lights) {
+    if (!light->is_enabled)
+      continue;
+
+    const int index = distribution_index++;
+    lamp_emitter.push_back(index);
+
+    if (light->type == LIGHT_DISTANT || light->type == LIGHT_BACKGROUND) {
+      infinite_lights.push_back(index);
+      continue;
+    }
+
+    LightTreePrimitive prim;
+    prim.energy = fabsf(average(light->strength));
+    prim.inv_area = 0.0f;
+    prim.distribution_index = index;
+
+    if (light->type == LIGHT_AREA) {
+      const float3 axisu = light->axisu * (light->sizeu * light->size * 0.5f);
+      const float3 axisv = light->axisv * (light->sizev * light->size * 0.5f);
+      prim.bbox = BoundBox(light->co - axisu - axisv);
+      prim.bbox.grow(light->co - axisu + axisv);
+      prim.bbox.grow(light->co + axisu - axisv);
+      prim.bbox.grow(light->co + axisu + axisv);
+      prim.cone.axis = safe_normalize(light->dir);
+      prim.cone.theta_o = 0.0f;
+      prim.cone.theta_e = M_PI_2_F;
+    }
+    else {
+      prim.bbox = BoundBox(light->co - make_float3(light->size),
+                           light->co + make_float3(light->size));
+      if (light->type == LIGHT_SPOT) {
+        prim.cone.axis = safe_normalize(light->dir);
+        prim.cone.theta_o = 0.0f;
+        prim.cone.theta_e = min(light->spot_angle * 0.5f, M_PI_F);
+      }
+      else {
+        prim.cone = LightTreeCone::omnidirectional();
+      }
+    }
+
+    primitives.push_back(prim);
+  }
+
+  if (progress.get_cancel())
+    return;
+
+  LightTree tree(primitives);
+  const vector<LightTreeNode> &nodes = tree.get_nodes();
+  const vector<LightTreePrimitive> &emitters = tree.get_emitters();
+  const int num_emitters = emitters.size();
+  const int num_infinite = infinite_lights.size();
+
+  VLOG(1) << "Light tree with " << nodes.size() << " nodes for " << num_emitters
+          << " emitters and " << num_infinite << " distant lights.";
+
+  /* Nodes, device arrays are never empty. */
+  const size_t num_nodes = nodes.empty() ? 1 : nodes.size();
+  KernelLightTreeNode *knodes = dscene->light_tree_nodes.alloc(num_nodes);
+  memset(knodes, 0, sizeof(KernelLightTreeNode) * num_nodes);
+
+  /* Emitters from the tree followed by distant lights. Maps distribution index to emitter. */
+  const int num_kemitters = (num_emitters + num_infinite == 0) ? 1 : num_emitters + num_infinite;
+  KernelLightTreeEmitter *kemitters = dscene->light_tree_emitters.alloc(num_kemitters);
+  memset(kemitters, 0, sizeof(KernelLightTreeEmitter) * num_kemitters);
+  vector<int> distribution_emitter(distribution_index, -1);
+
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const LightTreeNode &node = nodes[i];
+    KernelLightTreeNode &knode = knodes[i];
+
+    knode.bbox_min[0] = node.bbox.min.x;
+    knode.bbox_min[1] = node.bbox.min.y;
+    knode.bbox_min[2] = node.bbox.min.z;
+    knode.bbox_max[0] = node.bbox.max.x;
+    knode.bbox_max[1] = node.bbox.max.y;
+    knode.bbox_max[2] = node.bbox.max.z;
+    knode.energy = node.energy;
+    knode.parent = node.parent;
+    knode.axis[0] = node.cone.axis.x;
+    knode.axis[1] = node.cone.axis.y;
+    knode.axis[2] = node.cone.axis.z;
+    knode.theta_o = node.cone.theta_o;
+    knode.theta_e = node.cone.theta_e;
+    knode.child = node.child;
+    knode.num_emitters = node.num_emitters;
+
+    for (int e = 0; e < node.num_emitters; e++) {
+      kemitters[node.child + e].leaf = i;
+    }
+  }
+
+  for (int e = 0; e < num_emitters; e++) {
+    kemitters[e].energy = emitters[e].energy;
+    kemitters[e].inv_area = emitters[e].inv_area;
+    kemitters[e].distribution_index = emitters[e].distribution_index;
+    distribution_emitter[emitters[e].distribution_index] = e;
+  }
+
+  for (int e = 0; e < num_infinite; e++) {
+    KernelLightTreeEmitter &kemitter = kemitters[num_emitters + e];
+    kemitter.energy = 0.0f;
+    kemitter.inv_area = 0.0f;
+    kemitter.distribution_index = infinite_lights[e];
+    kemitter.leaf = -1;
+    distribution_emitter[infinite_lights[e]] = num_emitters + e;
+  }
+
+  /* Lookup tables from lamps and triangles to emitters. */
+  for (size_t i = 0; i < lamp_emitter.size(); i++) {
+    lamp_emitter[i] = distribution_emitter[lamp_emitter[i]];
+  }
+  for (size_t i = 0; i < triangle_emitter.size(); i++) {
+    if (triangle_emitter[i] != -1) {
+      triangle_emitter[i] = distribution_emitter[triangle_emitter[i]];
+    }
+  }
+
+  if (lamp_emitter.empty()) {
+    lamp_emitter.push_back(-1);
+  }
+  if (object_lookup.empty()) {
+    object_lookup.resize(2, -1);
+  }
+  if (triangle_emitter.empty()) {
+    triangle_emitter.push_back(-1);
+  }
+
+  int *klamp_emitter = dscene->light_tree_lamp_emitter.alloc(lamp_emitter.size());
+  memcpy(klamp_emitter, lamp_emitter.data(), sizeof(int) * lamp_emitter.size());
+
+  int *kobject_lookup = dscene->light_tree_object_lookup.alloc(object_lookup.size());
+  memcpy(kobject_lookup, object_lookup.data(), sizeof(int) * object_lookup.size());
+
+  int *ktriangle_emitter = dscene->light_tree_triangle_emitter.alloc(triangle_emitter.size());
+  memcpy(ktriangle_emitter, triangle_emitter.data(), sizeof(int) * triangle_emitter.size());
+
+  /* Distant lights get a fixed share of samples, the same as all local lights together. */
+  kintegrator->use_light_tree = true;
+  kintegrator->num_light_tree_emitters = num_emitters;
+  kintegrator->num_light_tree_infinite = num_infinite;
+  if (num_infinite > 0) {
+    kintegrator->light_tree_infinite_pdf = 1.0f /
+                                           (num_infinite + ((num_emitters > 0) ? 1.0f : 0.0f));
+  }
+  kintegrator->light_tree_pdf = 1.0f - num_infinite * kintegrator->light_tree_infinite_pdf;
+
+  dscene->light_tree_nodes.copy_to_device();
+  dscene->light_tree_emitters.copy_to_device();
+  dscene->light_tree_lamp_emitter.copy_to_device();
+  dscene->light_tree_object_lookup.copy_to_device();
+  dscene->light_tree_triangle_emitter.copy_to_device();
+}
+
 static void background_cdf(
     int start, int end, int res_x, int res_y, const vector<float3> *pixels, float2 *cond_cdf)
 {
@@ -985,6 +1246,10 @@ void LightManager::device_update(Device *device,
   if (progress.get_cancel())
     return;
 
+  device_update_tree(dscene, scene, progress);
+  if (progress.get_cancel())
+    return;
+
   if (need_update_background) {
     device_update_background(device, dscene, scene, progress);
     if (progress.get_cancel())
@@ -1007,6 +1272,11 @@ void LightManager::device_update(Device *device,
 void LightManager::device_free(Device *, DeviceScene *dscene, const bool free_background)
 {
   dscene->light_distribution.free();
+  dscene->light_tree_nodes.free();
+  dscene->light_tree_emitters.free();
+  dscene->light_tree_lamp_emitter.free();
+  dscene->light_tree_object_lookup.free();
+  dscene->light_tree_triangle_emitter.free();
   dscene->lights.free();
   if (free_background) {
     dscene->light_background_marginal_cdf.free();
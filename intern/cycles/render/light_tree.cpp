@@ -0,0 +1,271 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/light_tree.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Cone */
+
+LightTreeCone LightTreeCone::empty()
+{
+  LightTreeCone cone;
+  cone.axis = make_float3(0.0f, 0.0f, 1.0f);
+  cone.theta_o = -1.0f;
+  cone.theta_e = 0.0f;
+  return cone;
+}
+
+LightTreeCone LightTreeCone::omnidirectional()
+{
+  LightTreeCone cone;
+  cone.axis = make_float3(0.0f, 0.0f, 1.0f);
+  cone.theta_o = M_PI_F;
+  cone.theta_e = M_PI_2_F;
+  return cone;
+}
+
+LightTreeCone LightTreeCone::merge(const LightTreeCone &other) const
+{
+  if (is_empty()) {
+    return other;
+  }
+  if (other.is_empty()) {
+    return *this;
+  }
+
+  /* Make a the wider cone. */
+  const LightTreeCone &a = (theta_o >= other.theta_o) ? *this : other;
+  const LightTreeCone &b = (theta_o >= other.theta_o) ? other : *this;
+
+  LightTreeCone cone;
+  cone.theta_e = max(a.theta_e, b.theta_e);
+
+  const float theta_d = safe_acosf(dot(a.axis, b.axis));
+
+  if (min(theta_d + b.theta_o, M_PI_F) <= a.theta_o) {
+    /* a already contains b. */
+    cone.axis = a.axis;
+    cone.theta_o = a.theta_o;
+    return cone;
+  }
+
+  cone.theta_o = 0.5f * (a.theta_o + theta_d + b.theta_o);
+
+  const float sin_theta_d = sinf(theta_d);
+  if (cone.theta_o >= M_PI_F || sin_theta_d < 1e-5f) {
+    cone.axis = a.axis;
+    cone.theta_o = M_PI_F;
+    return cone;
+  }
+
+  /* Rotate axis of a towards b. */
+  const float theta_r = cone.theta_o - a.theta_o;
+  cone.axis = normalize(a.axis * sinf(theta_d - theta_r) + b.axis * sinf(theta_r));
+  return cone;
+}
+
+float LightTreeCone::measure() const
+{
+  if (is_empty()) {
+    return 0.0f;
+  }
+
+  const float theta_w = min(theta_o + theta_e, M_PI_F);
+  const float sin_theta_o = sinf(theta_o);
+  const float cos_theta_o = cosf(theta_o);
+
+  return M_2PI_F * (1.0f - cos_theta_o) +
+         M_PI_2_F * (2.0f * theta_w * sin_theta_o - cosf(theta_o - 2.0f * theta_w) -
+                     2.0f * theta_o * sin_theta_o + cos_theta_o);
+}
+
+/* Tree */
+
+LightTree::LightTree(const vector<LightTreePrimitive> &primitives) : emitters(primitives)
+{
+  if (emitters.empty()) {
+    return;
+  }
+
+  nodes.reserve(emitters.size() * 2);
+  recursive_build(-1, 0, emitters.size());
+}
+
+int LightTree::recursive_build(int parent, int start, int end)
+{
+  const int node_index = nodes.size();
+  nodes.push_back(LightTreeNode());
+
+  BoundBox bbox = BoundBox::empty;
+  LightTreeCone cone = LightTreeCone::empty();
+  float energy = 0.0f;
+
+  for (int i = start; i < end; i++) {
+    bbox.grow(emitters[i].bbox);
+    cone = cone.merge(emitters[i].cone);
+    energy += emitters[i].energy;
+  }
+
+  int middle;
+  const bool is_leaf = (end - start == 1) || !find_split(start, end, bbox, cone, &middle);
+
+  if (is_leaf) {
+    LightTreeNode &node = nodes[node_index];
+    node.bbox = bbox;
+    node.cone = cone;
+    node.energy = energy;
+    node.parent = parent;
+    node.child = start;
+    node.num_emitters = end - start;
+    return node_index;
+  }
+
+  recursive_build(node_index, start, middle);
+  const int right_index = recursive_build(node_index, middle, end);
+
+  /* Fill in after recursion, the nodes vector might have been reallocated. */
+  LightTreeNode &node = nodes[node_index];
+  node.bbox = bbox;
+  node.cone = cone;
+  node.energy = energy;
+  node.parent = parent;
+  node.child = right_index;
+  node.num_emitters = 0;
+  return node_index;
+}
+
+bool LightTree::find_split(
+    int start, int end, const BoundBox &bbox, const LightTreeCone &cone, int *r_middle)
+{
+  const int num_buckets = 12;
+
+  struct Bucket {
+    BoundBox bbox;
+    LightTreeCone cone;
+    float energy;
+    int count;
+  };
+
+  BoundBox centroid_bbox = BoundBox::empty;
+  for (int i = start; i < end; i++) {
+    centroid_bbox.grow(emitters[i].centroid());
+  }
+
+  const float3 extent = bbox.size();
+  const float max_extent = max(extent.x, max(extent.y, extent.z));
+  const float node_cost = bbox.area() * cone.measure();
+
+  float min_cost = FLT_MAX;
+  int min_axis = -1;
+  int min_bucket = -1;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float centroid_min = centroid_bbox.min[axis];
+    const float centroid_extent = centroid_bbox.max[axis] - centroid_min;
+
+    if (centroid_extent == 0.0f) {
+      continue;
+    }
+
+    Bucket buckets[num_buckets];
+    for (int b = 0; b < num_buckets; b++) {
+      buckets[b].bbox = BoundBox::empty;
+      buckets[b].cone = LightTreeCone::empty();
+      buckets[b].energy = 0.0f;
+      buckets[b].count = 0;
+    }
+
+    for (int i = start; i < end; i++) {
+      const float offset = (emitters[i].centroid()[axis] - centroid_min) / centroid_extent;
+      const int b = min((int)(offset * num_buckets), num_buckets - 1);
+      buckets[b].bbox.grow(emitters[i].bbox);
+      buckets[b].cone = buckets[b].cone.merge(emitters[i].cone);
+      buckets[b].energy += emitters[i].energy;
+      buckets[b].count++;
+    }
+
+    /* Cost of splitting after every bucket, accumulated from both sides. */
+    float left_cost[num_buckets - 1];
+    BoundBox left_bbox = BoundBox::empty;
+    LightTreeCone left_cone = LightTreeCone::empty();
+    float left_energy = 0.0f;
+
+    for (int b = 0; b < num_buckets - 1; b++) {
+      left_bbox.grow(buckets[b].bbox);
+      left_cone = left_cone.merge(buckets[b].cone);
+      left_energy += buckets[b].energy;
+      left_cost[b] = (left_cone.is_empty()) ? 0.0f :
+                                              left_energy * left_bbox.area() * left_cone.measure();
+    }
+
+    BoundBox right_bbox = BoundBox::empty;
+    LightTreeCone right_cone = LightTreeCone::empty();
+    float right_energy = 0.0f;
+    int right_count = 0;
+
+    for (int b = num_buckets - 1; b > 0; b--) {
+      right_bbox.grow(buckets[b].bbox);
+      right_cone = right_cone.merge(buckets[b].cone);
+      right_energy += buckets[b].energy;
+      right_count += buckets[b].count;
+
+      if (right_count == 0 || right_count == end - start) {
+        continue;
+      }
+
+      const float right_cost = (right_cone.is_empty()) ?
+                                   0.0f :
+                                   right_energy * right_bbox.area() * right_cone.measure();
+
+      /* Regularize towards splitting along the longest axis, to avoid thin nodes. */
+      const float cost = (max_extent / max(extent[axis], 1e-8f)) *
+                         (left_cost[b - 1] + right_cost) / max(node_cost, 1e-8f);
+
+      if (cost < min_cost) {
+        min_cost = cost;
+        min_axis = axis;
+        min_bucket = b;
+      }
+    }
+  }
+
+  if (min_axis == -1) {
+    /* All centroids are in the same place, split in the middle if there are too many emitters
+     * for a leaf. */
+    if (end - start > max_leaf_size) {
+      *r_middle = (start + end) / 2;
+      return true;
+    }
+    return false;
+  }
+
+  const float centroid_min = centroid_bbox.min[min_axis];
+  const float centroid_extent = centroid_bbox.max[min_axis] - centroid_min;
+  LightTreePrimitive *middle = std::partition(
+      &emitters[start], &emitters[end - 1] + 1, [&](const LightTreePrimitive &prim) {
+        const float offset = (prim.centroid()[min_axis] - centroid_min) / centroid_extent;
+        return min((int)(offset * num_buckets), num_buckets - 1) < min_bucket;
+      });
+
+  *r_middle = middle - &emitters[0];
+  return true;
+}
+
+CCL_NAMESPACE_END
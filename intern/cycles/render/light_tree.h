@@ -0,0 +1,117 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "util/util_boundbox.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Orientation bounds: cone around axis with half-angle theta_o containing all emitter normals,
+ * theta_e is the angle around the normals in which light is emitted. */
+
+struct LightTreeCone {
+  float3 axis;
+  float theta_o;
+  float theta_e;
+
+  static LightTreeCone empty();
+  /* Cone for emitters which emit in all directions. */
+  static LightTreeCone omnidirectional();
+
+  bool is_empty() const
+  {
+    return theta_o < 0.0f;
+  }
+
+  LightTreeCone merge(const LightTreeCone &other) const;
+
+  /* Measure of the solid angle covered by the cone, used for split cost. */
+  float measure() const;
+};
+
+struct LightTreePrimitive {
+  BoundBox bbox;
+  LightTreeCone cone;
+  float energy;
+  /* Inverse of triangle area, zero for lamps. */
+  float inv_area;
+  /* Index in the light distribution. */
+  int distribution_index;
+
+  float3 centroid() const
+  {
+    return bbox.center();
+  }
+};
+
+struct LightTreeNode {
+  BoundBox bbox;
+  LightTreeCone cone;
+  float energy;
+  int parent;
+  /* Second child for inner nodes, first emitter for leaves. */
+  int child;
+  int num_emitters;
+
+  bool is_leaf() const
+  {
+    return num_emitters > 0;
+  }
+};
+
+/* Light Tree
+ *
+ * Bounding volume hierarchy over emitters, with nodes bounding both positions and orientations
+ * of emitters. Nodes are stored depth first, so the first child of a node directly follows it.
+ * Splits minimize the surface area orientation heuristic from "Importance Sampling of Many
+ * Lights with Adaptive Tree Splitting" by Conty and Kulla. */
+
+class LightTree {
+ public:
+  static const int max_leaf_size = 8;
+
+  explicit LightTree(const vector<LightTreePrimitive> &primitives);
+
+  /* Primitives ordered so that every leaf references a contiguous range of them. */
+  const vector<LightTreePrimitive> &get_emitters() const
+  {
+    return emitters;
+  }
+
+  const vector<LightTreeNode> &get_nodes() const
+  {
+    return nodes;
+  }
+
+ protected:
+  int recursive_build(int parent, int start, int end);
+  bool find_split(int start,
+                  int end,
+                  const BoundBox &bbox,
+                  const LightTreeCone &cone,
+                  int *r_middle);
+
+  vector<LightTreePrimitive> emitters;
+  vector<LightTreeNode> nodes;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
@@ -150,6 +150,7 @@ Mesh::Mesh(const NodeType *node_type_, Type geom_type_)
 
   subdivision_type = SUBDIVISION_NONE;
   subd_params = NULL;
+  subd_dice_cache = NULL;
 
   patch_table = NULL;
 }
@@ -162,6 +163,7 @@ Mesh::~Mesh()
 {
   delete patch_table;
   delete subd_params;
+  delete subd_dice_cache;
 }
 
 void Mesh::resize_mesh(int numverts, int numtris)
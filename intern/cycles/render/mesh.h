@@ -46,6 +46,7 @@ class Scene;
 class SceneParams;
 class AttributeRequest;
 struct SubdParams;
+struct SubdDiceCache;
 class DiagSplit;
 struct PackedPatchTable;
 
@@ -143,6 +144,8 @@ class Mesh : public Geometry {
   array<SubdEdgeCrease> subd_creases;
 
   SubdParams *subd_params;
+  /* Diced geometry of the last tessellation, reused for small changes in dicing. */
+  SubdDiceCache *subd_dice_cache;
 
   AttributeSet subd_attributes;
 
@@ -18,6 +18,7 @@
 #include "render/camera.h"
 #include "render/mesh.h"
 
+#include "subd/subd_dice.h"
 #include "subd/subd_patch.h"
 #include "subd/subd_patch_table.h"
 #include "subd/subd_split.h"
@@ -25,6 +26,7 @@
 #include "util/util_algorithm.h"
 #include "util/util_foreach.h"
 #include "util/util_hash.h"
+#include "util/util_md5.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -366,6 +368,54 @@ struct OsdPatch : Patch {
 
 #endif
 
+static void dice_cache_hash_append(MD5Hash &md5, const void *data, size_t size)
+{
+  /* Append in chunks, MD5Hash takes the size as int. */
+  const uint8_t *bytes = (const uint8_t *)data;
+  const size_t chunk_size = 1 << 30;
+
+  while (size > 0) {
+    const size_t n = min(size, chunk_size);
+    md5.append(bytes, (int)n);
+    bytes += n;
+    size -= n;
+  }
+}
+
+/* Key for reusing diced geometry, from everything the dicing depends on except for the edge
+ * factors, which are compared separately since they change with the camera. */
+static string dice_cache_key(Mesh *mesh, const SubdParams &params, const float3 *vN)
+{
+  MD5Hash md5;
+
+  dice_cache_hash_append(md5, mesh->verts.data(), sizeof(float3) * mesh->verts.size());
+  dice_cache_hash_append(
+      md5, mesh->subd_face_corners.data(), sizeof(int) * mesh->subd_face_corners.size());
+  dice_cache_hash_append(md5,
+                         mesh->subd_creases.data(),
+                         sizeof(Mesh::SubdEdgeCrease) * mesh->subd_creases.size());
+
+  /* Hash face members separately, to not depend on padding. */
+  for (size_t i = 0; i < mesh->subd_faces.size(); i++) {
+    const Mesh::SubdFace &face = mesh->subd_faces[i];
+    const int face_data[5] = {
+        face.start_corner, face.num_corners, face.shader, face.smooth, face.ptex_offset};
+    dice_cache_hash_append(md5, face_data, sizeof(face_data));
+  }
+
+  if (vN) {
+    dice_cache_hash_append(md5, vN, sizeof(float3) * mesh->verts.size());
+  }
+
+  const int type = mesh->subdivision_type;
+  dice_cache_hash_append(md5, &type, sizeof(type));
+  dice_cache_hash_append(md5, &params.dicing_rate, sizeof(params.dicing_rate));
+  dice_cache_hash_append(md5, &params.max_level, sizeof(params.max_level));
+  dice_cache_hash_append(md5, &params.ptex, sizeof(params.ptex));
+
+  return md5.get_hex();
+}
+
 void Mesh::tessellate(DiagSplit *split)
 {
 #ifdef WITH_OPENSUBDIV
@@ -396,6 +446,16 @@ void Mesh::tessellate(DiagSplit *split)
   Attribute *attr_vN = subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
   float3 *vN = (attr_vN) ? attr_vN->data_float3() : NULL;
 
+  /* Diced geometry is only reused when the control mesh did not change. */
+  if (subd_params) {
+    const string key = dice_cache_key(this, *subd_params, vN);
+    if (subd_dice_cache == NULL || subd_dice_cache->key != key) {
+      delete subd_dice_cache;
+      subd_dice_cache = new SubdDiceCache();
+      subd_dice_cache->key = key;
+    }
+  }
+
   /* count patches */
   int num_patches = 0;
   for (int f = 0; f < num_faces; f++) {
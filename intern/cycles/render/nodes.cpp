@@ -341,6 +341,39 @@ void ImageTextureNode::cull_tiles(Scene *scene, ShaderGraph *graph)
   tiles.swap(new_tiles);
 }
 
+int ImageTextureNode::differentials_attribute(SVMCompiler &compiler)
+{
+  /* Texture coordinate derivatives are only known when the image is mapped directly with a UV
+   * map, otherwise the texture cache reads from the highest resolution. */
+  if (projection != NODE_IMAGE_PROJ_FLAT || !tex_mapping.skip()) {
+    return -1;
+  }
+
+  ShaderInput *vector_in = input("Vector");
+  if (vector_in->link == NULL) {
+    return -1;
+  }
+
+  ShaderNode *node = vector_in->link->parent;
+  if (node->type == UVMapNode::node_type) {
+    UVMapNode *uvmap = (UVMapNode *)node;
+    if (uvmap->from_dupli) {
+      return -1;
+    }
+    return (uvmap->attribute != "") ? compiler.attribute(uvmap->attribute) :
+                                       compiler.attribute(ATTR_STD_UV);
+  }
+  else if (node->type == TextureCoordinateNode::node_type) {
+    TextureCoordinateNode *texco = (TextureCoordinateNode *)node;
+    if (vector_in->link != node->output("UV") || texco->from_dupli) {
+      return -1;
+    }
+    return compiler.attribute(ATTR_STD_UV);
+  }
+
+  return -1;
+}
+
 void ImageTextureNode::attributes(Shader *shader, AttributeRequestSet *attributes)
 {
 #ifdef WITH_PTEX
@@ -389,6 +422,14 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
     }
   }
 
+  int differentials_attr = -1;
+  if (compiler.scene->image_manager->use_texture_cache()) {
+    differentials_attr = differentials_attribute(compiler);
+    if (differentials_attr != -1) {
+      flags |= NODE_IMAGE_DIFFERENTIALS;
+    }
+  }
+
   if (projection != NODE_IMAGE_PROJ_BOX) {
     /* If there only is one image (a very common case), we encode it as a negative value. */
     int num_nodes;
@@ -407,6 +448,10 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
                                              flags),
                       projection);
 
+    if (flags & NODE_IMAGE_DIFFERENTIALS) {
+      compiler.add_node(differentials_attr, 0, 0, 0);
+    }
+
     if (num_nodes > 0) {
       for (int i = 0; i < num_nodes; i++) {
         int4 node;
@@ -121,6 +121,7 @@ class ImageTextureNode : public ImageSlotTextureNode {
 
  protected:
   void cull_tiles(Scene *scene, ShaderGraph *graph);
+  int differentials_attribute(SVMCompiler &compiler);
 };
 
 class EnvironmentTextureNode : public ImageSlotTextureNode {
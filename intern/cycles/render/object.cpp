@@ -771,6 +771,97 @@ void ObjectManager::device_update_flags(
   /* Copy object flag. */
   dscene->object_flag.copy_to_device();
   dscene->object_volume_step.copy_to_device();
+
+  device_update_volume_majorants(dscene, scene);
+}
+
+void ObjectManager::device_update_volume_majorants(DeviceScene *dscene, Scene *scene)
+{
+  /* Minimum number of expected collisions per cell in emissive volumes, to estimate emission
+   * where the density and so the majorant is low. */
+  const float emission_collisions_per_cell = 4.0f;
+  const bool motion_blur = scene->need_motion() == Scene::MOTION_BLUR;
+
+  KernelVolumeMajorant *object_volume_majorant = dscene->object_volume_majorant.alloc(
+      scene->objects.size());
+
+  /* Majorant values are shared between instances with the same scale. */
+  typedef std::pair<Geometry *, std::pair<float, float>> MajorantKey;
+  vector<float> values;
+  map<MajorantKey, int> offsets;
+
+  foreach (Object *object, scene->objects) {
+    KernelVolumeMajorant &kmajorant = object_volume_majorant[object->index];
+    kmajorant.tfm = transform_identity();
+    kmajorant.offset = -1;
+    kmajorant.resolution[0] = kmajorant.resolution[1] = kmajorant.resolution[2] = 0;
+
+    Geometry *geom = object->geometry;
+    if (geom->type != Geometry::VOLUME || !geom->has_volume || geom->used_shaders.empty()) {
+      continue;
+    }
+
+    /* Tracking uses the static object transform. */
+    if (motion_blur && object->use_motion()) {
+      continue;
+    }
+
+    Volume *volume = static_cast<Volume *>(geom);
+    const VolumeMajorantGrid &majorant = volume->majorant;
+
+    float density_scale;
+    bool emissive;
+    if (majorant.empty() || !volume->used_shaders[0]->get_volume_majorant(&density_scale,
+                                                                            &emissive)) {
+      continue;
+    }
+
+    if (volume->object_space) {
+      /* Same adjustment of density to object scale as for the kernel object. */
+      const float3 unit = normalize(make_float3(1.0f, 1.0f, 1.0f));
+      density_scale /= len(transform_direction(&object->tfm, unit));
+    }
+
+    const Transform tfm = majorant.tfm * transform_inverse(object->tfm);
+
+    float emission_majorant = 0.0f;
+    if (emissive) {
+      const Transform itfm = transform_inverse(tfm);
+      const float cell_length = min3(make_float3(len(transform_get_column(&itfm, 0)),
+                                                 len(transform_get_column(&itfm, 1)),
+                                                 len(transform_get_column(&itfm, 2))));
+      emission_majorant = emission_collisions_per_cell / cell_length;
+    }
+
+    const MajorantKey key(geom, std::make_pair(density_scale, emission_majorant));
+    map<MajorantKey, int>::iterator it = offsets.find(key);
+
+    if (it == offsets.end()) {
+      it = offsets.insert(std::make_pair(key, (int)values.size())).first;
+
+      for (size_t i = 0; i < majorant.density.size(); i++) {
+        const float value = majorant.density[i] * density_scale;
+        values.push_back((majorant.active[i]) ? max(value, emission_majorant) : value);
+      }
+    }
+
+    kmajorant.tfm = tfm;
+    kmajorant.offset = it->second;
+    kmajorant.resolution[0] = majorant.resolution.x;
+    kmajorant.resolution[1] = majorant.resolution.y;
+    kmajorant.resolution[2] = majorant.resolution.z;
+  }
+
+  dscene->object_volume_majorant.copy_to_device();
+
+  if (values.empty()) {
+    dscene->volume_majorant.free();
+  }
+  else {
+    float *volume_majorant = dscene->volume_majorant.alloc(values.size());
+    std::copy(values.begin(), values.end(), volume_majorant);
+    dscene->volume_majorant.copy_to_device();
+  }
 }
 
 void ObjectManager::device_update_mesh_offsets(Device *, DeviceScene *dscene, Scene *scene)
@@ -818,6 +909,8 @@ void ObjectManager::device_free(Device *, DeviceScene *dscene)
   dscene->object_motion.free();
   dscene->object_flag.free();
   dscene->object_volume_step.free();
+  dscene->object_volume_majorant.free();
+  dscene->volume_majorant.free();
 }
 
 void ObjectManager::apply_static_transforms(DeviceScene *dscene, Scene *scene, Progress &progress)
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/path_guiding.h"
+
+#include "util/util_logging.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Number of cells along the longest axis of the scene bounds. */
+static const int GRID_RESOLUTION = 16;
+/* Minimum number of recorded path vertices for a cell to get a distribution. */
+static const float MIN_CELL_VERTICES = 16.0f;
+/* Fraction of uniform distribution mixed into every cell, so that directions which were
+ * not sampled enough while learning can still be guided into. */
+static const float UNIFORM_FRACTION = 0.1f;
+/* Probability of sampling from the distribution instead of the BSDF. */
+static const float MIX_PROBABILITY = 0.5f;
+
+PathGuiding::PathGuiding()
+    : num_cells(0), num_samples(0), next_build_samples(1), training_samples(0)
+{
+  memset(&kguiding, 0, sizeof(kguiding));
+}
+
+PathGuiding::~PathGuiding()
+{
+}
+
+void PathGuiding::reset(const BoundBox &bounds_, int training_samples_)
+{
+  BoundBox bounds = bounds_;
+  if (!bounds.valid()) {
+    bounds = BoundBox(make_float3(0.0f, 0.0f, 0.0f), make_float3(1.0f, 1.0f, 1.0f));
+  }
+
+  /* Cubic cells, with at least one cell along flat axes. */
+  const float3 size = bounds.size();
+  const float cell_size = max(max3(size), 1e-4f) / GRID_RESOLUTION;
+  int3 resolution;
+  resolution.x = clamp((int)ceilf(size.x / cell_size), 1, GRID_RESOLUTION);
+  resolution.y = clamp((int)ceilf(size.y / cell_size), 1, GRID_RESOLUTION);
+  resolution.z = clamp((int)ceilf(size.z / cell_size), 1, GRID_RESOLUTION);
+
+  num_cells = resolution.x * resolution.y * resolution.z;
+  num_samples = 0;
+  next_build_samples = 1;
+  training_samples = max(training_samples_, 1);
+
+  cdf.clear();
+  cdf.resize(num_cells * (PATH_GUIDING_BINS + 1), 0.0f);
+  training.clear();
+  training.resize(num_cells * (PATH_GUIDING_BINS + 1), 0.0f);
+
+  kguiding.bounds_min = bounds.min;
+  kguiding.inv_cell_size = make_float3(1.0f / cell_size, 1.0f / cell_size, 1.0f / cell_size);
+  kguiding.resolution[0] = resolution.x;
+  kguiding.resolution[1] = resolution.y;
+  kguiding.resolution[2] = resolution.z;
+  kguiding.mix_probability = 0.0f;
+  kguiding.cdf = cdf.data();
+  kguiding.training = training.data();
+
+  VLOG(1) << "Path guiding grid resolution " << resolution.x << "x" << resolution.y << "x"
+          << resolution.z << ", learning from " << training_samples << " samples.";
+}
+
+bool PathGuiding::add_samples(int num_samples_)
+{
+  if (!is_learning()) {
+    return false;
+  }
+
+  num_samples += num_samples_;
+  if (num_samples < next_build_samples && num_samples < training_samples) {
+    return false;
+  }
+
+  build_distribution();
+
+  if (num_samples >= training_samples) {
+    /* Done learning, stop recording in the kernel. */
+    training.free_memory();
+    kguiding.training = NULL;
+  }
+  else {
+    memset(training.data(), 0, sizeof(float) * training.size());
+    next_build_samples = num_samples * 2;
+  }
+
+  return true;
+}
+
+void PathGuiding::build_distribution()
+{
+  int num_valid_cells = 0;
+
+  for (int cell = 0; cell < num_cells; cell++) {
+    const float *cell_training = &training[cell * (PATH_GUIDING_BINS + 1)];
+    float *cell_cdf = &cdf[cell * (PATH_GUIDING_BINS + 1)];
+
+    float sum = 0.0f;
+    for (int bin = 0; bin < PATH_GUIDING_BINS; bin++) {
+      sum += cell_training[bin];
+    }
+
+    /* Keep the previous distribution if there was not enough data. */
+    if (cell_training[PATH_GUIDING_BINS] >= MIN_CELL_VERTICES && sum > 0.0f) {
+      const float scale = (1.0f - UNIFORM_FRACTION) / sum;
+      const float uniform = UNIFORM_FRACTION / PATH_GUIDING_BINS;
+
+      cell_cdf[0] = 0.0f;
+      for (int bin = 0; bin < PATH_GUIDING_BINS; bin++) {
+        cell_cdf[bin + 1] = cell_cdf[bin] + cell_training[bin] * scale + uniform;
+      }
+
+      const float inv_total = 1.0f / cell_cdf[PATH_GUIDING_BINS];
+      for (int bin = 1; bin < PATH_GUIDING_BINS; bin++) {
+        cell_cdf[bin] *= inv_total;
+      }
+      cell_cdf[PATH_GUIDING_BINS] = 1.0f;
+    }
+
+    if (cell_cdf[PATH_GUIDING_BINS] != 0.0f) {
+      num_valid_cells++;
+    }
+  }
+
+  kguiding.mix_probability = (num_valid_cells > 0) ? MIX_PROBABILITY : 0.0f;
+
+  VLOG(1) << "Path guiding distribution built after " << num_samples << " samples, "
+          << num_valid_cells << " of " << num_cells << " cells guided.";
+}
+
+CCL_NAMESPACE_END
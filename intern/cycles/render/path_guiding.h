@@ -0,0 +1,73 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PATH_GUIDING_H__
+#define __PATH_GUIDING_H__
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_boundbox.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Path Guiding
+ *
+ * Learns the distribution of incident radiance used for path guiding by the CPU kernel, from
+ * radiance recorded while rendering the first samples. The distribution is rebuilt after 1, 2,
+ * 4, ... samples until the number of training samples is reached, each time from the samples
+ * rendered since the previous rebuild only, since those were guided by a better distribution.
+ *
+ * Data is shared with the kernel directly, so it must only be modified between samples. */
+
+class PathGuiding {
+ public:
+  PathGuiding();
+  ~PathGuiding();
+
+  /* Clear the learned distribution and start learning for a grid over the bounds. */
+  void reset(const BoundBox &bounds, int training_samples);
+
+  /* Update after rendering samples, returns true if the distribution was rebuilt. */
+  bool add_samples(int num_samples);
+
+  bool is_learning() const
+  {
+    return kguiding.training != NULL;
+  }
+
+  KernelPathGuiding *get_kernel_data()
+  {
+    return &kguiding;
+  }
+
+ protected:
+  void build_distribution();
+
+  KernelPathGuiding kguiding;
+
+  vector<float> cdf;
+  vector<float> training;
+  int num_cells;
+
+  int num_samples;
+  int next_build_samples;
+  int training_samples;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __PATH_GUIDING_H__ */
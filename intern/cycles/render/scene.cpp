@@ -66,6 +66,8 @@ DeviceScene::DeviceScene(Device *device)
       object_motion(device, "__object_motion", MEM_GLOBAL),
       object_flag(device, "__object_flag", MEM_GLOBAL),
       object_volume_step(device, "__object_volume_step", MEM_GLOBAL),
+      object_volume_majorant(device, "__object_volume_majorant", MEM_GLOBAL),
+      volume_majorant(device, "__volume_majorant", MEM_GLOBAL),
       camera_motion(device, "__camera_motion", MEM_GLOBAL),
       attributes_map(device, "__attributes_map", MEM_GLOBAL),
       attributes_float(device, "__attributes_float", MEM_GLOBAL),
@@ -76,6 +78,11 @@ DeviceScene::DeviceScene(Device *device)
       lights(device, "__lights", MEM_GLOBAL),
       light_background_marginal_cdf(device, "__light_background_marginal_cdf", MEM_GLOBAL),
       light_background_conditional_cdf(device, "__light_background_conditional_cdf", MEM_GLOBAL),
+      light_tree_nodes(device, "__light_tree_nodes", MEM_GLOBAL),
+      light_tree_emitters(device, "__light_tree_emitters", MEM_GLOBAL),
+      light_tree_lamp_emitter(device, "__light_tree_lamp_emitter", MEM_GLOBAL),
+      light_tree_object_lookup(device, "__light_tree_object_lookup", MEM_GLOBAL),
+      light_tree_triangle_emitter(device, "__light_tree_triangle_emitter", MEM_GLOBAL),
       particles(device, "__particles", MEM_GLOBAL),
       svm_nodes(device, "__svm_nodes", MEM_GLOBAL),
       shaders(device, "__shaders", MEM_GLOBAL),
@@ -110,6 +117,7 @@ Scene::Scene(const SceneParams &params_, Device *device)
   object_manager = new ObjectManager();
   integrator = create_node<Integrator>();
   image_manager = new ImageManager(device->info);
+  image_manager->set_texture_cache_params(params.texture_cache);
   particle_system_manager = new ParticleSystemManager();
   bake_manager = new BakeManager();
   kernels_loaded = false;
@@ -96,6 +96,10 @@ class DeviceScene {
   device_vector<DecomposedTransform> object_motion;
   device_vector<uint> object_flag;
   device_vector<float> object_volume_step;
+  device_vector<KernelVolumeMajorant> object_volume_majorant;
+
+  /* volumes */
+  device_vector<float> volume_majorant;
 
   /* cameras */
   device_vector<DecomposedTransform> camera_motion;
@@ -112,6 +116,11 @@ class DeviceScene {
   device_vector<KernelLight> lights;
   device_vector<float2> light_background_marginal_cdf;
   device_vector<float2> light_background_conditional_cdf;
+  device_vector<KernelLightTreeNode> light_tree_nodes;
+  device_vector<KernelLightTreeEmitter> light_tree_emitters;
+  device_vector<int> light_tree_lamp_emitter;
+  device_vector<int> light_tree_object_lookup;
+  device_vector<int> light_tree_triangle_emitter;
 
   /* particles */
   device_vector<KernelParticle> particles;
@@ -176,6 +185,7 @@ class SceneParams {
   CurveShapeType hair_shape;
   bool persistent_data;
   int texture_limit;
+  TextureCacheParams texture_cache;
 
   bool background;
 
@@ -202,7 +212,8 @@ class SceneParams {
              use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes &&
              num_bvh_time_steps == params.num_bvh_time_steps &&
              hair_subdivisions == params.hair_subdivisions && hair_shape == params.hair_shape &&
-             persistent_data == params.persistent_data && texture_limit == params.texture_limit);
+             persistent_data == params.persistent_data && texture_limit == params.texture_limit &&
+             !texture_cache.modified(params.texture_cache));
   }
 
   int curve_subdivisions()
@@ -26,6 +26,7 @@
 #include "render/light.h"
 #include "render/mesh.h"
 #include "render/object.h"
+#include "render/path_guiding.h"
 #include "render/scene.h"
 #include "render/session.h"
 
@@ -79,6 +80,7 @@ Session::Session(const SessionParams &params_)
 
   session_thread = NULL;
   scene = NULL;
+  path_guiding = NULL;
 
   reset_time = 0.0;
   last_update_time = 0.0;
@@ -131,6 +133,7 @@ Session::~Session()
   delete display;
   delete scene;
   delete device;
+  delete path_guiding;
 
   TaskScheduler::exit();
 }
@@ -734,6 +737,10 @@ void Session::run_cpu()
 
     device->task_wait();
 
+    if (path_guiding && !no_tiles) {
+      path_guiding->add_samples(tile_manager.state.num_samples);
+    }
+
     {
       thread_scoped_lock reset_lock(delayed_reset.mutex);
       thread_scoped_lock buffers_lock(buffers_mutex);
@@ -941,6 +948,9 @@ bool Session::update_scene()
 
   bool kernel_switch_needed = false;
   if (scene->update(progress, kernel_switch_needed)) {
+    /* Radiance learned for the previous state of the scene is no longer valid. */
+    reset_path_guiding();
+
     if (kernel_switch_needed) {
       reset(tile_manager.params, params.samples);
     }
@@ -949,6 +959,33 @@ bool Session::update_scene()
   return false;
 }
 
+void Session::reset_path_guiding()
+{
+  /* Only supported by the CPU kernel. */
+  if (!scene->integrator->use_path_guiding_sampling() || params.device.type != DEVICE_CPU) {
+    if (path_guiding) {
+      device->set_path_guiding(NULL);
+      delete path_guiding;
+      path_guiding = NULL;
+    }
+    return;
+  }
+
+  BoundBox bounds = BoundBox::empty;
+  foreach (Object *object, scene->objects) {
+    if (object->bounds.valid()) {
+      bounds.grow(object->bounds);
+    }
+  }
+
+  if (path_guiding == NULL) {
+    path_guiding = new PathGuiding();
+  }
+
+  path_guiding->reset(bounds, scene->integrator->path_guiding_training_samples);
+  device->set_path_guiding(path_guiding->get_kernel_data());
+}
+
 void Session::update_status_time(bool show_pause, bool show_done)
 {
   int progressive_sample = tile_manager.state.sample;
@@ -35,6 +35,7 @@ class Device;
 class DeviceScene;
 class DeviceRequestedFeatures;
 class DisplayBuffer;
+class PathGuiding;
 class Progress;
 class RenderBuffers;
 class Scene;
@@ -224,6 +225,10 @@ class Session {
 
   /* progressive refine */
   bool update_progressive_refine(bool cancel);
+
+  /* path guiding, learned in the first samples */
+  PathGuiding *path_guiding;
+  void reset_path_guiding();
 };
 
 CCL_NAMESPACE_END
@@ -271,6 +271,37 @@ bool Shader::is_constant_emission(float3 *emission)
   return true;
 }
 
+bool Shader::get_volume_majorant(float *density_scale, bool *emissive)
+{
+  if (!has_volume) {
+    return false;
+  }
+
+  ShaderInput *volume = graph->output()->input("Volume");
+
+  if (volume->link == NULL || volume->link->parent->type != PrincipledVolumeNode::node_type) {
+    return false;
+  }
+
+  PrincipledVolumeNode *node = (PrincipledVolumeNode *)volume->link->parent;
+
+  if (node->input("Density")->link || node->input("Color")->link) {
+    return false;
+  }
+
+  if (Attribute::name_standard(node->density_attribute.c_str()) != ATTR_STD_VOLUME_DENSITY) {
+    return false;
+  }
+
+  /* Extinction is (color + absorption) * density, where absorption is at most 1 - color. This
+   * assumes a color attribute, if any, is in the 0..1 range. */
+  *density_scale = max(node->density, 0.0f) * max(max3(node->color), 1.0f);
+  *emissive = node->input("Emission Strength")->link || node->emission_strength != 0.0f ||
+              node->input("Blackbody Intensity")->link || node->blackbody_intensity != 0.0f;
+
+  return true;
+}
+
 void Shader::set_graph(ShaderGraph *graph_)
 {
   /* do this here already so that we can detect if mesh or object attributes
@@ -357,7 +388,9 @@ void Shader::tag_update(Scene *scene)
     scene->geometry_manager->need_update = true;
   }
 
-  if (has_volume != prev_has_volume || volume_step_rate != prev_volume_step_rate) {
+  /* Volume majorant grids depend on the volume shader nodes as well. */
+  if (has_volume || has_volume != prev_has_volume ||
+      volume_step_rate != prev_volume_step_rate) {
     scene->geometry_manager->need_flags_update = true;
     scene->object_manager->need_flags_update = true;
     prev_volume_step_rate = volume_step_rate;
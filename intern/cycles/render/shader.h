@@ -149,6 +149,12 @@ class Shader : public Node {
    * then used for speeding up light evaluation. */
   bool is_constant_emission(float3 *emission);
 
+  /* Checks whether the volume shader is a Principled Volume node with fixed density and color
+   * that's connected directly to the output, so that the extinction coefficient is bounded by
+   * the density attribute multiplied by density_scale. Emissive is set if the volume may emit
+   * light, also where the density is zero. */
+  bool get_volume_majorant(float *density_scale, bool *emissive);
+
   void set_graph(ShaderGraph *graph);
   void tag_update(Scene *scene);
   void tag_used(Scene *scene);
@@ -242,13 +242,31 @@ string MeshStats::full_report(int indent_level)
 
 ImageStats::ImageStats()
 {
+  has_texture_cache = false;
 }
 
 string ImageStats::full_report(int indent_level)
 {
   const string indent(indent_level * kIndentNumSpaces, ' ');
+  const string double_indent = indent + indent;
   string result = "";
   result += indent + "Textures:\n" + textures.full_report(indent_level + 1);
+  if (has_texture_cache) {
+    result += indent + "Texture Cache:\n";
+    result += string_printf("%sImages: %d\n", double_indent.c_str(), texture_cache.num_images);
+    result += string_printf("%sMemory: %s\n",
+                            double_indent.c_str(),
+                            string_human_readable_size(texture_cache.memory_used).c_str());
+    result += string_printf("%sRead from disk: %s (%.2fs)\n",
+                            double_indent.c_str(),
+                            string_human_readable_size(texture_cache.bytes_read).c_str(),
+                            texture_cache.file_io_time);
+    result += string_printf("%sTiles: %llu created, %llu lookups, %llu misses\n",
+                            double_indent.c_str(),
+                            (unsigned long long)texture_cache.tiles_created,
+                            (unsigned long long)texture_cache.tile_lookups,
+                            (unsigned long long)texture_cache.tile_misses);
+  }
   return result;
 }
 
@@ -21,6 +21,7 @@
 
 #include "util/util_stats.h"
 #include "util/util_string.h"
+#include "util/util_texture_cache.h"
 #include "util/util_vector.h"
 
 CCL_NAMESPACE_BEGIN
@@ -171,6 +172,9 @@ class ImageStats {
   string full_report(int indent_level = 0);
 
   NamedSizeStats textures;
+
+  bool has_texture_cache;
+  TextureCacheStats texture_cache;
 };
 
 /* Render process statistics. */
@@ -59,6 +59,7 @@ Volume::Volume() : Mesh(node_type, Geometry::VOLUME)
 void Volume::clear()
 {
   Mesh::clear(true);
+  majorant.clear();
 }
 
 struct QuadData {
@@ -186,6 +187,10 @@ class VolumeMeshBuilder {
   bool empty_grid() const;
 
 #ifdef WITH_OPENVDB
+  void create_majorant(openvdb::GridBase::ConstPtr density_grid,
+                       int pad_size,
+                       VolumeMajorantGrid &majorant);
+
   template<typename GridType>
   void merge_grid(openvdb::GridBase::ConstPtr grid, bool do_clipping, float volume_clipping)
   {
@@ -424,6 +429,157 @@ bool VolumeMeshBuilder::empty_grid() const
 #endif
 }
 
+#ifdef WITH_OPENVDB
+/* Majorant grid cells are blocks of voxels of the topology grid, bigger than this for very high
+ * resolution volumes to limit memory usage. */
+#  define VOLUME_MAJORANT_CELL_SIZE 8
+#  define VOLUME_MAJORANT_MAX_RESOLUTION 256
+
+void VolumeMeshBuilder::create_majorant(openvdb::GridBase::ConstPtr density_grid,
+                                        int pad_size,
+                                        VolumeMajorantGrid &majorant)
+{
+  majorant.clear();
+
+  if (!density_grid || !density_grid->isType<openvdb::FloatGrid>()) {
+    return;
+  }
+
+  openvdb::CoordBBox bbox;
+  if (!topology_grid->tree().evalLeafBoundingBox(bbox)) {
+    return;
+  }
+
+  /* The mesh covers voxels from their index to the next index, add a margin of one voxel on
+   * all sides so that the grid covers the mesh and the interpolation footprint of voxels
+   * regardless of where voxel centers are placed. */
+  const openvdb::Vec3d origin = bbox.min().asVec3d() - openvdb::Vec3d(1.0);
+  const openvdb::Coord dim = bbox.dim() + openvdb::Coord(3);
+  const int max_dim = max(dim.x(), max(dim.y(), dim.z()));
+  const int cell_size = max(VOLUME_MAJORANT_CELL_SIZE,
+                            (int)divide_up(max_dim, VOLUME_MAJORANT_MAX_RESOLUTION));
+
+  const int3 resolution = make_int3((int)divide_up(dim.x(), cell_size),
+                                    (int)divide_up(dim.y(), cell_size),
+                                    (int)divide_up(dim.z(), cell_size));
+  const size_t num_cells = (size_t)resolution.x * resolution.y * resolution.z;
+
+  majorant.density.resize(num_cells, 0.0f);
+  majorant.active.resize(num_cells, false);
+
+  /* Range of cells overlapping a box in the index space of the topology grid. */
+  auto cell_range = [&](const openvdb::BBoxd &box, int3 &cell_min, int3 &cell_max) {
+    for (int axis = 0; axis < 3; axis++) {
+      const int res = resolution[axis];
+      cell_min[axis] = clamp(
+          (int)floor((box.min()[axis] - origin[axis]) / cell_size), 0, res - 1);
+      cell_max[axis] = clamp(
+          (int)floor((box.max()[axis] - origin[axis]) / cell_size), 0, res - 1);
+    }
+  };
+
+  auto cell_index = [&](int x, int y, int z) {
+    return x + (size_t)resolution.x * (y + (size_t)resolution.y * z);
+  };
+
+  /* Cells covered by the mesh, which is made of leaf nodes of the topology grid. */
+  for (auto leaf = topology_grid->tree().cbeginLeaf(); leaf; ++leaf) {
+    const openvdb::CoordBBox leaf_bbox = leaf->getNodeBoundingBox();
+    const openvdb::BBoxd box(leaf_bbox.min().asVec3d() - openvdb::Vec3d(0.5),
+                             leaf_bbox.max().asVec3d() + openvdb::Vec3d(1.5));
+
+    int3 cell_min, cell_max;
+    cell_range(box, cell_min, cell_max);
+
+    for (int z = cell_min.z; z <= cell_max.z; z++) {
+      for (int y = cell_min.y; y <= cell_max.y; y++) {
+        for (int x = cell_min.x; x <= cell_max.x; x++) {
+          majorant.active[cell_index(x, y, z)] = true;
+        }
+      }
+    }
+  }
+
+  /* Maximum density, with voxels dilated by the interpolation footprint and transformed into
+   * the index space of the topology grid in case the grid transforms differ. */
+  openvdb::FloatGrid::ConstPtr grid = openvdb::gridConstPtrCast<openvdb::FloatGrid>(
+      density_grid);
+  const openvdb::math::Transform &density_transform = grid->transform();
+  const openvdb::math::Transform &topology_transform = topology_grid->transform();
+
+  auto grow_density = [&](const openvdb::CoordBBox &voxels, float value) {
+    const openvdb::BBoxd voxel_box(voxels.min().asVec3d() - openvdb::Vec3d(pad_size + 0.5),
+                                   voxels.max().asVec3d() + openvdb::Vec3d(pad_size + 1.5));
+    const openvdb::BBoxd box = topology_transform.worldToIndex(
+        density_transform.indexToWorld(voxel_box));
+
+    int3 cell_min, cell_max;
+    cell_range(box, cell_min, cell_max);
+
+    for (int z = cell_min.z; z <= cell_max.z; z++) {
+      for (int y = cell_min.y; y <= cell_max.y; y++) {
+        for (int x = cell_min.x; x <= cell_max.x; x++) {
+          float &density = majorant.density[cell_index(x, y, z)];
+          density = max(density, value);
+        }
+      }
+    }
+  };
+
+  /* Per leaf node rather than per voxel, cells are about as big as leaf nodes anyway. */
+  for (auto leaf = grid->tree().cbeginLeaf(); leaf; ++leaf) {
+    float value = 0.0f;
+    for (auto iter = leaf->cbeginValueOn(); iter; ++iter) {
+      value = max(value, *iter);
+    }
+
+    if (value > 0.0f) {
+      openvdb::CoordBBox voxels;
+      leaf->evalActiveBoundingBox(voxels);
+      grow_density(voxels, value);
+    }
+  }
+
+  /* Active tiles above the leaf level. */
+  openvdb::FloatGrid::ValueOnCIter tile = grid->cbeginValueOn();
+  tile.setMaxDepth(openvdb::FloatGrid::ValueOnCIter::LEAF_DEPTH - 1);
+  for (; tile; ++tile) {
+    if (*tile > 0.0f) {
+      grow_density(tile.getBoundingBox(), *tile);
+    }
+  }
+
+  /* Inactive voxels inside the mesh have the background value. */
+  const float background = grid->background();
+  if (background > 0.0f) {
+    for (size_t i = 0; i < num_cells; i++) {
+      if (majorant.active[i]) {
+        majorant.density[i] = max(majorant.density[i], background);
+      }
+    }
+  }
+
+  /* Object space to cell coordinates. */
+  openvdb::math::Mat4f grid_matrix =
+      topology_transform.baseMap()->getAffineMap()->getMat4();
+  Transform index_to_object;
+  for (int col = 0; col < 4; col++) {
+    for (int row = 0; row < 3; row++) {
+      index_to_object[row][col] = (float)grid_matrix[col][row];
+    }
+  }
+
+  majorant.tfm = transform_scale(make_float3(1.0f / cell_size)) *
+                 transform_translate(make_float3(
+                     (float)-origin.x(), (float)-origin.y(), (float)-origin.z())) *
+                 transform_inverse(index_to_object);
+  majorant.resolution = resolution;
+
+  VLOG(1) << "Volume majorant grid resolution " << resolution.x << "x" << resolution.y << "x"
+          << resolution.z << ", cell size " << cell_size << " voxels.";
+}
+#endif
+
 #ifdef WITH_OPENVDB
 template<typename GridType>
 static openvdb::GridBase::ConstPtr openvdb_grid_from_device_texture(device_texture *image_memory,
@@ -493,6 +649,8 @@ void GeometryManager::create_volume_mesh(Volume *volume, Progress &progress)
   VolumeMeshBuilder builder;
 
 #ifdef WITH_OPENVDB
+  openvdb::GridBase::ConstPtr density_grid;
+
   foreach (Attribute &attr, volume->attributes.attributes) {
     if (attr.element != ATTR_ELEMENT_VOXEL) {
       continue;
@@ -532,6 +690,10 @@ void GeometryManager::create_volume_mesh(Volume *volume, Progress &progress)
 
     if (grid) {
       builder.add_grid(grid, do_clipping, volume->clipping);
+
+      if (attr.std == ATTR_STD_VOLUME_DENSITY) {
+        density_grid = grid;
+      }
     }
   }
 #endif
@@ -600,6 +762,11 @@ void GeometryManager::create_volume_mesh(Volume *volume, Progress &progress)
     fN[i] = face_normals[i];
   }
 
+  /* Create majorant grid. */
+#ifdef WITH_OPENVDB
+  builder.create_majorant(density_grid, pad_size, volume->majorant);
+#endif
+
   /* Print stats. */
   VLOG(1) << "Memory usage volume mesh: "
           << ((vertices.size() + face_normals.size()) * sizeof(float3) +
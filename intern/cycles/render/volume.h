@@ -20,8 +20,36 @@
 
 #include "render/mesh.h"
 
+#include "util/util_transform.h"
+#include "util/util_vector.h"
+
 CCL_NAMESPACE_BEGIN
 
+/* Coarse grid with the maximum of the density attribute over blocks of voxels, dilated to cover
+ * the interpolation footprint. Used as majorant for tracking through the volume in the kernel
+ * and to skip empty space. */
+struct VolumeMajorantGrid {
+  /* Object space to grid cell coordinates. */
+  Transform tfm;
+  int3 resolution;
+
+  /* Maximum density per cell. */
+  vector<float> density;
+  /* Cells that overlap active voxels of any grid, where the volume may be emissive. */
+  vector<bool> active;
+
+  bool empty() const
+  {
+    return density.empty();
+  }
+
+  void clear()
+  {
+    density.clear();
+    active.clear();
+  }
+};
+
 class Volume : public Mesh {
  public:
   NODE_DECLARE
@@ -32,6 +60,8 @@ class Volume : public Mesh {
   float step_size;
   bool object_space;
 
+  VolumeMajorantGrid majorant;
+
   virtual void clear() override;
 };
 
@@ -45,8 +45,7 @@ void EdgeDice::reserve(int num_verts, int num_triangles)
   vert_offset = mesh->verts.size();
   tri_offset = mesh->num_triangles();
 
-  mesh->resize_mesh(mesh->verts.size() + num_verts, mesh->num_triangles());
-  mesh->reserve_mesh(mesh->verts.size() + num_verts, mesh->num_triangles() + num_triangles);
+  mesh->resize_mesh(mesh->verts.size() + num_verts, mesh->num_triangles() + num_triangles);
 
   Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
 
@@ -73,8 +72,15 @@ void EdgeDice::add_triangle(Patch *patch, int v0, int v1, int v2)
 {
   Mesh *mesh = params.mesh;
 
-  mesh->add_triangle(v0 + vert_offset, v1 + vert_offset, v2 + vert_offset, patch->shader, true);
-  params.mesh->triangle_patch[params.mesh->num_triangles() - 1] = patch->patch_index;
+  assert(tri_offset < mesh->num_triangles());
+
+  int *triangle = mesh->triangles.data() + tri_offset * 3;
+  triangle[0] = v0 + vert_offset;
+  triangle[1] = v1 + vert_offset;
+  triangle[2] = v2 + vert_offset;
+  mesh->shader[tri_offset] = patch->shader;
+  mesh->smooth[tri_offset] = true;
+  mesh->triangle_patch[tri_offset] = patch->patch_index;
 
   tri_offset++;
 }
@@ -190,6 +196,14 @@ void QuadDice::set_side(Subpatch &sub, int edge)
   }
 }
 
+void QuadDice::set_sides(Subpatch &sub)
+{
+  set_side(sub, 0);
+  set_side(sub, 1);
+  set_side(sub, 2);
+  set_side(sub, 3);
+}
+
 float QuadDice::quad_area(const float3 &a, const float3 &b, const float3 &c, const float3 &d)
 {
   return triangle_area(a, b, d) + triangle_area(a, d, c);
@@ -250,7 +264,7 @@ void QuadDice::add_grid(Subpatch &sub, int Mu, int Mv, int offset)
   }
 }
 
-void QuadDice::dice(Subpatch &sub)
+void QuadDice::dice_inner(Subpatch &sub)
 {
   /* compute inner grid size with scale factor */
   int Mu = max(sub.edge_u0.T, sub.edge_u1.T);
@@ -269,15 +283,16 @@ void QuadDice::dice(Subpatch &sub)
   add_grid(sub, Mu, Mv, sub.inner_grid_vert_offset);
 
   /* sides */
-  set_side(sub, 0);
-  set_side(sub, 1);
-  set_side(sub, 2);
-  set_side(sub, 3);
-
   stitch_triangles(sub, 0);
   stitch_triangles(sub, 1);
   stitch_triangles(sub, 2);
   stitch_triangles(sub, 3);
 }
 
+void QuadDice::dice(Subpatch &sub)
+{
+  set_sides(sub);
+  dice_inner(sub);
+}
+
 CCL_NAMESPACE_END
@@ -22,6 +22,9 @@
  * DiagSplit. For more algorithm details, see the DiagSplit paper or the
  * ARB_tessellation_shader OpenGL extension, Section 2.X.2. */
 
+#include "util/util_array.h"
+#include "util/util_map.h"
+#include "util/util_string.h"
 #include "util/util_types.h"
 #include "util/util_vector.h"
 
@@ -57,6 +60,33 @@ struct SubdParams {
   }
 };
 
+/* Dice Cache
+ *
+ * Diced geometry of a mesh, kept to be reused when the mesh is tessellated again with the same
+ * control mesh and the edge factors DiagSplit computes stay within a tolerance of the ones the
+ * geometry was diced with, as is the case for small camera movements. */
+
+struct SubdDiceCache {
+  /* Hash of the control mesh and dicing parameters. */
+  string key;
+  /* Edge factors of DiagSplit the geometry was diced with. */
+  vector<int> edge_factors;
+
+  array<float3> verts;
+  array<float3> normals;
+  array<float2> patch_uv;
+  array<int> triangles;
+  array<int> shader;
+  array<int> triangle_patch;
+  /* Pairs of vert index and stitching key, in the order they were added. */
+  vector<pair<int, int>> stitching_keys;
+
+  bool empty() const
+  {
+    return edge_factors.empty();
+  }
+};
+
 /* EdgeDice Base */
 
 class EdgeDice {
@@ -69,6 +99,8 @@ class EdgeDice {
 
   explicit EdgeDice(const SubdParams &params);
 
+  /* Allocates verts and triangles, which are then written by index so that subpatches can be
+   * diced in parallel. */
   void reserve(int num_verts, int num_triangles);
 
   void set_vert(Patch *patch, int index, float2 uv);
@@ -91,10 +123,14 @@ class QuadDice : public EdgeDice {
   void add_grid(Subpatch &sub, int Mu, int Mv, int offset);
 
   void set_side(Subpatch &sub, int edge);
+  void set_sides(Subpatch &sub);
 
   float quad_area(const float3 &a, const float3 &b, const float3 &c, const float3 &d);
   float scale_factor(Subpatch &sub, int Mu, int Mv);
 
+  /* Verts on the sides of subpatches are shared with neighbors, and must be set before the
+   * inner grid is diced, which only writes verts and triangles of the subpatch itself. */
+  void dice_inner(Subpatch &sub);
   void dice(Subpatch &sub);
 };
 
@@ -25,6 +25,7 @@
 #include "util/util_foreach.h"
 #include "util/util_hash.h"
 #include "util/util_math.h"
+#include "util/util_tbb.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -34,6 +35,8 @@ CCL_NAMESPACE_BEGIN
 #define DSPLIT_NON_UNIFORM -1
 #define STITCH_NGON_CENTER_VERT_INDEX_OFFSET 0x60000000
 #define STITCH_NGON_SPLIT_EDGE_CENTER_VERT_TAG (0x60000000 - 1)
+/* Relative difference of edge factors for which cached diced geometry is still used. */
+#define DSPLIT_DICE_CACHE_TOLERANCE 0.25f
 
 DiagSplit::DiagSplit(const SubdParams &params_) : params(params_)
 {
@@ -601,11 +604,111 @@ void DiagSplit::split_ngon(const Mesh::SubdFace &face, Patch *patches, size_t pa
   }
 }
 
+bool DiagSplit::dice_cache_valid(const SubdDiceCache &cache) const
+{
+  if (cache.empty() || cache.edge_factors.size() != edges.size()) {
+    return false;
+  }
+
+  size_t i = 0;
+  foreach (const Edge &edge, edges) {
+    const int cached_T = cache.edge_factors[i++];
+
+    if (abs(edge.T - cached_T) > (int)(cached_T * DSPLIT_DICE_CACHE_TOLERANCE)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void DiagSplit::dice_from_cache(const SubdDiceCache &cache)
+{
+  Mesh *mesh = params.mesh;
+  EdgeDice dice(params);
+
+  dice.reserve(cache.verts.size(), cache.shader.size());
+
+  const size_t num_verts = cache.verts.size();
+  memcpy(dice.mesh_P, cache.verts.data(), sizeof(float3) * num_verts);
+  memcpy(dice.mesh_N, cache.normals.data(), sizeof(float3) * num_verts);
+  memcpy(mesh->vert_patch_uv.data() + dice.vert_offset,
+         cache.patch_uv.data(),
+         sizeof(float2) * num_verts);
+
+  const size_t num_triangles = cache.shader.size();
+  memcpy(mesh->triangles.data() + dice.tri_offset * 3,
+         cache.triangles.data(),
+         sizeof(int) * num_triangles * 3);
+  memcpy(mesh->shader.data() + dice.tri_offset, cache.shader.data(), sizeof(int) * num_triangles);
+  memcpy(mesh->triangle_patch.data() + dice.tri_offset,
+         cache.triangle_patch.data(),
+         sizeof(int) * num_triangles);
+  for (size_t i = 0; i < num_triangles; i++) {
+    mesh->smooth[dice.tri_offset + i] = true;
+  }
+
+  for (size_t i = 0; i < cache.stitching_keys.size(); i++) {
+    const int vert = cache.stitching_keys[i].first;
+    const int key = cache.stitching_keys[i].second;
+
+    mesh->vert_to_stitching_key_map[vert] = key;
+    mesh->vert_stitching_map.insert({key, vert});
+  }
+}
+
+void DiagSplit::dice_to_cache(SubdDiceCache &cache, const EdgeDice &dice)
+{
+  Mesh *mesh = params.mesh;
+
+  cache.edge_factors.clear();
+  cache.edge_factors.reserve(edges.size());
+  foreach (const Edge &edge, edges) {
+    cache.edge_factors.push_back(edge.T);
+  }
+
+  const size_t num_verts = mesh->verts.size() - dice.vert_offset;
+  cache.verts.resize(num_verts);
+  cache.normals.resize(num_verts);
+  cache.patch_uv.resize(num_verts);
+  memcpy(cache.verts.data(), dice.mesh_P, sizeof(float3) * num_verts);
+  memcpy(cache.normals.data(), dice.mesh_N, sizeof(float3) * num_verts);
+  memcpy(cache.patch_uv.data(),
+         mesh->vert_patch_uv.data() + dice.vert_offset,
+         sizeof(float2) * num_verts);
+
+  const size_t num_triangles = mesh->num_triangles() - dice.tri_offset;
+  cache.triangles.resize(num_triangles * 3);
+  cache.shader.resize(num_triangles);
+  cache.triangle_patch.resize(num_triangles);
+  memcpy(cache.triangles.data(),
+         mesh->triangles.data() + dice.tri_offset * 3,
+         sizeof(int) * num_triangles * 3);
+  memcpy(cache.shader.data(), mesh->shader.data() + dice.tri_offset, sizeof(int) * num_triangles);
+  memcpy(cache.triangle_patch.data(),
+         mesh->triangle_patch.data() + dice.tri_offset,
+         sizeof(int) * num_triangles);
+}
+
 void DiagSplit::post_split()
 {
   int num_stitch_verts = 0;
 
   /* All patches are now split, and all T values known. */
+  SubdDiceCache *cache = params.mesh->subd_dice_cache;
+
+  if (cache && dice_cache_valid(*cache)) {
+    dice_from_cache(*cache);
+    used_dice_cache = true;
+
+    subpatches.clear();
+    edges.clear();
+    return;
+  }
+
+  if (cache) {
+    cache->stitching_keys.clear();
+  }
 
   foreach (Edge &edge, edges) {
     if (edge.second_vert_index < 0) {
@@ -710,6 +813,10 @@ void DiagSplit::post_split()
             params.mesh->vert_to_stitching_key_map.end()) {
           params.mesh->vert_to_stitching_key_map[vert] = key;
           params.mesh->vert_stitching_map.insert({key, vert});
+
+          if (cache) {
+            cache->stitching_keys.push_back({vert, key});
+          }
         }
       }
     }
@@ -720,14 +827,7 @@ void DiagSplit::post_split()
 
   int num_verts = num_alloced_verts;
   int num_triangles = 0;
-
-  for (size_t i = 0; i < subpatches.size(); i++) {
-    subpatches[i].inner_grid_vert_offset = num_verts;
-    num_verts += subpatches[i].calc_num_inner_verts();
-    num_triangles += subpatches[i].calc_num_triangles();
-  }
-
-  dice.reserve(num_verts, num_triangles);
+  vector<int> triangle_offsets(subpatches.size());
 
   for (size_t i = 0; i < subpatches.size(); i++) {
     Subpatch &sub = subpatches[i];
@@ -737,7 +837,36 @@ void DiagSplit::post_split()
     sub.edge_v0.T = max(sub.edge_v0.T, 1);
     sub.edge_v1.T = max(sub.edge_v1.T, 1);
 
-    dice.dice(sub);
+    sub.inner_grid_vert_offset = num_verts;
+    triangle_offsets[i] = num_triangles;
+    num_verts += sub.calc_num_inner_verts();
+    num_triangles += sub.calc_num_triangles();
+  }
+
+  dice.reserve(num_verts, num_triangles);
+
+  /* Verts on the sides of subpatches are shared, set them in order so that the result does not
+   * depend on scheduling. */
+  for (size_t i = 0; i < subpatches.size(); i++) {
+    dice.set_sides(subpatches[i]);
+  }
+
+  /* Inner grids and the triangles of each subpatch are written to their own ranges, and diced
+   * in parallel. */
+  const size_t tri_offset = dice.tri_offset;
+
+  parallel_for(blocked_range<size_t>(0, subpatches.size(), 32),
+               [&](const blocked_range<size_t> &range) {
+                 QuadDice task_dice(dice);
+
+                 for (size_t i = range.begin(); i != range.end(); i++) {
+                   task_dice.tri_offset = tri_offset + triangle_offsets[i];
+                   task_dice.dice_inner(subpatches[i]);
+                 }
+               });
+
+  if (cache) {
+    dice_to_cache(*cache, dice);
   }
 
   /* Cleanup */
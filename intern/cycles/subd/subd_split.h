@@ -57,6 +57,11 @@ class DiagSplit {
   int num_alloced_verts = 0;
   int alloc_verts(int n); /* Returns start index of new verts. */
 
+  bool used_dice_cache = false;
+  bool dice_cache_valid(const SubdDiceCache &cache) const;
+  void dice_from_cache(const SubdDiceCache &cache);
+  void dice_to_cache(SubdDiceCache &cache, const EdgeDice &dice);
+
  public:
   Edge *alloc_edge();
 
@@ -68,6 +73,12 @@ class DiagSplit {
   void split_ngon(const Mesh::SubdFace &face, Patch *patches, size_t patches_byte_stride);
 
   void post_split();
+
+  /* Diced geometry was reused from the cache of the mesh. */
+  bool get_used_dice_cache() const
+  {
+    return used_dice_cache;
+  }
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "bvh/bvh2_compressed.h"
+
+#include "util/util_hash.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+bool bbox_contains(const BoundBox &outer, const BoundBox &inner)
+{
+  return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+         outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+float3 random_float3(uint seed, float scale, float offset)
+{
+  return make_float3(hash_uint2_to_float(seed, 0) * scale + offset,
+                     hash_uint2_to_float(seed, 1) * scale + offset,
+                     hash_uint2_to_float(seed, 2) * scale + offset);
+}
+
+BoundBox random_bounds(uint seed, float scale, float offset)
+{
+  BoundBox bounds(random_float3(seed, scale, offset));
+  bounds.grow(random_float3(seed + 1, scale * 0.1f, offset));
+  return bounds;
+}
+
+void check_quantized_bounds(const BoundBox &b0, const BoundBox &b1)
+{
+  const BVHQuantizedBounds qbounds = BVHQuantizedBounds::quantize(b0, b1);
+  const BoundBox child_bounds[2] = {b0, b1};
+
+  for (int child = 0; child < 2; child++) {
+    const BoundBox dequantized = qbounds.dequantize(child);
+    EXPECT_TRUE(bbox_contains(dequantized, child_bounds[child]));
+
+    /* Quantized bounds are at most one step bigger on each side. */
+    for (int axis = 0; axis < 3; axis++) {
+      const float step = qbounds.step(axis);
+      EXPECT_LE(child_bounds[child].min[axis] - dequantized.min[axis], step);
+      EXPECT_LE(dequantized.max[axis] - child_bounds[child].max[axis], step);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(bvh_compressed, quantize_random)
+{
+  for (uint i = 0; i < 1000; i++) {
+    const float scale = (i % 3 == 0) ? 1e-3f : ((i % 3 == 1) ? 1.0f : 1e5f);
+    const float offset = (i % 2) ? 0.0f : -1e4f;
+    check_quantized_bounds(random_bounds(i * 4, scale, offset),
+                           random_bounds(i * 4 + 2, scale, offset));
+  }
+}
+
+TEST(bvh_compressed, quantize_degenerate)
+{
+  /* Flat bounds, as for axis aligned quads. */
+  const BoundBox flat(make_float3(-1.0f, 2.0f, 3.0f), make_float3(1.0f, 2.0f, 5.0f));
+  check_quantized_bounds(flat, flat);
+
+  /* Single point, as for the root of an empty mesh. */
+  const BoundBox point(make_float3(1.0f, 1.0f, 1.0f));
+  check_quantized_bounds(point, point);
+
+  /* Child far away from the origin relative to its size. */
+  const BoundBox small(make_float3(1e6f, 1e6f, 1e6f), make_float3(1e6f + 0.5f));
+  const BoundBox big(make_float3(-1e6f), make_float3(1e6f));
+  check_quantized_bounds(small, big);
+}
+
+TEST(bvh_compressed, quantize_empty_child)
+{
+  const BoundBox bounds(make_float3(0.0f), make_float3(1.0f));
+  const BVHQuantizedBounds qbounds = BVHQuantizedBounds::quantize(bounds, BoundBox::empty);
+
+  EXPECT_TRUE(bbox_contains(qbounds.dequantize(0), bounds));
+  EXPECT_TRUE(qbounds.dequantize(1).valid());
+}
+
+CCL_NAMESPACE_END
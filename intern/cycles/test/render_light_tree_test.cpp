@@ -0,0 +1,150 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/light_tree.h"
+
+#include "util/util_math.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int max_leaf_size = LightTree::max_leaf_size;
+
+vector<LightTreePrimitive> make_primitives(int num)
+{
+  vector<LightTreePrimitive> primitives;
+  for (int i = 0; i < num; i++) {
+    /* Grid of lights with varying energy and orientation. */
+    const float3 co = make_float3((float)(i % 7), (float)((i / 7) % 5), (float)(i / 35));
+    LightTreePrimitive prim;
+    prim.bbox = BoundBox(co - make_float3(0.1f), co + make_float3(0.1f));
+    if (i % 3 == 0) {
+      prim.cone = LightTreeCone::omnidirectional();
+    }
+    else {
+      prim.cone.axis = normalize(make_float3((i % 2) ? 1.0f : -1.0f, 0.5f, (float)(i % 4)));
+      prim.cone.theta_o = 0.0f;
+      prim.cone.theta_e = M_PI_2_F;
+    }
+    prim.energy = 1.0f + (i % 5);
+    prim.inv_area = 0.0f;
+    prim.distribution_index = i;
+    primitives.push_back(prim);
+  }
+  return primitives;
+}
+
+bool bbox_contains(const BoundBox &outer, const BoundBox &inner)
+{
+  return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+         outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+}  // namespace
+
+TEST(render_light_tree, Empty)
+{
+  LightTree tree(vector<LightTreePrimitive>{});
+  EXPECT_TRUE(tree.get_nodes().empty());
+  EXPECT_TRUE(tree.get_emitters().empty());
+}
+
+TEST(render_light_tree, Structure)
+{
+  const int num = 200;
+  LightTree tree(make_primitives(num));
+  const vector<LightTreeNode> &nodes = tree.get_nodes();
+  const vector<LightTreePrimitive> &emitters = tree.get_emitters();
+
+  ASSERT_EQ(emitters.size(), (size_t)num);
+  ASSERT_FALSE(nodes.empty());
+  EXPECT_EQ(nodes[0].parent, -1);
+
+  /* Every emitter is referenced by exactly one leaf. */
+  vector<int> leaf_count(num, 0);
+  vector<bool> seen_index(num, false);
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const LightTreeNode &node = nodes[i];
+    float energy = 0.0f;
+
+    if (node.is_leaf()) {
+      EXPECT_LE(node.num_emitters, max_leaf_size);
+      for (int e = node.child; e < node.child + node.num_emitters; e++) {
+        leaf_count[e]++;
+        energy += emitters[e].energy;
+        EXPECT_TRUE(bbox_contains(node.bbox, emitters[e].bbox));
+      }
+    }
+    else {
+      /* First child directly follows its parent. */
+      const LightTreeNode &left = nodes[i + 1];
+      const LightTreeNode &right = nodes[node.child];
+      EXPECT_EQ(left.parent, (int)i);
+      EXPECT_EQ(right.parent, (int)i);
+      energy = left.energy + right.energy;
+    }
+
+    EXPECT_NEAR(node.energy, energy, 1e-3f);
+  }
+
+  for (int e = 0; e < num; e++) {
+    EXPECT_EQ(leaf_count[e], 1);
+    EXPECT_FALSE(seen_index[emitters[e].distribution_index]);
+    seen_index[emitters[e].distribution_index] = true;
+  }
+}
+
+TEST(render_light_tree, CoincidentEmitters)
+{
+  /* Emitters at the same position can not be split spatially, but leaves are still bounded. */
+  vector<LightTreePrimitive> primitives = make_primitives(1);
+  primitives.resize(50, primitives[0]);
+
+  LightTree tree(primitives);
+  int num_emitters = 0;
+  for (const LightTreeNode &node : tree.get_nodes()) {
+    if (node.is_leaf()) {
+      EXPECT_LE(node.num_emitters, max_leaf_size);
+      num_emitters += node.num_emitters;
+    }
+  }
+  EXPECT_EQ(num_emitters, 50);
+}
+
+TEST(render_light_tree, ConeMerge)
+{
+  LightTreeCone a;
+  a.axis = make_float3(0.0f, 0.0f, 1.0f);
+  a.theta_o = 0.0f;
+  a.theta_e = M_PI_2_F;
+
+  LightTreeCone b = a;
+  b.axis = make_float3(1.0f, 0.0f, 0.0f);
+
+  const LightTreeCone merged = a.merge(b);
+  EXPECT_NEAR(merged.theta_o, M_PI_4_F, 1e-5f);
+  EXPECT_NEAR(dot(merged.axis, normalize(make_float3(1.0f, 0.0f, 1.0f))), 1.0f, 1e-5f);
+
+  /* Merging with an empty cone or a contained cone keeps the cone. */
+  EXPECT_NEAR(a.merge(LightTreeCone::empty()).theta_o, 0.0f, 1e-6f);
+  EXPECT_NEAR(LightTreeCone::omnidirectional().merge(a).theta_o, M_PI_F, 1e-6f);
+}
+
+CCL_NAMESPACE_END
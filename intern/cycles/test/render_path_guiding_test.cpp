@@ -0,0 +1,104 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/path_guiding.h"
+
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int cell_stride = PATH_GUIDING_BINS + 1;
+
+/* Record radiance in one bin of a cell, as done by the kernel. */
+void record(KernelPathGuiding *kguiding, int cell, int bin, float weight, int num_vertices)
+{
+  float *cell_training = kguiding->training + cell * cell_stride;
+  cell_training[bin] += weight;
+  cell_training[PATH_GUIDING_BINS] += (float)num_vertices;
+}
+
+float bin_probability(const KernelPathGuiding *kguiding, int cell, int bin)
+{
+  const float *cdf = kguiding->cdf + cell * cell_stride;
+  return cdf[bin + 1] - cdf[bin];
+}
+
+}  // namespace
+
+TEST(render_path_guiding, grid_resolution)
+{
+  PathGuiding guiding;
+  guiding.reset(BoundBox(make_float3(0.0f, 0.0f, 0.0f), make_float3(4.0f, 2.0f, 0.0f)), 8);
+
+  const KernelPathGuiding *kguiding = guiding.get_kernel_data();
+  EXPECT_EQ(kguiding->resolution[0], 16);
+  EXPECT_EQ(kguiding->resolution[1], 8);
+  EXPECT_EQ(kguiding->resolution[2], 1);
+  EXPECT_TRUE(guiding.is_learning());
+  EXPECT_EQ(kguiding->mix_probability, 0.0f);
+}
+
+TEST(render_path_guiding, build_distribution)
+{
+  PathGuiding guiding;
+  guiding.reset(BoundBox(make_float3(0.0f, 0.0f, 0.0f), make_float3(1.0f, 1.0f, 1.0f)), 4);
+  KernelPathGuiding *kguiding = guiding.get_kernel_data();
+
+  /* Cell with enough data, and one with too few recorded vertices. */
+  record(kguiding, 0, 5, 3.0f, 100);
+  record(kguiding, 0, 70, 1.0f, 0);
+  record(kguiding, 1, 5, 1.0f, 1);
+
+  EXPECT_TRUE(guiding.add_samples(1));
+  EXPECT_GT(kguiding->mix_probability, 0.0f);
+
+  const float *cdf = kguiding->cdf;
+  EXPECT_EQ(cdf[0], 0.0f);
+  EXPECT_EQ(cdf[PATH_GUIDING_BINS], 1.0f);
+  for (int bin = 0; bin < PATH_GUIDING_BINS; bin++) {
+    EXPECT_LE(cdf[bin], cdf[bin + 1]);
+    EXPECT_GT(bin_probability(kguiding, 0, bin), 0.0f);
+  }
+  EXPECT_NEAR(bin_probability(kguiding, 0, 5), 3.0f * bin_probability(kguiding, 0, 70), 1e-2f);
+  EXPECT_GT(bin_probability(kguiding, 0, 5), bin_probability(kguiding, 0, 6) * 10.0f);
+
+  EXPECT_EQ(cdf[cell_stride + PATH_GUIDING_BINS], 0.0f);
+}
+
+TEST(render_path_guiding, learning_schedule)
+{
+  PathGuiding guiding;
+  guiding.reset(BoundBox(make_float3(0.0f, 0.0f, 0.0f), make_float3(1.0f, 1.0f, 1.0f)), 6);
+
+  /* Rebuilt after 1, 2 and 4 samples, then when the training samples are done. */
+  EXPECT_TRUE(guiding.add_samples(1));
+  EXPECT_TRUE(guiding.add_samples(1));
+  EXPECT_FALSE(guiding.add_samples(1));
+  EXPECT_TRUE(guiding.add_samples(1));
+  EXPECT_FALSE(guiding.add_samples(1));
+  EXPECT_TRUE(guiding.is_learning());
+  EXPECT_TRUE(guiding.add_samples(1));
+
+  EXPECT_FALSE(guiding.is_learning());
+  EXPECT_EQ(guiding.get_kernel_data()->training, (float *)NULL);
+  EXPECT_FALSE(guiding.add_samples(1));
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/util_texture_cache.h"
+
+#include "util/util_logging.h"
+#include "util/util_math.h"
+
+#include <OpenImageIO/texture.h>
+
+CCL_NAMESPACE_BEGIN
+
+OIIO_NAMESPACE_USING
+
+struct TextureCache::Image {
+  TextureSystem::TextureHandle *handle;
+  TextureOpt options;
+};
+
+TextureCache::TextureCache(const TextureCacheParams &params)
+{
+  /* Own texture system rather than the shared one used by OSL, so that the memory budget is
+   * not shared with other renders in the same process. */
+  TextureSystem *ts = TextureSystem::create(false);
+  ts->attribute("max_memory_MB", (float)max(params.cache_size, 1));
+  ts->attribute("automip", 1);
+  ts->attribute("autotile", 64);
+  ts->attribute("accept_untiled", 1);
+  ts->attribute("accept_unmipped", 1);
+  ts->attribute("gray_to_rgb", 1);
+  ts->attribute("max_open_files", 512);
+  texture_system = ts;
+}
+
+TextureCache::~TextureCache()
+{
+  for (size_t slot = 0; slot < images.size(); slot++) {
+    delete images[slot];
+  }
+
+  TextureSystem *ts = (TextureSystem *)texture_system;
+  VLOG(2) << "Texture cache statistics:\n" << ts->getstats();
+  TextureSystem::destroy(ts);
+}
+
+bool TextureCache::add_image(int slot,
+                             const string &filepath,
+                             InterpolationType interpolation,
+                             ExtensionType extension)
+{
+  TextureSystem *ts = (TextureSystem *)texture_system;
+  TextureSystem::TextureHandle *handle = ts->get_texture_handle(ustring(filepath));
+
+  if (handle == NULL || !ts->good(handle)) {
+    /* Clear error so it does not leak into later lookups. */
+    ts->geterror();
+    return false;
+  }
+
+  Image *img = new Image();
+  img->handle = handle;
+
+  switch (interpolation) {
+    case INTERPOLATION_CLOSEST:
+      img->options.interpmode = TextureOpt::InterpClosest;
+      img->options.mipmode = TextureOpt::MipModeOneLevel;
+      break;
+    case INTERPOLATION_CUBIC:
+      img->options.interpmode = TextureOpt::InterpBicubic;
+      break;
+    case INTERPOLATION_SMART:
+      img->options.interpmode = TextureOpt::InterpSmartBicubic;
+      break;
+    case INTERPOLATION_LINEAR:
+    default:
+      img->options.interpmode = TextureOpt::InterpBilinear;
+      break;
+  }
+
+  switch (extension) {
+    case EXTENSION_REPEAT:
+      img->options.swrap = img->options.twrap = TextureOpt::WrapPeriodic;
+      break;
+    case EXTENSION_CLIP:
+      img->options.swrap = img->options.twrap = TextureOpt::WrapBlack;
+      break;
+    case EXTENSION_EXTEND:
+    default:
+      img->options.swrap = img->options.twrap = TextureOpt::WrapClamp;
+      break;
+  }
+
+  /* Opaque alpha for images without alpha channel. */
+  img->options.fill = 1.0f;
+
+  if ((size_t)slot >= images.size()) {
+    images.resize(slot + 1, NULL);
+  }
+
+  delete images[slot];
+  images[slot] = img;
+
+  return true;
+}
+
+void TextureCache::remove_image(int slot)
+{
+  if (has_image(slot)) {
+    delete images[slot];
+    images[slot] = NULL;
+  }
+}
+
+float4 TextureCache::lookup(int slot, float x, float y, float2 dx, float2 dy) const
+{
+  TextureSystem *ts = (TextureSystem *)texture_system;
+  const Image *img = images[slot];
+
+  /* Options are modified by lookups, so use a copy. */
+  TextureOpt options = img->options;
+  float result[4];
+
+  /* Image rows are stored bottom to top in Cycles, top to bottom in OpenImageIO. */
+  const bool ok = ts->texture(img->handle,
+                              ts->get_perthread_info(),
+                              options,
+                              x,
+                              1.0f - y,
+                              dx.x,
+                              -dx.y,
+                              dy.x,
+                              -dy.y,
+                              4,
+                              result);
+
+  if (!ok) {
+    ts->geterror();
+    return make_float4(
+        TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
+  }
+
+  return make_float4(result[0], result[1], result[2], result[3]);
+}
+
+void TextureCache::invalidate(const string &filepath)
+{
+  TextureSystem *ts = (TextureSystem *)texture_system;
+  ts->invalidate(ustring(filepath));
+}
+
+void TextureCache::collect_statistics(TextureCacheStats *stats) const
+{
+  TextureSystem *ts = (TextureSystem *)texture_system;
+
+  int num_images = 0;
+  for (size_t slot = 0; slot < images.size(); slot++) {
+    if (images[slot]) {
+      num_images++;
+    }
+  }
+
+  long long memory_used = 0, bytes_read = 0, tile_lookups = 0;
+  int tiles_created = 0, tile_misses = 0;
+  float file_io_time = 0.0f;
+
+  ts->getattribute("stat:cache_memory_used", TypeDesc::INT64, &memory_used);
+  ts->getattribute("stat:bytes_read", TypeDesc::INT64, &bytes_read);
+  ts->getattribute("stat:find_tile_calls", TypeDesc::INT64, &tile_lookups);
+  ts->getattribute("stat:tiles_created", TypeDesc::INT, &tiles_created);
+  ts->getattribute("stat:find_tile_cache_misses", TypeDesc::INT, &tile_misses);
+  ts->getattribute("stat:fileio_time", TypeDesc::FLOAT, &file_io_time);
+
+  stats->num_images = num_images;
+  stats->memory_used = memory_used;
+  stats->bytes_read = bytes_read;
+  stats->tiles_created = tiles_created;
+  stats->tile_lookups = tile_lookups;
+  stats->tile_misses = tile_misses;
+  stats->file_io_time = file_io_time;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_TEXTURE_CACHE_H__
+#define __UTIL_TEXTURE_CACHE_H__
+
+#include "util/util_string.h"
+#include "util/util_texture.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Texture Cache Parameters */
+
+class TextureCacheParams {
+ public:
+  bool use_cache;
+  /* Memory budget in megabytes. */
+  int cache_size;
+
+  TextureCacheParams() : use_cache(false), cache_size(1024)
+  {
+  }
+
+  bool modified(const TextureCacheParams &other) const
+  {
+    return !(use_cache == other.use_cache && cache_size == other.cache_size);
+  }
+};
+
+/* Texture Cache Statistics */
+
+class TextureCacheStats {
+ public:
+  int num_images;
+  size_t memory_used;
+  uint64_t bytes_read;
+  uint64_t tiles_created;
+  uint64_t tile_lookups;
+  uint64_t tile_misses;
+  double file_io_time;
+
+  TextureCacheStats()
+      : num_images(0),
+        memory_used(0),
+        bytes_read(0),
+        tiles_created(0),
+        tile_lookups(0),
+        tile_misses(0),
+        file_io_time(0.0)
+  {
+  }
+};
+
+/* Texture Cache
+ *
+ * Image files which are not loaded into device memory, but read on demand per tile and MIP
+ * level through the OpenImageIO texture system, within a fixed memory budget. Files that are
+ * not tiled or mipmapped are tiled and mipmapped in memory on first access, converting them
+ * to .tx files up front is recommended for large textures.
+ *
+ * Lookups happen from the CPU kernel, slots match the image manager slots. */
+
+class TextureCache {
+ public:
+  explicit TextureCache(const TextureCacheParams &params);
+  ~TextureCache();
+
+  /* Register image file for a slot, returns false if the file can not be read by the texture
+   * system, in which case the image has to be loaded into memory as usual. */
+  bool add_image(int slot,
+                 const string &filepath,
+                 InterpolationType interpolation,
+                 ExtensionType extension);
+  void remove_image(int slot);
+
+  bool has_image(int slot) const
+  {
+    return slot >= 0 && (size_t)slot < images.size() && images[slot] != NULL;
+  }
+
+  /* Lookup with texture coordinate derivatives, used to choose the MIP level. Zero derivatives
+   * read from the highest resolution. */
+  float4 lookup(int slot, float x, float y, float2 dx, float2 dy) const;
+
+  /* Drop cached tiles of the file, when it changed on disk. */
+  void invalidate(const string &filepath);
+
+  void collect_statistics(TextureCacheStats *stats) const;
+
+ protected:
+  struct Image;
+
+  /* OIIO::TextureSystem, kept opaque so that the kernel does not include OpenImageIO. */
+  void *texture_system;
+  vector<Image *> images;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_TEXTURE_CACHE_H__ */
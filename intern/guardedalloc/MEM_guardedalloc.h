@@ -226,9 +226,38 @@ void MEM_use_memleak_detection(bool enabled);
  * tests. */
 void MEM_enable_fail_on_memleak(void);
 
+/* Switch allocator back to the default lock-free allocator. Like switching to the other
+ * allocators, this must happen while no memory is allocated, which is mainly useful in tests. */
+void MEM_use_lockfree_allocator(void);
+
 /* Switch allocator to slower but fully guarded mode. */
 void MEM_use_guarded_allocator(void);
 
+/* Switch allocator to use per-thread caches of small blocks, for heavily threaded workloads.
+ * Like the guarded allocator, this must be called before any memory is allocated. */
+void MEM_use_threadcache_allocator(void);
+
+/* Number of allocations and frees since startup, zero unless the thread caching allocator
+ * is used. */
+void MEM_get_allocation_counts(size_t *r_num_alloc, size_t *r_num_free);
+
+/* Heap profiling of the default lock-free allocator. Allocations are sampled about once every
+ * sample_interval bytes, and memory in use is estimated per allocation name, and per call site
+ * when use_call_sites is set. Overhead is low enough to keep it running in production. */
+typedef void (*MEMHeapProfileFn)(void *user_data,
+                                 const char *tag,
+                                 const void *call_site,
+                                 size_t bytes,
+                                 size_t blocks,
+                                 size_t peak_bytes);
+
+void MEM_heap_profile_start(size_t sample_interval, bool use_call_sites);
+void MEM_heap_profile_stop(void);
+bool MEM_heap_profile_is_running(void);
+void MEM_heap_profile_foreach(MEMHeapProfileFn func, void *user_data);
+/* Write in the folded stacks format used by flame graph tools. */
+bool MEM_heap_profile_write_folded(const char *filepath, bool use_peak);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -64,6 +64,8 @@ size_t (*MEM_get_peak_memory)(void) = MEM_lockfree_get_peak_memory;
 const char *(*MEM_name_ptr)(void *vmemh) = MEM_lockfree_name_ptr;
 #endif
 
+static bool use_threadcache_allocator = false;
+
 void *aligned_malloc(size_t size, size_t alignment)
 {
   /* posix_memalign requires alignment to be a multiple of sizeof(void *). */
@@ -95,6 +97,37 @@ void aligned_free(void *ptr)
 #endif
 }
 
+void MEM_use_lockfree_allocator(void)
+{
+  MEM_allocN_len = MEM_lockfree_allocN_len;
+  MEM_freeN = MEM_lockfree_freeN;
+  MEM_dupallocN = MEM_lockfree_dupallocN;
+  MEM_reallocN_id = MEM_lockfree_reallocN_id;
+  MEM_recallocN_id = MEM_lockfree_recallocN_id;
+  MEM_callocN = MEM_lockfree_callocN;
+  MEM_calloc_arrayN = MEM_lockfree_calloc_arrayN;
+  MEM_mallocN = MEM_lockfree_mallocN;
+  MEM_malloc_arrayN = MEM_lockfree_malloc_arrayN;
+  MEM_mallocN_aligned = MEM_lockfree_mallocN_aligned;
+  MEM_printmemlist_pydict = MEM_lockfree_printmemlist_pydict;
+  MEM_printmemlist = MEM_lockfree_printmemlist;
+  MEM_callbackmemlist = MEM_lockfree_callbackmemlist;
+  MEM_printmemlist_stats = MEM_lockfree_printmemlist_stats;
+  MEM_set_error_callback = MEM_lockfree_set_error_callback;
+  MEM_consistency_check = MEM_lockfree_consistency_check;
+  MEM_set_memory_debug = MEM_lockfree_set_memory_debug;
+  MEM_get_memory_in_use = MEM_lockfree_get_memory_in_use;
+  MEM_get_memory_blocks_in_use = MEM_lockfree_get_memory_blocks_in_use;
+  MEM_reset_peak_memory = MEM_lockfree_reset_peak_memory;
+  MEM_get_peak_memory = MEM_lockfree_get_peak_memory;
+
+#ifndef NDEBUG
+  MEM_name_ptr = MEM_lockfree_name_ptr;
+#endif
+
+  use_threadcache_allocator = false;
+}
+
 void MEM_use_guarded_allocator(void)
 {
   MEM_allocN_len = MEM_guarded_allocN_len;
@@ -122,4 +155,49 @@ void MEM_use_guarded_allocator(void)
 #ifndef NDEBUG
   MEM_name_ptr = MEM_guarded_name_ptr;
 #endif
+
+  use_threadcache_allocator = false;
+}
+
+void MEM_use_threadcache_allocator(void)
+{
+  MEM_allocN_len = MEM_threadcache_allocN_len;
+  MEM_freeN = MEM_threadcache_freeN;
+  MEM_dupallocN = MEM_threadcache_dupallocN;
+  MEM_reallocN_id = MEM_threadcache_reallocN_id;
+  MEM_recallocN_id = MEM_threadcache_recallocN_id;
+  MEM_callocN = MEM_threadcache_callocN;
+  MEM_calloc_arrayN = MEM_threadcache_calloc_arrayN;
+  MEM_mallocN = MEM_threadcache_mallocN;
+  MEM_malloc_arrayN = MEM_threadcache_malloc_arrayN;
+  MEM_mallocN_aligned = MEM_threadcache_mallocN_aligned;
+  MEM_printmemlist_pydict = MEM_threadcache_printmemlist_pydict;
+  MEM_printmemlist = MEM_threadcache_printmemlist;
+  MEM_callbackmemlist = MEM_threadcache_callbackmemlist;
+  MEM_printmemlist_stats = MEM_threadcache_printmemlist_stats;
+  MEM_set_error_callback = MEM_threadcache_set_error_callback;
+  MEM_consistency_check = MEM_threadcache_consistency_check;
+  MEM_set_memory_debug = MEM_threadcache_set_memory_debug;
+  MEM_get_memory_in_use = MEM_threadcache_get_memory_in_use;
+  MEM_get_memory_blocks_in_use = MEM_threadcache_get_memory_blocks_in_use;
+  MEM_reset_peak_memory = MEM_threadcache_reset_peak_memory;
+  MEM_get_peak_memory = MEM_threadcache_get_peak_memory;
+
+#ifndef NDEBUG
+  MEM_name_ptr = MEM_threadcache_name_ptr;
+#endif
+
+  use_threadcache_allocator = true;
+}
+
+void MEM_get_allocation_counts(size_t *r_num_alloc, size_t *r_num_free)
+{
+  if (use_threadcache_allocator) {
+    MEM_threadcache_get_allocation_counts(r_num_alloc, r_num_free);
+  }
+  else {
+    /* Only counted by the thread caching allocator. */
+    *r_num_alloc = 0;
+    *r_num_free = 0;
+  }
 }
@@ -0,0 +1,322 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup MEM
+ *
+ * Sampling heap profiler for the lock-free allocator.
+ *
+ * Every thread counts down the bytes it allocates, and the allocation that reaches zero is
+ * sampled. The sampled block is accounted with the sample interval as its weight, so the sum of
+ * weights estimates memory in use per tag without touching shared memory for other blocks. Blocks
+ * larger than the sample interval are always sampled, with their own size as weight, and are not
+ * part of the countdown.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "atomic_ops.h"
+#include "mallocn_intern.h"
+
+/* Maximum number of distinct tags and call sites, further ones are accounted together. */
+#define HEAP_PROFILE_TABLE_SIZE 8192
+
+#define HEAP_PROFILE_DEFAULT_INTERVAL (512 * 1024)
+
+struct MemHeapProfileEntry {
+  const char *tag;
+  const void *call_site;
+
+  /* Estimated memory and blocks in use, and estimated peak of memory in use. */
+  size_t bytes;
+  size_t blocks;
+  size_t peak_bytes;
+};
+
+bool mem_heap_profile_running = false;
+
+static size_t sample_interval = HEAP_PROFILE_DEFAULT_INTERVAL;
+static bool use_call_sites = false;
+
+static pthread_mutex_t table_mutex = PTHREAD_MUTEX_INITIALIZER;
+static MemHeapProfileEntry table[HEAP_PROFILE_TABLE_SIZE];
+static unsigned int table_used = 0;
+static MemHeapProfileEntry overflow_entry = {"(other)", NULL, 0, 0, 0};
+
+static MEM_THREAD_LOCAL int64_t bytes_until_sample = 0;
+static MEM_THREAD_LOCAL bool bytes_until_sample_init = false;
+static MEM_THREAD_LOCAL uint32_t sample_rng = 0;
+
+/* Next interval is randomized, to avoid always sampling the same allocation in a loop. */
+static int64_t next_sample_interval(void)
+{
+  if (sample_rng == 0) {
+    sample_rng = (uint32_t)(uintptr_t)&sample_rng | 1u;
+  }
+
+  /* Xorshift. */
+  sample_rng ^= sample_rng << 13;
+  sample_rng ^= sample_rng >> 17;
+  sample_rng ^= sample_rng << 5;
+
+  /* Uniform in [interval / 2, interval * 3 / 2). */
+  const uint64_t interval = (uint64_t)sample_interval;
+  return (int64_t)(interval / 2 + ((uint64_t)sample_rng * interval >> 32));
+}
+
+bool mem_heap_profile_sample(size_t len)
+{
+  if (len > sample_interval) {
+    return true;
+  }
+
+  bytes_until_sample -= (int64_t)len;
+  if (LIKELY(bytes_until_sample > 0)) {
+    return false;
+  }
+
+  /* Start counting down on the first allocation of the thread, instead of sampling it. */
+  if (UNLIKELY(!bytes_until_sample_init)) {
+    bytes_until_sample_init = true;
+    bytes_until_sample = next_sample_interval() - (int64_t)len;
+    if (bytes_until_sample > 0) {
+      return false;
+    }
+  }
+
+  bytes_until_sample = next_sample_interval();
+  return true;
+}
+
+MEM_INLINE unsigned int entry_hash(const char *tag, const void *call_site)
+{
+  uint64_t hash = (uint64_t)(uintptr_t)tag ^ ((uint64_t)(uintptr_t)call_site * 31);
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return (unsigned int)(hash % HEAP_PROFILE_TABLE_SIZE);
+}
+
+/* Find or add the entry for a tag, with open addressing. Entries are never removed, so blocks
+ * can keep pointers to them. */
+static MemHeapProfileEntry *entry_ensure(const char *tag, const void *call_site)
+{
+  MemHeapProfileEntry *entry = &overflow_entry;
+
+  pthread_mutex_lock(&table_mutex);
+
+  for (unsigned int i = entry_hash(tag, call_site), probe = 0; probe < HEAP_PROFILE_TABLE_SIZE;
+       i = (i + 1) % HEAP_PROFILE_TABLE_SIZE, probe++) {
+    if (table[i].tag == NULL) {
+      /* Keep free slots for probing, the table gets slow when nearly full. */
+      if (table_used < HEAP_PROFILE_TABLE_SIZE * 3 / 4) {
+        table[i].tag = tag;
+        table[i].call_site = call_site;
+        table_used++;
+        entry = &table[i];
+      }
+      break;
+    }
+    if (table[i].tag == tag && table[i].call_site == call_site) {
+      entry = &table[i];
+      break;
+    }
+  }
+
+  pthread_mutex_unlock(&table_mutex);
+
+  return entry;
+}
+
+MemHeapProfileEntry *mem_heap_profile_add(const char *tag,
+                                          const void *call_site,
+                                          size_t len,
+                                          size_t *r_weight)
+{
+  MemHeapProfileEntry *entry = entry_ensure(tag, use_call_sites ? call_site : NULL);
+
+  const size_t weight = (len > sample_interval) ? len : sample_interval;
+  const size_t blocks = (len > 0 && weight > len) ? weight / len : 1;
+
+  const size_t bytes = atomic_add_and_fetch_z(&entry->bytes, weight);
+  atomic_add_and_fetch_z(&entry->blocks, blocks);
+  atomic_fetch_and_update_max_z(&entry->peak_bytes, bytes);
+
+  *r_weight = weight;
+  return entry;
+}
+
+void mem_heap_profile_remove(MemHeapProfileEntry *entry, size_t len, size_t weight)
+{
+  const size_t blocks = (len > 0 && weight > len) ? weight / len : 1;
+
+  atomic_sub_and_fetch_z(&entry->bytes, weight);
+  atomic_sub_and_fetch_z(&entry->blocks, blocks);
+}
+
+void MEM_heap_profile_start(size_t interval, bool call_sites)
+{
+  sample_interval = (interval > 0) ? interval : HEAP_PROFILE_DEFAULT_INTERVAL;
+  use_call_sites = call_sites;
+  mem_heap_profile_running = true;
+}
+
+void MEM_heap_profile_stop(void)
+{
+  /* Blocks that were sampled are still removed from the statistics when freed. */
+  mem_heap_profile_running = false;
+}
+
+bool MEM_heap_profile_is_running(void)
+{
+  return mem_heap_profile_running;
+}
+
+void MEM_heap_profile_foreach(MEMHeapProfileFn func, void *user_data)
+{
+  pthread_mutex_lock(&table_mutex);
+
+  for (unsigned int i = 0; i < HEAP_PROFILE_TABLE_SIZE; i++) {
+    const MemHeapProfileEntry *entry = &table[i];
+    if (entry->tag) {
+      func(user_data,
+           entry->tag,
+           entry->call_site,
+           entry->bytes,
+           entry->blocks,
+           entry->peak_bytes);
+    }
+  }
+
+  if (overflow_entry.peak_bytes) {
+    func(user_data,
+         overflow_entry.tag,
+         NULL,
+         overflow_entry.bytes,
+         overflow_entry.blocks,
+         overflow_entry.peak_bytes);
+  }
+
+  pthread_mutex_unlock(&table_mutex);
+}
+
+static int entry_bytes_cmp(const void *a, const void *b)
+{
+  const MemHeapProfileEntry *entry_a = *(const MemHeapProfileEntry **)a;
+  const MemHeapProfileEntry *entry_b = *(const MemHeapProfileEntry **)b;
+  return (entry_a->bytes < entry_b->bytes) - (entry_a->bytes > entry_b->bytes);
+}
+
+void mem_heap_profile_print(void)
+{
+  MemHeapProfileEntry **entries = (MemHeapProfileEntry **)malloc(
+      sizeof(*entries) * (HEAP_PROFILE_TABLE_SIZE + 1));
+  unsigned int entries_num = 0;
+
+  if (entries == NULL) {
+    printf("\nheap profile: not enough memory to print\n");
+    return;
+  }
+
+  pthread_mutex_lock(&table_mutex);
+
+  for (unsigned int i = 0; i < HEAP_PROFILE_TABLE_SIZE; i++) {
+    if (table[i].tag && table[i].bytes) {
+      entries[entries_num++] = &table[i];
+    }
+  }
+  if (overflow_entry.bytes) {
+    entries[entries_num++] = &overflow_entry;
+  }
+
+  if (entries_num) {
+    qsort(entries, entries_num, sizeof(*entries), entry_bytes_cmp);
+
+    printf("\nheap profile (estimated, sample interval " SIZET_FORMAT " bytes):\n",
+           SIZET_ARG(sample_interval));
+    printf("%12s %12s %12s  %s\n", "len (KB)", "peak (KB)", "blocks", "name");
+    for (unsigned int i = 0; i < entries_num; i++) {
+      const MemHeapProfileEntry *entry = entries[i];
+      printf("%12.3f %12.3f %12u  %s",
+             (double)entry->bytes / 1024.0,
+             (double)entry->peak_bytes / 1024.0,
+             (unsigned int)entry->blocks,
+             entry->tag);
+      if (entry->call_site) {
+        printf(" (%p)", entry->call_site);
+      }
+      printf("\n");
+    }
+  }
+
+  pthread_mutex_unlock(&table_mutex);
+
+  free(entries);
+}
+
+typedef struct FoldedWriteData {
+  FILE *file;
+  bool use_peak;
+} FoldedWriteData;
+
+static void heap_profile_write_folded_entry(void *user_data,
+                                            const char *tag,
+                                            const void *call_site,
+                                            size_t bytes,
+                                            size_t UNUSED(blocks),
+                                            size_t peak_bytes)
+{
+  FoldedWriteData *data = (FoldedWriteData *)user_data;
+  const size_t value = data->use_peak ? peak_bytes : bytes;
+
+  if (value == 0) {
+    return;
+  }
+
+  /* Separators of the folded format can't be part of frame names. */
+  for (const char *c = tag; *c; c++) {
+    fputc((*c == ';' || *c == ' ' || *c == '\n') ? '_' : *c, data->file);
+  }
+  if (call_site) {
+    fprintf(data->file, ";%p", call_site);
+  }
+  fprintf(data->file, " " SIZET_FORMAT "\n", SIZET_ARG(value));
+}
+
+bool MEM_heap_profile_write_folded(const char *filepath, bool use_peak)
+{
+  FoldedWriteData data;
+  data.file = fopen(filepath, "w");
+  data.use_peak = use_peak;
+
+  if (data.file == NULL) {
+    return false;
+  }
+
+  MEM_heap_profile_foreach(heap_profile_write_folded_entry, &data);
+
+  return fclose(data.file) == 0;
+}
@@ -89,6 +89,15 @@ size_t malloc_usable_size(void *ptr);
 #  define MEM_INLINE static inline
 #endif
 
+#ifdef _MSC_VER
+#  include <intrin.h>
+#  define MEM_THREAD_LOCAL __declspec(thread)
+#  define MEM_RETURN_ADDRESS() _ReturnAddress()
+#else
+#  define MEM_THREAD_LOCAL __thread
+#  define MEM_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
 #define IS_POW2(a) (((a) & ((a)-1)) == 0)
 
 /* Extra padding which needs to be applied on MemHead to make it aligned. */
@@ -98,6 +107,15 @@ size_t malloc_usable_size(void *ptr);
 /* Real pointer returned by the malloc or aligned_alloc. */
 #define MEMHEAD_REAL_PTR(memh) ((char *)memh - MEMHEAD_ALIGN_PADDING(memh->alignment))
 
+/* Flags stored in MemHead.len by the lock-free and thread cache allocators. Both use the same
+ * header layout, so every flag gets its own bit. Lengths are aligned to 4 bytes, which leaves
+ * the two lowest bits, the highest bit is never part of a valid length. */
+#define MEMHEAD_ALIGN_FLAG ((size_t)1)
+/* Lock-free allocator: block has a #MemHeadSampled before its MemHead. */
+#define MEMHEAD_SAMPLED_FLAG ((size_t)2)
+/* Thread cache allocator: block is allocated from a size class, and owned by the caches. */
+#define MEMHEAD_SMALL_FLAG ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
 #include "mallocn_inline.h"
 
 #ifdef __cplusplus
@@ -112,6 +130,19 @@ void aligned_free(void *ptr);
 extern bool leak_detector_has_run;
 extern char free_after_leak_detection_message[];
 
+/* Heap profiling, used by the lock-free allocator. */
+typedef struct MemHeapProfileEntry MemHeapProfileEntry;
+
+extern bool mem_heap_profile_running;
+
+bool mem_heap_profile_sample(size_t len);
+MemHeapProfileEntry *mem_heap_profile_add(const char *tag,
+                                          const void *call_site,
+                                          size_t len,
+                                          size_t *r_weight);
+void mem_heap_profile_remove(MemHeapProfileEntry *entry, size_t len, size_t weight);
+void mem_heap_profile_print(void);
+
 /* Prototypes for counted allocator functions */
 size_t MEM_lockfree_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
 void MEM_lockfree_freeN(void *vmemh);
@@ -155,6 +186,52 @@ size_t MEM_lockfree_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
 const char *MEM_lockfree_name_ptr(void *vmemh);
 #endif
 
+/* Prototypes for thread caching allocator functions */
+size_t MEM_threadcache_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
+void MEM_threadcache_freeN(void *vmemh);
+void *MEM_threadcache_dupallocN(const void *vmemh) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void *MEM_threadcache_reallocN_id(void *vmemh,
+                                  size_t len,
+                                  const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(2);
+void *MEM_threadcache_recallocN_id(void *vmemh,
+                                   size_t len,
+                                   const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(2);
+void *MEM_threadcache_callocN(size_t len,
+                              const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *MEM_threadcache_calloc_arrayN(size_t len,
+                                    size_t size,
+                                    const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1, 2) ATTR_NONNULL(3);
+void *MEM_threadcache_mallocN(size_t len,
+                              const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *MEM_threadcache_malloc_arrayN(size_t len,
+                                    size_t size,
+                                    const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1, 2) ATTR_NONNULL(3);
+void *MEM_threadcache_mallocN_aligned(size_t len,
+                                      size_t alignment,
+                                      const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1) ATTR_NONNULL(3);
+void MEM_threadcache_printmemlist_pydict(void);
+void MEM_threadcache_printmemlist(void);
+void MEM_threadcache_callbackmemlist(void (*func)(void *));
+void MEM_threadcache_printmemlist_stats(void);
+void MEM_threadcache_set_error_callback(void (*func)(const char *));
+bool MEM_threadcache_consistency_check(void);
+void MEM_threadcache_set_memory_debug(void);
+size_t MEM_threadcache_get_memory_in_use(void);
+unsigned int MEM_threadcache_get_memory_blocks_in_use(void);
+void MEM_threadcache_reset_peak_memory(void);
+size_t MEM_threadcache_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
+void MEM_threadcache_get_allocation_counts(size_t *r_num_alloc, size_t *r_num_free);
+#ifndef NDEBUG
+const char *MEM_threadcache_name_ptr(void *vmemh);
+#endif
+
 /* Prototypes for fully guarded allocator functions */
 size_t MEM_guarded_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
 void MEM_guarded_freeN(void *vmemh);
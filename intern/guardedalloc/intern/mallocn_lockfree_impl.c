@@ -43,20 +43,26 @@ typedef struct MemHeadAligned {
   size_t len;
 } MemHeadAligned;
 
+/* Stored before the MemHead of blocks sampled by the heap profiler. */
+typedef struct MemHeadSampled {
+  MemHeapProfileEntry *entry;
+  size_t weight;
+} MemHeadSampled;
+
 static unsigned int totblock = 0;
 static size_t mem_in_use = 0, peak_mem = 0;
 static bool malloc_debug_memset = false;
 
 static void (*error_callback)(const char *) = NULL;
 
-enum {
-  MEMHEAD_ALIGN_FLAG = 1,
-};
+#define MEMHEAD_FLAGS (MEMHEAD_ALIGN_FLAG | MEMHEAD_SAMPLED_FLAG)
 
 #define MEMHEAD_FROM_PTR(ptr) (((MemHead *)ptr) - 1)
 #define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
 #define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned *)ptr) - 1)
 #define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & (size_t)MEMHEAD_ALIGN_FLAG)
+#define MEMHEAD_IS_SAMPLED(memhead) ((memhead)->len & (size_t)MEMHEAD_SAMPLED_FLAG)
+#define MEMHEAD_SAMPLED_FROM_MEMHEAD(memhead) (((MemHeadSampled *)memhead) - 1)
 
 /* Uncomment this to have proper peak counter. */
 #define USE_ATOMIC_MAX
@@ -92,7 +98,7 @@ print_error(const char *str, ...)
 size_t MEM_lockfree_allocN_len(const void *vmemh)
 {
   if (vmemh) {
-    return MEMHEAD_FROM_PTR(vmemh)->len & ~((size_t)(MEMHEAD_ALIGN_FLAG));
+    return MEMHEAD_FROM_PTR(vmemh)->len & ~MEMHEAD_FLAGS;
   }
 
   return 0;
@@ -125,6 +131,11 @@ void MEM_lockfree_freeN(void *vmemh)
     MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
     aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
   }
+  else if (UNLIKELY(MEMHEAD_IS_SAMPLED(memh))) {
+    MemHeadSampled *memh_sampled = MEMHEAD_SAMPLED_FROM_MEMHEAD(memh);
+    mem_heap_profile_remove(memh_sampled->entry, len, memh_sampled->weight);
+    free(memh_sampled);
+  }
   else {
     free(memh);
   }
@@ -226,16 +237,44 @@ void *MEM_lockfree_recallocN_id(void *vmemh, size_t len, const char *str)
   return newp;
 }
 
+/* Allocate a block with the extra header for the heap profiler. */
+static MemHead *lockfree_alloc_sampled(size_t len,
+                                       const char *str,
+                                       const void *call_site,
+                                       bool clear)
+{
+  const size_t alloc_len = len + sizeof(MemHeadSampled) + sizeof(MemHead);
+  MemHeadSampled *memh_sampled = (MemHeadSampled *)(clear ? calloc(1, alloc_len) :
+                                                            malloc(alloc_len));
+
+  if (UNLIKELY(memh_sampled == NULL)) {
+    return NULL;
+  }
+
+  memh_sampled->entry = mem_heap_profile_add(str, call_site, len, &memh_sampled->weight);
+
+  MemHead *memh = (MemHead *)(memh_sampled + 1);
+  memh->len = len | (size_t)MEMHEAD_SAMPLED_FLAG;
+  return memh;
+}
+
 void *MEM_lockfree_callocN(size_t len, const char *str)
 {
   MemHead *memh;
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+  if (UNLIKELY(mem_heap_profile_running) && mem_heap_profile_sample(len)) {
+    memh = lockfree_alloc_sampled(len, str, MEM_RETURN_ADDRESS(), true);
+  }
+  else {
+    memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+    if (LIKELY(memh)) {
+      memh->len = len;
+    }
+  }
 
   if (LIKELY(memh)) {
-    memh->len = len;
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
@@ -273,14 +312,21 @@ void *MEM_lockfree_mallocN(size_t len, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)malloc(len + sizeof(MemHead));
+  if (UNLIKELY(mem_heap_profile_running) && mem_heap_profile_sample(len)) {
+    memh = lockfree_alloc_sampled(len, str, MEM_RETURN_ADDRESS(), false);
+  }
+  else {
+    memh = (MemHead *)malloc(len + sizeof(MemHead));
+    if (LIKELY(memh)) {
+      memh->len = len;
+    }
+  }
 
   if (LIKELY(memh)) {
     if (UNLIKELY(malloc_debug_memset && len)) {
       memset(memh + 1, 255, len);
     }
 
-    memh->len = len;
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
@@ -383,6 +429,9 @@ void MEM_lockfree_printmemlist_stats(void)
 {
   printf("\ntotal memory len: %.3f MB\n", (double)mem_in_use / (double)(1024 * 1024));
   printf("peak memory len: %.3f MB\n", (double)peak_mem / (double)(1024 * 1024));
+
+  mem_heap_profile_print();
+
   printf(
       "\nFor more detailed per-block statistics run Blender with memory debugging command line "
       "argument.\n");
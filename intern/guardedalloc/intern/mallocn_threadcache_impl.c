@@ -0,0 +1,809 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup MEM
+ *
+ * Memory allocation with per-thread caches of small blocks, so that most allocations and frees
+ * do not touch any memory shared between threads.
+ *
+ * Small blocks are rounded up to a size class. Every thread has a free list per size class,
+ * blocks freed by a thread go into its own cache regardless of which thread allocated them.
+ * Empty caches are refilled in batches from a central free list per size class, and caches
+ * exceeding their limit return half of their blocks to it. Memory for small blocks is allocated
+ * in chunks, which are not returned to the system. Large and aligned blocks are allocated from
+ * the system, the same as in the lock-free allocator.
+ *
+ * Memory statistics are kept per thread and summed when queried. Peak memory is updated from
+ * changes accumulated per thread, so it is accurate to within #STATS_FLUSH_THRESHOLD bytes per
+ * thread.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h> /* memcpy */
+#include <sys/types.h>
+
+#include <pthread.h>
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "atomic_ops.h"
+#include "mallocn_intern.h"
+
+typedef struct MemHead {
+  /* Length of allocated memory block. */
+  size_t len;
+} MemHead;
+
+typedef struct MemHeadAligned {
+  short alignment;
+  size_t len;
+} MemHeadAligned;
+
+ATOMIC_STATIC_ASSERT((MEMHEAD_SMALL_FLAG & (MEMHEAD_ALIGN_FLAG | MEMHEAD_SAMPLED_FLAG)) == 0,
+                     "MemHead flags overlap")
+
+#define MEMHEAD_FLAGS (MEMHEAD_ALIGN_FLAG | MEMHEAD_SMALL_FLAG)
+
+#define MEMHEAD_FROM_PTR(ptr) (((MemHead *)ptr) - 1)
+#define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
+#define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned *)ptr) - 1)
+#define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & MEMHEAD_ALIGN_FLAG)
+#define MEMHEAD_IS_SMALL(memhead) ((memhead)->len & MEMHEAD_SMALL_FLAG)
+
+/* -------------------------------------------------------------------- */
+/** \name Size Classes
+ *
+ * Sizes include the #MemHead. Steps of 16 bytes up to 256 bytes, then four classes per power
+ * of two up to #SMALL_BLOCK_MAX_SIZE.
+ * \{ */
+
+#define SMALL_BLOCK_MAX_SIZE 1024
+#define NUM_SIZE_CLASSES 24
+
+/* Memory of a cache per size class before blocks are returned to the central free list. */
+#define CACHE_MAX_BYTES (64 * 1024)
+/* Minimum size of chunks allocated from the system for small blocks. */
+#define CHUNK_MIN_BYTES (64 * 1024)
+
+/* Changes of memory in use of a thread after which the global statistics are updated. */
+#define STATS_FLUSH_THRESHOLD (256 * 1024)
+
+static const unsigned int size_class_sizes[NUM_SIZE_CLASSES] = {
+    16,  32,  48,  64,  80,  96,  112, 128, 144, 160, 176, 192,
+    208, 224, 240, 256, 320, 384, 448, 512, 640, 768, 896, 1024,
+};
+
+MEM_INLINE unsigned int size_class_index(size_t size)
+{
+  if (size <= 256) {
+    return (size <= 16) ? 0 : (unsigned int)((size + 15) / 16) - 1;
+  }
+  if (size <= 512) {
+    return 16 + (unsigned int)((size - 257) / 64);
+  }
+  return 20 + (unsigned int)((size - 513) / 128);
+}
+
+MEM_INLINE unsigned int size_class_max_blocks(unsigned int size_class)
+{
+  const unsigned int max_blocks = CACHE_MAX_BYTES / size_class_sizes[size_class];
+  return (max_blocks < 16) ? 16 : max_blocks;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Thread Caches
+ * \{ */
+
+/* Free blocks store the next pointer after their #MemHead. */
+typedef struct FreeBlock {
+  MemHead head;
+  struct FreeBlock *next;
+} FreeBlock;
+
+typedef struct FreeList {
+  FreeBlock *first;
+  unsigned int num_blocks;
+} FreeList;
+
+typedef struct CentralFreeList {
+  pthread_mutex_t mutex;
+  FreeList list;
+} CentralFreeList;
+
+typedef struct ThreadCache {
+  struct ThreadCache *next, *prev;
+
+  FreeList lists[NUM_SIZE_CLASSES];
+
+  /* Statistics of allocations and frees done by this thread. Memory and blocks in use can be
+   * negative, when the thread frees blocks allocated by other threads. These are summed up by
+   * other threads, so they are only accessed atomically. */
+  int64_t mem_in_use;
+  int64_t totblock;
+  uint64_t num_alloc;
+  uint64_t num_free;
+  /* Only used by the thread itself. */
+  int64_t mem_unflushed;
+} ThreadCache;
+
+static CentralFreeList central_lists[NUM_SIZE_CLASSES];
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_cache_key;
+static MEM_THREAD_LOCAL ThreadCache *thread_cache = NULL;
+
+/* All thread caches, and statistics of threads which exited. */
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ThreadCache *registry_first = NULL;
+static ThreadCache retired_stats;
+
+static int64_t mem_in_use_flushed = 0;
+static size_t peak_mem = 0;
+static bool malloc_debug_memset = false;
+
+static void (*error_callback)(const char *) = NULL;
+
+#ifdef __GNUC__
+__attribute__((format(printf, 1, 2)))
+#endif
+static void
+print_error(const char *str, ...)
+{
+  char buf[512];
+  va_list ap;
+
+  va_start(ap, str);
+  vsnprintf(buf, sizeof(buf), str, ap);
+  va_end(ap);
+  buf[sizeof(buf) - 1] = '\0';
+
+  if (error_callback) {
+    error_callback(buf);
+  }
+}
+
+static void free_list_push(FreeList *list, FreeBlock *block)
+{
+  block->next = list->first;
+  list->first = block;
+  list->num_blocks++;
+}
+
+MEM_INLINE FreeBlock *free_list_pop(FreeList *list)
+{
+  FreeBlock *block = list->first;
+  list->first = block->next;
+  list->num_blocks--;
+  return block;
+}
+
+/* Move up to num_blocks blocks from one list to another. */
+static void free_list_move(FreeList *to, FreeList *from, unsigned int num_blocks)
+{
+  while (from->first && num_blocks--) {
+    free_list_push(to, free_list_pop(from));
+  }
+}
+
+static void thread_cache_flush_stats(ThreadCache *cache)
+{
+  const int64_t mem_in_use = atomic_add_and_fetch_int64(&mem_in_use_flushed,
+                                                        cache->mem_unflushed);
+  cache->mem_unflushed = 0;
+
+  if (mem_in_use > 0) {
+    atomic_fetch_and_update_max_z(&peak_mem, (size_t)mem_in_use);
+  }
+}
+
+static void thread_cache_exit(void *data)
+{
+  ThreadCache *cache = (ThreadCache *)data;
+
+  for (unsigned int i = 0; i < NUM_SIZE_CLASSES; i++) {
+    CentralFreeList *central = &central_lists[i];
+    pthread_mutex_lock(&central->mutex);
+    free_list_move(&central->list, &cache->lists[i], cache->lists[i].num_blocks);
+    pthread_mutex_unlock(&central->mutex);
+  }
+
+  thread_cache_flush_stats(cache);
+
+  pthread_mutex_lock(&registry_mutex);
+  retired_stats.mem_in_use += cache->mem_in_use;
+  retired_stats.totblock += cache->totblock;
+  retired_stats.num_alloc += cache->num_alloc;
+  retired_stats.num_free += cache->num_free;
+  if (cache->prev) {
+    cache->prev->next = cache->next;
+  }
+  else {
+    registry_first = cache->next;
+  }
+  if (cache->next) {
+    cache->next->prev = cache->prev;
+  }
+  pthread_mutex_unlock(&registry_mutex);
+
+  thread_cache = NULL;
+  free(cache);
+}
+
+static void thread_cache_init_once(void)
+{
+  for (unsigned int i = 0; i < NUM_SIZE_CLASSES; i++) {
+    pthread_mutex_init(&central_lists[i].mutex, NULL);
+  }
+  pthread_key_create(&thread_cache_key, thread_cache_exit);
+}
+
+static ThreadCache *thread_cache_create(void)
+{
+  pthread_once(&init_once, thread_cache_init_once);
+
+  ThreadCache *cache = (ThreadCache *)calloc(1, sizeof(ThreadCache));
+  if (UNLIKELY(cache == NULL)) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&registry_mutex);
+  cache->next = registry_first;
+  if (registry_first) {
+    registry_first->prev = cache;
+  }
+  registry_first = cache;
+  pthread_mutex_unlock(&registry_mutex);
+
+  /* Only used to free the cache when the thread exits. */
+  pthread_setspecific(thread_cache_key, cache);
+
+  thread_cache = cache;
+  return cache;
+}
+
+MEM_INLINE ThreadCache *thread_cache_get(void)
+{
+  return LIKELY(thread_cache) ? thread_cache : thread_cache_create();
+}
+
+MEM_INLINE void thread_cache_add_stats(ThreadCache *cache, size_t len)
+{
+  atomic_add_and_fetch_int64(&cache->mem_in_use, (int64_t)len);
+  atomic_add_and_fetch_int64(&cache->totblock, 1);
+  atomic_add_and_fetch_uint64(&cache->num_alloc, 1);
+  cache->mem_unflushed += (int64_t)len;
+
+  if (UNLIKELY(cache->mem_unflushed > STATS_FLUSH_THRESHOLD)) {
+    thread_cache_flush_stats(cache);
+  }
+}
+
+MEM_INLINE void thread_cache_sub_stats(ThreadCache *cache, size_t len)
+{
+  atomic_sub_and_fetch_int64(&cache->mem_in_use, (int64_t)len);
+  atomic_sub_and_fetch_int64(&cache->totblock, 1);
+  atomic_add_and_fetch_uint64(&cache->num_free, 1);
+  cache->mem_unflushed -= (int64_t)len;
+
+  if (UNLIKELY(cache->mem_unflushed < -STATS_FLUSH_THRESHOLD)) {
+    thread_cache_flush_stats(cache);
+  }
+}
+
+/* Refill an empty cache from the central free list, or from a new chunk when that is empty. */
+static bool thread_cache_refill(ThreadCache *cache, unsigned int size_class)
+{
+  FreeList *list = &cache->lists[size_class];
+  CentralFreeList *central = &central_lists[size_class];
+  const unsigned int batch_size = size_class_max_blocks(size_class) / 2;
+
+  pthread_mutex_lock(&central->mutex);
+  free_list_move(list, &central->list, batch_size);
+  pthread_mutex_unlock(&central->mutex);
+
+  if (list->first) {
+    return true;
+  }
+
+  const size_t block_size = size_class_sizes[size_class];
+  size_t num_blocks = CHUNK_MIN_BYTES / block_size;
+  if (num_blocks < batch_size) {
+    num_blocks = batch_size;
+  }
+
+  char *chunk = (char *)malloc(num_blocks * block_size);
+  if (UNLIKELY(chunk == NULL)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < num_blocks; i++) {
+    free_list_push(list, (FreeBlock *)(chunk + i * block_size));
+  }
+
+  return true;
+}
+
+static MemHead *thread_cache_alloc(ThreadCache *cache, size_t len)
+{
+  const unsigned int size_class = size_class_index(len + sizeof(MemHead));
+  FreeList *list = &cache->lists[size_class];
+
+  if (UNLIKELY(list->first == NULL) && !thread_cache_refill(cache, size_class)) {
+    return NULL;
+  }
+
+  return &free_list_pop(list)->head;
+}
+
+static void thread_cache_free(ThreadCache *cache, MemHead *memh, size_t len)
+{
+  const unsigned int size_class = size_class_index(len + sizeof(MemHead));
+  FreeList *list = &cache->lists[size_class];
+
+  free_list_push(list, (FreeBlock *)memh);
+
+  /* Return half of the blocks when over the limit, so that memory freed by one thread can be
+   * reused by others. */
+  const unsigned int max_blocks = size_class_max_blocks(size_class);
+  if (UNLIKELY(list->num_blocks > max_blocks)) {
+    CentralFreeList *central = &central_lists[size_class];
+    pthread_mutex_lock(&central->mutex);
+    free_list_move(&central->list, list, max_blocks / 2);
+    pthread_mutex_unlock(&central->mutex);
+  }
+}
+
+/* Sum of statistics of all threads. */
+static void thread_cache_sum_stats(ThreadCache *r_stats)
+{
+  pthread_mutex_lock(&registry_mutex);
+  *r_stats = retired_stats;
+  for (ThreadCache *cache = registry_first; cache; cache = cache->next) {
+    r_stats->mem_in_use += atomic_add_and_fetch_int64(&cache->mem_in_use, 0);
+    r_stats->totblock += atomic_add_and_fetch_int64(&cache->totblock, 0);
+    r_stats->num_alloc += atomic_add_and_fetch_uint64(&cache->num_alloc, 0);
+    r_stats->num_free += atomic_add_and_fetch_uint64(&cache->num_free, 0);
+  }
+  pthread_mutex_unlock(&registry_mutex);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Allocation
+ * \{ */
+
+size_t MEM_threadcache_allocN_len(const void *vmemh)
+{
+  if (vmemh) {
+    return MEMHEAD_FROM_PTR(vmemh)->len & ~MEMHEAD_FLAGS;
+  }
+
+  return 0;
+}
+
+void MEM_threadcache_freeN(void *vmemh)
+{
+  if (leak_detector_has_run) {
+    print_error("%s\n", free_after_leak_detection_message);
+  }
+
+  if (vmemh == NULL) {
+    print_error("Attempt to free NULL pointer\n");
+#ifdef WITH_ASSERT_ABORT
+    abort();
+#endif
+    return;
+  }
+
+  MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+  size_t len = MEM_threadcache_allocN_len(vmemh);
+  ThreadCache *cache = thread_cache_get();
+
+  if (UNLIKELY(malloc_debug_memset && len)) {
+    memset(memh + 1, 255, len);
+  }
+
+  if (LIKELY(cache)) {
+    thread_cache_sub_stats(cache, len);
+  }
+
+  if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+    MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+    aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
+  }
+  else if (MEMHEAD_IS_SMALL(memh)) {
+    if (LIKELY(cache)) {
+      thread_cache_free(cache, memh, len);
+    }
+    /* Without a cache the block can only be leaked, small blocks are part of a chunk. */
+  }
+  else {
+    free(memh);
+  }
+}
+
+void *MEM_threadcache_dupallocN(const void *vmemh)
+{
+  void *newp = NULL;
+  if (vmemh) {
+    MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    const size_t prev_size = MEM_threadcache_allocN_len(vmemh);
+    if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+      MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_threadcache_mallocN_aligned(
+          prev_size, (size_t)memh_aligned->alignment, "dupli_malloc");
+    }
+    else {
+      newp = MEM_threadcache_mallocN(prev_size, "dupli_malloc");
+    }
+    memcpy(newp, vmemh, prev_size);
+  }
+  return newp;
+}
+
+void *MEM_threadcache_reallocN_id(void *vmemh, size_t len, const char *str)
+{
+  void *newp = NULL;
+
+  if (vmemh) {
+    MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    size_t old_len = MEM_threadcache_allocN_len(vmemh);
+
+    if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+      newp = MEM_threadcache_mallocN(len, "realloc");
+    }
+    else {
+      MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_threadcache_mallocN_aligned(len, (size_t)memh_aligned->alignment, "realloc");
+    }
+
+    if (newp) {
+      if (len < old_len) {
+        /* shrink */
+        memcpy(newp, vmemh, len);
+      }
+      else {
+        /* grow (or remain same size) */
+        memcpy(newp, vmemh, old_len);
+      }
+    }
+
+    MEM_threadcache_freeN(vmemh);
+  }
+  else {
+    newp = MEM_threadcache_mallocN(len, str);
+  }
+
+  return newp;
+}
+
+void *MEM_threadcache_recallocN_id(void *vmemh, size_t len, const char *str)
+{
+  void *newp = NULL;
+
+  if (vmemh) {
+    MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    size_t old_len = MEM_threadcache_allocN_len(vmemh);
+
+    if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+      newp = MEM_threadcache_mallocN(len, "recalloc");
+    }
+    else {
+      MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_threadcache_mallocN_aligned(len, (size_t)memh_aligned->alignment, "recalloc");
+    }
+
+    if (newp) {
+      if (len < old_len) {
+        /* shrink */
+        memcpy(newp, vmemh, len);
+      }
+      else {
+        memcpy(newp, vmemh, old_len);
+
+        if (len > old_len) {
+          /* grow */
+          /* zero new bytes */
+          memset(((char *)newp) + old_len, 0, len - old_len);
+        }
+      }
+    }
+
+    MEM_threadcache_freeN(vmemh);
+  }
+  else {
+    newp = MEM_threadcache_callocN(len, str);
+  }
+
+  return newp;
+}
+
+/* Allocate a block with MemHead, from the thread cache for small sizes. */
+static MemHead *threadcache_alloc_memhead(size_t len, bool clear)
+{
+  ThreadCache *cache = thread_cache_get();
+  MemHead *memh;
+
+  if (LIKELY(cache) && len + sizeof(MemHead) <= SMALL_BLOCK_MAX_SIZE) {
+    memh = thread_cache_alloc(cache, len);
+    if (UNLIKELY(memh == NULL)) {
+      return NULL;
+    }
+    if (clear) {
+      memset(memh + 1, 0, len);
+    }
+    memh->len = len | MEMHEAD_SMALL_FLAG;
+  }
+  else {
+    memh = (MemHead *)(clear ? calloc(1, len + sizeof(MemHead)) :
+                               malloc(len + sizeof(MemHead)));
+    if (UNLIKELY(memh == NULL)) {
+      return NULL;
+    }
+    memh->len = len;
+  }
+
+  if (LIKELY(cache)) {
+    thread_cache_add_stats(cache, len);
+  }
+
+  return memh;
+}
+
+void *MEM_threadcache_callocN(size_t len, const char *str)
+{
+  MemHead *memh;
+
+  len = SIZET_ALIGN_4(len);
+
+  memh = threadcache_alloc_memhead(len, true);
+
+  if (LIKELY(memh)) {
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Calloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+              SIZET_ARG(len),
+              str,
+              (unsigned int)MEM_threadcache_get_memory_in_use());
+  return NULL;
+}
+
+void *MEM_threadcache_calloc_arrayN(size_t len, size_t size, const char *str)
+{
+  size_t total_size;
+  if (UNLIKELY(!MEM_size_safe_multiply(len, size, &total_size))) {
+    print_error(
+        "Calloc array aborted due to integer overflow: "
+        "len=" SIZET_FORMAT "x" SIZET_FORMAT " in %s, total %u\n",
+        SIZET_ARG(len),
+        SIZET_ARG(size),
+        str,
+        (unsigned int)MEM_threadcache_get_memory_in_use());
+    abort();
+    return NULL;
+  }
+
+  return MEM_threadcache_callocN(total_size, str);
+}
+
+void *MEM_threadcache_mallocN(size_t len, const char *str)
+{
+  MemHead *memh;
+
+  len = SIZET_ALIGN_4(len);
+
+  memh = threadcache_alloc_memhead(len, false);
+
+  if (LIKELY(memh)) {
+    if (UNLIKELY(malloc_debug_memset && len)) {
+      memset(memh + 1, 255, len);
+    }
+
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+              SIZET_ARG(len),
+              str,
+              (unsigned int)MEM_threadcache_get_memory_in_use());
+  return NULL;
+}
+
+void *MEM_threadcache_malloc_arrayN(size_t len, size_t size, const char *str)
+{
+  size_t total_size;
+  if (UNLIKELY(!MEM_size_safe_multiply(len, size, &total_size))) {
+    print_error(
+        "Malloc array aborted due to integer overflow: "
+        "len=" SIZET_FORMAT "x" SIZET_FORMAT " in %s, total %u\n",
+        SIZET_ARG(len),
+        SIZET_ARG(size),
+        str,
+        (unsigned int)MEM_threadcache_get_memory_in_use());
+    abort();
+    return NULL;
+  }
+
+  return MEM_threadcache_mallocN(total_size, str);
+}
+
+void *MEM_threadcache_mallocN_aligned(size_t len, size_t alignment, const char *str)
+{
+  /* Huge alignment values doesn't make sense and they wouldn't fit into 'short' used in the
+   * MemHead. */
+  assert(alignment < 1024);
+
+  /* We only support alignments that are a power of two. */
+  assert(IS_POW2(alignment));
+
+  /* Some OS specific aligned allocators require a certain minimal alignment. */
+  if (alignment < ALIGNED_MALLOC_MINIMUM_ALIGNMENT) {
+    alignment = ALIGNED_MALLOC_MINIMUM_ALIGNMENT;
+  }
+
+  /* Aligned blocks are not cached, see the lock-free allocator for the layout. */
+  size_t extra_padding = MEMHEAD_ALIGN_PADDING(alignment);
+
+  len = SIZET_ALIGN_4(len);
+
+  MemHeadAligned *memh = (MemHeadAligned *)aligned_malloc(
+      len + extra_padding + sizeof(MemHeadAligned), alignment);
+
+  if (LIKELY(memh)) {
+    memh = (MemHeadAligned *)((char *)memh + extra_padding);
+
+    if (UNLIKELY(malloc_debug_memset && len)) {
+      memset(memh + 1, 255, len);
+    }
+
+    memh->len = len | MEMHEAD_ALIGN_FLAG;
+    memh->alignment = (short)alignment;
+
+    ThreadCache *cache = thread_cache_get();
+    if (LIKELY(cache)) {
+      thread_cache_add_stats(cache, len);
+    }
+
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+              SIZET_ARG(len),
+              str,
+              (unsigned int)MEM_threadcache_get_memory_in_use());
+  return NULL;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Statistics and Debugging
+ * \{ */
+
+void MEM_threadcache_printmemlist_pydict(void)
+{
+}
+
+void MEM_threadcache_printmemlist(void)
+{
+}
+
+/* unused */
+void MEM_threadcache_callbackmemlist(void (*func)(void *))
+{
+  (void)func; /* Ignored. */
+}
+
+void MEM_threadcache_printmemlist_stats(void)
+{
+  ThreadCache stats;
+  thread_cache_sum_stats(&stats);
+
+  printf("\ntotal memory len: %.3f MB\n", (double)stats.mem_in_use / (double)(1024 * 1024));
+  printf("peak memory len: %.3f MB\n", (double)peak_mem / (double)(1024 * 1024));
+  printf("total allocations: %llu\n", (unsigned long long)stats.num_alloc);
+  printf("total frees: %llu\n", (unsigned long long)stats.num_free);
+
+  printf("\nSize classes (cached blocks in central lists):\n");
+  for (unsigned int i = 0; i < NUM_SIZE_CLASSES; i++) {
+    CentralFreeList *central = &central_lists[i];
+    pthread_mutex_lock(&central->mutex);
+    const unsigned int num_blocks = central->list.num_blocks;
+    pthread_mutex_unlock(&central->mutex);
+
+    if (num_blocks) {
+      printf("  %4u bytes: %u\n", size_class_sizes[i], num_blocks);
+    }
+  }
+
+  printf(
+      "\nFor more detailed per-block statistics run Blender with memory debugging command line "
+      "argument.\n");
+
+#ifdef HAVE_MALLOC_STATS
+  printf("System Statistics:\n");
+  malloc_stats();
+#endif
+}
+
+void MEM_threadcache_set_error_callback(void (*func)(const char *))
+{
+  error_callback = func;
+}
+
+bool MEM_threadcache_consistency_check(void)
+{
+  return true;
+}
+
+void MEM_threadcache_set_memory_debug(void)
+{
+  malloc_debug_memset = true;
+}
+
+size_t MEM_threadcache_get_memory_in_use(void)
+{
+  ThreadCache stats;
+  thread_cache_sum_stats(&stats);
+  return (stats.mem_in_use > 0) ? (size_t)stats.mem_in_use : 0;
+}
+
+unsigned int MEM_threadcache_get_memory_blocks_in_use(void)
+{
+  ThreadCache stats;
+  thread_cache_sum_stats(&stats);
+  return (stats.totblock > 0) ? (unsigned int)stats.totblock : 0;
+}
+
+void MEM_threadcache_reset_peak_memory(void)
+{
+  peak_mem = MEM_threadcache_get_memory_in_use();
+}
+
+size_t MEM_threadcache_get_peak_memory(void)
+{
+  const size_t mem_in_use = MEM_threadcache_get_memory_in_use();
+  atomic_fetch_and_update_max_z(&peak_mem, mem_in_use);
+  return peak_mem;
+}
+
+void MEM_threadcache_get_allocation_counts(size_t *r_num_alloc, size_t *r_num_free)
+{
+  ThreadCache stats;
+  thread_cache_sum_stats(&stats);
+  *r_num_alloc = (size_t)stats.num_alloc;
+  *r_num_free = (size_t)stats.num_free;
+}
+
+#ifndef NDEBUG
+const char *MEM_threadcache_name_ptr(void *vmemh)
+{
+  if (vmemh) {
+    return "unknown block name ptr";
+  }
+
+  return "MEM_threadcache_name_ptr(NULL)";
+}
+#endif /* NDEBUG */
+
+/** \} */
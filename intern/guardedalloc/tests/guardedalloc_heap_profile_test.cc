@@ -0,0 +1,141 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <thread>
+#include <vector>
+
+#include "BLI_utildefines.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "guardedalloc_test_base.h"
+
+namespace {
+
+struct TagStats {
+  const char *tag;
+  size_t bytes = 0;
+  size_t blocks = 0;
+  size_t peak_bytes = 0;
+};
+
+void tag_stats_add(void *user_data,
+                   const char *tag,
+                   const void * /*call_site*/,
+                   size_t bytes,
+                   size_t blocks,
+                   size_t peak_bytes)
+{
+  TagStats *stats = (TagStats *)user_data;
+  if (STREQ(tag, stats->tag)) {
+    stats->bytes += bytes;
+    stats->blocks += blocks;
+    stats->peak_bytes += peak_bytes;
+  }
+}
+
+TagStats tag_stats_get(const char *tag)
+{
+  TagStats stats;
+  stats.tag = tag;
+  MEM_heap_profile_foreach(tag_stats_add, &stats);
+  return stats;
+}
+
+}  // namespace
+
+/* Only the lock-free allocator is profiled. */
+TEST_F(LockfreeAllocatorTest, HeapProfileEstimate)
+{
+  const char *tag = "HeapProfileEstimate";
+  const size_t sample_interval = 4096;
+  const size_t block_len = 64;
+  const size_t num_blocks = 20000;
+
+  MEM_heap_profile_start(sample_interval, false);
+  EXPECT_TRUE(MEM_heap_profile_is_running());
+
+  std::vector<void *> blocks;
+  for (size_t i = 0; i < num_blocks; i++) {
+    blocks.push_back(MEM_mallocN(block_len, tag));
+  }
+
+  /* Sampling is randomized, the estimate should be well within 20%. */
+  TagStats stats = tag_stats_get(tag);
+  EXPECT_GT(stats.bytes, block_len * num_blocks * 8 / 10);
+  EXPECT_LT(stats.bytes, block_len * num_blocks * 12 / 10);
+  EXPECT_LE(stats.bytes, stats.peak_bytes);
+
+  MEM_heap_profile_stop();
+  EXPECT_FALSE(MEM_heap_profile_is_running());
+
+  for (void *block : blocks) {
+    MEM_freeN(block);
+  }
+
+  stats = tag_stats_get(tag);
+  EXPECT_EQ(stats.bytes, 0);
+  EXPECT_EQ(stats.blocks, 0);
+  EXPECT_GT(stats.peak_bytes, 0);
+}
+
+TEST_F(LockfreeAllocatorTest, HeapProfileLargeBlocks)
+{
+  const char *tag = "HeapProfileLargeBlocks";
+
+  MEM_heap_profile_start(4096, false);
+
+  /* Blocks larger than the sample interval are always sampled. */
+  void *block = MEM_callocN(100000, tag);
+  TagStats stats = tag_stats_get(tag);
+  EXPECT_EQ(stats.bytes, 100000);
+  EXPECT_EQ(stats.blocks, 1);
+
+  MEM_freeN(block);
+  MEM_heap_profile_stop();
+
+  stats = tag_stats_get(tag);
+  EXPECT_EQ(stats.bytes, 0);
+}
+
+TEST_F(LockfreeAllocatorTest, HeapProfileBlocksAboveInterval)
+{
+  const char *tag = "HeapProfileBlocksAboveInterval";
+  const size_t sample_interval = 4096;
+  const size_t block_len = sample_interval + 100;
+  const size_t num_blocks = 100;
+
+  MEM_heap_profile_start(sample_interval, false);
+
+  /* Blocks just above the interval are exact too, none are skipped by the countdown. */
+  std::vector<void *> blocks;
+  for (size_t i = 0; i < num_blocks; i++) {
+    blocks.push_back(MEM_mallocN(block_len, tag));
+  }
+  TagStats stats = tag_stats_get(tag);
+  EXPECT_EQ(stats.bytes, block_len * num_blocks);
+  EXPECT_EQ(stats.blocks, num_blocks);
+
+  for (void *block : blocks) {
+    MEM_freeN(block);
+  }
+  MEM_heap_profile_stop();
+}
+
+TEST_F(LockfreeAllocatorTest, HeapProfileFirstAllocation)
+{
+  const char *tag = "HeapProfileFirstAllocation";
+
+  MEM_heap_profile_start(4096, false);
+
+  /* The countdown of a new thread starts at half the interval or more, so a small first
+   * allocation is not sampled. */
+  void *block = NULL;
+  std::thread thread([&]() { block = MEM_mallocN(64, tag); });
+  thread.join();
+  EXPECT_EQ(tag_stats_get(tag).bytes, 0);
+
+  MEM_freeN(block);
+  MEM_heap_profile_stop();
+}
@@ -0,0 +1,40 @@
+/* Apache License, Version 2.0 */
+
+#ifndef __GUARDEDALLOC_TEST_BASE_H__
+#define __GUARDEDALLOC_TEST_BASE_H__
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+/* Fixtures running a test with another allocator than the guarded allocator used by the test
+ * harness, which is restored after the test. Allocators can only be switched while no memory
+ * is allocated, so tests must free all their blocks. */
+
+class LockfreeAllocatorTest : public testing::Test {
+ protected:
+  void SetUp() override
+  {
+    MEM_use_lockfree_allocator();
+  }
+
+  void TearDown() override
+  {
+    MEM_use_guarded_allocator();
+  }
+};
+
+class ThreadcacheAllocatorTest : public testing::Test {
+ protected:
+  void SetUp() override
+  {
+    MEM_use_threadcache_allocator();
+  }
+
+  void TearDown() override
+  {
+    MEM_use_guarded_allocator();
+  }
+};
+
+#endif /* __GUARDEDALLOC_TEST_BASE_H__ */
@@ -0,0 +1,83 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <thread>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+#include "guardedalloc_test_base.h"
+
+TEST_F(ThreadcacheAllocatorTest, Sizes)
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  const unsigned int blocks_in_use = MEM_get_memory_blocks_in_use();
+
+  /* Cover all size classes and large blocks. */
+  std::vector<char *> blocks;
+  for (size_t len = 1; len < 2048; len += 7) {
+    char *block = (char *)MEM_callocN(len, __func__);
+    for (size_t i = 0; i < len; i++) {
+      EXPECT_EQ(block[i], 0);
+    }
+    memset(block, 1, len);
+    EXPECT_GE(MEM_allocN_len(block), len);
+    blocks.push_back(block);
+  }
+
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use + blocks.size());
+
+  for (char *block : blocks) {
+    MEM_freeN(block);
+  }
+
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST_F(ThreadcacheAllocatorTest, Threads)
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  size_t num_alloc, num_free;
+  MEM_get_allocation_counts(&num_alloc, &num_free);
+
+  const int num_threads = 8;
+  const int num_blocks = 1000;
+
+  /* Blocks are allocated by one thread and freed by another. */
+  std::vector<std::vector<void *>> blocks(num_threads);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&blocks, t]() {
+      for (int i = 0; i < num_blocks; i++) {
+        blocks[t].push_back(MEM_mallocN((size_t)(i % 300) + 1, "ThreadcacheAllocatorTest"));
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+
+  EXPECT_GT(MEM_get_peak_memory(), mem_in_use);
+
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&blocks, t]() {
+      for (void *block : blocks[(t + 1) % num_threads]) {
+        MEM_freeN(block);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  size_t new_num_alloc, new_num_free;
+  MEM_get_allocation_counts(&new_num_alloc, &new_num_free);
+
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+  EXPECT_EQ(new_num_alloc - num_alloc, (size_t)(num_threads * num_blocks));
+  EXPECT_EQ(new_num_free - num_free, (size_t)(num_threads * num_blocks));
+}
@@ -54,6 +54,7 @@
  */
 
 #include "MEM_Allocator.h"
+#include <algorithm>
 #include <list>
 #include <queue>
 #include <vector>
@@ -72,7 +73,7 @@ bool MEM_CacheLimiter_is_disabled(void);
 template<class T> class MEM_CacheLimiterHandle {
  public:
   explicit MEM_CacheLimiterHandle(T *data_, MEM_CacheLimiter<T> *parent_)
-      : data(data_), refcount(0), parent(parent_)
+      : data(data_), refcount(0), size(0), parent(parent_)
   {
   }
 
@@ -133,6 +134,8 @@ template<class T> class MEM_CacheLimiterHandle {
   T *data;
   int refcount;
   int pos;
+  /* Size of data when it was last measured, summed up in parent. */
+  size_t size;
   MEM_CacheLimiter<T> *parent;
 };
 
@@ -142,7 +145,11 @@ template<class T> class MEM_CacheLimiter {
   typedef int (*MEM_CacheLimiter_ItemPriority_Func)(void *item, int default_priority);
   typedef bool (*MEM_CacheLimiter_ItemDestroyable_Func)(void *item);
 
-  MEM_CacheLimiter(MEM_CacheLimiter_DataSize_Func data_size_func) : data_size_func(data_size_func)
+  MEM_CacheLimiter(MEM_CacheLimiter_DataSize_Func data_size_func)
+      : total_size(0),
+        data_size_func(data_size_func),
+        item_priority_func(NULL),
+        item_destroyable_func(NULL)
   {
   }
 
@@ -158,12 +165,14 @@ template<class T> class MEM_CacheLimiter {
   {
     queue.push_back(new MEM_CacheLimiterHandle<T>(elem, this));
     queue.back()->pos = queue.size() - 1;
+    update_size(queue.back());
     return queue.back();
   }
 
   void unmanage(MEM_CacheLimiterHandle<T> *handle)
   {
     int pos = handle->pos;
+    total_size -= handle->size;
     queue[pos] = queue.back();
     queue[pos]->pos = pos;
     queue.pop_back();
@@ -172,17 +181,10 @@ template<class T> class MEM_CacheLimiter {
 
   size_t get_memory_in_use()
   {
-    size_t size = 0;
     if (data_size_func) {
-      int i;
-      for (i = 0; i < queue.size(); i++) {
-        size += data_size_func(queue[i]->get()->get_data());
-      }
-    }
-    else {
-      size = MEM_get_memory_in_use();
+      return total_size;
     }
-    return size;
+    return MEM_get_memory_in_use();
   }
 
   void enforce_limits()
@@ -205,6 +207,23 @@ template<class T> class MEM_CacheLimiter {
       return;
     }
 
+    if (data_size_func) {
+      /* Data can gain or lose buffers while it is in the cache without being touched, measure
+       * sizes again before freeing anything. Only done when over the limit, so keeping the
+       * total up to date costs nothing for caches that fit. */
+      update_sizes();
+      mem_in_use = total_size;
+
+      if (mem_in_use <= max) {
+        return;
+      }
+    }
+
+    if (item_priority_func && data_size_func) {
+      enforce_limits_by_priority(max);
+      return;
+    }
+
     while (!queue.empty() && mem_in_use > max) {
       MEM_CacheElementPtr elem = get_least_priority_destroyable_element();
 
@@ -231,6 +250,8 @@ template<class T> class MEM_CacheLimiter {
 
   void touch(MEM_CacheLimiterHandle<T> *handle)
   {
+    update_size(handle);
+
     /* If we're using custom priority callback re-arranging the queue
      * doesn't make much sense because we'll iterate it all to get
      * least priority element anyway.
@@ -259,6 +280,74 @@ template<class T> class MEM_CacheLimiter {
   typedef std::vector<MEM_CacheElementPtr, MEM_Allocator<MEM_CacheElementPtr>> MEM_CacheQueue;
   typedef typename MEM_CacheQueue::iterator iterator;
 
+  struct MEM_CachePriorityItem {
+    int priority;
+    int index;
+    MEM_CacheElementPtr elem;
+
+    /* Lowest priority compares greatest, ties go to the element first in the queue, so the
+     * eviction order does not depend on where elements are in memory. */
+    bool operator<(const MEM_CachePriorityItem &other) const
+    {
+      if (priority != other.priority) {
+        return priority > other.priority;
+      }
+      return index > other.index;
+    }
+  };
+
+  void update_size(MEM_CacheElementPtr elem)
+  {
+    if (data_size_func) {
+      size_t size = data_size_func(elem->get()->get_data());
+      total_size = total_size - elem->size + size;
+      elem->size = size;
+    }
+  }
+
+  void update_sizes()
+  {
+    for (int i = 0; i < queue.size(); i++) {
+      update_size(queue[i]);
+    }
+  }
+
+  int get_item_priority(int index)
+  {
+    /* by default 0 means highest priority element */
+    /* casting a size type to int is questionable,
+       but unlikely to cause problems */
+    int priority = -((int)(queue.size()) - index - 1);
+    return item_priority_func(queue[index]->get()->get_data(), priority);
+  }
+
+  /* Priorities are computed once, and elements are destroyed starting from the lowest priority
+   * until enough memory is freed, instead of iterating the whole queue for every element. */
+  void enforce_limits_by_priority(size_t max)
+  {
+    std::vector<MEM_CachePriorityItem, MEM_Allocator<MEM_CachePriorityItem>> heap;
+    heap.reserve(queue.size());
+
+    for (int i = 0; i < queue.size(); i++) {
+      MEM_CacheElementPtr elem = queue[i];
+      if (can_destroy_element(elem)) {
+        MEM_CachePriorityItem item = {get_item_priority(i), i, elem};
+        heap.push_back(item);
+      }
+    }
+
+    /* Lowest priority element is on top of the heap. */
+    std::make_heap(heap.begin(), heap.end());
+
+    while (!heap.empty() && total_size > max) {
+      std::pop_heap(heap.begin(), heap.end());
+      MEM_CacheElementPtr elem = heap.back().elem;
+      heap.pop_back();
+
+      elem->destroy_if_possible();
+    }
+  }
+
   /* Check whether element can be destroyed when enforcing cache limits */
   bool can_destroy_element(MEM_CacheElementPtr &elem)
   {
@@ -299,11 +388,7 @@ template<class T> class MEM_CacheLimiter {
         if (!can_destroy_element(elem))
           continue;
 
-        /* by default 0 means highest priority element */
-        /* casting a size type to int is questionable,
-           but unlikely to cause problems */
-        int priority = -((int)(queue.size()) - i - 1);
-        priority = item_priority_func(elem->get()->get_data(), priority);
+        int priority = get_item_priority(i);
 
         if (priority < best_match_priority || best_match_elem == NULL) {
           best_match_priority = priority;
@@ -316,6 +401,7 @@ template<class T> class MEM_CacheLimiter {
   }
 
   MEM_CacheQueue queue;
+  size_t total_size;
   MEM_CacheLimiter_DataSize_Func data_size_func;
   MEM_CacheLimiter_ItemPriority_Func item_priority_func;
   MEM_CacheLimiter_ItemDestroyable_Func item_destroyable_func;
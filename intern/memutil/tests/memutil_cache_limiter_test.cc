@@ -0,0 +1,156 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <vector>
+
+#include "BLI_utildefines.h"
+
+#include "MEM_CacheLimiter.h"
+
+namespace {
+
+class TestItem {
+ public:
+  TestItem(int id, size_t size, int priority, std::vector<int> *destroyed)
+      : id(id), size(size), priority(priority), destroyed(destroyed)
+  {
+  }
+
+  ~TestItem()
+  {
+    destroyed->push_back(id);
+  }
+
+  void *get_data()
+  {
+    return this;
+  }
+
+  int id;
+  size_t size;
+  int priority;
+  std::vector<int> *destroyed;
+};
+
+typedef MEM_CacheLimiter<TestItem> TestCache;
+typedef MEM_CacheLimiterHandle<TestItem> TestHandle;
+
+size_t test_item_size(void *data)
+{
+  return ((TestItem *)data)->size;
+}
+
+int test_item_priority(void *data, int /*default_priority*/)
+{
+  return ((TestItem *)data)->priority;
+}
+
+/* Destroy all items left in the cache, the limiter itself only frees its handles. */
+void free_all_items(TestCache &cache)
+{
+  MEM_CacheLimiter_set_maximum(1);
+  cache.enforce_limits();
+}
+
+class CacheLimiterTest : public testing::Test {
+ protected:
+  void SetUp() override
+  {
+    prev_maximum = MEM_CacheLimiter_get_maximum();
+    prev_disabled = MEM_CacheLimiter_is_disabled();
+    MEM_CacheLimiter_set_disabled(false);
+  }
+
+  void TearDown() override
+  {
+    MEM_CacheLimiter_set_maximum(prev_maximum);
+    MEM_CacheLimiter_set_disabled(prev_disabled);
+  }
+
+  size_t prev_maximum;
+  bool prev_disabled;
+};
+
+}  // namespace
+
+TEST_F(CacheLimiterTest, SizeAccounting)
+{
+  std::vector<int> destroyed;
+  TestCache cache(test_item_size);
+
+  TestItem *a = new TestItem(0, 100, 0, &destroyed);
+  TestItem *b = new TestItem(1, 200, 0, &destroyed);
+  TestHandle *handle_a = cache.insert(a);
+  TestHandle *handle_b = cache.insert(b);
+  EXPECT_EQ(cache.get_memory_in_use(), 300);
+
+  /* Size changes are picked up when items are touched. */
+  b->size = 50;
+  EXPECT_EQ(cache.get_memory_in_use(), 300);
+  handle_b->touch();
+  EXPECT_EQ(cache.get_memory_in_use(), 150);
+
+  /* And when the running total is over the limit. */
+  a->size = 1000;
+  MEM_CacheLimiter_set_maximum(2000);
+  cache.enforce_limits();
+  EXPECT_EQ(cache.get_memory_in_use(), 150);
+  handle_a->ref();
+  handle_b->ref();
+  MEM_CacheLimiter_set_maximum(100);
+  cache.enforce_limits();
+  EXPECT_EQ(cache.get_memory_in_use(), 1050);
+  EXPECT_TRUE(destroyed.empty());
+  handle_a->unref();
+  handle_b->unref();
+
+  handle_a->unmanage();
+  EXPECT_EQ(cache.get_memory_in_use(), 50);
+  delete a;
+
+  MEM_CacheLimiter_set_maximum(10);
+  cache.enforce_limits();
+  EXPECT_EQ(cache.get_memory_in_use(), 0);
+  EXPECT_EQ(destroyed, std::vector<int>({0, 1}));
+}
+
+TEST_F(CacheLimiterTest, EvictionOrderByPriority)
+{
+  std::vector<int> destroyed;
+  TestCache cache(test_item_size);
+  cache.set_item_priority_func(test_item_priority);
+
+  const int priorities[] = {5, 1, 3, 1, 4, 3};
+  for (int i = 0; i < (int)ARRAY_SIZE(priorities); i++) {
+    cache.insert(new TestItem(i, 100, priorities[i], &destroyed));
+  }
+
+  /* Lowest priority goes first, ties are evicted in the order items were added. */
+  MEM_CacheLimiter_set_maximum(250);
+  cache.enforce_limits();
+  EXPECT_EQ(destroyed, std::vector<int>({1, 3, 2, 5}));
+  EXPECT_EQ(cache.get_memory_in_use(), 200);
+
+  free_all_items(cache);
+}
+
+TEST_F(CacheLimiterTest, EvictionSkipsReferenced)
+{
+  std::vector<int> destroyed;
+  TestCache cache(test_item_size);
+  cache.set_item_priority_func(test_item_priority);
+
+  TestHandle *handle = cache.insert(new TestItem(0, 100, 0, &destroyed));
+  cache.insert(new TestItem(1, 100, 1, &destroyed));
+  cache.insert(new TestItem(2, 100, 2, &destroyed));
+
+  handle->ref();
+  MEM_CacheLimiter_set_maximum(150);
+  cache.enforce_limits();
+  EXPECT_EQ(destroyed, std::vector<int>({1, 2}));
+  EXPECT_EQ(cache.get_memory_in_use(), 100);
+  handle->unref();
+
+  free_all_items(cache);
+}
@@ -291,6 +291,10 @@ void BKE_animsys_eval_driver(struct Depsgraph *depsgraph,
 
 void BKE_animsys_update_driver_array(struct ID *id);
 
+void BKE_animsys_rna_path_cache_ensure(struct ID *id);
+void BKE_animsys_rna_path_cache_clear(struct ID *id);
+void BKE_animsys_rna_path_cache_free(struct AnimData *adt);
+
 /* ************************************* */
 
 #ifdef __cplusplus
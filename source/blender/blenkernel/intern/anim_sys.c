@@ -36,6 +36,7 @@
 #include "BLI_math_rotation.h"
 #include "BLI_math_vector.h"
 #include "BLI_string_utils.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.h"
@@ -362,6 +363,33 @@ void BKE_keyingsets_blend_read_expand(BlendExpander *expander, ListBase *list)
 /* ***************************************** */
 /* Evaluation Data-Setting Backend */
 
+/* Check if the resolved property can be animated, and set the array index to write to. */
+static bool animsys_store_rna_setting_index(PointerRNA *ptr,
+                                            const char *path,
+                                            const int array_index,
+                                            PathResolvedRNA *r_result)
+{
+  if ((ptr->owner_id == NULL) || RNA_property_animateable(&r_result->ptr, r_result->prop)) {
+    int array_len = RNA_property_array_length(&r_result->ptr, r_result->prop);
+
+    if (array_len && array_index >= array_len) {
+      if (G.debug & G_DEBUG) {
+        CLOG_WARN(&LOG,
+                  "Animato: Invalid array index. ID = '%s',  '%s[%d]', array length is %d",
+                  (ptr->owner_id) ? (ptr->owner_id->name + 2) : "<No ID>",
+                  path,
+                  array_index,
+                  array_len - 1);
+      }
+    }
+    else {
+      r_result->prop_index = array_len ? array_index : -1;
+      return true;
+    }
+  }
+  return false;
+}
+
 bool BKE_animsys_store_rna_setting(PointerRNA *ptr,
                                    /* typically 'fcu->rna_path', 'fcu->array_index' */
                                    const char *rna_path,
@@ -375,24 +403,7 @@ bool BKE_animsys_store_rna_setting(PointerRNA *ptr,
   if (path) {
     /* get property to write to */
     if (RNA_path_resolve_property(ptr, path, &r_result->ptr, &r_result->prop)) {
-      if ((ptr->owner_id == NULL) || RNA_property_animateable(&r_result->ptr, r_result->prop)) {
-        int array_len = RNA_property_array_length(&r_result->ptr, r_result->prop);
-
-        if (array_len && array_index >= array_len) {
-          if (G.debug & G_DEBUG) {
-            CLOG_WARN(&LOG,
-                      "Animato: Invalid array index. ID = '%s',  '%s[%d]', array length is %d",
-                      (ptr->owner_id) ? (ptr->owner_id->name + 2) : "<No ID>",
-                      path,
-                      array_index,
-                      array_len - 1);
-          }
-        }
-        else {
-          r_result->prop_index = array_len ? array_index : -1;
-          success = true;
-        }
-      }
+      success = animsys_store_rna_setting_index(ptr, path, array_index, r_result);
     }
     else {
       /* failed to get path */
@@ -411,6 +422,182 @@ bool BKE_animsys_store_rna_setting(PointerRNA *ptr,
   return success;
 }
 
+/* Resolved RNA Path Cache --------------------------- */
+
+/* Evaluated IDs cache the resolved RNA paths of their animated properties, so evaluating
+ * animation and drivers doesn't parse the paths and look up items by name every time.
+ *
+ * Only properties of the ID itself are cached: its data is only reallocated when the depsgraph
+ * copies the ID again, which frees the cache along with the animation data. Relation updates of
+ * the depsgraph clear the cache, as data may have been renamed or removed.
+ *
+ * Each driver has its own item, only accessed by the depsgraph node evaluating that driver.
+ *
+ * The animation of an ID can also be evaluated from other threads, for example by
+ * #BKE_object_modifier_update_subframe from simulations of other objects, so F-Curves claim
+ * slots without locking: a slot is filled by the thread claiming it before its index is stored
+ * in #FCurve.rna_path_cache_slot, and never changes until the cache is cleared. Actions can be
+ * shared by multiple IDs, so the slot is validated against the F-Curve before use. When it can't
+ * be used the path is resolved without the cache. */
+
+typedef struct AnimRNAPathCacheItem {
+  PointerRNA ptr;
+  /* NULL when the path is not resolved yet, or could not be cached. */
+  PropertyRNA *prop;
+} AnimRNAPathCacheItem;
+
+typedef struct AnimRNAPathCacheSlot {
+  /* F-Curve which claimed the slot, NULL while the slot is free. */
+  const FCurve *fcurve;
+  /* Path of the F-Curve, so a new F-Curve allocated at the address of a freed one (when the
+   * action is copied again) doesn't match. */
+  const char *rna_path;
+  AnimRNAPathCacheItem item;
+} AnimRNAPathCacheSlot;
+
+/* F-Curve slots are allocated in blocks which are never moved, so they can be read while other
+ * threads claim slots. */
+#define ANIM_RNA_PATH_CACHE_BLOCK_SIZE 256
+#define ANIM_RNA_PATH_CACHE_BLOCKS_MAX 256
+
+typedef struct AnimRNAPathCache {
+  AnimRNAPathCacheSlot *fcurve_blocks[ANIM_RNA_PATH_CACHE_BLOCKS_MAX];
+  /* Number of claimed F-Curve slots. */
+  uint fcurve_slots_len;
+  /* Paths of the drivers, indexed like #AnimData.driver_array. */
+  AnimRNAPathCacheItem *drivers;
+  int drivers_len;
+} AnimRNAPathCache;
+
+/* Get the cache to use for paths relative to the pointer, if any. */
+static AnimRNAPathCache *animsys_rna_path_cache_get(const PointerRNA *ptr)
+{
+  ID *id = ptr->owner_id;
+  /* Temporary objects used for evaluating actions may share the animation data of an evaluated
+   * ID, these are not tagged as copied-on-write. */
+  if (id == NULL || ptr->data != id || (id->tag & LIB_TAG_COPIED_ON_WRITE) == 0) {
+    return NULL;
+  }
+  AnimData *adt = BKE_animdata_from_id(id);
+  return (adt != NULL) ? adt->rna_path_cache : NULL;
+}
+
+/* Get the slot at the index, allocating its block when needed. */
+static AnimRNAPathCacheSlot *animsys_rna_path_cache_slot_get(AnimRNAPathCache *cache,
+                                                             const uint slot_index)
+{
+  const uint block_index = slot_index / ANIM_RNA_PATH_CACHE_BLOCK_SIZE;
+  if (block_index >= ANIM_RNA_PATH_CACHE_BLOCKS_MAX) {
+    return NULL;
+  }
+
+  AnimRNAPathCacheSlot *block = cache->fcurve_blocks[block_index];
+  if (block == NULL) {
+    AnimRNAPathCacheSlot *new_block = MEM_calloc_arrayN(
+        ANIM_RNA_PATH_CACHE_BLOCK_SIZE, sizeof(AnimRNAPathCacheSlot), "AnimRNAPathCache block");
+    block = atomic_cas_ptr((void **)&cache->fcurve_blocks[block_index], NULL, new_block);
+    if (block == NULL) {
+      block = new_block;
+    }
+    else {
+      /* Another thread allocated the block first. */
+      MEM_freeN(new_block);
+    }
+  }
+  return &block[slot_index % ANIM_RNA_PATH_CACHE_BLOCK_SIZE];
+}
+
+/* Same as #BKE_animsys_store_rna_setting, using the cached path when the item has one and filling
+ * it otherwise. */
+static bool animsys_store_rna_setting_cached(PointerRNA *ptr,
+                                             AnimRNAPathCacheItem *item,
+                                             const char *rna_path,
+                                             const int array_index,
+                                             PathResolvedRNA *r_result)
+{
+  if (item->prop != NULL) {
+    r_result->ptr = item->ptr;
+    r_result->prop = item->prop;
+    return animsys_store_rna_setting_index(ptr, rna_path, array_index, r_result);
+  }
+
+  if (!BKE_animsys_store_rna_setting(ptr, rna_path, array_index, r_result)) {
+    return false;
+  }
+  /* Data of other IDs can be reallocated independently of this ID. */
+  if (r_result->ptr.owner_id == ptr->owner_id) {
+    item->ptr = r_result->ptr;
+    item->prop = r_result->prop;
+  }
+  return true;
+}
+
+/* Resolve the path of the F-Curve and claim a slot for the result, when one is left. */
+static bool animsys_store_rna_setting_fcurve_claim(PointerRNA *ptr,
+                                                   AnimRNAPathCache *cache,
+                                                   FCurve *fcu,
+                                                   const int prev_slot,
+                                                   PathResolvedRNA *r_result)
+{
+  if (!BKE_animsys_store_rna_setting(ptr, fcu->rna_path, fcu->array_index, r_result)) {
+    return false;
+  }
+  if (r_result->ptr.owner_id != ptr->owner_id ||
+      cache->fcurve_slots_len >= ANIM_RNA_PATH_CACHE_BLOCK_SIZE * ANIM_RNA_PATH_CACHE_BLOCKS_MAX) {
+    return true;
+  }
+
+  const uint slot_index = atomic_fetch_and_add_u(&cache->fcurve_slots_len, 1);
+  AnimRNAPathCacheSlot *slot = animsys_rna_path_cache_slot_get(cache, slot_index);
+  if (slot == NULL) {
+    return true;
+  }
+
+  /* The slot is only visible to other threads once its index is stored in the F-Curve. */
+  slot->rna_path = fcu->rna_path;
+  slot->item.ptr = r_result->ptr;
+  slot->item.prop = r_result->prop;
+  atomic_cas_ptr((void **)&slot->fcurve, NULL, fcu);
+  atomic_cas_int32(&fcu->rna_path_cache_slot, prev_slot, (int)slot_index + 1);
+  return true;
+}
+
+/* Resolve the property animated by an F-Curve of an action. */
+static bool animsys_store_rna_setting_fcurve(PointerRNA *ptr,
+                                             FCurve *fcu,
+                                             PathResolvedRNA *r_result)
+{
+  AnimRNAPathCache *cache = animsys_rna_path_cache_get(ptr);
+  if (cache == NULL || fcu->rna_path == NULL) {
+    return BKE_animsys_store_rna_setting(ptr, fcu->rna_path, fcu->array_index, r_result);
+  }
+
+  const int prev_slot = fcu->rna_path_cache_slot;
+  if (prev_slot == 0) {
+    return animsys_store_rna_setting_fcurve_claim(ptr, cache, fcu, prev_slot, r_result);
+  }
+
+  const uint slot_index = (uint)prev_slot - 1;
+  AnimRNAPathCacheSlot *slot = NULL;
+  if (slot_index < cache->fcurve_slots_len) {
+    slot = animsys_rna_path_cache_slot_get(cache, slot_index);
+  }
+
+  if (slot == NULL || slot->fcurve == NULL) {
+    /* Claimed before the cache was cleared, or by another ID using the same action which has
+     * more slots in use. */
+    return animsys_store_rna_setting_fcurve_claim(ptr, cache, fcu, prev_slot, r_result);
+  }
+  if (slot->fcurve != fcu || slot->rna_path != fcu->rna_path) {
+    /* The F-Curve uses the slot of another ID, don't take it away. */
+    return BKE_animsys_store_rna_setting(ptr, fcu->rna_path, fcu->array_index, r_result);
+  }
+
+  r_result->ptr = slot->item.ptr;
+  r_result->prop = slot->item.prop;
+  return animsys_store_rna_setting_index(ptr, fcu->rna_path, fcu->array_index, r_result);
+}
+
 /* less than 1.0 evaluates to false, use epsilon to avoid float error */
 #define ANIMSYS_FLOAT_AS_BOOL(value) ((value) > ((1.0f - FLT_EPSILON)))
 
@@ -582,6 +769,122 @@ static void animsys_write_orig_anim_rna(PointerRNA *ptr,
   }
 }
 
+/* Number of F-Curves from which their values are computed in parallel. Below this, the threading
+ * overhead is larger than the time spent evaluating the curves. */
+#define ANIMSYS_FCURVES_PARALLEL_THRESHOLD 1024
+
+/* Check if the F-Curve is to be evaluated, not being muted or empty. */
+static bool animsys_fcurve_is_evaluated(FCurve *fcu)
+{
+  /* Check if this F-Curve doesn't belong to a muted group. */
+  if ((fcu->grp != NULL) && (fcu->grp->flag & AGRP_MUTED)) {
+    return false;
+  }
+  /* Check if this curve should be skipped. */
+  if ((fcu->flag & (FCURVE_MUTED | FCURVE_DISABLED))) {
+    return false;
+  }
+  /* Skip empty curves, as if muted. */
+  if (BKE_fcurve_is_empty(fcu)) {
+    return false;
+  }
+  return true;
+}
+
+/* Calculate the F-Curve value and write it to the animated property. */
+static void animsys_evaluate_fcurve(PointerRNA *ptr,
+                                    FCurve *fcu,
+                                    const AnimationEvalContext *anim_eval_context,
+                                    bool flush_to_original)
+{
+  PathResolvedRNA anim_rna;
+  if (animsys_store_rna_setting_fcurve(ptr, fcu, &anim_rna)) {
+    const float curval = calculate_fcurve(&anim_rna, fcu, anim_eval_context);
+    BKE_animsys_write_rna_setting(&anim_rna, curval);
+    if (flush_to_original) {
+      animsys_write_orig_anim_rna(ptr, fcu->rna_path, fcu->array_index, curval);
+    }
+  }
+}
+
+/* Write an already calculated F-Curve value to the animated property. */
+static void animsys_write_fcurve_value(PointerRNA *ptr,
+                                       FCurve *fcu,
+                                       const float curval,
+                                       bool flush_to_original)
+{
+  PathResolvedRNA anim_rna;
+  if (animsys_store_rna_setting_fcurve(ptr, fcu, &anim_rna)) {
+    BKE_animsys_write_rna_setting(&anim_rna, curval);
+    if (flush_to_original) {
+      animsys_write_orig_anim_rna(ptr, fcu->rna_path, fcu->array_index, curval);
+    }
+  }
+}
+
+typedef struct AnimsysFCurvesBatchData {
+  FCurve **fcurves;
+  float *values;
+  const AnimationEvalContext *anim_eval_context;
+} AnimsysFCurvesBatchData;
+
+static void animsys_evaluate_fcurves_batch_cb(void *__restrict userdata,
+                                              const int index,
+                                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  AnimsysFCurvesBatchData *data = userdata;
+  /* Only drivers need the resolved property, these are not part of a batch. */
+  data->values[index] = calculate_fcurve(NULL, data->fcurves[index], data->anim_eval_context);
+}
+
+/**
+ * Evaluate a large number of F-Curves: compute all the values in parallel first, then write
+ * them to the properties. Writing stays single threaded, as properties of the same data can be
+ * animated by multiple curves.
+ */
+static void animsys_evaluate_fcurves_batch(PointerRNA *ptr,
+                                           ListBase *list,
+                                           const int fcurves_len,
+                                           const AnimationEvalContext *anim_eval_context,
+                                           bool flush_to_original)
+{
+  AnimsysFCurvesBatchData data = {
+      .fcurves = MEM_malloc_arrayN(fcurves_len, sizeof(FCurve *), __func__),
+      .values = MEM_malloc_arrayN(fcurves_len, sizeof(float), __func__),
+      .anim_eval_context = anim_eval_context,
+  };
+
+  int batch_len = 0;
+  LISTBASE_FOREACH (FCurve *, fcu, list) {
+    if (animsys_fcurve_is_evaluated(fcu) && fcu->driver == NULL) {
+      data.fcurves[batch_len++] = fcu;
+    }
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 256;
+  BLI_task_parallel_range(0, batch_len, &data, animsys_evaluate_fcurves_batch_cb, &settings);
+
+  /* Write in the original order, so the last curve wins when there are duplicates. */
+  int batch_index = 0;
+  LISTBASE_FOREACH (FCurve *, fcu, list) {
+    if (!animsys_fcurve_is_evaluated(fcu)) {
+      continue;
+    }
+    if (fcu->driver == NULL) {
+      BLI_assert(data.fcurves[batch_index] == fcu);
+      animsys_write_fcurve_value(ptr, fcu, data.values[batch_index++], flush_to_original);
+    }
+    else {
+      animsys_evaluate_fcurve(ptr, fcu, anim_eval_context, flush_to_original);
+    }
+  }
+
+  MEM_freeN(data.fcurves);
+  MEM_freeN(data.values);
+}
+
 /**
  * Evaluate all the F-Curves in the given list
  * This performs a set of standard checks. If extra checks are required,
@@ -592,27 +895,17 @@ static void animsys_evaluate_fcurves(PointerRNA *ptr,
                                      const AnimationEvalContext *anim_eval_context,
                                      bool flush_to_original)
 {
+  const int fcurves_len = BLI_listbase_count_at_most(list, ANIMSYS_FCURVES_PARALLEL_THRESHOLD);
+  if (fcurves_len >= ANIMSYS_FCURVES_PARALLEL_THRESHOLD) {
+    animsys_evaluate_fcurves_batch(
+        ptr, list, BLI_listbase_count(list), anim_eval_context, flush_to_original);
+    return;
+  }
+
   /* Calculate then execute each curve. */
   LISTBASE_FOREACH (FCurve *, fcu, list) {
-    /* Check if this F-Curve doesn't belong to a muted group. */
-    if ((fcu->grp != NULL) && (fcu->grp->flag & AGRP_MUTED)) {
-      continue;
-    }
-    /* Check if this curve should be skipped. */
-    if ((fcu->flag & (FCURVE_MUTED | FCURVE_DISABLED))) {
-      continue;
-    }
-    /* Skip empty curves, as if muted. */
-    if (BKE_fcurve_is_empty(fcu)) {
-      continue;
-    }
-    PathResolvedRNA anim_rna;
-    if (BKE_animsys_store_rna_setting(ptr, fcu->rna_path, fcu->array_index, &anim_rna)) {
-      const float curval = calculate_fcurve(&anim_rna, fcu, anim_eval_context);
-      BKE_animsys_write_rna_setting(&anim_rna, curval);
-      if (flush_to_original) {
-        animsys_write_orig_anim_rna(ptr, fcu->rna_path, fcu->array_index, curval);
-      }
+    if (animsys_fcurve_is_evaluated(fcu)) {
+      animsys_evaluate_fcurve(ptr, fcu, anim_eval_context, flush_to_original);
     }
   }
 }
@@ -2853,6 +3146,22 @@ void BKE_animsys_update_driver_array(ID *id)
   }
 }
 
+/* Resolve the property written by the driver, with the cache of the evaluated ID. */
+static bool animsys_store_rna_setting_driver(PointerRNA *id_ptr,
+                                             const int driver_index,
+                                             FCurve *fcu,
+                                             PathResolvedRNA *r_result)
+{
+  AnimRNAPathCache *cache = animsys_rna_path_cache_get(id_ptr);
+  if (cache == NULL || driver_index >= cache->drivers_len || fcu->rna_path == NULL) {
+    return BKE_animsys_store_rna_setting(id_ptr, fcu->rna_path, fcu->array_index, r_result);
+  }
+
+  /* The item is only used by the depsgraph node of this driver, no locking needed. */
+  return animsys_store_rna_setting_cached(
+      id_ptr, &cache->drivers[driver_index], fcu->rna_path, fcu->array_index, r_result);
+}
+
 void BKE_animsys_eval_driver(Depsgraph *depsgraph, ID *id, int driver_index, FCurve *fcu_orig)
 {
   BLI_assert(fcu_orig != NULL);
@@ -2889,7 +3198,7 @@ void BKE_animsys_eval_driver(Depsgraph *depsgraph, ID *id, int driver_index, FCu
       // printf("\told val = %f\n", fcu->curval);
 
       PathResolvedRNA anim_rna;
-      if (BKE_animsys_store_rna_setting(&id_ptr, fcu->rna_path, fcu->array_index, &anim_rna)) {
+      if (animsys_store_rna_setting_driver(&id_ptr, driver_index, fcu, &anim_rna)) {
         /* Evaluate driver, and write results to COW-domain destination */
         const float ctime = DEG_get_ctime(depsgraph);
         const AnimationEvalContext anim_eval_context = BKE_animsys_eval_context_construct(
@@ -2929,3 +3238,59 @@ void BKE_animsys_eval_driver(Depsgraph *depsgraph, ID *id, int driver_index, FCu
     }
   }
 }
+
+/* Create the resolved RNA path cache of an ID evaluated by the depsgraph. */
+void BKE_animsys_rna_path_cache_ensure(ID *id)
+{
+  AnimData *adt = BKE_animdata_from_id(id);
+  if (adt == NULL || adt->rna_path_cache != NULL) {
+    return;
+  }
+
+  AnimRNAPathCache *cache = MEM_callocN(sizeof(AnimRNAPathCache), "AnimRNAPathCache");
+  cache->drivers_len = BLI_listbase_count(&adt->drivers);
+  if (cache->drivers_len) {
+    cache->drivers = MEM_calloc_arrayN(
+        cache->drivers_len, sizeof(AnimRNAPathCacheItem), "AnimRNAPathCache drivers");
+  }
+  adt->rna_path_cache = cache;
+}
+
+/* Forget the resolved RNA paths, for when the data they point to may have changed.
+ * Not thread safe, only used while the ID is not evaluated. F-Curves keep their slot index,
+ * they claim a new slot when they find it free. */
+void BKE_animsys_rna_path_cache_clear(ID *id)
+{
+  AnimData *adt = BKE_animdata_from_id(id);
+  if (adt == NULL || adt->rna_path_cache == NULL) {
+    return;
+  }
+
+  AnimRNAPathCache *cache = adt->rna_path_cache;
+  for (int i = 0; i < ANIM_RNA_PATH_CACHE_BLOCKS_MAX; i++) {
+    if (cache->fcurve_blocks[i]) {
+      memset(cache->fcurve_blocks[i],
+             0,
+             sizeof(AnimRNAPathCacheSlot) * ANIM_RNA_PATH_CACHE_BLOCK_SIZE);
+    }
+  }
+  cache->fcurve_slots_len = 0;
+  if (cache->drivers) {
+    memset(cache->drivers, 0, sizeof(AnimRNAPathCacheItem) * cache->drivers_len);
+  }
+}
+
+void BKE_animsys_rna_path_cache_free(AnimData *adt)
+{
+  AnimRNAPathCache *cache = adt->rna_path_cache;
+  if (cache == NULL) {
+    return;
+  }
+
+  for (int i = 0; i < ANIM_RNA_PATH_CACHE_BLOCKS_MAX; i++) {
+    MEM_SAFE_FREE(cache->fcurve_blocks[i]);
+  }
+  MEM_SAFE_FREE(cache->drivers);
+  MEM_freeN(cache);
+  adt->rna_path_cache = NULL;
+}
@@ -55,6 +55,10 @@
 
 #include "CLG_log.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 static CLG_LogRef LOG = {"bke.armature_deform"};
 
 /* -------------------------------------------------------------------- */
@@ -229,6 +233,50 @@ static void pchan_bone_deform(bPoseChannel *pchan,
   (*contrib) += weight;
 }
 
+/* Add a weighted bone matrix to the linear blend sum. The translation is weighted too, so the
+ * sum can be applied to a coordinate at once instead of once per bone. */
+BLI_INLINE void armature_deform_mat_accumulate(float mat_accum[4][4],
+                                               const float mat[4][4],
+                                               const float weight)
+{
+#ifdef __SSE2__
+  const __m128 weight_vec = _mm_set1_ps(weight);
+  for (int i = 0; i < 4; i++) {
+    const __m128 mat_vec = _mm_mul_ps(_mm_loadu_ps(mat[i]), weight_vec);
+    _mm_storeu_ps(mat_accum[i], _mm_add_ps(_mm_loadu_ps(mat_accum[i]), mat_vec));
+  }
+#else
+  for (int i = 0; i < 4; i++) {
+    mat_accum[i][0] += mat[i][0] * weight;
+    mat_accum[i][1] += mat[i][1] * weight;
+    mat_accum[i][2] += mat[i][2] * weight;
+    mat_accum[i][3] += mat[i][3] * weight;
+  }
+#endif
+}
+
+/* Same as #add_weighted_dq_dq, inlined for the common case of bones without scale. */
+BLI_INLINE void armature_deform_dq_accumulate(DualQuat *dq_accum,
+                                              const DualQuat *dq,
+                                              float weight)
+{
+#ifdef __SSE2__
+  if (dq->scale_weight == 0.0f) {
+    if (dot_qtqt(dq->quat, dq_accum->quat) < 0.0f) {
+      weight = -weight;
+    }
+
+    const __m128 weight_vec = _mm_set1_ps(weight);
+    const __m128 quat_vec = _mm_mul_ps(_mm_loadu_ps(dq->quat), weight_vec);
+    const __m128 trans_vec = _mm_mul_ps(_mm_loadu_ps(dq->trans), weight_vec);
+    _mm_storeu_ps(dq_accum->quat, _mm_add_ps(_mm_loadu_ps(dq_accum->quat), quat_vec));
+    _mm_storeu_ps(dq_accum->trans, _mm_add_ps(_mm_loadu_ps(dq_accum->trans), trans_vec));
+    return;
+  }
+#endif
+  add_weighted_dq_dq(dq_accum, dq, weight);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -237,6 +285,18 @@ static void pchan_bone_deform(bPoseChannel *pchan,
  * #BKE_armature_deform_coords and related functions.
  * \{ */
 
+/**
+ * Deformation of the bone used by a vertex group, stored in an array indexed by the group index
+ * so vertices don't have to look into the pose channels for every weight.
+ */
+typedef struct ArmatureDeformGroup {
+  /** Copy of #bPoseChannel.chan_mat. */
+  float mat[4][4];
+  const DualQuat *dq;
+  /** The deformation depends on the vertex position (B-Bones or envelope multiplication). */
+  bool use_pchan_deform;
+} ArmatureDeformGroup;
+
 typedef struct ArmatureUserdata {
   const Object *ob_arm;
   const Object *ob_target;
@@ -256,6 +316,7 @@ typedef struct ArmatureUserdata {
   int dverts_len;
 
   bPoseChannel **pchan_from_defbase;
+  const ArmatureDeformGroup *deform_groups;
   int defbase_len;
 
   float premat[4][4];
@@ -331,14 +392,33 @@ static void armature_vert_task_with_dvert(const ArmatureUserdata *data,
     const MDeformWeight *dw = dvert->dw;
     int deformed = 0;
     unsigned int j;
+    /* Linear blend of the bones that don't depend on the vertex position. */
+    float mat_accum[4][4], mat_accum_weight = 0.0f;
+    zero_m4(mat_accum);
+
     for (j = dvert->totweight; j != 0; j--, dw++) {
       const uint index = dw->def_nr;
       if (index < data->defbase_len && (pchan = data->pchan_from_defbase[index])) {
+        const ArmatureDeformGroup *deform_group = &data->deform_groups[index];
         float weight = dw->weight;
         Bone *bone = pchan->bone;
 
         deformed = 1;
 
+        if (!deform_group->use_pchan_deform) {
+          if (weight != 0.0f) {
+            if (use_quaternion) {
+              armature_deform_dq_accumulate(dq, deform_group->dq, weight);
+            }
+            else {
+              armature_deform_mat_accumulate(mat_accum, deform_group->mat, weight);
+              mat_accum_weight += weight;
+            }
+            contrib += weight;
+          }
+          continue;
+        }
+
         if (bone && bone->flag & BONE_MULT_VG_ENV) {
           weight *= distfactor_to_bone(
               co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
@@ -347,6 +427,19 @@ static void armature_vert_task_with_dvert(const ArmatureUserdata *data,
         pchan_bone_deform(pchan, weight, vec, dq, smat, co, &contrib);
       }
     }
+
+    if (mat_accum_weight != 0.0f) {
+      float tmp[3];
+      mul_v3_m4v3(tmp, mat_accum, co);
+      madd_v3_v3fl(tmp, co, -mat_accum_weight);
+      add_v3_v3(vec, tmp);
+
+      if (smat) {
+        float tmpmat[3][3];
+        copy_m3_m4(tmpmat, mat_accum);
+        add_m3_m3m3(smat, smat, tmpmat);
+      }
+    }
     /* If there are vertex-groups but not groups with bones (like for soft-body groups). */
     if (deformed == 0 && use_envelope) {
       for (pchan = data->ob_arm->pose->chanbase.first; pchan; pchan = pchan->next) {
@@ -473,6 +566,7 @@ static void armature_deform_coords_impl(const Object *ob_arm,
 {
   bArmature *arm = ob_arm->data;
   bPoseChannel **pchan_from_defbase = NULL;
+  ArmatureDeformGroup *deform_groups = NULL;
   const MDeformVert *dverts = NULL;
   bDeformGroup *dg;
   const bool use_envelope = (deformflag & ARM_DEF_ENVELOPE) != 0;
@@ -543,17 +637,27 @@ static void armature_deform_coords_impl(const Object *ob_arm,
 
       if (use_dverts) {
         pchan_from_defbase = MEM_callocN(sizeof(*pchan_from_defbase) * defbase_len, "defnrToBone");
+        deform_groups = MEM_mallocN(sizeof(*deform_groups) * defbase_len, "ArmatureDeformGroup");
         /* TODO(sergey): Some considerations here:
          *
          * - Check whether keeping this consistent across frames gives speedup.
          */
         for (i = 0, dg = ob_target->defbase.first; dg; i++, dg = dg->next) {
-          pchan_from_defbase[i] = BKE_pose_channel_find_name(ob_arm->pose, dg->name);
+          bPoseChannel *pchan = BKE_pose_channel_find_name(ob_arm->pose, dg->name);
           /* exclude non-deforming bones */
-          if (pchan_from_defbase[i]) {
-            if (pchan_from_defbase[i]->bone->flag & BONE_NO_DEFORM) {
-              pchan_from_defbase[i] = NULL;
-            }
+          if (pchan && (pchan->bone->flag & BONE_NO_DEFORM)) {
+            pchan = NULL;
+          }
+          pchan_from_defbase[i] = pchan;
+
+          if (pchan) {
+            const Bone *bone = pchan->bone;
+            ArmatureDeformGroup *deform_group = &deform_groups[i];
+            copy_m4_m4(deform_group->mat, pchan->chan_mat);
+            deform_group->dq = &pchan->runtime.deform_dual_quat;
+            deform_group->use_pchan_deform = (bone->flag & BONE_MULT_VG_ENV) ||
+                                             (bone->segments > 1 &&
+                                              pchan->runtime.bbone_segments == bone->segments);
           }
         }
       }
@@ -575,6 +679,7 @@ static void armature_deform_coords_impl(const Object *ob_arm,
       .dverts = dverts,
       .dverts_len = dverts_len,
       .pchan_from_defbase = pchan_from_defbase,
+      .deform_groups = deform_groups,
       .defbase_len = defbase_len,
       .bmesh =
           {
@@ -611,6 +716,9 @@ static void armature_deform_coords_impl(const Object *ob_arm,
   if (pchan_from_defbase) {
     MEM_freeN(pchan_from_defbase);
   }
+  if (deform_groups) {
+    MEM_freeN(deform_groups);
+  }
 }
 
 void BKE_armature_deform_coords_with_gpencil_stroke(const Object *ob_arm,
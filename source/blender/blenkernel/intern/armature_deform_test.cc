@@ -0,0 +1,331 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#include "testing/testing.h"
+
+#include "BKE_action.h"
+#include "BKE_armature.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_armature_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_rand.hh"
+#include "BLI_string.h"
+
+namespace blender::bke::tests {
+
+/* Bones without B-Bones or envelope multiplication take the accumulated fast path in
+ * #armature_vert_task_with_dvert, the others go through #pchan_bone_deform. Giving the fast path
+ * bones envelope multiplication with a radius covering all vertices makes them use
+ * #pchan_bone_deform with an unchanged weight, which is the reference to compare against. */
+
+enum {
+  TEST_BONE_PLAIN_A,
+  TEST_BONE_PLAIN_B,
+  TEST_BONE_SCALED,
+  TEST_BONE_BBONE,
+  TEST_BONE_ENVELOPE,
+  TEST_BONE_LEN,
+};
+
+static const char *test_bone_names[TEST_BONE_LEN] = {
+    "PlainA", "PlainB", "Scaled", "BBone", "Envelope"};
+
+#define TEST_BBONE_SEGMENTS 4
+#define TEST_REFERENCE_RADIUS 1e4f
+
+struct ArmatureDeformTestContext {
+  Object *ob_arm;
+  bArmature *arm;
+  Object *ob_mesh;
+  Mesh *mesh;
+  int verts_len;
+};
+
+static void test_random_deform_mat(RandomNumberGenerator *rng, float r_mat[4][4], bool scale)
+{
+  float eul[3], loc[3], size[3] = {1.0f, 1.0f, 1.0f};
+  for (int i = 0; i < 3; i++) {
+    eul[i] = (rng->get_float() - 0.5f) * (float)M_PI;
+    loc[i] = (rng->get_float() - 0.5f) * 2.0f;
+    if (scale) {
+      size[i] = 0.5f + rng->get_float();
+    }
+  }
+  loc_eul_size_to_mat4(r_mat, loc, eul, size);
+}
+
+static void test_armature_deform_init(ArmatureDeformTestContext *ctx,
+                                      RandomNumberGenerator *rng,
+                                      int verts_len)
+{
+  ctx->arm = (bArmature *)MEM_callocN(sizeof(bArmature), __func__);
+  ctx->ob_arm = (Object *)MEM_callocN(sizeof(Object), __func__);
+  ctx->ob_arm->type = OB_ARMATURE;
+  ctx->ob_arm->data = ctx->arm;
+  ctx->ob_arm->pose = (bPose *)MEM_callocN(sizeof(bPose), __func__);
+  unit_m4(ctx->ob_arm->obmat);
+
+  for (int i = 0; i < TEST_BONE_LEN; i++) {
+    Bone *bone = (Bone *)MEM_callocN(sizeof(Bone), __func__);
+    STRNCPY(bone->name, test_bone_names[i]);
+    copy_v3_fl3(bone->arm_head, (float)i, 0.0f, 0.0f);
+    copy_v3_fl3(bone->arm_tail, (float)i, 1.0f, 0.0f);
+    unit_m4(bone->arm_mat);
+    copy_v3_v3(bone->arm_mat[3], bone->arm_head);
+    bone->length = 1.0f;
+    bone->segments = 1;
+    bone->weight = 1.0f;
+    BLI_addtail(&ctx->arm->bonebase, bone);
+
+    bPoseChannel *pchan = (bPoseChannel *)MEM_callocN(sizeof(bPoseChannel), __func__);
+    STRNCPY(pchan->name, bone->name);
+    pchan->bone = bone;
+    test_random_deform_mat(rng, pchan->chan_mat, i == TEST_BONE_SCALED);
+    if (ELEM(i, TEST_BONE_PLAIN_A, TEST_BONE_PLAIN_B)) {
+      /* Opposite quaternion hemispheres, so dual quaternion blending has to flip one of them. */
+      const float axis[3] = {1.0f, 0.0f, 0.0f};
+      float rot[3][3];
+      axis_angle_normalized_to_mat3(rot, axis, (i == TEST_BONE_PLAIN_A ? 0.8f : -0.8f) * (float)M_PI);
+      for (int j = 0; j < 3; j++) {
+        copy_v3_v3(pchan->chan_mat[j], rot[j]);
+      }
+    }
+    mat4_to_dquat(&pchan->runtime.deform_dual_quat, bone->arm_mat, pchan->chan_mat);
+    BLI_addtail(&ctx->ob_arm->pose->chanbase, pchan);
+
+    if (i == TEST_BONE_BBONE) {
+      bPoseChannel_Runtime *runtime = &pchan->runtime;
+      bone->segments = TEST_BBONE_SEGMENTS;
+      runtime->bbone_segments = TEST_BBONE_SEGMENTS;
+      runtime->bbone_deform_mats = (Mat4 *)MEM_malloc_arrayN(
+          TEST_BBONE_SEGMENTS + 2, sizeof(Mat4), __func__);
+      runtime->bbone_dual_quats = (DualQuat *)MEM_malloc_arrayN(
+          TEST_BBONE_SEGMENTS + 1, sizeof(DualQuat), __func__);
+      invert_m4_m4(runtime->bbone_deform_mats[0].mat, bone->arm_mat);
+      for (int a = 0; a <= TEST_BBONE_SEGMENTS; a++) {
+        test_random_deform_mat(rng, runtime->bbone_deform_mats[a + 1].mat, false);
+        mat4_to_dquat(
+            &runtime->bbone_dual_quats[a], bone->arm_mat, runtime->bbone_deform_mats[a + 1].mat);
+      }
+    }
+    else if (i == TEST_BONE_ENVELOPE) {
+      /* Vertices lie in and around the envelope, so the factor varies. */
+      bone->flag |= BONE_MULT_VG_ENV;
+      bone->rad_head = 0.5f;
+      bone->rad_tail = 0.5f;
+      bone->dist = 1.0f;
+    }
+  }
+
+  ctx->verts_len = verts_len;
+  ctx->mesh = (Mesh *)MEM_callocN(sizeof(Mesh), __func__);
+  ctx->mesh->totvert = verts_len;
+  ctx->mesh->dvert = (MDeformVert *)MEM_calloc_arrayN(verts_len, sizeof(MDeformVert), __func__);
+  ctx->ob_mesh = (Object *)MEM_callocN(sizeof(Object), __func__);
+  ctx->ob_mesh->type = OB_MESH;
+  ctx->ob_mesh->data = ctx->mesh;
+  unit_m4(ctx->ob_mesh->obmat);
+
+  for (int i = 0; i < TEST_BONE_LEN; i++) {
+    bDeformGroup *dg = (bDeformGroup *)MEM_callocN(sizeof(bDeformGroup), __func__);
+    STRNCPY(dg->name, test_bone_names[i]);
+    BLI_addtail(&ctx->ob_mesh->defbase, dg);
+  }
+}
+
+/* Give every vertex weights for the bones in `bones_mask`, zero weights included. */
+static void test_armature_deform_weights(ArmatureDeformTestContext *ctx,
+                                         RandomNumberGenerator *rng,
+                                         const int bones_mask)
+{
+  for (int i = 0; i < ctx->verts_len; i++) {
+    MDeformVert *dvert = &ctx->mesh->dvert[i];
+    MEM_SAFE_FREE(dvert->dw);
+    dvert->dw = (MDeformWeight *)MEM_calloc_arrayN(
+        TEST_BONE_LEN, sizeof(MDeformWeight), __func__);
+    dvert->totweight = 0;
+
+    for (int bone = 0; bone < TEST_BONE_LEN; bone++) {
+      if (bones_mask & (1 << bone)) {
+        MDeformWeight *dw = &dvert->dw[dvert->totweight++];
+        dw->def_nr = bone;
+        dw->weight = (i % TEST_BONE_LEN == bone) ? 0.0f : rng->get_float();
+      }
+    }
+  }
+}
+
+static void test_armature_deform_free(ArmatureDeformTestContext *ctx)
+{
+  LISTBASE_FOREACH (bPoseChannel *, pchan, &ctx->ob_arm->pose->chanbase) {
+    BKE_pose_channel_free_bbone_cache(&pchan->runtime);
+  }
+  BLI_freelistN(&ctx->ob_arm->pose->chanbase);
+  BLI_freelistN(&ctx->arm->bonebase);
+  MEM_freeN(ctx->ob_arm->pose);
+  MEM_freeN(ctx->ob_arm);
+  MEM_freeN(ctx->arm);
+
+  for (int i = 0; i < ctx->verts_len; i++) {
+    MEM_SAFE_FREE(ctx->mesh->dvert[i].dw);
+  }
+  MEM_freeN(ctx->mesh->dvert);
+  MEM_freeN(ctx->mesh);
+  BLI_freelistN(&ctx->ob_mesh->defbase);
+  MEM_freeN(ctx->ob_mesh);
+}
+
+/* Switch the bones that take the fast path over to the reference path and back. */
+static void test_armature_deform_use_reference(ArmatureDeformTestContext *ctx, bool use_reference)
+{
+  LISTBASE_FOREACH (Bone *, bone, &ctx->arm->bonebase) {
+    if (bone->segments > 1 || STREQ(bone->name, test_bone_names[TEST_BONE_ENVELOPE])) {
+      continue;
+    }
+    if (use_reference) {
+      bone->flag |= BONE_MULT_VG_ENV;
+      bone->rad_head = bone->rad_tail = TEST_REFERENCE_RADIUS;
+    }
+    else {
+      bone->flag &= ~BONE_MULT_VG_ENV;
+      bone->rad_head = bone->rad_tail = 0.0f;
+    }
+  }
+}
+
+static void test_armature_deform_compare(const int bones_mask, const int deformflag)
+{
+  const int verts_len = 1000;
+  ArmatureDeformTestContext ctx;
+  RandomNumberGenerator rng;
+  test_armature_deform_init(&ctx, &rng, verts_len);
+  test_armature_deform_weights(&ctx, &rng, bones_mask);
+
+  float(*coords)[3] = (float(*)[3])MEM_malloc_arrayN(verts_len, sizeof(float[3]), __func__);
+  for (int i = 0; i < verts_len; i++) {
+    coords[i][0] = rng.get_float() * TEST_BONE_LEN - 0.5f;
+    coords[i][1] = rng.get_float() * 2.0f - 0.5f;
+    coords[i][2] = rng.get_float() - 0.5f;
+  }
+
+  float(*coords_fast)[3] = (float(*)[3])MEM_dupallocN(coords);
+  float(*coords_ref)[3] = (float(*)[3])MEM_dupallocN(coords);
+  float(*mats_fast)[3][3] = (float(*)[3][3])MEM_malloc_arrayN(
+      verts_len, sizeof(float[3][3]), __func__);
+  float(*mats_ref)[3][3] = (float(*)[3][3])MEM_malloc_arrayN(
+      verts_len, sizeof(float[3][3]), __func__);
+  for (int i = 0; i < verts_len; i++) {
+    unit_m3(mats_fast[i]);
+    unit_m3(mats_ref[i]);
+  }
+
+  test_armature_deform_use_reference(&ctx, false);
+  BKE_armature_deform_coords_with_mesh(ctx.ob_arm,
+                                       ctx.ob_mesh,
+                                       coords_fast,
+                                       mats_fast,
+                                       verts_len,
+                                       deformflag,
+                                       nullptr,
+                                       nullptr,
+                                       nullptr);
+
+  test_armature_deform_use_reference(&ctx, true);
+  BKE_armature_deform_coords_with_mesh(ctx.ob_arm,
+                                       ctx.ob_mesh,
+                                       coords_ref,
+                                       mats_ref,
+                                       verts_len,
+                                       deformflag,
+                                       nullptr,
+                                       nullptr,
+                                       nullptr);
+
+  for (int i = 0; i < verts_len; i++) {
+    EXPECT_V3_NEAR(coords_fast[i], coords_ref[i], 1e-4f);
+    EXPECT_M3_NEAR(mats_fast[i], mats_ref[i], 1e-4f);
+  }
+
+  /* Make sure the comparison isn't trivially true. */
+  int moved = 0;
+  for (int i = 0; i < verts_len; i++) {
+    moved += len_squared_v3v3(coords[i], coords_fast[i]) > 1e-6f;
+  }
+  EXPECT_GT(moved, verts_len / 2);
+
+  MEM_freeN(coords);
+  MEM_freeN(coords_fast);
+  MEM_freeN(coords_ref);
+  MEM_freeN(mats_fast);
+  MEM_freeN(mats_ref);
+  test_armature_deform_free(&ctx);
+}
+
+#define TEST_MASK_PLAIN \
+  ((1 << TEST_BONE_PLAIN_A) | (1 << TEST_BONE_PLAIN_B) | (1 << TEST_BONE_SCALED))
+#define TEST_MASK_ALL ((1 << TEST_BONE_LEN) - 1)
+
+TEST(armature_deform, linear_plain_bones)
+{
+  test_armature_deform_compare(TEST_MASK_PLAIN, ARM_DEF_VGROUP);
+}
+
+TEST(armature_deform, linear_bbones)
+{
+  test_armature_deform_compare(TEST_MASK_PLAIN | (1 << TEST_BONE_BBONE), ARM_DEF_VGROUP);
+}
+
+TEST(armature_deform, linear_envelope_multiply)
+{
+  test_armature_deform_compare(TEST_MASK_PLAIN | (1 << TEST_BONE_ENVELOPE), ARM_DEF_VGROUP);
+}
+
+TEST(armature_deform, linear_all)
+{
+  test_armature_deform_compare(TEST_MASK_ALL, ARM_DEF_VGROUP);
+}
+
+TEST(armature_deform, dual_quat_plain_bones)
+{
+  test_armature_deform_compare(TEST_MASK_PLAIN, ARM_DEF_VGROUP | ARM_DEF_QUATERNION);
+}
+
+TEST(armature_deform, dual_quat_bbones)
+{
+  test_armature_deform_compare(TEST_MASK_PLAIN | (1 << TEST_BONE_BBONE),
+                               ARM_DEF_VGROUP | ARM_DEF_QUATERNION);
+}
+
+TEST(armature_deform, dual_quat_envelope_multiply)
+{
+  test_armature_deform_compare(TEST_MASK_PLAIN | (1 << TEST_BONE_ENVELOPE),
+                               ARM_DEF_VGROUP | ARM_DEF_QUATERNION);
+}
+
+TEST(armature_deform, dual_quat_all)
+{
+  test_armature_deform_compare(TEST_MASK_ALL, ARM_DEF_VGROUP | ARM_DEF_QUATERNION);
+}
+
+}  // namespace blender::bke::tests
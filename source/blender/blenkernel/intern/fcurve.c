@@ -141,6 +141,8 @@ FCurve *BKE_fcurve_copy(const FCurve *fcu)
 
   fcu_d->next = fcu_d->prev = NULL;
   fcu_d->grp = NULL;
+  /* The slot belongs to the cache of the ID evaluating the source. */
+  fcu_d->rna_path_cache_slot = 0;
 
   /* Copy curve data. */
   fcu_d->bezt = MEM_dupallocN(fcu_d->bezt);
@@ -1661,6 +1663,64 @@ static float fcurve_eval_keyframes_extrapolate(
   return endpoint_bezt->vec[1][1] - (fac * dx);
 }
 
+/**
+ * Check if the evaluation time falls on or right before keyframe \a a, returning the same result
+ * as #BKE_fcurve_bezt_binarysearch_index_ex would in that case.
+ */
+static bool fcurve_eval_keyframes_segment_check(
+    const BezTriple *bezts, int totvert, int a, float evaltime, float threshold, bool *r_exact)
+{
+  if ((a > 0 && IS_EQT(evaltime, bezts[a - 1].vec[1][0], threshold)) ||
+      (a + 1 < totvert && IS_EQT(evaltime, bezts[a + 1].vec[1][0], threshold))) {
+    /* Multiple keyframes may be within the threshold, leave it to the search to pick one. */
+    return false;
+  }
+  if (IS_EQT(evaltime, bezts[a].vec[1][0], threshold)) {
+    *r_exact = true;
+    return true;
+  }
+  if (a > 0 && bezts[a - 1].vec[1][0] < evaltime && evaltime < bezts[a].vec[1][0]) {
+    *r_exact = false;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Find the keyframe index for evaluating between keyframes. During playback the evaluation time
+ * is usually in the same or the next segment as the previous evaluation, so check those before
+ * doing a binary search.
+ */
+static int fcurve_eval_keyframes_search(FCurve *fcu,
+                                        BezTriple *bezts,
+                                        float evaltime,
+                                        float threshold,
+                                        bool *r_exact)
+{
+  const int totvert = (int)fcu->totvert;
+  /* The same F-Curve may be evaluated from multiple threads (actions shared by multiple IDs),
+   * which read and write the hint without synchronization. Any value is possible, so it's
+   * clamped and the segment is checked before use, a wrong hint only costs the search. */
+  const int hint = clamp_i(fcu->eval_segment_hint, 0, totvert - 1);
+  int a;
+
+  if (fcurve_eval_keyframes_segment_check(bezts, totvert, hint, evaltime, threshold, r_exact)) {
+    a = hint;
+  }
+  else if (hint + 1 < totvert && fcurve_eval_keyframes_segment_check(
+                                     bezts, totvert, hint + 1, evaltime, threshold, r_exact)) {
+    a = hint + 1;
+  }
+  else {
+    a = BKE_fcurve_bezt_binarysearch_index_ex(bezts, evaltime, totvert, threshold, r_exact);
+  }
+
+  if (a != fcu->eval_segment_hint) {
+    fcu->eval_segment_hint = a;
+  }
+  return a;
+}
+
 static float fcurve_eval_keyframes_interpolate(FCurve *fcu, BezTriple *bezts, float evaltime)
 {
   const float eps = 1.e-8f;
@@ -1670,7 +1730,7 @@ static float fcurve_eval_keyframes_interpolate(FCurve *fcu, BezTriple *bezts, fl
   /* Evaltime occurs somewhere in the middle of the curve. */
   bool exact = false;
 
-  /* Use binary search to find appropriate keyframes...
+  /* Search for the appropriate keyframes...
    *
    * The threshold here has the following constraints:
    * - 0.001 is too coarse:
@@ -1680,7 +1740,7 @@ static float fcurve_eval_keyframes_interpolate(FCurve *fcu, BezTriple *bezts, fl
    *   Weird errors, like selecting the wrong keyframe range (see T39207), occur.
    *   This lower bound was established in b888a32eee8147b028464336ad2404d8155c64dd.
    */
-  a = BKE_fcurve_bezt_binarysearch_index_ex(bezts, evaltime, fcu->totvert, 0.0001, &exact);
+  a = fcurve_eval_keyframes_search(fcu, bezts, evaltime, 0.0001f, &exact);
   bezt = bezts + a;
 
   if (exact) {
@@ -2288,6 +2348,10 @@ void BKE_fcurve_blend_read_data(BlendDataReader *reader, ListBase *fcurves)
      */
     fcu->flag &= ~FCURVE_DISABLED;
 
+    /* Runtime evaluation hint, saved with whatever the last evaluation left. */
+    fcu->eval_segment_hint = 0;
+    fcu->rna_path_cache_slot = 0;
+
     /* driver */
     BLO_read_data_address(reader, &fcu->driver);
     if (fcu->driver) {
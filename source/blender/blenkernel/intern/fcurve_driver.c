@@ -1064,6 +1064,11 @@ static bool driver_compile_simple_expr(ChannelDriver *driver)
   if (atomic_cas_ptr((void **)&driver->expr_simple, NULL, expr) != NULL) {
     BLI_expr_pylike_free(expr);
   }
+  /* Report expressions falling back to Python once per compile, since these serialize
+   * evaluation on the Python lock. Use `--log "bke.fcurve"` to list them. */
+  else if (!BLI_expr_pylike_is_valid(expr) && driver->expression[0] != '\0') {
+    CLOG_INFO(&LOG, 1, "driver expression requires Python: '%s'", driver->expression);
+  }
 
   return true;
 }
@@ -211,6 +211,46 @@ TEST(evaluate_fcurve, ExtrapolationBezierKeys)
   BKE_fcurve_free(fcu);
 }
 
+TEST(evaluate_fcurve, SegmentHint)
+{
+  FCurve *fcu = BKE_fcurve_create();
+
+  for (int i = 0; i < 10; i++) {
+    insert_vert_fcurve(fcu, i * 2.0f, (i % 3) * 5.0f, BEZT_KEYTYPE_KEYFRAME, INSERTKEY_NO_USERPREF);
+  }
+  fcu->bezt[4].ipo = BEZT_IPO_LIN;
+  fcu->bezt[6].ipo = BEZT_IPO_CONST;
+
+  /* Values computed without a usable hint, searching the keyframes every time. */
+  float expected[80];
+  for (int i = 0; i < 80; i++) {
+    fcu->eval_segment_hint = 0;
+    expected[i] = evaluate_fcurve(fcu, i * 0.25f);
+  }
+
+  /* Forward, as for playback. */
+  for (int i = 0; i < 80; i++) {
+    EXPECT_EQ(evaluate_fcurve(fcu, i * 0.25f), expected[i]);
+  }
+  /* Backward. */
+  for (int i = 79; i >= 0; i--) {
+    EXPECT_EQ(evaluate_fcurve(fcu, i * 0.25f), expected[i]);
+  }
+  /* Jumping around, and with a hint that is out of range. */
+  for (int i = 0; i < 80; i++) {
+    const int index = (i * 37) % 80;
+    EXPECT_EQ(evaluate_fcurve(fcu, index * 0.25f), expected[index]);
+  }
+  fcu->eval_segment_hint = 1000;
+  EXPECT_EQ(evaluate_fcurve(fcu, 5.0f), expected[20]);
+
+  /* Within the search threshold of a keyframe, after evaluating the segment before it. */
+  EXPECT_EQ(evaluate_fcurve(fcu, 5.5f), expected[22]);
+  EXPECT_EQ(evaluate_fcurve(fcu, 6.00008f), fcu->bezt[3].vec[1][1]);
+
+  BKE_fcurve_free(fcu);
+}
+
 TEST(fcurve_subdivide, BKE_fcurve_bezt_subdivide_handles)
 {
   FCurve *fcu = BKE_fcurve_create();
@@ -83,6 +83,10 @@ enum {
    * order of allocation when no chunks have been freed.
    */
   BLI_MEMPOOL_ALLOW_ITER = (1 << 0),
+  /** Allow allocating and freeing from multiple threads at once,
+   * using #BLI_mempool_thread_begin.
+   */
+  BLI_MEMPOOL_ALLOW_THREADS = (1 << 1),
 };
 
 void BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter) ATTR_NONNULL();
@@ -93,6 +97,23 @@ BLI_mempool_iter *BLI_mempool_iter_threadsafe_create(BLI_mempool *pool,
     ATTR_NONNULL();
 void BLI_mempool_iter_threadsafe_free(BLI_mempool_iter *iter_arr) ATTR_NONNULL();
 
+/** Thread-safe allocation, the pool must be created with #BLI_MEMPOOL_ALLOW_THREADS.
+ *
+ * Each thread uses its own context, which keeps a list of free elements reserved from the pool.
+ * Elements allocated in one context may be freed in another one. The pool itself may only be
+ * accessed again (iterated, cleared, ...) after all contexts ended.
+ */
+typedef struct BLI_mempool_thread BLI_mempool_thread;
+
+BLI_mempool_thread *BLI_mempool_thread_begin(BLI_mempool *pool) ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL(1);
+void *BLI_mempool_thread_alloc(BLI_mempool_thread *tpool) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL(1);
+void *BLI_mempool_thread_calloc(BLI_mempool_thread *tpool) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL(1);
+void BLI_mempool_thread_free(BLI_mempool_thread *tpool, void *addr) ATTR_NONNULL(1, 2);
+void BLI_mempool_thread_end(BLI_mempool_thread *tpool) ATTR_NONNULL(1);
+
 #ifdef __cplusplus
 }
 #endif
@@ -47,6 +47,27 @@ void BLI_task_scheduler_init(void);
 void BLI_task_scheduler_exit(void);
 int BLI_task_scheduler_num_threads(void);
 
+/* NUMA
+ *
+ * Optionally the scheduler creates a task arena per NUMA node, with worker threads that only
+ * run on the processors of that node. Task pools and other parallel work can be pinned to a
+ * node, so the memory they use stays local to it. Without NUMA support or with a single node,
+ * everything runs in the global arena and node 0 stands for the whole system.
+ *
+ * Must be enabled before #BLI_task_scheduler_init, #BLI_task_scheduler_exit disables it again. */
+
+void BLI_task_scheduler_numa_enable(void);
+int BLI_task_scheduler_num_numa_nodes(void);
+
+/* Run func in the arena of a NUMA node, so that parallel loops and task pools used
+ * inside of it run on threads of that node. */
+void BLI_task_numa_node_execute(int numa_node, void (*func)(void *userdata), void *userdata);
+
+/* Scratch memory allocated on a NUMA node, or with guarded allocation when that's not possible.
+ * The size must be passed again when freeing. */
+void *BLI_task_numa_malloc(size_t size, int numa_node, const char *str);
+void BLI_task_numa_free(void *ptr, size_t size);
+
 /* Task Pool
  *
  * Pool of tasks that will be executed by the central task scheduler. For each
@@ -88,6 +109,10 @@ TaskPool *BLI_task_pool_create_background_serial(void *userdata, TaskPriority pr
  * are created. */
 TaskPool *BLI_task_pool_create_suspended(void *userdata, TaskPriority priority);
 
+/* NUMA: like a regular task pool, with tasks executed by threads of the given
+ * NUMA node. See #BLI_task_scheduler_numa_enable. */
+TaskPool *BLI_task_pool_create_numa(void *userdata, TaskPriority priority, int numa_node);
+
 /* No threads: immediately executes tasks on the same thread. For debugging. */
 TaskPool *BLI_task_pool_create_no_threads(void *userdata);
 
@@ -27,6 +27,8 @@
  * - Freeing chunks.
  * - Iterating over allocated chunks
  *   (optionally when using the #BLI_MEMPOOL_ALLOW_ITER flag).
+ * - Allocating from multiple threads
+ *   (optionally when using the #BLI_MEMPOOL_ALLOW_THREADS flag).
  */
 
 #include <stdlib.h>
@@ -37,6 +39,7 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_mempool.h" /* own include */
+#include "BLI_threads.h"
 
 #include "MEM_guardedalloc.h"
 
@@ -131,12 +134,27 @@ struct BLI_mempool {
   uint maxchunks;
   /** Number of elements currently in use. */
   uint totused;
+  /** Protects the free list and chunks when allocating from thread contexts,
+   * only initialized with #BLI_MEMPOOL_ALLOW_THREADS. */
+  SpinLock lock;
 #ifdef USE_TOTALLOC
   /** Number of elements allocated in total. */
   uint totalloc;
 #endif
 };
 
+/**
+ * Per thread context for #BLI_MEMPOOL_ALLOW_THREADS pools,
+ * elements are reserved from the pool in batches.
+ */
+struct BLI_mempool_thread {
+  BLI_mempool *pool;
+  /** Free elements reserved by this context, or freed in it. */
+  BLI_freenode *free;
+  /** Change in number of elements in use, negative when freeing elements of other contexts. */
+  int totused;
+};
+
 #define MEMPOOL_ELEM_SIZE_MIN (sizeof(void *) * 2)
 
 #define CHUNK_DATA(chunk) (CHECK_TYPE_INLINE(chunk, BLI_mempool_chunk *), (void *)((chunk) + 1))
@@ -184,6 +202,40 @@ static BLI_mempool_chunk *mempool_chunk_alloc(BLI_mempool *pool)
   return MEM_mallocN(sizeof(BLI_mempool_chunk) + (size_t)pool->csize, "BLI_Mempool Chunk");
 }
 
+/**
+ * Link all elements of a chunk into a free list, starting at the chunk data.
+ *
+ * \return The last element, its next pointer is NULL.
+ */
+static BLI_freenode *mempool_chunk_init_free(const BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
+{
+  const uint esize = pool->esize;
+  BLI_freenode *curnode = CHUNK_DATA(mpchunk);
+  uint j;
+
+  /* loop through the allocated data, building the pointer structures */
+  j = pool->pchunk;
+  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+    while (j--) {
+      curnode->next = NODE_STEP_NEXT(curnode);
+      curnode->freeword = FREEWORD;
+      curnode = curnode->next;
+    }
+  }
+  else {
+    while (j--) {
+      curnode->next = NODE_STEP_NEXT(curnode);
+      curnode = curnode->next;
+    }
+  }
+
+  /* terminate the list (rewind one) */
+  curnode = NODE_STEP_PREV(curnode);
+  curnode->next = NULL;
+
+  return curnode;
+}
+
 /**
  * Initialize a chunk and add into \a pool->chunks
  *
@@ -197,9 +249,7 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
                                        BLI_mempool_chunk *mpchunk,
                                        BLI_freenode *last_tail)
 {
-  const uint esize = pool->esize;
   BLI_freenode *curnode = CHUNK_DATA(mpchunk);
-  uint j;
 
   /* append */
   if (pool->chunk_tail) {
@@ -217,26 +267,8 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
     pool->free = curnode;
   }
 
-  /* loop through the allocated data, building the pointer structures */
-  j = pool->pchunk;
-  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
-    while (j--) {
-      curnode->next = NODE_STEP_NEXT(curnode);
-      curnode->freeword = FREEWORD;
-      curnode = curnode->next;
-    }
-  }
-  else {
-    while (j--) {
-      curnode->next = NODE_STEP_NEXT(curnode);
-      curnode = curnode->next;
-    }
-  }
-
-  /* terminate the list (rewind one)
-   * will be overwritten if 'curnode' gets passed in again as 'last_tail' */
-  curnode = NODE_STEP_PREV(curnode);
-  curnode->next = NULL;
+  /* will be overwritten if 'curnode' gets passed in again as 'last_tail' */
+  curnode = mempool_chunk_init_free(pool, mpchunk);
 
 #ifdef USE_TOTALLOC
   pool->totalloc += pool->pchunk;
@@ -316,6 +348,10 @@ BLI_mempool *BLI_mempool_create(uint esize, uint totelem, uint pchunk, uint flag
 #endif
   pool->totused = 0;
 
+  if (flag & BLI_MEMPOOL_ALLOW_THREADS) {
+    BLI_spin_init(&pool->lock);
+  }
+
   if (totelem) {
     /* Allocate the actual chunks. */
     for (i = 0; i < maxchunks; i++) {
@@ -366,6 +402,151 @@ void *BLI_mempool_calloc(BLI_mempool *pool)
   return retval;
 }
 
+/**
+ * Begin allocating from a thread, the returned context must only be used by one thread at a time.
+ */
+BLI_mempool_thread *BLI_mempool_thread_begin(BLI_mempool *pool)
+{
+  BLI_assert(pool->flag & BLI_MEMPOOL_ALLOW_THREADS);
+
+  BLI_mempool_thread *tpool = MEM_mallocN(sizeof(*tpool), __func__);
+  tpool->pool = pool;
+  tpool->free = NULL;
+  tpool->totused = 0;
+  return tpool;
+}
+
+/**
+ * Reserve up to a chunk of free elements from the pool,
+ * or allocate a new chunk when the pool has no free elements.
+ */
+static void mempool_thread_reserve(BLI_mempool_thread *tpool)
+{
+  BLI_mempool *pool = tpool->pool;
+  BLI_freenode *last = NULL;
+  uint len = 0;
+
+  BLI_spin_lock(&pool->lock);
+  tpool->free = pool->free;
+  for (BLI_freenode *node = pool->free; node && len < pool->pchunk; node = node->next, len++) {
+    last = node;
+  }
+  if (last) {
+    pool->free = last->next;
+    last->next = NULL;
+  }
+  BLI_spin_unlock(&pool->lock);
+
+  if (last) {
+    return;
+  }
+
+  /* Initialize the new chunk before taking the lock, only linking it needs to be protected. */
+  BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+  mpchunk->next = NULL;
+  mempool_chunk_init_free(pool, mpchunk);
+  tpool->free = CHUNK_DATA(mpchunk);
+
+  BLI_spin_lock(&pool->lock);
+  if (pool->chunk_tail) {
+    pool->chunk_tail->next = mpchunk;
+  }
+  else {
+    pool->chunks = mpchunk;
+  }
+  pool->chunk_tail = mpchunk;
+#ifdef USE_TOTALLOC
+  pool->totalloc += pool->pchunk;
+#endif
+  BLI_spin_unlock(&pool->lock);
+}
+
+void *BLI_mempool_thread_alloc(BLI_mempool_thread *tpool)
+{
+  BLI_freenode *free_pop;
+
+  if (UNLIKELY(tpool->free == NULL)) {
+    mempool_thread_reserve(tpool);
+  }
+
+  free_pop = tpool->free;
+
+  if (tpool->pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+    free_pop->freeword = USEDWORD;
+  }
+
+  tpool->free = free_pop->next;
+  tpool->totused++;
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_ALLOC(tpool->pool, free_pop, tpool->pool->esize);
+#endif
+
+  return (void *)free_pop;
+}
+
+void *BLI_mempool_thread_calloc(BLI_mempool_thread *tpool)
+{
+  void *retval = BLI_mempool_thread_alloc(tpool);
+  memset(retval, 0, (size_t)tpool->pool->esize);
+  return retval;
+}
+
+/**
+ * Free an element into the thread context, it becomes available to other threads once the
+ * context ends. Unlike #BLI_mempool_free, chunks are never freed.
+ */
+void BLI_mempool_thread_free(BLI_mempool_thread *tpool, void *addr)
+{
+  BLI_freenode *newhead = addr;
+
+#ifndef NDEBUG
+  /* Enable for debugging. */
+  if (UNLIKELY(mempool_debug_memset)) {
+    memset(addr, 255, tpool->pool->esize);
+  }
+#endif
+
+  if (tpool->pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+#ifndef NDEBUG
+    /* This will detect double free's. */
+    BLI_assert(newhead->freeword != FREEWORD);
+#endif
+    newhead->freeword = FREEWORD;
+  }
+
+  newhead->next = tpool->free;
+  tpool->free = newhead;
+  tpool->totused--;
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_FREE(tpool->pool, addr);
+#endif
+}
+
+/**
+ * Return the remaining free elements of the context to the pool, and free the context.
+ */
+void BLI_mempool_thread_end(BLI_mempool_thread *tpool)
+{
+  BLI_mempool *pool = tpool->pool;
+  BLI_freenode *last = tpool->free;
+
+  while (last && last->next) {
+    last = last->next;
+  }
+
+  BLI_spin_lock(&pool->lock);
+  if (last) {
+    last->next = pool->free;
+    pool->free = tpool->free;
+  }
+  pool->totused = (uint)((int)pool->totused + tpool->totused);
+  BLI_spin_unlock(&pool->lock);
+
+  MEM_freeN(tpool);
+}
+
 /**
  * Free an element from the mempool.
  *
@@ -758,6 +939,10 @@ void BLI_mempool_destroy(BLI_mempool *pool)
 {
   mempool_chunk_free_all(pool->chunks);
 
+  if (pool->flag & BLI_MEMPOOL_ALLOW_THREADS) {
+    BLI_spin_end(&pool->lock);
+  }
+
 #ifdef WITH_MEM_VALGRIND
   VALGRIND_DESTROY_MEMPOOL(pool);
 #endif
@@ -315,6 +315,59 @@ static double op_div(double a, double b)
   return a / b;
 }
 
+/* Python raises ZeroDivisionError for floor division and modulo by zero, even where C would
+ * report an invalid operation, like fmod(0, 0). Divide by zero to report it the same way. */
+static double op_zero_division(double b)
+{
+  /* volatile so the compiler can't fold the division and lose the exception. */
+  volatile double zero = b;
+  return 1.0 / zero;
+}
+
+/* Python modulo: the result has the same sign as the divisor, unlike fmod. */
+static double op_mod(double a, double b)
+{
+  if (UNLIKELY(b == 0.0)) {
+    return op_zero_division(b);
+  }
+
+  double mod = fmod(a, b);
+  if (mod != 0.0) {
+    if ((b < 0.0) != (mod < 0.0)) {
+      mod += b;
+    }
+  }
+  else {
+    mod = copysign(0.0, b);
+  }
+  return mod;
+}
+
+/* Python floor division, as in float_floor_div of CPython. Computed from the remainder,
+ * since floor(a / b) can be off by one when a / b is rounded, like 1 // 0.1. */
+static double op_floordiv(double a, double b)
+{
+  if (UNLIKELY(b == 0.0)) {
+    return op_zero_division(b);
+  }
+
+  double mod = fmod(a, b);
+  double div = (a - mod) / b;
+  if (mod != 0.0 && (b < 0.0) != (mod < 0.0)) {
+    div -= 1.0;
+  }
+
+  if (div == 0.0) {
+    return copysign(0.0, a / b);
+  }
+
+  double floordiv = floor(div);
+  if (div - floordiv > 0.5) {
+    floordiv += 1.0;
+  }
+  return floordiv;
+}
+
 static double op_add(double a, double b)
 {
   return a + b;
@@ -364,6 +417,16 @@ static double op_smoothstep(double a, double b, double x)
   return t * t * (3.0 - 2.0 * t);
 }
 
+static double op_float(double a)
+{
+  return a;
+}
+
+static double op_bool(double a)
+{
+  return a ? 1.0 : 0.0;
+}
+
 static double op_not(double a)
 {
   return a ? 0.0 : 1.0;
@@ -405,7 +468,13 @@ typedef struct BuiltinConstDef {
 } BuiltinConstDef;
 
 static BuiltinConstDef builtin_consts[] = {
-    {"pi", M_PI}, {"True", 1.0}, {"False", 0.0}, {NULL, 0.0}};
+    {"pi", M_PI},
+    {"tau", 2.0 * M_PI},
+    {"e", M_E},
+    {"True", 1.0},
+    {"False", 0.0},
+    {NULL, 0.0},
+};
 
 typedef struct BuiltinOpDef {
   const char *name;
@@ -430,6 +499,8 @@ static BuiltinOpDef builtin_ops[] = {
     {"trunc", OPCODE_FUNC1, trunc},
     {"round", OPCODE_FUNC1, round},
     {"int", OPCODE_FUNC1, trunc},
+    {"float", OPCODE_FUNC1, op_float},
+    {"bool", OPCODE_FUNC1, op_bool},
     {"sin", OPCODE_FUNC1, sin},
     {"cos", OPCODE_FUNC1, cos},
     {"tan", OPCODE_FUNC1, tan},
@@ -437,12 +508,19 @@ static BuiltinOpDef builtin_ops[] = {
     {"acos", OPCODE_FUNC1, acos},
     {"atan", OPCODE_FUNC1, atan},
     {"atan2", OPCODE_FUNC2, atan2},
+    {"sinh", OPCODE_FUNC1, sinh},
+    {"cosh", OPCODE_FUNC1, cosh},
+    {"tanh", OPCODE_FUNC1, tanh},
+    {"hypot", OPCODE_FUNC2, hypot},
     {"exp", OPCODE_FUNC1, exp},
     {"log", OPCODE_FUNC1, log},
     {"log", OPCODE_FUNC2, op_log2},
+    {"log2", OPCODE_FUNC1, log2},
+    {"log10", OPCODE_FUNC1, log10},
     {"sqrt", OPCODE_FUNC1, sqrt},
     {"pow", OPCODE_FUNC2, pow},
     {"fmod", OPCODE_FUNC2, fmod},
+    {"copysign", OPCODE_FUNC2, copysign},
     {"lerp", OPCODE_FUNC3, op_lerp},
     {"clamp", OPCODE_FUNC1, op_clamp},
     {"clamp", OPCODE_FUNC3, op_clamp3},
@@ -477,8 +555,11 @@ static BuiltinOpDef builtin_ops[] = {
 #define TOKEN_NOT MAKE_CHAR2('N', 'O')
 #define TOKEN_IF MAKE_CHAR2('I', 'F')
 #define TOKEN_ELSE MAKE_CHAR2('E', 'L')
+#define TOKEN_POW MAKE_CHAR2('*', '*')
+#define TOKEN_FLOORDIV MAKE_CHAR2('/', '/')
 
 static const char *token_eq_characters = "!=><";
+static const char *token_double_characters = "*/";
 static const char *token_characters = "~`!@#$%^&*+-=/\\?:;<>(){}[]|.,\"'";
 
 typedef struct KeywordTokenDef {
@@ -713,6 +794,13 @@ static bool parse_next_token(ExprParseState *state)
     return (end == out);
   }
 
+  /* Doubled character tokens: ** and // */
+  if (state->cur[0] == state->cur[1] && strchr(token_double_characters, state->cur[0])) {
+    state->token = MAKE_CHAR2(state->cur[0], state->cur[1]);
+    state->cur += 2;
+    return true;
+  }
+
   /* ?= tokens */
   if (state->cur[1] == '=' && strchr(token_eq_characters, state->cur[0])) {
     state->token = MAKE_CHAR2(state->cur[0], state->cur[1]);
@@ -792,19 +880,11 @@ static int parse_function_args(ExprParseState *state)
   }
 }
 
-static bool parse_unary(ExprParseState *state)
+static bool parse_primary(ExprParseState *state)
 {
   int i;
 
   switch (state->token) {
-    case '+':
-      return parse_next_token(state) && parse_unary(state);
-
-    case '-':
-      CHECK_ERROR(parse_next_token(state) && parse_unary(state));
-      parse_add_func(state, OPCODE_FUNC1, 1, op_negate);
-      return true;
-
     case '(':
       return parse_next_token(state) && parse_expr(state) && state->token == ')' &&
              parse_next_token(state);
@@ -875,6 +955,38 @@ static bool parse_unary(ExprParseState *state)
   }
 }
 
+static bool parse_unary(ExprParseState *state);
+
+/* Power binds tighter than unary minus on its left, but not on its right:
+ * "-2 ** -2" is "-(2 ** (-2))", and it is right associative. */
+static bool parse_power(ExprParseState *state)
+{
+  CHECK_ERROR(parse_primary(state));
+
+  if (state->token == TOKEN_POW) {
+    CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+    parse_add_func(state, OPCODE_FUNC2, 2, pow);
+  }
+
+  return true;
+}
+
+static bool parse_unary(ExprParseState *state)
+{
+  switch (state->token) {
+    case '+':
+      return parse_next_token(state) && parse_unary(state);
+
+    case '-':
+      CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+      parse_add_func(state, OPCODE_FUNC1, 1, op_negate);
+      return true;
+
+    default:
+      return parse_power(state);
+  }
+}
+
 static bool parse_mul(ExprParseState *state)
 {
   CHECK_ERROR(parse_unary(state));
@@ -891,6 +1003,16 @@ static bool parse_mul(ExprParseState *state)
         parse_add_func(state, OPCODE_FUNC2, 2, op_div);
         break;
 
+      case TOKEN_FLOORDIV:
+        CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+        parse_add_func(state, OPCODE_FUNC2, 2, op_floordiv);
+        break;
+
+      case '%':
+        CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+        parse_add_func(state, OPCODE_FUNC2, 2, op_mod);
+        break;
+
       default:
         return true;
     }
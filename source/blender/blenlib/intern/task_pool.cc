@@ -37,6 +37,9 @@
 /* Quiet top level deprecation message, unrelated to API usage here. */
 #  define TBB_SUPPRESS_DEPRECATED_MESSAGES 1
 #  include <tbb/tbb.h>
+
+/* Defined in task_scheduler.cc. */
+tbb::task_arena *task_scheduler_numa_arena(int numa_node);
 #endif
 
 /* Task
@@ -167,6 +170,8 @@ struct TaskPool {
   /* TBB task pool. */
 #ifdef WITH_TBB
   TBBTaskGroup tbb_group;
+  /* Arena of the NUMA node to run tasks in, null for the global arena. */
+  tbb::task_arena *numa_arena;
 #endif
   volatile bool is_suspended;
   BLI_mempool *suspended_mempool;
@@ -218,7 +223,12 @@ static void tbb_task_pool_run(TaskPool *pool, Task &&task)
 #ifdef WITH_TBB
   else if (pool->use_threads) {
     /* Execute in TBB task group. */
-    pool->tbb_group.run(std::move(task));
+    if (pool->numa_arena) {
+      pool->numa_arena->execute([&] { pool->tbb_group.run(std::move(task)); });
+    }
+    else {
+      pool->tbb_group.run(std::move(task));
+    }
   }
 #endif
   else {
@@ -247,7 +257,12 @@ static void tbb_task_pool_work_and_wait(TaskPool *pool)
     /* This is called wait(), but internally it can actually do work. This
      * matters because we don't want recursive usage of task pools to run
      * out of threads and get stuck. */
-    pool->tbb_group.wait();
+    if (pool->numa_arena) {
+      pool->numa_arena->execute([&] { pool->tbb_group.wait(); });
+    }
+    else {
+      pool->tbb_group.wait();
+    }
   }
 #endif
 }
@@ -257,7 +272,12 @@ static void tbb_task_pool_cancel(TaskPool *pool)
 #ifdef WITH_TBB
   if (pool->use_threads) {
     pool->tbb_group.cancel();
-    pool->tbb_group.wait();
+    if (pool->numa_arena) {
+      pool->numa_arena->execute([&] { pool->tbb_group.wait(); });
+    }
+    else {
+      pool->tbb_group.wait();
+    }
   }
 #else
   UNUSED_VARS(pool);
@@ -432,6 +452,23 @@ TaskPool *BLI_task_pool_create_suspended(void *userdata, TaskPriority priority)
   return task_pool_create_ex(userdata, TASK_POOL_TBB_SUSPENDED, priority);
 }
 
+/**
+ * Like BLI_task_pool_create(), with tasks executed by the worker threads of a NUMA node.
+ * Without NUMA arenas this is a regular task pool.
+ */
+TaskPool *BLI_task_pool_create_numa(void *userdata, TaskPriority priority, int numa_node)
+{
+  TaskPool *pool = task_pool_create_ex(userdata, TASK_POOL_TBB, priority);
+#ifdef WITH_TBB
+  if (pool->use_threads) {
+    pool->numa_arena = task_scheduler_numa_arena(numa_node);
+  }
+#else
+  UNUSED_VARS(numa_node);
+#endif
+  return pool;
+}
+
 /**
  * Single threaded task pool that executes pushed task immediately, for
  * debugging purposes.
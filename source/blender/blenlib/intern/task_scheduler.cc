@@ -24,6 +24,17 @@
 
 #include "BLI_task.h"
 #include "BLI_threads.h"
+#include "BLI_utildefines.h"
+#include "BLI_vector.hh"
+
+#include "numaapi.h"
+
+#ifdef WIN32
+#  include <windows.h>
+#elif defined(__linux__)
+#  include <pthread.h>
+#  include <sched.h>
+#endif
 
 #ifdef WITH_TBB
 /* Quiet top level deprecation message, unrelated to API usage here. */
@@ -31,6 +42,7 @@
 #  include <tbb/tbb.h>
 #  if TBB_INTERFACE_VERSION_MAJOR >= 10
 #    define WITH_TBB_GLOBAL_CONTROL
+#    define WITH_TBB_NUMA_ARENAS
 #  endif
 #endif
 
@@ -41,6 +53,234 @@ static int task_scheduler_num_threads = 1;
 static tbb::global_control *task_scheduler_global_control = nullptr;
 #endif
 
+/* NUMA Arenas
+ *
+ * One arena per NUMA node with processors, an observer pins the worker threads
+ * that enter an arena to the processors of its node. */
+
+#ifdef WITH_TBB_NUMA_ARENAS
+/* Processor affinity of a worker thread from before it entered a NUMA arena. Workers move
+ * between arenas, so it is restored when they leave. The memory policy set by numaapi is local
+ * allocation, which is the default already. */
+struct ThreadAffinity {
+#  ifdef WIN32
+  GROUP_AFFINITY affinity;
+#  elif defined(__linux__)
+  cpu_set_t affinity;
+#  endif
+  bool is_stored = false;
+};
+
+static thread_local ThreadAffinity numa_worker_affinity;
+
+static void thread_affinity_store(ThreadAffinity &thread_affinity)
+{
+#  ifdef WIN32
+  thread_affinity.is_stored = GetThreadGroupAffinity(GetCurrentThread(),
+                                                     &thread_affinity.affinity) != 0;
+#  elif defined(__linux__)
+  thread_affinity.is_stored = pthread_getaffinity_np(pthread_self(),
+                                                     sizeof(thread_affinity.affinity),
+                                                     &thread_affinity.affinity) == 0;
+#  else
+  UNUSED_VARS(thread_affinity);
+#  endif
+}
+
+static void thread_affinity_restore(ThreadAffinity &thread_affinity)
+{
+  if (!thread_affinity.is_stored) {
+    return;
+  }
+#  ifdef WIN32
+  SetThreadGroupAffinity(GetCurrentThread(), &thread_affinity.affinity, nullptr);
+#  elif defined(__linux__)
+  pthread_setaffinity_np(
+      pthread_self(), sizeof(thread_affinity.affinity), &thread_affinity.affinity);
+#  endif
+  thread_affinity.is_stored = false;
+}
+
+class NumaNodeObserver : public tbb::task_scheduler_observer {
+  int numa_node_;
+
+ public:
+  NumaNodeObserver(tbb::task_arena &arena, int numa_node)
+      : tbb::task_scheduler_observer(arena), numa_node_(numa_node)
+  {
+    observe(true);
+  }
+
+  void on_scheduler_entry(bool is_worker) override
+  {
+    if (is_worker) {
+      thread_affinity_store(numa_worker_affinity);
+      numaAPI_RunThreadOnNode(numa_node_);
+    }
+  }
+
+  void on_scheduler_exit(bool is_worker) override
+  {
+    if (is_worker) {
+      thread_affinity_restore(numa_worker_affinity);
+    }
+  }
+};
+
+struct NumaArena {
+  int numa_node;
+  tbb::task_arena arena;
+  NumaNodeObserver *observer = nullptr;
+
+  NumaArena(int numa_node, int num_threads) : numa_node(numa_node), arena(num_threads)
+  {
+  }
+};
+
+static blender::Vector<NumaArena *> task_scheduler_numa_arenas;
+#endif
+
+static bool task_scheduler_numa_enabled = false;
+
+static void task_scheduler_numa_init()
+{
+#ifdef WITH_TBB_NUMA_ARENAS
+  if (!task_scheduler_numa_enabled || numaAPI_Initialize() != NUMAAPI_SUCCESS) {
+    return;
+  }
+
+  const int num_nodes = numaAPI_GetNumNodes();
+  if (num_nodes < 2) {
+    return;
+  }
+
+  for (int node = 0; node < num_nodes; node++) {
+    if (!numaAPI_IsNodeAvailable(node)) {
+      continue;
+    }
+
+    /* Split the thread count override over the nodes, relative to their processors. */
+    int num_threads = numaAPI_GetNumNodeProcessors(node);
+    const int num_threads_override = BLI_system_num_threads_override_get();
+    if (num_threads_override > 0) {
+      num_threads = max_ii(1, num_threads_override / num_nodes);
+    }
+
+    NumaArena *numa_arena = OBJECT_GUARDED_NEW(NumaArena, node, num_threads);
+    numa_arena->arena.initialize();
+    numa_arena->observer = OBJECT_GUARDED_NEW(NumaNodeObserver, numa_arena->arena, node);
+    task_scheduler_numa_arenas.append(numa_arena);
+  }
+
+  /* A single node is the same as the global arena. */
+  if (task_scheduler_numa_arenas.size() == 1) {
+    NumaArena *numa_arena = task_scheduler_numa_arenas[0];
+    OBJECT_GUARDED_DELETE(numa_arena->observer, NumaNodeObserver);
+    OBJECT_GUARDED_DELETE(numa_arena, NumaArena);
+    task_scheduler_numa_arenas.clear();
+  }
+#endif
+}
+
+static void task_scheduler_numa_exit()
+{
+#ifdef WITH_TBB_NUMA_ARENAS
+  for (NumaArena *numa_arena : task_scheduler_numa_arenas) {
+    OBJECT_GUARDED_DELETE(numa_arena->observer, NumaNodeObserver);
+    OBJECT_GUARDED_DELETE(numa_arena, NumaArena);
+  }
+  task_scheduler_numa_arenas.clear_and_make_inline();
+#endif
+}
+
+#ifdef WITH_TBB
+/* Arena of a NUMA node, or null to use the global arena. Used by task pools. */
+tbb::task_arena *task_scheduler_numa_arena(int numa_node)
+{
+#  ifdef WITH_TBB_NUMA_ARENAS
+  if (task_scheduler_numa_arenas.is_empty()) {
+    return nullptr;
+  }
+  const int index = (numa_node >= 0) ? numa_node % (int)task_scheduler_numa_arenas.size() : 0;
+  return &task_scheduler_numa_arenas[index]->arena;
+#  else
+  UNUSED_VARS(numa_node);
+  return nullptr;
+#  endif
+}
+#endif
+
+void BLI_task_scheduler_numa_enable()
+{
+  task_scheduler_numa_enabled = true;
+}
+
+int BLI_task_scheduler_num_numa_nodes()
+{
+#ifdef WITH_TBB_NUMA_ARENAS
+  return max_ii(1, (int)task_scheduler_numa_arenas.size());
+#else
+  return 1;
+#endif
+}
+
+void BLI_task_numa_node_execute(int numa_node, void (*func)(void *userdata), void *userdata)
+{
+#ifdef WITH_TBB
+  tbb::task_arena *arena = task_scheduler_numa_arena(numa_node);
+  if (arena) {
+    arena->execute([&] { func(userdata); });
+    return;
+  }
+#else
+  UNUSED_VARS(numa_node);
+#endif
+  func(userdata);
+}
+
+/* NUMA allocations fall back to guarded allocation when they fail, so blocks start with a header
+ * telling how they were allocated. Its size keeps the data aligned to cache lines. */
+#define NUMA_MEM_HEAD_SIZE 64
+
+void *BLI_task_numa_malloc(size_t size, int numa_node, const char *str)
+{
+  const size_t len = size + NUMA_MEM_HEAD_SIZE;
+  char *mem = nullptr;
+  bool is_numa = false;
+
+#ifdef WITH_TBB_NUMA_ARENAS
+  if (!task_scheduler_numa_arenas.is_empty()) {
+    const int index = (numa_node >= 0) ? numa_node % (int)task_scheduler_numa_arenas.size() : 0;
+    mem = (char *)numaAPI_AllocateOnNode(len, task_scheduler_numa_arenas[index]->numa_node);
+    is_numa = (mem != nullptr);
+  }
+#else
+  UNUSED_VARS(numa_node);
+#endif
+
+  if (mem == nullptr) {
+    mem = (char *)MEM_mallocN_aligned(len, NUMA_MEM_HEAD_SIZE, str);
+  }
+
+  *(bool *)mem = is_numa;
+  return mem + NUMA_MEM_HEAD_SIZE;
+}
+
+void BLI_task_numa_free(void *ptr, size_t size)
+{
+  char *mem = (char *)ptr - NUMA_MEM_HEAD_SIZE;
+
+  if (*(bool *)mem) {
+    numaAPI_Free(mem, size + NUMA_MEM_HEAD_SIZE);
+    return;
+  }
+
+  UNUSED_VARS(size);
+  MEM_freeN(mem);
+}
+
+/* Task Scheduler */
+
 void BLI_task_scheduler_init()
 {
 #ifdef WITH_TBB_GLOBAL_CONTROL
@@ -63,10 +303,15 @@ void BLI_task_scheduler_init()
 #else
   task_scheduler_num_threads = BLI_system_thread_count();
 #endif
+
+  task_scheduler_numa_init();
 }
 
 void BLI_task_scheduler_exit()
 {
+  task_scheduler_numa_exit();
+  task_scheduler_numa_enabled = false;
+
 #ifdef WITH_TBB_GLOBAL_CONTROL
   OBJECT_GUARDED_DELETE(task_scheduler_global_control, tbb::global_control);
 #endif
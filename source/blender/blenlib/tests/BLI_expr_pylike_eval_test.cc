@@ -111,6 +111,10 @@ TEST_PARSE_FAIL(Truncated7, "1 and")
 TEST_PARSE_FAIL(Truncated8, "1 or")
 TEST_PARSE_FAIL(Truncated9, "sqrt(1")
 TEST_PARSE_FAIL(Truncated10, "fmod(1,")
+TEST_PARSE_FAIL(Truncated11, "2 **")
+TEST_PARSE_FAIL(Truncated12, "2 //")
+TEST_PARSE_FAIL(Truncated13, "2 %")
+TEST_PARSE_FAIL(TriplePow, "2 *** 2")
 
 /* Constant expression with working constant folding */
 #define TEST_CONST(name, str, value) \
@@ -143,6 +147,8 @@ TEST_CONST(TenE, "1.e+1", 10.0)
 TEST_CONST(Half, ".5", 0.5)
 
 TEST_CONST(Pi, "pi", M_PI)
+TEST_CONST(Tau, "tau", M_PI * 2.0)
+TEST_CONST(E, "e", M_E)
 TEST_CONST(True, "True", TRUE_VAL)
 TEST_CONST(False, "False", FALSE_VAL)
 
@@ -156,6 +162,18 @@ TEST_CONST(Pow, "pow(4, 0.5)", 2.0)
 TEST_EVAL(Pow, "pow(4, x)", 0.5, 2.0)
 
 TEST_CONST(Log2_1, "log(4, 2)", 2.0)
+TEST_CONST(Log2_2, "log2(8)", 3.0)
+TEST_CONST(Log10, "log10(100)", 2.0)
+
+TEST_CONST(Hypot, "hypot(3, 4)", 5.0)
+TEST_EVAL(Hypot, "hypot(x, 4)", -3.0, 5.0)
+
+TEST_CONST(CopySign, "copysign(2, -1)", -2.0)
+
+TEST_CONST(Float, "float(True)", 1.0)
+TEST_CONST(Bool1, "bool(-0.5)", TRUE_VAL)
+TEST_CONST(Bool2, "bool(0)", FALSE_VAL)
+TEST_EVAL(Bool, "bool(x)", 2.0, TRUE_VAL)
 
 TEST_CONST(Round1, "round(-0.5)", -1.0)
 TEST_CONST(Round2, "round(-0.4)", 0.0)
@@ -205,6 +223,32 @@ TEST_EVAL(BinaryMul, "x*3", 2, 6.0)
 TEST_CONST(BinaryDiv, "3/2", 1.5)
 TEST_EVAL(BinaryDiv, "3/x", 2, 1.5)
 
+TEST_CONST(BinaryPow, "2**3", 8.0)
+TEST_EVAL(BinaryPow, "x**3", 2, 8.0)
+
+TEST_CONST(BinaryFloorDiv1, "7//2", 3.0)
+TEST_CONST(BinaryFloorDiv2, "-7//2", -4.0)
+TEST_EVAL(BinaryFloorDiv, "x//2", -7, -4.0)
+/* Not floor(1 / 0.1), which is 10 since the division rounds up. */
+TEST_CONST(BinaryFloorDiv3, "1 // 0.1", 9.0)
+TEST_CONST(BinaryFloorDiv4, "-1 // 0.1", -10.0)
+TEST_CONST(BinaryFloorDiv5, "7.5 // -2", -4.0)
+
+TEST_CONST(BinaryMod1, "7 % 3", 1.0)
+TEST_CONST(BinaryMod2, "-7 % 3", 2.0)
+TEST_CONST(BinaryMod3, "7 % -3", -2.0)
+TEST_CONST(BinaryMod4, "6 % 3", 0.0)
+TEST_CONST(BinaryMod5, "5.5 % 2", 1.5)
+TEST_EVAL(BinaryMod, "x % 3", -7, 2.0)
+TEST_CONST(BinaryMod6, "1 % 0.1", 0.09999999999999995)
+
+TEST_CONST(Pow1, "-2 ** 2", -4.0)
+TEST_CONST(Pow2, "2 ** -1", 0.5)
+TEST_CONST(Pow3, "2 ** 3 ** 2", 512.0)
+TEST_CONST(Pow4, "(-2) ** 2", 4.0)
+TEST_CONST(Pow5, "2 * 3 ** 2", 18.0)
+TEST_EVAL(Pow1, "-x ** 2", 3, -9.0)
+
 TEST_CONST(Arith1, "1 + -2 * 3", -5.0)
 TEST_CONST(Arith2, "(1 + -2) * 3", -3.0)
 TEST_CONST(Arith3, "-1 + 2 * 3", 5.0)
@@ -338,6 +382,16 @@ TEST_ERROR(PowDomain1, "pow(-1, 0.5)", 0.0, EXPR_PYLIKE_MATH_ERROR)
 TEST_ERROR(PowDomain2, "pow(-1, x)", 0.5, EXPR_PYLIKE_MATH_ERROR)
 TEST_ERROR(PowDomain3, "pow(-1, x)", 2.0, EXPR_PYLIKE_SUCCESS)
 
+TEST_ERROR(PowDomain4, "(-1) ** x", 0.5, EXPR_PYLIKE_MATH_ERROR)
+TEST_ERROR(PowDomain5, "0 ** x", -1.0, EXPR_PYLIKE_DIV_BY_ZERO)
+
+TEST_ERROR(FloorDivZero1, "1 // x", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
+TEST_ERROR(FloorDivZero2, "0 // x", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
+TEST_ERROR(FloorDivZero3, "1 // 0", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
+TEST_ERROR(ModZero1, "1 % x", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
+TEST_ERROR(ModZero2, "0 % x", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
+TEST_ERROR(ModZero3, "1 % 0", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
+
 TEST_ERROR(Mixed1, "sqrt(x) + 1 / max(0, x)", -1.0, EXPR_PYLIKE_MATH_ERROR)
 TEST_ERROR(Mixed2, "sqrt(x) + 1 / max(0, x)", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
 TEST_ERROR(Mixed3, "sqrt(x) + 1 / max(0, x)", 1.0, EXPR_PYLIKE_SUCCESS)
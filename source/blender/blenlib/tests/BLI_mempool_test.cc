@@ -0,0 +1,128 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <thread>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_mempool.h"
+#include "BLI_utildefines.h"
+
+namespace {
+
+struct Elem {
+  int thread;
+  int index;
+};
+
+}  // namespace
+
+TEST(mempool, Basic)
+{
+  BLI_mempool *pool = BLI_mempool_create(sizeof(Elem), 0, 64, BLI_MEMPOOL_ALLOW_ITER);
+
+  std::vector<Elem *> elems;
+  for (int i = 0; i < 1000; i++) {
+    Elem *elem = (Elem *)BLI_mempool_alloc(pool);
+    elem->thread = 0;
+    elem->index = i;
+    elems.push_back(elem);
+  }
+  EXPECT_EQ(BLI_mempool_len(pool), 1000);
+
+  for (int i = 0; i < 1000; i += 2) {
+    BLI_mempool_free(pool, elems[i]);
+  }
+  EXPECT_EQ(BLI_mempool_len(pool), 500);
+
+  /* Iteration is in order of allocation, skipping freed elements. */
+  BLI_mempool_iter iter;
+  BLI_mempool_iternew(pool, &iter);
+  int index = 1;
+  for (Elem *elem = (Elem *)BLI_mempool_iterstep(&iter); elem;
+       elem = (Elem *)BLI_mempool_iterstep(&iter)) {
+    EXPECT_EQ(elem->index, index);
+    index += 2;
+  }
+  EXPECT_EQ(index, 1001);
+
+  EXPECT_EQ(((Elem *)BLI_mempool_findelem(pool, 10))->index, 21);
+
+  BLI_mempool_destroy(pool);
+}
+
+TEST(mempool, ThreadAllocFree)
+{
+  const int num_threads = 8;
+  const int num_elems = 10000;
+
+  BLI_mempool *pool = BLI_mempool_create(
+      sizeof(Elem), 0, 128, BLI_MEMPOOL_ALLOW_ITER | BLI_MEMPOOL_ALLOW_THREADS);
+
+  std::vector<std::vector<Elem *>> elems(num_threads);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([pool, &elems, t]() {
+      BLI_mempool_thread *tpool = BLI_mempool_thread_begin(pool);
+      for (int i = 0; i < num_elems; i++) {
+        Elem *elem = (Elem *)BLI_mempool_thread_calloc(tpool);
+        EXPECT_EQ(elem->index, 0);
+        elem->thread = t;
+        elem->index = i;
+        elems[t].push_back(elem);
+      }
+      BLI_mempool_thread_end(tpool);
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+
+  EXPECT_EQ(BLI_mempool_len(pool), num_threads * num_elems);
+
+  /* All elements are found by iterating, exactly once. */
+  std::vector<int> found(num_threads * num_elems, 0);
+  BLI_mempool_iter iter;
+  BLI_mempool_iternew(pool, &iter);
+  for (Elem *elem = (Elem *)BLI_mempool_iterstep(&iter); elem;
+       elem = (Elem *)BLI_mempool_iterstep(&iter)) {
+    found[elem->thread * num_elems + elem->index]++;
+  }
+  for (int count : found) {
+    EXPECT_EQ(count, 1);
+  }
+
+  /* Free half of the elements of another thread, and allocate again. */
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([pool, &elems, t]() {
+      BLI_mempool_thread *tpool = BLI_mempool_thread_begin(pool);
+      std::vector<Elem *> &other_elems = elems[(t + 1) % num_threads];
+      for (int i = 0; i < num_elems; i += 2) {
+        BLI_mempool_thread_free(tpool, other_elems[i]);
+      }
+      for (int i = 0; i < num_elems / 4; i++) {
+        Elem *elem = (Elem *)BLI_mempool_thread_alloc(tpool);
+        elem->thread = -1;
+      }
+      BLI_mempool_thread_end(tpool);
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(BLI_mempool_len(pool), num_threads * (num_elems / 2 + num_elems / 4));
+
+  int iter_len = 0;
+  BLI_mempool_iternew(pool, &iter);
+  while (BLI_mempool_iterstep(&iter)) {
+    iter_len++;
+  }
+  EXPECT_EQ(iter_len, BLI_mempool_len(pool));
+
+  BLI_mempool_destroy(pool);
+}
@@ -0,0 +1,130 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_ghash.h"
+#include "BLI_map.hh"
+#include "BLI_rand.h"
+#include "BLI_set.hh"
+#include "BLI_utildefines.h"
+#include "BLI_vector.hh"
+
+#include "PIL_time.h"
+
+namespace blender::tests {
+
+/* Keys in random order, with duplicates. */
+static Vector<int> random_keys(const int keys_len, const int random_seed)
+{
+  RNG *rng = BLI_rng_new(random_seed);
+  Vector<int> keys(keys_len);
+  for (int &key : keys) {
+    key = (int)(BLI_rng_get_uint(rng) % (uint)keys_len);
+  }
+  BLI_rng_free(rng);
+  return keys;
+}
+
+static void containers_vector_test(const int len)
+{
+  double start_time = PIL_check_seconds_timer();
+  Vector<int> vector;
+  for (int i = 0; i < len; i++) {
+    vector.append(i);
+  }
+  record_performance("vector_append", PIL_check_seconds_timer() - start_time);
+
+  start_time = PIL_check_seconds_timer();
+  int64_t sum = 0;
+  for (const int value : vector) {
+    sum += value;
+  }
+  record_performance("vector_iterate", PIL_check_seconds_timer() - start_time);
+
+  EXPECT_EQ(sum, (int64_t)len * (len - 1) / 2);
+}
+
+static void containers_map_test(const int len)
+{
+  const Vector<int> keys = random_keys(len, 0);
+
+  double start_time = PIL_check_seconds_timer();
+  Map<int, int> map;
+  for (const int key : keys) {
+    map.add(key, key);
+  }
+  record_performance("map_add", PIL_check_seconds_timer() - start_time);
+
+  start_time = PIL_check_seconds_timer();
+  int found = 0;
+  for (int i = 0; i < len; i++) {
+    found += map.contains(i);
+  }
+  record_performance("map_lookup", PIL_check_seconds_timer() - start_time);
+
+  EXPECT_EQ(found, map.size());
+
+  /* Same operations with GHash, as reference. */
+  start_time = PIL_check_seconds_timer();
+  GHash *ghash = BLI_ghash_int_new(__func__);
+  for (const int key : keys) {
+    BLI_ghash_reinsert(ghash, POINTER_FROM_INT(key), POINTER_FROM_INT(key), NULL, NULL);
+  }
+  record_performance("ghash_add", PIL_check_seconds_timer() - start_time);
+
+  start_time = PIL_check_seconds_timer();
+  found = 0;
+  for (int i = 0; i < len; i++) {
+    found += BLI_ghash_haskey(ghash, POINTER_FROM_INT(i));
+  }
+  record_performance("ghash_lookup", PIL_check_seconds_timer() - start_time);
+
+  EXPECT_EQ(found, BLI_ghash_len(ghash));
+  BLI_ghash_free(ghash, NULL, NULL);
+}
+
+static void containers_set_test(const int len)
+{
+  const Vector<int> keys = random_keys(len, 1);
+
+  double start_time = PIL_check_seconds_timer();
+  Set<int> set;
+  for (const int key : keys) {
+    set.add(key);
+  }
+  record_performance("set_add", PIL_check_seconds_timer() - start_time);
+
+  start_time = PIL_check_seconds_timer();
+  int found = 0;
+  for (int i = 0; i < len; i++) {
+    found += set.contains(i);
+  }
+  record_performance("set_lookup", PIL_check_seconds_timer() - start_time);
+
+  EXPECT_EQ(found, set.size());
+
+  start_time = PIL_check_seconds_timer();
+  for (int i = 0; i < len; i += 2) {
+    set.remove(i);
+  }
+  record_performance("set_remove", PIL_check_seconds_timer() - start_time);
+}
+
+TEST(containers, Vector10M)
+{
+  containers_vector_test(10000000);
+}
+
+TEST(containers, Map1M)
+{
+  containers_map_test(1000000);
+}
+
+TEST(containers, Set1M)
+{
+  containers_set_test(1000000);
+}
+
+}  // namespace blender::tests
@@ -0,0 +1,149 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+
+#define NUM_RUN_AVERAGED 10
+
+/* Triangles of a randomly displaced grid, similar to a high resolution mesh. */
+static float (*grid_triangles_create(const int grid_size, const int random_seed))[3][3]
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  const int tris_len = (grid_size - 1) * (grid_size - 1) * 2;
+  float(*tris)[3][3] = (float(*)[3][3])MEM_malloc_arrayN(tris_len, sizeof(*tris), __func__);
+
+  float(*verts)[3] = (float(*)[3])MEM_malloc_arrayN(
+      grid_size * grid_size, sizeof(*verts), __func__);
+  for (int y = 0; y < grid_size; y++) {
+    for (int x = 0; x < grid_size; x++) {
+      float *co = verts[y * grid_size + x];
+      co[0] = (float)x / (float)grid_size;
+      co[1] = (float)y / (float)grid_size;
+      co[2] = BLI_rng_get_float(rng) * 0.01f;
+    }
+  }
+
+  int tri = 0;
+  for (int y = 0; y < grid_size - 1; y++) {
+    for (int x = 0; x < grid_size - 1; x++) {
+      const int v = y * grid_size + x;
+      copy_v3_v3(tris[tri][0], verts[v]);
+      copy_v3_v3(tris[tri][1], verts[v + 1]);
+      copy_v3_v3(tris[tri][2], verts[v + grid_size]);
+      tri++;
+      copy_v3_v3(tris[tri][0], verts[v + 1]);
+      copy_v3_v3(tris[tri][1], verts[v + grid_size + 1]);
+      copy_v3_v3(tris[tri][2], verts[v + grid_size]);
+      tri++;
+    }
+  }
+
+  MEM_freeN(verts);
+  BLI_rng_free(rng);
+  return tris;
+}
+
+static BVHTree *grid_bvhtree_create(float (*tris)[3][3], const int tris_len, const int tree_type)
+{
+  BVHTree *tree = BLI_bvhtree_new(tris_len, 0.0f, (char)tree_type, 6);
+  for (int i = 0; i < tris_len; i++) {
+    BLI_bvhtree_insert(tree, i, &tris[i][0][0], 3);
+  }
+  BLI_bvhtree_balance(tree);
+  return tree;
+}
+
+static void kdopbvh_build_test(const char *id, const int grid_size, const int tree_type)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  const int tris_len = (grid_size - 1) * (grid_size - 1) * 2;
+  float(*tris)[3][3] = grid_triangles_create(grid_size, 0);
+
+  double averaged_timing = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    const double init_time = PIL_check_seconds_timer();
+    BVHTree *tree = grid_bvhtree_create(tris, tris_len, tree_type);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+
+    EXPECT_EQ(BLI_bvhtree_get_len(tree), tris_len);
+    BLI_bvhtree_free(tree);
+  }
+
+  blender::tests::record_performance("build", averaged_timing / NUM_RUN_AVERAGED);
+
+  MEM_freeN(tris);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+static void kdopbvh_query_test(const char *id, const int grid_size, const int queries_len)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  const int tris_len = (grid_size - 1) * (grid_size - 1) * 2;
+  float(*tris)[3][3] = grid_triangles_create(grid_size, 0);
+  BVHTree *tree = grid_bvhtree_create(tris, tris_len, 2);
+
+  struct RNG *rng = BLI_rng_new(1);
+  float(*points)[3] = (float(*)[3])MEM_malloc_arrayN(queries_len, sizeof(*points), __func__);
+  for (int i = 0; i < queries_len; i++) {
+    points[i][0] = BLI_rng_get_float(rng);
+    points[i][1] = BLI_rng_get_float(rng);
+    points[i][2] = BLI_rng_get_float(rng) * 0.1f;
+  }
+
+  /* Without callbacks leaf bounds are used, which measures the tree traversal only. */
+  int hits = 0;
+  double start_time = PIL_check_seconds_timer();
+  for (int i = 0; i < queries_len; i++) {
+    BVHTreeNearest nearest;
+    nearest.index = -1;
+    nearest.dist_sq = FLT_MAX;
+    hits += (BLI_bvhtree_find_nearest(tree, points[i], &nearest, NULL, NULL) != -1);
+  }
+  blender::tests::record_performance("find_nearest", PIL_check_seconds_timer() - start_time);
+  EXPECT_EQ(hits, queries_len);
+
+  const float dir[3] = {0.0f, 0.0f, -1.0f};
+  hits = 0;
+  start_time = PIL_check_seconds_timer();
+  for (int i = 0; i < queries_len; i++) {
+    BVHTreeRayHit hit;
+    hit.index = -1;
+    hit.dist = BVH_RAYCAST_DIST_MAX;
+    hits += (BLI_bvhtree_ray_cast(tree, points[i], dir, 0.0f, &hit, NULL, NULL) != -1);
+  }
+  blender::tests::record_performance("ray_cast", PIL_check_seconds_timer() - start_time);
+  EXPECT_GT(hits, 0);
+
+  MEM_freeN(points);
+  BLI_rng_free(rng);
+  BLI_bvhtree_free(tree);
+  MEM_freeN(tris);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdopbvh, Build4Tree250k)
+{
+  kdopbvh_build_test("BVH build - 4-tree - 250k triangles", 354, 4);
+}
+
+TEST(kdopbvh, Build2Tree250k)
+{
+  kdopbvh_build_test("BVH build - 2-tree - 250k triangles", 354, 2);
+}
+
+TEST(kdopbvh, Query250k)
+{
+  kdopbvh_query_test("BVH query - 250k triangles - 100k queries", 354, 100000);
+}
@@ -129,10 +129,7 @@ static void task_listbase_test_do(ListBase *list,
     *num_items_tmp = num_items;
   }
 
-  printf("\t%s: done in %fs on average over %d runs\n",
-         id,
-         averaged_timing / NUM_RUN_AVERAGED,
-         NUM_RUN_AVERAGED);
+  blender::tests::record_performance(id, averaged_timing / NUM_RUN_AVERAGED);
 }
 
 static void task_listbase_test(const char *id, const int nbr, const bool use_threads)
@@ -154,7 +151,7 @@ static void task_listbase_test(const char *id, const int nbr, const bool use_thr
   task_listbase_test_do(&list,
                         num_items,
                         &num_items_tmp,
-                        "Light iter",
+                        "light_iter",
                         task_listbase_light_iter_func,
                         use_threads,
                         false);
@@ -162,7 +159,7 @@ static void task_listbase_test(const char *id, const int nbr, const bool use_thr
   task_listbase_test_do(&list,
                         num_items,
                         &num_items_tmp,
-                        "Light iter with mem barrier",
+                        "light_iter_membarrier",
                         task_listbase_light_membarrier_iter_func,
                         use_threads,
                         true);
@@ -170,7 +167,7 @@ static void task_listbase_test(const char *id, const int nbr, const bool use_thr
   task_listbase_test_do(&list,
                         num_items,
                         &num_items_tmp,
-                        "Heavy iter",
+                        "heavy_iter",
                         task_listbase_heavy_iter_func,
                         use_threads,
                         false);
@@ -178,7 +175,7 @@ static void task_listbase_test(const char *id, const int nbr, const bool use_thr
   task_listbase_test_do(&list,
                         num_items,
                         &num_items_tmp,
-                        "Heavy iter with mem barrier",
+                        "heavy_iter_membarrier",
                         task_listbase_heavy_membarrier_iter_func,
                         use_threads,
                         true);
@@ -208,3 +205,117 @@ TEST(task, ListBaseIter100k)
 {
   task_listbase_test("ListBase parallel iteration - Threaded - 100000 items", 100000, true);
 }
+
+/* *** Memory bandwidth bound iterations, with and without NUMA arenas. *** */
+
+#define NUMA_NUM_FLOATS (64 * 1024 * 1024)
+
+typedef struct NumaNodeData {
+  int numa_node;
+  float *buffer;
+  int num_floats;
+} NumaNodeData;
+
+static void task_numa_fill_func(void *__restrict userdata,
+                                const int index,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  NumaNodeData *data = (NumaNodeData *)userdata;
+  data->buffer[index] = (float)(index % 1024);
+}
+
+static void task_numa_scale_func(void *__restrict userdata,
+                                 const int index,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  NumaNodeData *data = (NumaNodeData *)userdata;
+  data->buffer[index] = data->buffer[index] * 0.5f + 1.0f;
+}
+
+static void task_numa_node_run(void *userdata)
+{
+  NumaNodeData *data = (NumaNodeData *)userdata;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 64 * 1024;
+
+  /* First touch from the threads of the node also places memory there without NUMA memory. */
+  BLI_task_parallel_range(0, data->num_floats, data, task_numa_fill_func, &settings);
+
+  for (int i = 0; i < 10; i++) {
+    BLI_task_parallel_range(0, data->num_floats, data, task_numa_scale_func, &settings);
+  }
+}
+
+static void task_numa_node_pool_func(TaskPool *__restrict pool, void *UNUSED(taskdata))
+{
+  NumaNodeData *data = (NumaNodeData *)BLI_task_pool_user_data(pool);
+  task_numa_node_run(data);
+}
+
+static void task_numa_test(const char *id, const bool use_numa)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  if (use_numa) {
+    BLI_task_scheduler_numa_enable();
+  }
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  const int num_nodes = BLI_task_scheduler_num_numa_nodes();
+  const int num_floats = NUMA_NUM_FLOATS / num_nodes;
+  printf("\t%d NUMA node(s)\n", num_nodes);
+
+  NumaNodeData *nodes = (NumaNodeData *)MEM_calloc_arrayN(num_nodes, sizeof(*nodes), __func__);
+  for (int node = 0; node < num_nodes; node++) {
+    nodes[node].numa_node = node;
+    nodes[node].num_floats = num_floats;
+    nodes[node].buffer = (float *)BLI_task_numa_malloc(
+        sizeof(float) * (size_t)num_floats, node, __func__);
+  }
+
+  double averaged_timing = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED / 10; i++) {
+    const double init_time = PIL_check_seconds_timer();
+
+    /* One pool per node, each running the work of its node in parallel. */
+    TaskPool **pools = (TaskPool **)MEM_calloc_arrayN(num_nodes, sizeof(*pools), __func__);
+    for (int node = 0; node < num_nodes; node++) {
+      pools[node] = BLI_task_pool_create_numa(&nodes[node], TASK_PRIORITY_HIGH, node);
+      BLI_task_pool_push(pools[node], task_numa_node_pool_func, NULL, false, NULL);
+    }
+    for (int node = 0; node < num_nodes; node++) {
+      BLI_task_pool_work_and_wait(pools[node]);
+      BLI_task_pool_free(pools[node]);
+    }
+    MEM_freeN(pools);
+
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+  }
+
+  for (int node = 0; node < num_nodes; node++) {
+    EXPECT_GT(nodes[node].buffer[num_floats - 1], 0.0f);
+    BLI_task_numa_free(nodes[node].buffer, sizeof(float) * (size_t)num_floats);
+  }
+  MEM_freeN(nodes);
+
+  blender::tests::record_performance("numa_bandwidth",
+                                     averaged_timing / (NUM_RUN_AVERAGED / 10));
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(task, NumaGlobalArena)
+{
+  task_numa_test("NUMA bandwidth - Global arena", false);
+}
+
+TEST(task, NumaNodeArenas)
+{
+  task_numa_test("NUMA bandwidth - Arena per node", true);
+}
@@ -35,6 +35,7 @@
 #include "BLI_utildefines.h"
 
 #include "BKE_action.h"
+#include "BKE_animsys.h"
 
 #include "intern/builder/deg_builder_cache.h"
 #include "intern/builder/deg_builder_remove_noop.h"
@@ -224,7 +225,11 @@ void deg_graph_build_finalize(Main *bmain, Depsgraph *graph)
     if (id_node->customdata_masks != id_node->previous_customdata_masks) {
       flag |= ID_RECALC_GEOMETRY;
     }
-    if (!deg_copy_on_write_is_expanded(id_node->id_cow)) {
+    if (deg_copy_on_write_is_expanded(id_node->id_cow)) {
+      /* Resolved RNA paths of animation can point to data which got renamed or removed. */
+      BKE_animsys_rna_path_cache_clear(id_node->id_cow);
+    }
+    else {
       flag |= ID_RECALC_COPY_ON_WRITE;
       /* This means ID is being added to the dependency graph first
        * time, which is similar to "ob-visible-change" */
@@ -43,6 +43,16 @@ typedef void *(*MovieCacheGetPriorityDataFP)(void *userkey);
 typedef int (*MovieCacheGetItemPriorityFP)(void *last_userkey, void *priority_data);
 typedef void (*MovieCachePriorityDeleterFP)(void *priority_data);
 
+typedef struct MovieCacheStats {
+  /* Lookups which found a buffer and lookups which did not. */
+  uint64_t hits, misses;
+  /* Buffers added to the cache and buffers freed by the memory limiter. */
+  uint64_t puts, recycled;
+  /* Buffers currently in the cache. */
+  size_t memory_used;
+  int item_count;
+} MovieCacheStats;
+
 void IMB_moviecache_init(void);
 void IMB_moviecache_destruct(void);
 
@@ -63,6 +73,7 @@ struct ImBuf *IMB_moviecache_get(struct MovieCache *cache, void *userkey);
 void IMB_moviecache_remove(struct MovieCache *cache, void *userkey);
 bool IMB_moviecache_has_frame(struct MovieCache *cache, void *userkey);
 void IMB_moviecache_free(struct MovieCache *cache);
+void IMB_moviecache_get_stats(struct MovieCache *cache, MovieCacheStats *r_stats);
 
 void IMB_moviecache_cleanup(struct MovieCache *cache,
                             bool(cleanup_check_cb)(struct ImBuf *ibuf,
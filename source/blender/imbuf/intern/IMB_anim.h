@@ -136,6 +136,14 @@ struct anim {
   int64_t last_pts;
   int64_t next_pts;
   AVPacket next_packet;
+
+  /* Decoding time-stamp of the last video packet sent to the decoder, -1 when not known. */
+  int64_t next_packet_dts;
+
+  /* Sorted time-stamps of key-frames, taken from container index when file is opened.
+   * Used to avoid seeking when no timecode index is available. */
+  int64_t *keyframe_dts;
+  int keyframe_dts_len;
 #endif
 
   char index_dir[768];
@@ -53,8 +53,10 @@
 #  include <io.h>
 #endif
 
+#include "BLI_math_base.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "MEM_guardedalloc.h"
@@ -500,11 +502,92 @@ static ImBuf *avi_fetchibuf(struct anim *anim, int position)
 
 #ifdef WITH_FFMPEG
 
+/* Maximum number of threads used by the decoder of each movie. */
+#  define FFMPEG_DECODE_THREADS_MAX 8
+
 BLI_INLINE bool need_aligned_ffmpeg_buffer(struct anim *anim)
 {
   return (anim->x & 31) != 0;
 }
 
+/* Collect time-stamps of key-frames from index of the container (if it has one), so we know
+ * where decoding can start without reading the whole stream.
+ *
+ * Index entries of mp4/mov are decoding time-stamps, other containers like mkv use presentation
+ * time-stamps. These differ when there are B-frames, key-frames are decoded before they're
+ * presented. Either way an entry is never before the DTS of its key-frame, see
+ * ffmpeg_keyframe_index_can_scan() for how that's used. */
+static void ffmpeg_keyframe_index_build(struct anim *anim, AVStream *video_stream)
+{
+  int len = 0;
+
+  anim->keyframe_dts = NULL;
+  anim->keyframe_dts_len = 0;
+
+  if (video_stream->nb_index_entries <= 0) {
+    return;
+  }
+
+  anim->keyframe_dts = MEM_malloc_arrayN(
+      video_stream->nb_index_entries, sizeof(*anim->keyframe_dts), "ffmpeg keyframe index");
+
+  for (int i = 0; i < video_stream->nb_index_entries; i++) {
+    const AVIndexEntry *entry = &video_stream->index_entries[i];
+
+    if (entry->flags & AVINDEX_KEYFRAME) {
+      /* Entries are sorted by time-stamp. */
+      anim->keyframe_dts[len++] = entry->timestamp;
+    }
+  }
+
+  if (len == 0) {
+    MEM_SAFE_FREE(anim->keyframe_dts);
+  }
+
+  anim->keyframe_dts_len = len;
+}
+
+/* Time-stamp of last key-frame at or before the time-stamp, -1 when not known. */
+static int64_t ffmpeg_keyframe_index_find(struct anim *anim, int64_t timestamp)
+{
+  int64_t *keyframes = anim->keyframe_dts;
+  int low = 0;
+  int high = anim->keyframe_dts_len - 1;
+  int64_t result = -1;
+
+  while (low <= high) {
+    int mid = (low + high) / 2;
+
+    if (keyframes[mid] <= timestamp) {
+      result = keyframes[mid];
+      low = mid + 1;
+    }
+    else {
+      high = mid - 1;
+    }
+  }
+
+  return result;
+}
+
+/* When there is no key-frame between currently decoded frame and searched frame, seeking would
+ * only bring us back to the same or an earlier key-frame, so it is faster to continue decoding.
+ *
+ * Packets are compared in decoding order. The DTS of the searched frame is not known, but it's
+ * at most its PTS, so the last key-frame up to that PTS is the key-frame of the searched frame
+ * or a later one. Scanning is only chosen when the decoder already got past that key-frame, so
+ * mixing up time-stamps of the index can only cause a seek that wasn't needed. */
+static bool ffmpeg_keyframe_index_can_scan(struct anim *anim, int64_t pts_to_search)
+{
+  if (anim->keyframe_dts_len == 0 || anim->next_packet_dts < 0 || anim->next_pts < 0 ||
+      anim->next_pts > pts_to_search) {
+    return false;
+  }
+
+  int64_t keyframe_ts = ffmpeg_keyframe_index_find(anim, pts_to_search);
+  return keyframe_ts != -1 && keyframe_ts <= anim->next_packet_dts;
+}
+
 static int startffmpeg(struct anim *anim)
 {
   int i, video_stream_index;
@@ -573,6 +656,12 @@ static int startffmpeg(struct anim *anim)
 
   pCodecCtx->workaround_bugs = 1;
 
+  /* Frame threading is most efficient for long-GOP codecs, slice threading is used by intra-only
+   * codecs. Thread count is capped since the sequencer decodes multiple strips at once, and every
+   * frame thread adds a frame of delay to the decoder output. */
+  pCodecCtx->thread_count = min_ii(BLI_system_thread_count(), FFMPEG_DECODE_THREADS_MAX);
+  pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
   if (avcodec_open2(pCodecCtx, pCodec, NULL) < 0) {
     avformat_close_input(&pFormatCtx);
     return -1;
@@ -639,8 +728,11 @@ static int startffmpeg(struct anim *anim)
   anim->last_frame = 0;
   anim->last_pts = -1;
   anim->next_pts = -1;
+  anim->next_packet_dts = -1;
   anim->next_packet.stream_index = -1;
 
+  ffmpeg_keyframe_index_build(anim, video_stream);
+
   anim->pFrame = av_frame_alloc();
   anim->pFrameComplete = false;
   anim->pFrameDeinterlaced = av_frame_alloc();
@@ -902,6 +994,9 @@ static int ffmpeg_decode_video_frame(struct anim *anim)
            (anim->next_packet.flags & AV_PKT_FLAG_KEY) ? " KEY" : "");
     if (anim->next_packet.stream_index == anim->videoStream) {
       anim->pFrameComplete = 0;
+      anim->next_packet_dts = (anim->next_packet.dts == AV_NOPTS_VALUE) ?
+                                  -1 :
+                                  anim->next_packet.dts;
 
       avcodec_decode_video2(
           anim->pCodecCtx, anim->pFrame, &anim->pFrameComplete, &anim->next_packet);
@@ -1123,6 +1218,15 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
 
     ffmpeg_decode_video_frame_scan(anim, pts_to_search);
   }
+  else if (!tc_index && position != anim->curposition + 1 &&
+           ffmpeg_keyframe_index_can_scan(anim, pts_to_search)) {
+    av_log(anim->pFormatCtx,
+           AV_LOG_DEBUG,
+           "FETCH: no key-frame before searched frame "
+           "(key-frame index tells us)\n");
+
+    ffmpeg_decode_video_frame_scan(anim, pts_to_search);
+  }
   else if (position != anim->curposition + 1) {
     long long pos;
     int ret;
@@ -1184,6 +1288,7 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
     avcodec_flush_buffers(anim->pCodecCtx);
 
     anim->next_pts = -1;
+    anim->next_packet_dts = -1;
 
     if (anim->next_packet.stream_index == anim->videoStream) {
       av_free_packet(&anim->next_packet);
@@ -1276,6 +1381,8 @@ static void free_anim_ffmpeg(struct anim *anim)
     if (anim->next_packet.stream_index != -1) {
       av_free_packet(&anim->next_packet);
     }
+    MEM_SAFE_FREE(anim->keyframe_dts);
+    anim->keyframe_dts_len = 0;
   }
   anim->duration_in_frames = 0;
 }
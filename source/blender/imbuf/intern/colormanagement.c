@@ -42,11 +42,14 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_blenlib.h"
 #include "BLI_math.h"
 #include "BLI_math_color.h"
 #include "BLI_rect.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_appdir.h"
@@ -66,6 +69,15 @@
 
 #define DISPLAY_BUFFER_CHANNELS 4
 
+/* Display transform baked into a 3D LUT, used when creating byte display buffers of large
+ * images. Grid is spaced logarithmically between 0 and DISPLAY_LUT_MAX, pixels outside of
+ * this range go through the OCIO processor. */
+#define DISPLAY_LUT_SIZE 65
+#define DISPLAY_LUT_MAX 64.0f
+#define DISPLAY_LUT_OFFSET (1.0f / 1024.0f)
+/* Minimal number of pixels for which baking the LUT is worth it. */
+#define DISPLAY_LUT_MIN_PIXELS (4 * DISPLAY_LUT_SIZE * DISPLAY_LUT_SIZE * DISPLAY_LUT_SIZE)
+
 /* ** list of all supported color spaces, displays and views */
 static char global_role_data[MAX_COLORSPACE_NAME];
 static char global_role_scene_linear[MAX_COLORSPACE_NAME];
@@ -99,12 +111,40 @@ static float imbuf_linear_srgb_to_xyz[3][3] = {{0.0f}};
  */
 static pthread_mutex_t processor_lock = BLI_MUTEX_INITIALIZER;
 
+/* Display transform baked into a 3D LUT, see display_lut_acquire(). */
+typedef struct DisplayLUT {
+  /* Settings of the processor baked into the LUT. */
+  char look[MAX_COLORSPACE_NAME];
+  char view[MAX_COLORSPACE_NAME];
+  char display[MAX_COLORSPACE_NAME];
+  float exposure, gamma;
+
+  /* Processors using the LUT, and the global state while it's the last baked one. */
+  int users;
+
+  /* RGB triplets. */
+  float *data;
+} DisplayLUT;
+
 typedef struct ColormanageProcessor {
   OCIO_ConstProcessorRcPtr *processor;
   CurveMapping *curve_mapping;
   bool is_data_result;
+  /* OCIO processor baked into a LUT, used instead of the processor when set. */
+  DisplayLUT *display_lut;
 } ColormanageProcessor;
 
+/* Last baked display LUT, re-used while display settings stay the same. Baking takes longer
+ * than applying the LUT to a large image, so it's not done again for every display buffer
+ * update, e.g. while painting or playing back a sequence. */
+static struct global_display_lut_state {
+  DisplayLUT *lut;
+} global_display_lut_state = {NULL};
+
+static pthread_mutex_t display_lut_lock = BLI_MUTEX_INITIALIZER;
+
+static void display_lut_release(DisplayLUT *lut);
+
 static struct global_glsl_state {
   /* Actual processor used for GLSL baked LUTs. */
   /* UI colorspace here refers to the display linear color space,
@@ -178,8 +218,17 @@ static struct global_color_picking_state {
  *      shouldn't lead extra buffers adding to cache, it shall
  *      invalidate cached images.
  *
- *      Currently such a data contains only exposure and gamma, but
- *      would likely extended further.
+ *      Look and view flags are part of the cache key, so switching
+ *      between them re-uses buffers which were already calculated.
+ *      Exposure, gamma, dither and curve mapping are stored in the data
+ *      and invalidate buffers: these are changed continuously by dragging
+ *      sliders, and every value would add a full size buffer to the cache.
+ *
+ *      Data also contains generation of the original image buffer at the
+ *      moment display buffer was calculated. Generation is increased every
+ *      time display buffers of an image buffer are marked as invalid, so
+ *      buffers calculated for other looks and exposures before the image
+ *      buffer was modified are not used.
  *
  *      data field is not null only for elements of cache, not used for
  *      original image buffers.
@@ -225,22 +274,26 @@ typedef struct ColormanageCacheDisplaySettings {
 typedef struct ColormanageCacheKey {
   int view;    /* view transformation used for display buffer */
   int display; /* display device name */
+  int look;    /* additional artistic transform */
+  int flag;    /* view flags */
 } ColormanageCacheKey;
 
 typedef struct ColormanageCacheData {
-  int flag;                    /* view flags of cached buffer */
-  int look;                    /* Additional artistics transform */
   float exposure;              /* exposure value cached buffer is calculated with */
   float gamma;                 /* gamma value cached buffer is calculated with */
   float dither;                /* dither value cached buffer is calculated with */
   CurveMapping *curve_mapping; /* curve mapping used for cached buffer */
   int curve_mapping_timestamp; /* time stamp of curve mapping used for cached buffer */
+  unsigned int generation;     /* generation of original buffer cached buffer is calculated for */
 } ColormanageCacheData;
 
 typedef struct ColormanageCache {
   struct MovieCache *moviecache;
 
   ColormanageCacheData *data;
+
+  /* Increased every time display buffers are invalidated, see cache implementation notes. */
+  unsigned int generation;
 } ColormanageCache;
 
 static struct MovieCache *colormanage_moviecache_get(const ImBuf *ibuf)
@@ -267,6 +320,8 @@ static unsigned int colormanage_hashhash(const void *key_v)
 
   unsigned int rval = (key->display << 16) | (key->view % 0xffff);
 
+  rval ^= ((unsigned int)key->look << 24) ^ ((unsigned int)key->flag << 8);
+
   return rval;
 }
 
@@ -275,7 +330,8 @@ static bool colormanage_hashcmp(const void *av, const void *bv)
   const ColormanageCacheKey *a = av;
   const ColormanageCacheKey *b = bv;
 
-  return ((a->view != b->view) || (a->display != b->display));
+  return ((a->view != b->view) || (a->display != b->display) || (a->look != b->look) ||
+          (a->flag != b->flag));
 }
 
 static struct MovieCache *colormanage_moviecache_ensure(ImBuf *ibuf)
@@ -338,6 +394,18 @@ static void colormanage_settings_to_key(ColormanageCacheKey *key,
 {
   key->view = view_settings->view;
   key->display = display_settings->display;
+  key->look = view_settings->look;
+  key->flag = view_settings->flag;
+}
+
+/* Mark all display buffers of the image buffer as outdated. */
+static void colormanage_cache_invalidate(ImBuf *ibuf)
+{
+  memset(ibuf->display_buffer_flags, 0, global_tot_display * sizeof(unsigned int));
+
+  if (ibuf->colormanage_cache) {
+    ibuf->colormanage_cache->generation++;
+  }
 }
 
 static ImBuf *colormanage_cache_get_ibuf(ImBuf *ibuf,
@@ -388,24 +456,27 @@ static unsigned char *colormanage_cache_get(
 
     BLI_assert(cache_ibuf->x == ibuf->x && cache_ibuf->y == ibuf->y);
 
-    /* only buffers with different color space conversions are being stored
-     * in cache separately. buffer which were used only different exposure/gamma
-     * are re-suing the same cached buffer
+    /* buffers with different looks or view flags are stored in cache separately.
+     * buffers which were used only different exposure/gamma/dither/curve are re-using
+     * the same cached buffer
      *
-     * check here which exposure/gamma/curve was used for cached buffer and if they're
+     * check here which exposure/gamma/dither/curve was used for cached buffer and if they're
      * different from requested buffer should be re-generated
      */
     cache_data = colormanage_cachedata_get(cache_ibuf);
 
-    if (cache_data->look != view_settings->look ||
-        cache_data->exposure != view_settings->exposure ||
+    if (cache_data->exposure != view_settings->exposure ||
         cache_data->gamma != view_settings->gamma || cache_data->dither != view_settings->dither ||
-        cache_data->flag != view_settings->flag || cache_data->curve_mapping != curve_mapping ||
-        cache_data->curve_mapping_timestamp != curve_mapping_timestamp) {
+        cache_data->curve_mapping != curve_mapping ||
+        cache_data->curve_mapping_timestamp != curve_mapping_timestamp ||
+        cache_data->generation != ibuf->colormanage_cache->generation) {
       *cache_handle = NULL;
 
       IMB_freeImBuf(cache_ibuf);
 
+      /* Outdated buffer would never be used again. */
+      IMB_moviecache_remove(ibuf->colormanage_cache->moviecache, &key);
+
       return NULL;
     }
 
@@ -444,13 +515,12 @@ static void colormanage_cache_put(ImBuf *ibuf,
   /* Store data which is needed to check whether cached buffer
    * could be used for color managed display settings. */
   cache_data = MEM_callocN(sizeof(ColormanageCacheData), "color manage cache imbuf data");
-  cache_data->look = view_settings->look;
   cache_data->exposure = view_settings->exposure;
   cache_data->gamma = view_settings->gamma;
   cache_data->dither = view_settings->dither;
-  cache_data->flag = view_settings->flag;
   cache_data->curve_mapping = curve_mapping;
   cache_data->curve_mapping_timestamp = curve_mapping_timestamp;
+  cache_data->generation = ibuf->colormanage_cache->generation;
 
   colormanage_cachedata_set(cache_ibuf, cache_data);
 
@@ -754,8 +824,13 @@ void colormanagement_exit(void)
     OCIO_processorRelease(global_color_picking_state.processor_from);
   }
 
+  if (global_display_lut_state.lut) {
+    display_lut_release(global_display_lut_state.lut);
+  }
+
   memset(&global_glsl_state, 0, sizeof(global_glsl_state));
   memset(&global_color_picking_state, 0, sizeof(global_color_picking_state));
+  memset(&global_display_lut_state, 0, sizeof(global_display_lut_state));
 
   colormanage_free_config();
 }
@@ -1650,6 +1725,205 @@ static void display_buffer_apply_get_linear_buffer(DisplayBufferThread *handle,
   }
 }
 
+BLI_INLINE float display_lut_shaper_scale(void)
+{
+  return (DISPLAY_LUT_SIZE - 1) /
+         (log2f(DISPLAY_LUT_MAX + DISPLAY_LUT_OFFSET) - log2f(DISPLAY_LUT_OFFSET));
+}
+
+static void display_lut_bake_slice(void *__restrict userdata,
+                                   const int b,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ColormanageProcessor *cm_processor = (ColormanageProcessor *)userdata;
+  const float scale = display_lut_shaper_scale();
+  const float offset_log = log2f(DISPLAY_LUT_OFFSET);
+  float *slice = cm_processor->display_lut->data + 3 * b * DISPLAY_LUT_SIZE * DISPLAY_LUT_SIZE;
+  float grid[DISPLAY_LUT_SIZE];
+  OCIO_PackedImageDesc *img;
+
+  for (int i = 0; i < DISPLAY_LUT_SIZE; i++) {
+    grid[i] = exp2f(i / scale + offset_log) - DISPLAY_LUT_OFFSET;
+  }
+  grid[0] = 0.0f;
+
+  for (int g = 0; g < DISPLAY_LUT_SIZE; g++) {
+    for (int r = 0; r < DISPLAY_LUT_SIZE; r++) {
+      float *rgb = slice + 3 * (g * DISPLAY_LUT_SIZE + r);
+      rgb[0] = grid[r];
+      rgb[1] = grid[g];
+      rgb[2] = grid[b];
+    }
+  }
+
+  img = OCIO_createOCIO_PackedImageDesc(slice,
+                                        DISPLAY_LUT_SIZE,
+                                        DISPLAY_LUT_SIZE,
+                                        3,
+                                        sizeof(float),
+                                        3 * sizeof(float),
+                                        3 * sizeof(float) * DISPLAY_LUT_SIZE);
+  OCIO_processorApply(cm_processor->processor, img);
+  OCIO_PackedImageDescRelease(img);
+}
+
+static bool display_lut_matches(const DisplayLUT *lut,
+                                const ColorManagedViewSettings *view_settings,
+                                const ColorManagedDisplaySettings *display_settings)
+{
+  return (lut->exposure == view_settings->exposure && lut->gamma == view_settings->gamma &&
+          STREQ(lut->look, view_settings->look) &&
+          STREQ(lut->view, view_settings->view_transform) &&
+          STREQ(lut->display, display_settings->display_device));
+}
+
+static void display_lut_release(DisplayLUT *lut)
+{
+  if (atomic_sub_and_fetch_int32(&lut->users, 1) == 0) {
+    MEM_freeN(lut->data);
+    MEM_freeN(lut);
+  }
+}
+
+/* Use the OCIO processor baked into a 3D LUT, so display buffers are calculated with a few
+ * lookups per pixel instead of running the whole OCIO transform chain. The LUT is only baked
+ * when the settings differ from the last baked one. The curve mapping isn't part of the LUT,
+ * it's applied per pixel. */
+static void display_lut_acquire(ColormanageProcessor *cm_processor,
+                                const ColorManagedViewSettings *view_settings,
+                                const ColorManagedDisplaySettings *display_settings)
+{
+  const size_t lut_len = DISPLAY_LUT_SIZE * DISPLAY_LUT_SIZE * DISPLAY_LUT_SIZE;
+  TaskParallelSettings settings;
+  DisplayLUT *lut;
+
+  BLI_mutex_lock(&display_lut_lock);
+  lut = global_display_lut_state.lut;
+  if (lut && display_lut_matches(lut, view_settings, display_settings)) {
+    atomic_add_and_fetch_int32(&lut->users, 1);
+    cm_processor->display_lut = lut;
+    BLI_mutex_unlock(&display_lut_lock);
+    return;
+  }
+  BLI_mutex_unlock(&display_lut_lock);
+
+  /* Bake without holding the lock, tasks of this thread may need it meanwhile. */
+  lut = MEM_callocN(sizeof(DisplayLUT), "display transform lut");
+  BLI_strncpy(lut->look, view_settings->look, MAX_COLORSPACE_NAME);
+  BLI_strncpy(lut->view, view_settings->view_transform, MAX_COLORSPACE_NAME);
+  BLI_strncpy(lut->display, display_settings->display_device, MAX_COLORSPACE_NAME);
+  lut->exposure = view_settings->exposure;
+  lut->gamma = view_settings->gamma;
+  lut->users = 2;
+  lut->data = MEM_mallocN(sizeof(float[3]) * lut_len, "display transform lut data");
+  cm_processor->display_lut = lut;
+
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, DISPLAY_LUT_SIZE, cm_processor, display_lut_bake_slice, &settings);
+
+  BLI_mutex_lock(&display_lut_lock);
+  if (global_display_lut_state.lut) {
+    display_lut_release(global_display_lut_state.lut);
+  }
+  global_display_lut_state.lut = lut;
+  BLI_mutex_unlock(&display_lut_lock);
+}
+
+/* Tetrahedral interpolation in the baked LUT. */
+static void display_lut_apply_v3(ColormanageProcessor *cm_processor, float rgb[3])
+{
+  const float scale = display_lut_shaper_scale();
+  const float offset_log = log2f(DISPLAY_LUT_OFFSET);
+  const int stride[3] = {3, 3 * DISPLAY_LUT_SIZE, 3 * DISPLAY_LUT_SIZE * DISPLAY_LUT_SIZE};
+  float f[3];
+  int index = 0;
+
+  for (int i = 0; i < 3; i++) {
+    /* Written this way to catch NaN as well. */
+    if (!(rgb[i] >= 0.0f && rgb[i] <= DISPLAY_LUT_MAX)) {
+      OCIO_processorApplyRGB(cm_processor->processor, rgb);
+      return;
+    }
+
+    const float t = (log2f(rgb[i] + DISPLAY_LUT_OFFSET) - offset_log) * scale;
+    const int i0 = min_ii((int)t, DISPLAY_LUT_SIZE - 2);
+
+    f[i] = t - i0;
+    index += i0 * stride[i];
+  }
+
+  /* Pick the tetrahedron containing the point, walking from the lower corner to the upper one
+   * along the axis with the largest fraction first. */
+  int axis_a, axis_b, axis_c;
+  if (f[0] >= f[1]) {
+    if (f[1] >= f[2]) {
+      axis_a = 0, axis_b = 1, axis_c = 2;
+    }
+    else if (f[0] >= f[2]) {
+      axis_a = 0, axis_b = 2, axis_c = 1;
+    }
+    else {
+      axis_a = 2, axis_b = 0, axis_c = 1;
+    }
+  }
+  else {
+    if (f[2] >= f[1]) {
+      axis_a = 2, axis_b = 1, axis_c = 0;
+    }
+    else if (f[2] >= f[0]) {
+      axis_a = 1, axis_b = 2, axis_c = 0;
+    }
+    else {
+      axis_a = 1, axis_b = 0, axis_c = 2;
+    }
+  }
+
+  const float *c0 = cm_processor->display_lut->data + index;
+  const float *c1 = c0 + stride[axis_a];
+  const float *c2 = c1 + stride[axis_b];
+  const float *c3 = c2 + stride[axis_c];
+  const float w0 = 1.0f - f[axis_a];
+  const float w1 = f[axis_a] - f[axis_b];
+  const float w2 = f[axis_b] - f[axis_c];
+  const float w3 = f[axis_c];
+
+  for (int i = 0; i < 3; i++) {
+    rgb[i] = w0 * c0[i] + w1 * c1[i] + w2 * c2[i] + w3 * c3[i];
+  }
+}
+
+/* Same as IMB_colormanagement_processor_apply, but uses baked LUT instead of OCIO processor. */
+static void display_lut_apply(ColormanageProcessor *cm_processor,
+                              float *buffer,
+                              int width,
+                              int height,
+                              int channels,
+                              bool predivide)
+{
+  const size_t i_last = ((size_t)width) * height;
+  size_t i;
+  float *fp;
+
+  BLI_assert(channels >= 3);
+
+  for (i = 0, fp = buffer; i != i_last; i++, fp += channels) {
+    if (cm_processor->curve_mapping) {
+      curve_mapping_apply_pixel(cm_processor->curve_mapping, fp, channels);
+    }
+
+    if (predivide && channels == 4 && fp[3] != 1.0f && fp[3] != 0.0f) {
+      const float alpha = fp[3];
+
+      mul_v3_fl(fp, 1.0f / alpha);
+      display_lut_apply_v3(cm_processor, fp);
+      mul_v3_fl(fp, alpha);
+    }
+    else {
+      display_lut_apply_v3(cm_processor, fp);
+    }
+  }
+}
+
 static void *do_display_buffer_apply_thread(void *handle_v)
 {
   DisplayBufferThread *handle = (DisplayBufferThread *)handle_v;
@@ -1701,6 +1975,9 @@ static void *do_display_buffer_apply_thread(void *handle_v)
        * only generate byte buffers
        */
     }
+    else if (cm_processor->display_lut) {
+      display_lut_apply(cm_processor, linear_buffer, width, height, channels, predivide);
+    }
     else {
       /* apply processor */
       IMB_colormanagement_processor_apply(
@@ -1827,6 +2104,12 @@ static void colormanage_display_buffer_process_ex(
 
   if (skip_transform == false) {
     cm_processor = IMB_colormanagement_display_processor_new(view_settings, display_settings);
+
+    /* Byte display buffer hides interpolation error of the LUT. */
+    if (display_buffer == NULL && cm_processor->processor && ibuf->channels >= 3 &&
+        ((size_t)ibuf->x) * ibuf->y >= DISPLAY_LUT_MIN_PIXELS) {
+      display_lut_acquire(cm_processor, view_settings, display_settings);
+    }
   }
 
   display_buffer_apply_threaded(ibuf,
@@ -2775,7 +3058,7 @@ unsigned char *IMB_display_buffer_acquire(ImBuf *ibuf,
     /* all display buffers were marked as invalid from other areas,
      * now propagate this flag to internal color management routines
      */
-    memset(ibuf->display_buffer_flags, 0, global_tot_display * sizeof(unsigned int));
+    colormanage_cache_invalidate(ibuf);
 
     ibuf->userflags &= ~IB_DISPLAY_BUFFER_INVALID;
   }
@@ -3671,9 +3954,14 @@ static void imb_partial_display_buffer_update_ex(
     buffer_width = ibuf->x;
 
     /* Mark all other buffers as invalid. */
-    memset(ibuf->display_buffer_flags, 0, global_tot_display * sizeof(unsigned int));
+    colormanage_cache_invalidate(ibuf);
     ibuf->display_buffer_flags[display_index] |= view_flag;
 
+    /* Buffer which is being updated stays valid. */
+    if (display_buffer) {
+      colormanage_cachedata_get(cache_handle)->generation = ibuf->colormanage_cache->generation;
+    }
+
     BLI_thread_unlock(LOCK_COLORMANAGE);
   }
 
@@ -3995,6 +4283,9 @@ void IMB_colormanagement_processor_free(ColormanageProcessor *cm_processor)
   if (cm_processor->processor) {
     OCIO_processorRelease(cm_processor->processor);
   }
+  if (cm_processor->display_lut) {
+    display_lut_release(cm_processor->display_lut);
+  }
 
   MEM_freeN(cm_processor);
 }
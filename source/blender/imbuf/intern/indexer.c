@@ -29,6 +29,7 @@
 #include "BLI_ghash.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 #ifdef _WIN32
 #  include "BLI_winstuff.h"
@@ -774,6 +775,11 @@ static IndexBuildContext *index_ffmpeg_create_context(struct anim *anim,
 
   context->iCodecCtx->workaround_bugs = 1;
 
+  /* Only slice threading is used, frame threading delays output of frames which would make
+   * packet positions stored in index not match decoded frames. */
+  context->iCodecCtx->thread_count = BLI_system_thread_count();
+  context->iCodecCtx->thread_type = FF_THREAD_SLICE;
+
   if (avcodec_open2(context->iCodecCtx, context->iCodec, NULL) < 0) {
     avformat_close_input(&context->iFormatCtx);
     MEM_freeN(context);
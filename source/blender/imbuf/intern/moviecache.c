@@ -35,11 +35,15 @@
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
+#include "BKE_global.h" /* G.debug */
+
 #include "IMB_moviecache.h"
 
 #include "IMB_imbuf.h"
 #include "IMB_imbuf_types.h"
 
+#include "atomic_ops.h"
+
 #ifdef DEBUG_MESSAGES
 #  if defined __GNUC__
 #    define PRINT(format, args...) printf(format, ##args)
@@ -74,7 +78,13 @@ typedef struct MovieCache {
   void *last_userkey;
 
   int totseg, *points, proxy, render_flags; /* for visual statistics optimization */
-  int pad;
+
+  /* Number of items which buffers were freed by the cache limiter, but which are still in the
+   * hash. Items of any cache can be destroyed when limits are enforced, so this is atomic. */
+  uint32_t unused_keys;
+
+  /* Statistics, see IMB_moviecache_get_stats(). */
+  uint64_t hits, misses, puts, recycled;
 } MovieCache;
 
 typedef struct MovieCacheKey {
@@ -136,6 +146,11 @@ static void check_unused_keys(MovieCache *cache)
 {
   GHashIterator gh_iter;
 
+  /* Avoid iterating the whole hash on every put when nothing was destroyed. */
+  if (atomic_fetch_and_and_uint32(&cache->unused_keys, 0) == 0) {
+    return;
+  }
+
   BLI_ghashIterator_init(&gh_iter, cache->hash);
 
   while (!BLI_ghashIterator_done(&gh_iter)) {
@@ -178,6 +193,9 @@ static void IMB_moviecache_destructor(void *p)
     item->ibuf = NULL;
     item->c_handle = NULL;
 
+    atomic_add_and_fetch_uint32(&cache->unused_keys, 1);
+    atomic_add_and_fetch_uint64(&cache->recycled, 1);
+
     /* force cached segments to be updated */
     if (cache->points) {
       MEM_freeN(cache->points);
@@ -334,6 +352,8 @@ static void do_moviecache_put(MovieCache *cache, void *userkey, ImBuf *ibuf, boo
 
   BLI_ghash_reinsert(cache->hash, key, item, moviecache_keyfree, moviecache_valfree);
 
+  atomic_add_and_fetch_uint64(&cache->puts, 1);
+
   if (cache->last_userkey) {
     memcpy(cache->last_userkey, userkey, cache->keysize);
   }
@@ -412,10 +432,14 @@ ImBuf *IMB_moviecache_get(MovieCache *cache, void *userkey)
 
       IMB_refImBuf(item->ibuf);
 
+      atomic_add_and_fetch_uint64(&cache->hits, 1);
+
       return item->ibuf;
     }
   }
 
+  atomic_add_and_fetch_uint64(&cache->misses, 1);
+
   return NULL;
 }
 
@@ -431,10 +455,55 @@ bool IMB_moviecache_has_frame(MovieCache *cache, void *userkey)
   return item != NULL;
 }
 
+void IMB_moviecache_get_stats(MovieCache *cache, MovieCacheStats *r_stats)
+{
+  GHashIterator gh_iter;
+
+  r_stats->hits = atomic_add_and_fetch_uint64(&cache->hits, 0);
+  r_stats->misses = atomic_add_and_fetch_uint64(&cache->misses, 0);
+  r_stats->puts = atomic_add_and_fetch_uint64(&cache->puts, 0);
+  r_stats->recycled = atomic_add_and_fetch_uint64(&cache->recycled, 0);
+  r_stats->memory_used = 0;
+  r_stats->item_count = 0;
+
+  BLI_mutex_lock(&limitor_lock);
+
+  GHASH_ITER (gh_iter, cache->hash) {
+    const MovieCacheItem *item = BLI_ghashIterator_getValue(&gh_iter);
+
+    if (item->ibuf) {
+      r_stats->memory_used += IMB_get_size_in_memory(item->ibuf);
+      r_stats->item_count++;
+    }
+  }
+
+  BLI_mutex_unlock(&limitor_lock);
+}
+
+static void moviecache_print_stats(MovieCache *cache)
+{
+  MovieCacheStats stats;
+
+  IMB_moviecache_get_stats(cache, &stats);
+
+  printf("Movie cache '%s': %d items, %.2f MB, %llu hits, %llu misses, %llu puts, %llu recycled\n",
+         cache->name,
+         stats.item_count,
+         (double)stats.memory_used / (1024.0 * 1024.0),
+         (unsigned long long)stats.hits,
+         (unsigned long long)stats.misses,
+         (unsigned long long)stats.puts,
+         (unsigned long long)stats.recycled);
+}
+
 void IMB_moviecache_free(MovieCache *cache)
 {
   PRINT("%s: cache '%s' free\n", __func__, cache->name);
 
+  if (G.debug & G_DEBUG) {
+    moviecache_print_stats(cache);
+  }
+
   BLI_ghash_free(cache->hash, moviecache_keyfree, moviecache_valfree);
 
   BLI_mempool_destroy(cache->keys_pool);
@@ -624,6 +624,21 @@ typedef struct FCurve {
   float color[3];
 
   float prev_norm_factor, prev_offset;
+
+  /**
+   * Runtime: index of the keyframe found by the last evaluation, only a hint to avoid searching
+   * the keyframes when the next evaluation falls within the same or the next segment.
+   * Evaluations of a shared action write it from multiple threads without synchronization, so
+   * it is racy and never trusted: it's validated against the keyframes before every use.
+   * Reset when reading files.
+   */
+  int eval_segment_hint;
+  /**
+   * Runtime: 1-based index of the slot of the F-Curve in the resolved RNA path cache of the
+   * evaluated ID animated by it, 0 when it has none. Actions can be shared by multiple IDs, so
+   * it is validated against the slot before use. Reset when copying and reading files.
+   */
+  int rna_path_cache_slot;
 } FCurve;
 
 /* user-editable flags/settings */
@@ -1093,6 +1108,8 @@ typedef struct AnimData {
 
   /** Runtime data, for depsgraph evaluation. */
   FCurve **driver_array;
+  /** Runtime data, resolved RNA paths of animated properties for depsgraph evaluation. */
+  struct AnimRNAPathCache *rna_path_cache;
 
   /* settings for animation evaluation */
   /** User-defined settings. */
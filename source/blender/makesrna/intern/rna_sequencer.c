@@ -1104,6 +1104,46 @@ static void rna_SequenceEditor_overlay_lock_set(PointerRNA *ptr, bool value)
   }
 }
 
+static int rna_SequenceEditor_cache_stat_clamp(uint64_t value)
+{
+  return (int)MIN2(value, INT_MAX);
+}
+
+static int rna_SequenceEditor_cache_hits_get(PointerRNA *ptr)
+{
+  SeqCacheStats stats;
+  BKE_sequencer_cache_stats_get((Scene *)ptr->owner_id, &stats);
+  return rna_SequenceEditor_cache_stat_clamp(stats.hits);
+}
+
+static int rna_SequenceEditor_cache_disk_hits_get(PointerRNA *ptr)
+{
+  SeqCacheStats stats;
+  BKE_sequencer_cache_stats_get((Scene *)ptr->owner_id, &stats);
+  return rna_SequenceEditor_cache_stat_clamp(stats.disk_hits);
+}
+
+static int rna_SequenceEditor_cache_misses_get(PointerRNA *ptr)
+{
+  SeqCacheStats stats;
+  BKE_sequencer_cache_stats_get((Scene *)ptr->owner_id, &stats);
+  return rna_SequenceEditor_cache_stat_clamp(stats.misses);
+}
+
+static int rna_SequenceEditor_cache_recycled_get(PointerRNA *ptr)
+{
+  SeqCacheStats stats;
+  BKE_sequencer_cache_stats_get((Scene *)ptr->owner_id, &stats);
+  return rna_SequenceEditor_cache_stat_clamp(stats.recycled);
+}
+
+static int rna_SequenceEditor_cache_memory_used_get(PointerRNA *ptr)
+{
+  SeqCacheStats stats;
+  BKE_sequencer_cache_stats_get((Scene *)ptr->owner_id, &stats);
+  return rna_SequenceEditor_cache_stat_clamp(stats.memory_used / (1024 * 1024));
+}
+
 static int rna_SequenceEditor_overlay_frame_get(PointerRNA *ptr)
 {
   Scene *scene = (Scene *)ptr->owner_id;
@@ -2035,6 +2075,36 @@ static void rna_def_editor(BlenderRNA *brna)
   RNA_def_property_ui_text(prop, "Proxy Directory", "");
   RNA_def_property_update(prop, NC_SPACE | ND_SPACE_SEQUENCER, "rna_SequenceEditor_update_cache");
 
+  /* cache statistics */
+
+  prop = RNA_def_property(srna, "cache_hits", PROP_INT, PROP_UNSIGNED);
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+  RNA_def_property_int_funcs(prop, "rna_SequenceEditor_cache_hits_get", NULL, NULL);
+  RNA_def_property_ui_text(prop, "Cache Hits", "Number of images found in memory cache");
+
+  prop = RNA_def_property(srna, "cache_disk_hits", PROP_INT, PROP_UNSIGNED);
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+  RNA_def_property_int_funcs(prop, "rna_SequenceEditor_cache_disk_hits_get", NULL, NULL);
+  RNA_def_property_ui_text(prop, "Disk Cache Hits", "Number of images found in disk cache");
+
+  prop = RNA_def_property(srna, "cache_misses", PROP_INT, PROP_UNSIGNED);
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+  RNA_def_property_int_funcs(prop, "rna_SequenceEditor_cache_misses_get", NULL, NULL);
+  RNA_def_property_ui_text(
+      prop, "Cache Misses", "Number of images that were not found in cache and had to be rendered");
+
+  prop = RNA_def_property(srna, "cache_recycled", PROP_INT, PROP_UNSIGNED);
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+  RNA_def_property_int_funcs(prop, "rna_SequenceEditor_cache_recycled_get", NULL, NULL);
+  RNA_def_property_ui_text(
+      prop, "Recycled Frames", "Number of frames freed from cache to make space for new images");
+
+  prop = RNA_def_property(srna, "cache_memory_used", PROP_INT, PROP_UNSIGNED);
+  RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+  RNA_def_property_int_funcs(prop, "rna_SequenceEditor_cache_memory_used_get", NULL, NULL);
+  RNA_def_property_ui_text(
+      prop, "Cache Memory Used", "Memory used by images in cache, in megabytes");
+
   /* cache flags */
 
   prop = RNA_def_property(srna, "show_cache", PROP_BOOLEAN, PROP_NONE);
@@ -0,0 +1,210 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup pythonintern
+ *
+ * Memory usage and heap profiling.
+ */
+
+#include <Python.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+
+#include "../generic/py_capi_utils.h"
+
+#include "bpy_app_memory.h"
+
+PyDoc_STRVAR(bpy_app_memory_usage_doc,
+             ".. function:: usage()\n"
+             "\n"
+             "   Memory allocated by Blender.\n"
+             "\n"
+             "   :return: Bytes in use, peak bytes in use and number of blocks.\n"
+             "   :rtype: tuple of ints\n");
+static PyObject *bpy_app_memory_usage(PyObject *UNUSED(self))
+{
+  return Py_BuildValue("(nnn)",
+                       (Py_ssize_t)MEM_get_memory_in_use(),
+                       (Py_ssize_t)MEM_get_peak_memory(),
+                       (Py_ssize_t)MEM_get_memory_blocks_in_use());
+}
+
+PyDoc_STRVAR(
+    bpy_app_memory_heap_profile_start_doc,
+    ".. function:: heap_profile_start(sample_interval=524288, call_sites=False)\n"
+    "\n"
+    "   Start sampling allocations, to estimate memory in use per allocation name.\n"
+    "   Only used with the default memory allocator, not with ``--debug-memory``.\n"
+    "\n"
+    "   :arg sample_interval: Average number of bytes allocated between samples.\n"
+    "   :type sample_interval: int\n"
+    "   :arg call_sites: Also separate memory by the address of the allocating code.\n"
+    "   :type call_sites: bool\n");
+static PyObject *bpy_app_memory_heap_profile_start(PyObject *UNUSED(self),
+                                                   PyObject *args,
+                                                   PyObject *kw)
+{
+  Py_ssize_t sample_interval = 512 * 1024;
+  bool call_sites = false;
+
+  static const char *_keywords[] = {"sample_interval", "call_sites", NULL};
+  static _PyArg_Parser _parser = {"|$nO&:heap_profile_start", _keywords, 0};
+  if (!_PyArg_ParseTupleAndKeywordsFast(
+          args, kw, &_parser, &sample_interval, PyC_ParseBool, &call_sites)) {
+    return NULL;
+  }
+
+  if (sample_interval <= 0) {
+    PyErr_SetString(PyExc_ValueError, "sample_interval must be positive");
+    return NULL;
+  }
+
+  MEM_heap_profile_start((size_t)sample_interval, call_sites);
+  Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(bpy_app_memory_heap_profile_stop_doc,
+             ".. function:: heap_profile_stop()\n"
+             "\n"
+             "   Stop sampling allocations, the statistics of sampled memory remain available.\n");
+static PyObject *bpy_app_memory_heap_profile_stop(PyObject *UNUSED(self))
+{
+  MEM_heap_profile_stop();
+  Py_RETURN_NONE;
+}
+
+static void heap_profile_stats_append(void *user_data,
+                                      const char *tag,
+                                      const void *call_site,
+                                      size_t bytes,
+                                      size_t blocks,
+                                      size_t peak_bytes)
+{
+  PyObject *list = user_data;
+  PyObject *py_call_site;
+  if (call_site) {
+    py_call_site = PyLong_FromVoidPtr((void *)call_site);
+  }
+  else {
+    py_call_site = Py_None;
+    Py_INCREF(py_call_site);
+  }
+
+  PyObject *item = Py_BuildValue("(sNnnn)",
+                                 tag,
+                                 py_call_site,
+                                 (Py_ssize_t)bytes,
+                                 (Py_ssize_t)blocks,
+                                 (Py_ssize_t)peak_bytes);
+  if (item) {
+    PyList_Append(list, item);
+    Py_DECREF(item);
+  }
+}
+
+PyDoc_STRVAR(bpy_app_memory_heap_profile_stats_doc,
+             ".. function:: heap_profile_stats()\n"
+             "\n"
+             "   Estimated memory use per allocation name, from the sampled allocations.\n"
+             "\n"
+             "   :return: List of (name, call_site, bytes, blocks, peak_bytes) tuples,\n"
+             "      call_site is None unless call sites are profiled.\n"
+             "   :rtype: list of tuples\n");
+static PyObject *bpy_app_memory_heap_profile_stats(PyObject *UNUSED(self))
+{
+  PyObject *list = PyList_New(0);
+  MEM_heap_profile_foreach(heap_profile_stats_append, list);
+
+  if (PyErr_Occurred()) {
+    Py_DECREF(list);
+    return NULL;
+  }
+  return list;
+}
+
+PyDoc_STRVAR(
+    bpy_app_memory_heap_profile_write_doc,
+    ".. function:: heap_profile_write(filepath, peak=False)\n"
+    "\n"
+    "   Write the heap profile in the folded stacks format, for flame graph tools.\n"
+    "\n"
+    "   :arg filepath: File path to write to.\n"
+    "   :type filepath: string\n"
+    "   :arg peak: Write the peak of memory in use per name instead of the current memory.\n"
+    "   :type peak: bool\n");
+static PyObject *bpy_app_memory_heap_profile_write(PyObject *UNUSED(self),
+                                                   PyObject *args,
+                                                   PyObject *kw)
+{
+  const char *filepath;
+  bool peak = false;
+
+  static const char *_keywords[] = {"filepath", "peak", NULL};
+  static _PyArg_Parser _parser = {"s|$O&:heap_profile_write", _keywords, 0};
+  if (!_PyArg_ParseTupleAndKeywordsFast(args, kw, &_parser, &filepath, PyC_ParseBool, &peak)) {
+    return NULL;
+  }
+
+  if (!MEM_heap_profile_write_folded(filepath, peak)) {
+    PyErr_Format(PyExc_IOError, "Unable to write heap profile to \"%s\"", filepath);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static struct PyMethodDef M_AppMemory_methods[] = {
+    {"usage", (PyCFunction)bpy_app_memory_usage, METH_NOARGS, bpy_app_memory_usage_doc},
+    {"heap_profile_start",
+     (PyCFunction)bpy_app_memory_heap_profile_start,
+     METH_VARARGS | METH_KEYWORDS,
+     bpy_app_memory_heap_profile_start_doc},
+    {"heap_profile_stop",
+     (PyCFunction)bpy_app_memory_heap_profile_stop,
+     METH_NOARGS,
+     bpy_app_memory_heap_profile_stop_doc},
+    {"heap_profile_stats",
+     (PyCFunction)bpy_app_memory_heap_profile_stats,
+     METH_NOARGS,
+     bpy_app_memory_heap_profile_stats_doc},
+    {"heap_profile_write",
+     (PyCFunction)bpy_app_memory_heap_profile_write,
+     METH_VARARGS | METH_KEYWORDS,
+     bpy_app_memory_heap_profile_write_doc},
+    {NULL, NULL, 0, NULL},
+};
+
+static struct PyModuleDef M_AppMemory_module_def = {
+    PyModuleDef_HEAD_INIT,
+    "bpy.app.memory",    /* m_name */
+    NULL,                /* m_doc */
+    0,                   /* m_size */
+    M_AppMemory_methods, /* m_methods */
+    NULL,                /* m_reload */
+    NULL,                /* m_traverse */
+    NULL,                /* m_clear */
+    NULL,                /* m_free */
+};
+
+PyObject *BPY_app_memory_module(void)
+{
+  PyObject *sys_modules = PyImport_GetModuleDict();
+  PyObject *mod = PyModule_Create(&M_AppMemory_module_def);
+  PyDict_SetItem(sys_modules, PyModule_GetNameObject(mod), mod);
+  return mod;
+}
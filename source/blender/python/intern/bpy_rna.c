@@ -5390,7 +5390,12 @@ static PyObject *foreach_getset(BPy_PropertyRNA *self, PyObject *args, int set)
 PyDoc_STRVAR(pyrna_prop_collection_foreach_get_doc,
              ".. method:: foreach_get(attr, seq)\n"
              "\n"
-             "   This is a function to give fast access to attributes within a collection.\n");
+             "   This is a function to give fast access to attributes within a collection.\n"
+             "\n"
+             "   This is the supported way to access large amounts of data such as mesh vertices,\n"
+             "   loops and attribute layers. Values are copied directly when ``seq`` is a\n"
+             "   one-dimensional buffer (e.g. a ``numpy`` array) of the same type as the attribute,\n"
+             "   ``float32`` for floats and ``int32`` for integers, other sequences are converted.\n");
 static PyObject *pyrna_prop_collection_foreach_get(BPy_PropertyRNA *self, PyObject *args)
 {
   PYRNA_PROP_CHECK_OBJ(self);
@@ -5401,7 +5406,12 @@ static PyObject *pyrna_prop_collection_foreach_get(BPy_PropertyRNA *self, PyObje
 PyDoc_STRVAR(pyrna_prop_collection_foreach_set_doc,
              ".. method:: foreach_set(attr, seq)\n"
              "\n"
-             "   This is a function to give fast access to attributes within a collection.\n");
+             "   This is a function to give fast access to attributes within a collection.\n"
+             "\n"
+             "   This is the supported way to access large amounts of data such as mesh vertices,\n"
+             "   loops and attribute layers. Values are copied directly when ``seq`` is a\n"
+             "   one-dimensional buffer (e.g. a ``numpy`` array) of the same type as the attribute,\n"
+             "   ``float32`` for floats and ``int32`` for integers, other sequences are converted.\n");
 static PyObject *pyrna_prop_collection_foreach_set(BPy_PropertyRNA *self, PyObject *args)
 {
   PYRNA_PROP_CHECK_OBJ(self);
@@ -241,7 +241,21 @@ double BKE_sequencer_rendersize_to_scale_factor(int size);
  * Sequencer memory cache management functions
  * ********************************************************************** */
 
+typedef struct SeqCacheStats {
+  /** Images found in memory cache. */
+  uint64_t hits;
+  /** Images found in disk cache. */
+  uint64_t disk_hits;
+  /** Images that had to be rendered. */
+  uint64_t misses;
+  /** Frames freed to make space for new images. */
+  uint64_t recycled;
+  size_t memory_used;
+  int item_count;
+} SeqCacheStats;
+
 void BKE_sequencer_cache_cleanup(struct Scene *scene);
+void BKE_sequencer_cache_stats_get(struct Scene *scene, SeqCacheStats *r_stats);
 void BKE_sequencer_cache_iterate(struct Scene *scene,
                                  void *userdata,
                                  bool callback_init(void *userdata, size_t item_count),
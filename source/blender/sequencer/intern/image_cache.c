@@ -20,12 +20,15 @@
  * \ingroup bke
  */
 
+#include <ctype.h>
 #include <memory.h>
 #include <stddef.h>
 #include <time.h>
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "DNA_scene_types.h"
 #include "DNA_sequence_types.h"
 #include "DNA_space_types.h" /* for FILE_MAX. */
@@ -51,6 +54,14 @@
 
 #include "sequencer.h"
 
+#ifdef WITH_LZO
+#  ifdef WITH_SYSTEM_LZO
+#    include <lzo/lzo1x.h>
+#  else
+#    include "minilzo.h"
+#  endif
+#endif
+
 /**
  * Sequencer Cache Design Notes
  * ============================
@@ -75,6 +86,17 @@
  *
  * User can exclude caching of some images. Such entries will have is_temp_cache set.
  *
+ * Locking: Hash is guarded by read-write lock. Lookups only take read lock, so playback,
+ * prefetch and render threads can query cache concurrently. Insertion, recycling and
+ * invalidation take write lock.
+ *
+ * Recycling: Candidates for recycling are collected in single pass over hash and sorted by
+ * frame number. Frames are then freed from both ends of this array, so freeing multiple frames
+ * doesn't require iterating over whole hash for each of them.
+ *
+ * Statistics: Number of hits, misses and recycled frames are counted using atomic operations
+ * and can be read with #BKE_sequencer_cache_stats_get().
+ *
  *
  * Disk Cache Design Notes
  * =======================
@@ -83,8 +105,15 @@
  * For each cached non-temp image, image data and supplementary info are written to HDD.
  * Multiple(DCACHE_IMAGES_PER_FILE) images share the same file.
  * Each of these files contains header DiskCacheHeader followed by image data.
- * Zlib compression with user definable level can be used to compress image data(per image)
+ * Image data can be stored uncompressed, compressed with fast LZO codec (when available), or
+ * with zlib. Codec is chosen by compression level in user preferences and stored per image.
+ * LZO data is stored in independent chunks, so it can be decompressed directly into ImBuf
+ * without intermediate buffer for the whole image.
+ * Headers of files are kept in memory once read, so looking up a frame that is not cached
+ * doesn't need to touch the file.
  * Images are written in order in which they are rendered.
+ * Writing is done in dedicated thread, so rendering doesn't have to wait for storage.
+ * When too many images are waiting to be written, they are written by rendering thread.
  * Overwriting of individual entry is not possible.
  * Stored images are deleted by invalidation, or when size of all files exceeds maximum
  * size specified in user preferences.
@@ -96,11 +125,21 @@
 /* <cache type>-<resolution X>x<resolution Y>-<rendersize>%(<view_id>)-<frame no>.dcf */
 #define DCACHE_FNAME_FORMAT "%d-%dx%d-%d%%(%d)-%d.dcf"
 #define DCACHE_IMAGES_PER_FILE 100
-#define DCACHE_CURRENT_VERSION 1
+#define DCACHE_CURRENT_VERSION 2
+#define DCACHE_LZO_CHUNK_SIZE (1024 * 1024)
+#define DCACHE_WRITES_PENDING_MAX 8
 #define COLORSPACE_NAME_MAX 64 /* XXX: defined in imb intern */
 
+/* Codec used to store image data. */
+enum {
+  DCACHE_CODEC_NONE = 0,
+  DCACHE_CODEC_ZLIB = 1,
+  DCACHE_CODEC_LZO = 2,
+};
+
 typedef struct DiskCacheHeaderEntry {
   unsigned char encoding;
+  unsigned char codec;
   uint64_t frameno;
   uint64_t size_compressed;
   uint64_t size_raw;
@@ -116,8 +155,17 @@ typedef struct SeqDiskCache {
   Main *bmain;
   int64_t timestamp;
   ListBase files;
+  /* Lookup of DiskCacheFile by path. */
+  struct GHash *files_hash;
   ThreadMutex read_write_mutex;
   size_t size_total;
+
+  /* Writing thread. */
+  ListBase write_threads;
+  ThreadQueue *write_queue;
+  ThreadMutex write_mutex;
+  ThreadCondition write_cond;
+  int writes_pending;
 } SeqDiskCache;
 
 typedef struct DiskCacheFile {
@@ -126,6 +174,8 @@ typedef struct DiskCacheFile {
   char dir[FILE_MAXDIR];
   char file[FILE_MAX];
   BLI_stat_t fstat;
+  /* Copy of file header, NULL until file is read or written. */
+  struct DiskCacheHeader *header;
   int cache_type;
   int rectx;
   int recty;
@@ -137,12 +187,17 @@ typedef struct DiskCacheFile {
 typedef struct SeqCache {
   Main *bmain;
   struct GHash *hash;
-  ThreadMutex iterator_mutex;
+  ThreadRWMutex iterator_mutex;
   struct BLI_mempool *keys_pool;
   struct BLI_mempool *items_pool;
   struct SeqCacheKey *last_key;
   size_t memory_used;
   SeqDiskCache *disk_cache;
+  /* Statistics, modified atomically. */
+  uint64_t hits;
+  uint64_t disk_hits;
+  uint64_t misses;
+  uint64_t recycled;
 } SeqCache;
 
 typedef struct SeqCacheItem {
@@ -174,6 +229,24 @@ static char *seq_disk_cache_base_dir(void)
   return U.sequencer_disk_cache_dir;
 }
 
+static int seq_disk_cache_codec(void)
+{
+  switch (U.sequencer_disk_cache_compression) {
+    case USER_SEQ_DISK_CACHE_COMPRESSION_NONE:
+      return DCACHE_CODEC_NONE;
+    case USER_SEQ_DISK_CACHE_COMPRESSION_LOW:
+#ifdef WITH_LZO
+      return DCACHE_CODEC_LZO;
+#else
+      return DCACHE_CODEC_ZLIB;
+#endif
+    case USER_SEQ_DISK_CACHE_COMPRESSION_HIGH:
+      return DCACHE_CODEC_ZLIB;
+  }
+
+  return DCACHE_CODEC_ZLIB;
+}
+
 static int seq_disk_cache_compression_level(void)
 {
   switch (U.sequencer_disk_cache_compression) {
@@ -200,6 +273,25 @@ static bool seq_disk_cache_is_enabled(Main *bmain)
           bmain->name[0] != '\0');
 }
 
+/* File paths are compared case-insensitively, so that paths differing only in case map to the
+ * same file on case-insensitive file systems. */
+static uint seq_disk_cache_path_hash(const void *ptr)
+{
+  const unsigned char *p;
+  uint h = 5381;
+
+  for (p = ptr; *p != '\0'; p++) {
+    h = (uint)((h << 5) + h) + (uint)tolower(*p);
+  }
+
+  return h;
+}
+
+static bool seq_disk_cache_path_cmp(const void *a, const void *b)
+{
+  return (a == b) ? false : (BLI_strcasecmp(a, b) != 0);
+}
+
 static DiskCacheFile *seq_disk_cache_add_file_to_list(SeqDiskCache *disk_cache, const char *path)
 {
 
@@ -219,9 +311,20 @@ static DiskCacheFile *seq_disk_cache_add_file_to_list(SeqDiskCache *disk_cache,
          &cache_file->start_frame);
   cache_file->start_frame *= DCACHE_IMAGES_PER_FILE;
   BLI_addtail(&disk_cache->files, cache_file);
+  BLI_ghash_insert(disk_cache->files_hash, cache_file->path, cache_file);
   return cache_file;
 }
 
+static void seq_disk_cache_free_files(SeqDiskCache *disk_cache)
+{
+  BLI_ghash_clear(disk_cache->files_hash, NULL, NULL);
+
+  LISTBASE_FOREACH (DiskCacheFile *, cache_file, &disk_cache->files) {
+    MEM_SAFE_FREE(cache_file->header);
+  }
+  BLI_freelistN(&disk_cache->files);
+}
+
 static void seq_disk_cache_get_files(SeqDiskCache *disk_cache, char *path)
 {
   struct direntry *filelist, *fl;
@@ -281,7 +384,9 @@ static void seq_disk_cache_delete_file(SeqDiskCache *disk_cache, DiskCacheFile *
 {
   disk_cache->size_total -= file->fstat.st_size;
   BLI_delete(file->path, false, false);
+  BLI_ghash_remove(disk_cache->files_hash, file->path, NULL, NULL);
   BLI_remlink(&disk_cache->files, file);
+  MEM_SAFE_FREE(file->header);
   MEM_freeN(file);
 }
 
@@ -299,7 +404,7 @@ static bool seq_disk_cache_enforce_limits(SeqDiskCache *disk_cache)
 
     if (BLI_exists(oldest_file->path) == 0) {
       /* File may have been manually deleted during runtime, do re-scan. */
-      BLI_freelistN(&disk_cache->files);
+      seq_disk_cache_free_files(disk_cache);
       seq_disk_cache_get_files(disk_cache, seq_disk_cache_base_dir());
       continue;
     }
@@ -311,27 +416,19 @@ static bool seq_disk_cache_enforce_limits(SeqDiskCache *disk_cache)
   return true;
 }
 
-static DiskCacheFile *seq_disk_cache_get_file_entry_by_path(SeqDiskCache *disk_cache, char *path)
+static DiskCacheFile *seq_disk_cache_get_file_entry_by_path(SeqDiskCache *disk_cache,
+                                                            const char *path)
 {
-  DiskCacheFile *cache_file = disk_cache->files.first;
-
-  for (; cache_file; cache_file = cache_file->next) {
-    if (BLI_strcasecmp(cache_file->path, path) == 0) {
-      return cache_file;
-    }
-  }
-
-  return NULL;
+  return BLI_ghash_lookup(disk_cache->files_hash, path);
 }
 
 /* Update file size and timestamp. */
-static void seq_disk_cache_update_file(SeqDiskCache *disk_cache, char *path)
+static void seq_disk_cache_update_file(SeqDiskCache *disk_cache, DiskCacheFile *cache_file)
 {
-  DiskCacheFile *cache_file;
+  const char *path = cache_file->path;
   int64_t size_before;
   int64_t size_after;
 
-  cache_file = seq_disk_cache_get_file_entry_by_path(disk_cache, path);
   size_before = cache_file->fstat.st_size;
 
   if (BLI_stat(path, &cache_file->fstat) == -1) {
@@ -457,6 +554,15 @@ static void seq_disk_cache_delete_invalid_files(SeqDiskCache *disk_cache,
   }
 }
 
+static void seq_disk_cache_wait_for_writes(SeqDiskCache *disk_cache)
+{
+  BLI_mutex_lock(&disk_cache->write_mutex);
+  while (disk_cache->writes_pending > 0) {
+    BLI_condition_wait(&disk_cache->write_cond, &disk_cache->write_mutex);
+  }
+  BLI_mutex_unlock(&disk_cache->write_mutex);
+}
+
 static void seq_disk_cache_invalidate(Scene *scene,
                                       Sequence *seq,
                                       Sequence *seq_changed,
@@ -466,6 +572,9 @@ static void seq_disk_cache_invalidate(Scene *scene,
   int end;
   SeqDiskCache *disk_cache = scene->ed->cache->disk_cache;
 
+  /* Images of invalidated range may be waiting to be written. */
+  seq_disk_cache_wait_for_writes(disk_cache);
+
   BLI_mutex_lock(&disk_cache->read_write_mutex);
 
   start = seq_changed->startdisp - DCACHE_IMAGES_PER_FILE;
@@ -476,29 +585,160 @@ static void seq_disk_cache_invalidate(Scene *scene,
   BLI_mutex_unlock(&disk_cache->read_write_mutex);
 }
 
+static size_t seq_disk_cache_write_raw(void *buf, size_t len, FILE *file, size_t offset)
+{
+  fseek(file, offset, 0);
+  if (fwrite(buf, 1, len, file) != len || ferror(file)) {
+    return 0;
+  }
+  return len;
+}
+
+static size_t seq_disk_cache_read_raw(void *buf, size_t len, FILE *file, size_t offset)
+{
+  fseek(file, offset, 0);
+  return fread(buf, 1, len, file);
+}
+
+#ifdef WITH_LZO
+
+#  define LZO_OUT_LEN(size) ((size) + (size) / 16 + 64 + 3)
+
+/* Data is compressed in chunks of DCACHE_LZO_CHUNK_SIZE bytes. Each chunk is preceded by its
+ * compressed size. Chunks that can not be compressed are stored as is, in that case compressed
+ * size equals to size of chunk. */
+static size_t seq_disk_cache_write_lzo(void *buf, size_t len, FILE *file, size_t offset)
+{
+  unsigned char *out = MEM_mallocN(LZO_OUT_LEN(DCACHE_LZO_CHUNK_SIZE), "SeqDiskCache LZO out");
+  void *wrkmem = MEM_mallocN(LZO1X_1_MEM_COMPRESS, "SeqDiskCache LZO wrkmem");
+  size_t bytes_written = 0;
+
+  fseek(file, offset, 0);
+
+  for (size_t pos = 0; pos < len; pos += DCACHE_LZO_CHUNK_SIZE) {
+    unsigned char *in = (unsigned char *)buf + pos;
+    lzo_uint in_len = MIN2(len - pos, DCACHE_LZO_CHUNK_SIZE);
+    lzo_uint out_len = LZO_OUT_LEN(in_len);
+    const unsigned char *chunk = out;
+
+    int r = lzo1x_1_compress(in, in_len, out, &out_len, wrkmem);
+    if (r != LZO_E_OK || out_len >= in_len) {
+      chunk = in;
+      out_len = in_len;
+    }
+
+    uint32_t chunk_len = (uint32_t)out_len;
+    if (fwrite(&chunk_len, sizeof(chunk_len), 1, file) != 1 ||
+        fwrite(chunk, 1, chunk_len, file) != chunk_len || ferror(file)) {
+      bytes_written = 0;
+      break;
+    }
+    bytes_written += sizeof(chunk_len) + chunk_len;
+  }
+
+  MEM_freeN(wrkmem);
+  MEM_freeN(out);
+  return bytes_written;
+}
+
+static size_t seq_disk_cache_read_lzo(void *buf,
+                                      size_t len,
+                                      FILE *file,
+                                      DiskCacheHeaderEntry *header_entry)
+{
+  unsigned char *in = MEM_mallocN(DCACHE_LZO_CHUNK_SIZE, "SeqDiskCache LZO in");
+  size_t bytes_read = 0;
+
+  fseek(file, header_entry->offset, 0);
+
+  while (bytes_read < len) {
+    unsigned char *out = (unsigned char *)buf + bytes_read;
+    lzo_uint out_len = MIN2(len - bytes_read, DCACHE_LZO_CHUNK_SIZE);
+    uint32_t chunk_len;
+
+    if (fread(&chunk_len, sizeof(chunk_len), 1, file) != 1) {
+      break;
+    }
+    if ((ENDIAN_ORDER == B_ENDIAN) && header_entry->encoding == 0) {
+      BLI_endian_switch_uint32(&chunk_len);
+    }
+    if (chunk_len > out_len) {
+      break;
+    }
+
+    if (chunk_len == out_len) {
+      /* Chunk is not compressed. */
+      if (fread(out, 1, chunk_len, file) != chunk_len) {
+        break;
+      }
+    }
+    else {
+      if (fread(in, 1, chunk_len, file) != chunk_len) {
+        break;
+      }
+      lzo_uint expected_len = out_len;
+      int r = lzo1x_decompress_safe(in, chunk_len, out, &out_len, NULL);
+      if (r != LZO_E_OK || out_len != expected_len) {
+        break;
+      }
+    }
+    bytes_read += out_len;
+  }
+
+  MEM_freeN(in);
+  return bytes_read;
+}
+
+#  undef LZO_OUT_LEN
+
+#endif /* WITH_LZO */
+
+static void *seq_disk_cache_imbuf_data(ImBuf *ibuf)
+{
+  if (ibuf->rect) {
+    return ibuf->rect;
+  }
+  return ibuf->rect_float;
+}
+
 static size_t deflate_imbuf_to_file(ImBuf *ibuf,
                                     FILE *file,
                                     int level,
                                     DiskCacheHeaderEntry *header_entry)
 {
-  if (ibuf->rect) {
-    return BLI_gzip_mem_to_file_at_pos(
-        ibuf->rect, header_entry->size_raw, file, header_entry->offset, level);
+  void *data = seq_disk_cache_imbuf_data(ibuf);
+
+  switch (header_entry->codec) {
+    case DCACHE_CODEC_NONE:
+      return seq_disk_cache_write_raw(data, header_entry->size_raw, file, header_entry->offset);
+#ifdef WITH_LZO
+    case DCACHE_CODEC_LZO:
+      return seq_disk_cache_write_lzo(data, header_entry->size_raw, file, header_entry->offset);
+#endif
   }
 
   return BLI_gzip_mem_to_file_at_pos(
-      ibuf->rect_float, header_entry->size_raw, file, header_entry->offset, level);
+      data, header_entry->size_raw, file, header_entry->offset, level);
 }
 
+/* Image data is read directly into buffer of pre-allocated ibuf. */
 static size_t inflate_file_to_imbuf(ImBuf *ibuf, FILE *file, DiskCacheHeaderEntry *header_entry)
 {
-  if (ibuf->rect) {
-    return BLI_ungzip_file_to_mem_at_pos(
-        ibuf->rect, header_entry->size_raw, file, header_entry->offset);
+  void *data = seq_disk_cache_imbuf_data(ibuf);
+
+  switch (header_entry->codec) {
+    case DCACHE_CODEC_NONE:
+      return seq_disk_cache_read_raw(data, header_entry->size_raw, file, header_entry->offset);
+    case DCACHE_CODEC_LZO:
+#ifdef WITH_LZO
+      return seq_disk_cache_read_lzo(data, header_entry->size_raw, file, header_entry);
+#else
+      /* Can not decode, file is treated as invalid. */
+      return 0;
+#endif
   }
 
-  return BLI_ungzip_file_to_mem_at_pos(
-      ibuf->rect_float, header_entry->size_raw, file, header_entry->offset);
+  return BLI_ungzip_file_to_mem_at_pos(data, header_entry->size_raw, file, header_entry->offset);
 }
 
 static void seq_disk_cache_read_header(FILE *file, DiskCacheHeader *header)
@@ -556,6 +796,7 @@ static int seq_disk_cache_add_header_entry(SeqCacheKey *key, ImBuf *ibuf, DiskCa
 
   header->entry[i].offset = offset;
   header->entry[i].frameno = key->nfra;
+  header->entry[i].codec = seq_disk_cache_codec();
 
   /* Store colorspace name of ibuf. */
   const char *colorspace_name;
@@ -584,25 +825,43 @@ static int seq_disk_cache_get_header_entry(SeqCacheKey *key, DiskCacheHeader *he
   return -1;
 }
 
-static bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf *ibuf)
+/* Get header of file, it is read from file only once and then kept in memory. */
+static DiskCacheHeader *seq_disk_cache_get_file_header(DiskCacheFile *cache_file, FILE *file)
 {
-  char path[FILE_MAX];
+  if (cache_file->header == NULL) {
+    cache_file->header = MEM_callocN(sizeof(DiskCacheHeader), "DiskCacheHeader");
+    seq_disk_cache_read_header(file, cache_file->header);
+  }
+  return cache_file->header;
+}
 
-  seq_disk_cache_get_file_path(disk_cache, key, path, sizeof(path));
+static bool seq_disk_cache_write_file(SeqDiskCache *disk_cache,
+                                      SeqCacheKey *key,
+                                      const char *path,
+                                      ImBuf *ibuf)
+{
   BLI_make_existing_file(path);
 
+  DiskCacheFile *cache_file = seq_disk_cache_get_file_entry_by_path(disk_cache, path);
   FILE *file = BLI_fopen(path, "rb+");
   if (!file) {
     file = BLI_fopen(path, "wb+");
     if (!file) {
       return false;
     }
-    seq_disk_cache_add_file_to_list(disk_cache, path);
+    if (cache_file) {
+      /* File was deleted from outside, header copy is not valid anymore. */
+      MEM_SAFE_FREE(cache_file->header);
+    }
+    else {
+      cache_file = seq_disk_cache_add_file_to_list(disk_cache, path);
+    }
+  }
+  else if (cache_file == NULL) {
+    cache_file = seq_disk_cache_add_file_to_list(disk_cache, path);
   }
 
-  DiskCacheHeader header;
-  memset(&header, 0, sizeof(header));
-  seq_disk_cache_read_header(file, &header);
+  DiskCacheHeader header = *seq_disk_cache_get_file_header(cache_file, file);
   int entry_index = seq_disk_cache_add_header_entry(key, ibuf, &header);
   size_t bytes_written = deflate_imbuf_to_file(
       ibuf, file, seq_disk_cache_compression_level(), &header.entry[entry_index]);
@@ -613,30 +872,41 @@ static bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key
      */
     header.entry[entry_index].size_compressed = bytes_written;
     seq_disk_cache_write_header(file, &header);
-    seq_disk_cache_update_file(disk_cache, path);
+    *cache_file->header = header;
     fclose(file);
+    seq_disk_cache_update_file(disk_cache, cache_file);
 
     return true;
   }
 
+  fclose(file);
   return false;
 }
 
 static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *key)
 {
   char path[FILE_MAX];
-  DiskCacheHeader header;
 
   seq_disk_cache_get_file_path(disk_cache, key, path, sizeof(path));
-  BLI_make_existing_file(path);
+
+  /* Only files written by this cache or found when it was created are used. */
+  DiskCacheFile *cache_file = seq_disk_cache_get_file_entry_by_path(disk_cache, path);
+  if (cache_file == NULL) {
+    return NULL;
+  }
+
+  /* Item not found, no need to open file. */
+  if (cache_file->header && seq_disk_cache_get_header_entry(key, cache_file->header) < 0) {
+    return NULL;
+  }
 
   FILE *file = BLI_fopen(path, "rb");
   if (!file) {
     return NULL;
   }
 
-  seq_disk_cache_read_header(file, &header);
-  int entry_index = seq_disk_cache_get_header_entry(key, &header);
+  DiskCacheHeader *header = seq_disk_cache_get_file_header(cache_file, file);
+  int entry_index = seq_disk_cache_get_header_entry(key, header);
 
   /* Item not found. */
   if (entry_index < 0) {
@@ -649,22 +919,22 @@ static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *ke
   uint64_t size_float = (uint64_t)key->context.rectx * key->context.recty * 16;
   size_t expected_size;
 
-  if (header.entry[entry_index].size_raw == size_char) {
+  if (header->entry[entry_index].size_raw == size_char) {
     expected_size = size_char;
     ibuf = IMB_allocImBuf(key->context.rectx, key->context.recty, 32, IB_rect);
-    IMB_colormanagement_assign_rect_colorspace(ibuf, header.entry[entry_index].colorspace_name);
+    IMB_colormanagement_assign_rect_colorspace(ibuf, header->entry[entry_index].colorspace_name);
   }
-  else if (header.entry[entry_index].size_raw == size_float) {
+  else if (header->entry[entry_index].size_raw == size_float) {
     expected_size = size_float;
     ibuf = IMB_allocImBuf(key->context.rectx, key->context.recty, 32, IB_rectfloat);
-    IMB_colormanagement_assign_float_colorspace(ibuf, header.entry[entry_index].colorspace_name);
+    IMB_colormanagement_assign_float_colorspace(ibuf, header->entry[entry_index].colorspace_name);
   }
   else {
     fclose(file);
     return NULL;
   }
 
-  size_t bytes_read = inflate_file_to_imbuf(ibuf, file, &header.entry[entry_index]);
+  size_t bytes_read = inflate_file_to_imbuf(ibuf, file, &header->entry[entry_index]);
 
   /* Sanity check. */
   if (bytes_read != expected_size) {
@@ -672,17 +942,81 @@ static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *ke
     IMB_freeImBuf(ibuf);
     return NULL;
   }
-  BLI_file_touch(path);
-  seq_disk_cache_update_file(disk_cache, path);
   fclose(file);
+  BLI_file_touch(path);
+  seq_disk_cache_update_file(disk_cache, cache_file);
 
   return ibuf;
 }
 
+/* Image waiting to be written by writing thread. */
+typedef struct DiskCacheWriteTask {
+  SeqCacheKey key;
+  char path[FILE_MAX];
+  ImBuf *ibuf;
+} DiskCacheWriteTask;
+
+static void seq_disk_cache_write_task_exec(SeqDiskCache *disk_cache, DiskCacheWriteTask *task)
+{
+  BLI_mutex_lock(&disk_cache->read_write_mutex);
+  seq_disk_cache_write_file(disk_cache, &task->key, task->path, task->ibuf);
+  BLI_mutex_unlock(&disk_cache->read_write_mutex);
+  seq_disk_cache_enforce_limits(disk_cache);
+}
+
+static void *seq_disk_cache_write_thread(void *data)
+{
+  SeqDiskCache *disk_cache = data;
+  DiskCacheWriteTask *task;
+
+  while ((task = BLI_thread_queue_pop(disk_cache->write_queue))) {
+    seq_disk_cache_write_task_exec(disk_cache, task);
+    IMB_freeImBuf(task->ibuf);
+    MEM_freeN(task);
+
+    BLI_mutex_lock(&disk_cache->write_mutex);
+    disk_cache->writes_pending--;
+    BLI_condition_notify_all(&disk_cache->write_cond);
+    BLI_mutex_unlock(&disk_cache->write_mutex);
+  }
+
+  return NULL;
+}
+
+/* Write image in writing thread. Key is copied and path resolved immediately, so strip and
+ * cache entry can be freed before image is written. */
+static void seq_disk_cache_write_file_async(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf *ibuf)
+{
+  DiskCacheWriteTask *task = MEM_callocN(sizeof(DiskCacheWriteTask), "DiskCacheWriteTask");
+  task->key = *key;
+  seq_disk_cache_get_file_path(disk_cache, key, task->path, sizeof(task->path));
+
+  BLI_mutex_lock(&disk_cache->write_mutex);
+  const bool use_thread = disk_cache->writes_pending < DCACHE_WRITES_PENDING_MAX;
+  if (use_thread) {
+    disk_cache->writes_pending++;
+  }
+  BLI_mutex_unlock(&disk_cache->write_mutex);
+
+  if (use_thread) {
+    IMB_refImBuf(ibuf);
+    task->ibuf = ibuf;
+    BLI_thread_queue_push(disk_cache->write_queue, task);
+  }
+  else {
+    /* Storage can not keep up, don't hold more images in memory. */
+    task->ibuf = ibuf;
+    seq_disk_cache_write_task_exec(disk_cache, task);
+    MEM_freeN(task);
+  }
+}
+
 #undef DCACHE_FNAME_FORMAT
 #undef DCACHE_IMAGES_PER_FILE
 #undef COLORSPACE_NAME_MAX
 #undef DCACHE_CURRENT_VERSION
+#undef DCACHE_LZO_CHUNK_SIZE
+#undef DCACHE_WRITES_PENDING_MAX
 
 static bool seq_cmp_render_data(const SeqRenderData *a, const SeqRenderData *b)
 {
@@ -752,7 +1086,17 @@ static void seq_cache_lock(Scene *scene)
   SeqCache *cache = seq_cache_get_from_scene(scene);
 
   if (cache) {
-    BLI_mutex_lock(&cache->iterator_mutex);
+    BLI_rw_mutex_lock(&cache->iterator_mutex, THREAD_LOCK_WRITE);
+  }
+}
+
+/* Lock for lookups only, hash must not be modified while this lock is held. */
+static void seq_cache_lock_read(Scene *scene)
+{
+  SeqCache *cache = seq_cache_get_from_scene(scene);
+
+  if (cache) {
+    BLI_rw_mutex_lock(&cache->iterator_mutex, THREAD_LOCK_READ);
   }
 }
 
@@ -761,7 +1105,7 @@ static void seq_cache_unlock(Scene *scene)
   SeqCache *cache = seq_cache_get_from_scene(scene);
 
   if (cache) {
-    BLI_mutex_unlock(&cache->iterator_mutex);
+    BLI_rw_mutex_unlock(&cache->iterator_mutex);
   }
 }
 
@@ -918,23 +1262,37 @@ static void seq_cache_recycle_linked(Scene *scene, SeqCacheKey *base)
   }
 }
 
-static SeqCacheKey *seq_cache_get_item_for_removal(Scene *scene)
+static int seq_cache_recycle_candidate_cmp(const void *a_, const void *b_)
+{
+  const SeqCacheKey *a = *(const SeqCacheKey **)a_;
+  const SeqCacheKey *b = *(const SeqCacheKey **)b_;
+  const float a_cfra = seq_cache_frame_index_to_cfra(a->seq, a->nfra);
+  const float b_cfra = seq_cache_frame_index_to_cfra(b->seq, b->nfra);
+
+  if (a_cfra < b_cfra) {
+    return -1;
+  }
+  if (a_cfra > b_cfra) {
+    return 1;
+  }
+  return 0;
+}
+
+/* Collect "base" keys, that can be recycled, sorted by frame.
+ * Leftmost and rightmost candidates are then chosen from ends of returned array.
+ * Returned array must be freed by caller.
+ */
+static SeqCacheKey **seq_cache_get_items_for_removal(Scene *scene, int *r_len)
 {
   SeqCache *cache = seq_cache_get_from_scene(scene);
-  SeqCacheKey *finalkey = NULL;
-  /* Leftmost key. */
-  SeqCacheKey *lkey = NULL;
-  /* Rightmost key. */
-  SeqCacheKey *rkey = NULL;
-  SeqCacheKey *key = NULL;
+  SeqCacheKey **candidates = NULL;
+  int len = 0;
 
   GHashIterator gh_iter;
   BLI_ghashIterator_init(&gh_iter, cache->hash);
-  int total_count = 0;
-  int cheap_count = 0;
 
   while (!BLI_ghashIterator_done(&gh_iter)) {
-    key = BLI_ghashIterator_getKey(&gh_iter);
+    SeqCacheKey *key = BLI_ghashIterator_getKey(&gh_iter);
     SeqCacheItem *item = BLI_ghashIterator_getValue(&gh_iter);
     BLI_ghashIterator_step(&gh_iter);
 
@@ -943,6 +1301,7 @@ static SeqCacheKey *seq_cache_get_item_for_removal(Scene *scene)
       seq_cache_recycle_linked(scene, key);
       /* Can not continue iterating after linked remove. */
       BLI_ghashIterator_init(&gh_iter, cache->hash);
+      len = 0;
       continue;
     }
 
@@ -950,34 +1309,21 @@ static SeqCacheKey *seq_cache_get_item_for_removal(Scene *scene)
       continue;
     }
 
-    total_count++;
-
     if (key->cost <= scene->ed->recycle_max_cost) {
-      cheap_count++;
-      if (lkey) {
-        if (seq_cache_frame_index_to_cfra(key->seq, key->nfra) <
-            seq_cache_frame_index_to_cfra(lkey->seq, lkey->nfra)) {
-          lkey = key;
-        }
-      }
-      else {
-        lkey = key;
-      }
-      if (rkey) {
-        if (seq_cache_frame_index_to_cfra(key->seq, key->nfra) >
-            seq_cache_frame_index_to_cfra(rkey->seq, rkey->nfra)) {
-          rkey = key;
-        }
-      }
-      else {
-        rkey = key;
+      if (candidates == NULL) {
+        candidates = MEM_malloc_arrayN(
+            BLI_ghash_len(cache->hash), sizeof(*candidates), "SeqCache recycle candidates");
       }
+      candidates[len++] = key;
     }
   }
 
-  finalkey = seq_cache_choose_key(scene, lkey, rkey);
+  if (len > 1) {
+    qsort(candidates, len, sizeof(*candidates), seq_cache_recycle_candidate_cmp);
+  }
 
-  return finalkey;
+  *r_len = len;
+  return candidates;
 }
 
 /* Find only "base" keys.
@@ -993,19 +1339,47 @@ bool BKE_sequencer_cache_recycle_item(Scene *scene)
 
   seq_cache_lock(scene);
 
+  if (cache->memory_used <= memory_total) {
+    seq_cache_unlock(scene);
+    return true;
+  }
+
+  int candidates_len;
+  SeqCacheKey **candidates = seq_cache_get_items_for_removal(scene, &candidates_len);
+  int lindex = 0;
+  int rindex = candidates_len - 1;
+  bool success = true;
+
   while (cache->memory_used > memory_total) {
-    SeqCacheKey *finalkey = seq_cache_get_item_for_removal(scene);
+    SeqCacheKey *lkey = NULL;
+    SeqCacheKey *rkey = NULL;
+
+    if (lindex <= rindex) {
+      lkey = candidates[lindex];
+      rkey = candidates[rindex];
+    }
+
+    SeqCacheKey *finalkey = seq_cache_choose_key(scene, lkey, rkey);
+
+    if (finalkey == NULL) {
+      success = false;
+      break;
+    }
 
-    if (finalkey) {
-      seq_cache_recycle_linked(scene, finalkey);
+    if (finalkey == lkey) {
+      lindex++;
     }
     else {
-      seq_cache_unlock(scene);
-      return false;
+      rindex--;
     }
+
+    seq_cache_recycle_linked(scene, finalkey);
+    atomic_add_and_fetch_uint64(&cache->recycled, 1);
   }
+
+  MEM_SAFE_FREE(candidates);
   seq_cache_unlock(scene);
-  return true;
+  return success;
 }
 
 static void seq_cache_set_temp_cache_linked(Scene *scene, SeqCacheKey *base)
@@ -1037,23 +1411,45 @@ static void seq_disk_cache_create(Main *bmain, Scene *scene)
   BLI_mutex_lock(&cache_create_lock);
   SeqCache *cache = seq_cache_get_from_scene(scene);
 
-  if (cache == NULL) {
+  if (cache == NULL || cache->disk_cache != NULL) {
+    BLI_mutex_unlock(&cache_create_lock);
     return;
   }
 
-  if (cache->disk_cache != NULL) {
-    return;
-  }
+  SeqDiskCache *disk_cache = MEM_callocN(sizeof(SeqDiskCache), "SeqDiskCache");
+  disk_cache->bmain = bmain;
+  disk_cache->files_hash = BLI_ghash_new(
+      seq_disk_cache_path_hash, seq_disk_cache_path_cmp, "SeqDiskCache files");
+  BLI_mutex_init(&disk_cache->read_write_mutex);
+  seq_disk_cache_handle_versioning(disk_cache);
+  seq_disk_cache_get_files(disk_cache, seq_disk_cache_base_dir());
+  disk_cache->timestamp = scene->ed->disk_cache_timestamp;
 
-  cache->disk_cache = MEM_callocN(sizeof(SeqDiskCache), "SeqDiskCache");
-  cache->disk_cache->bmain = bmain;
-  BLI_mutex_init(&cache->disk_cache->read_write_mutex);
-  seq_disk_cache_handle_versioning(cache->disk_cache);
-  seq_disk_cache_get_files(cache->disk_cache, seq_disk_cache_base_dir());
-  cache->disk_cache->timestamp = scene->ed->disk_cache_timestamp;
+  BLI_mutex_init(&disk_cache->write_mutex);
+  BLI_condition_init(&disk_cache->write_cond);
+  disk_cache->write_queue = BLI_thread_queue_init();
+  BLI_threadpool_init(&disk_cache->write_threads, seq_disk_cache_write_thread, 1);
+  BLI_threadpool_insert(&disk_cache->write_threads, disk_cache);
+
+  cache->disk_cache = disk_cache;
   BLI_mutex_unlock(&cache_create_lock);
 }
 
+static void seq_disk_cache_free(SeqDiskCache *disk_cache)
+{
+  /* Let writing thread finish all pending writes and exit. */
+  BLI_thread_queue_nowait(disk_cache->write_queue);
+  BLI_threadpool_end(&disk_cache->write_threads);
+  BLI_thread_queue_free(disk_cache->write_queue);
+  BLI_condition_end(&disk_cache->write_cond);
+  BLI_mutex_end(&disk_cache->write_mutex);
+
+  seq_disk_cache_free_files(disk_cache);
+  BLI_ghash_free(disk_cache->files_hash, NULL, NULL);
+  BLI_mutex_end(&disk_cache->read_write_mutex);
+  MEM_freeN(disk_cache);
+}
+
 static void seq_cache_create(Main *bmain, Scene *scene)
 {
   BLI_mutex_lock(&cache_create_lock);
@@ -1064,7 +1460,7 @@ static void seq_cache_create(Main *bmain, Scene *scene)
     cache->hash = BLI_ghash_new(seq_cache_hashhash, seq_cache_hashcmp, "SeqCache hash");
     cache->last_key = NULL;
     cache->bmain = bmain;
-    BLI_mutex_init(&cache->iterator_mutex);
+    BLI_rw_mutex_init(&cache->iterator_mutex);
     scene->ed->cache = cache;
 
     if (scene->ed->disk_cache_timestamp == 0) {
@@ -1109,12 +1505,10 @@ void BKE_sequencer_cache_destruct(Scene *scene)
   BLI_ghash_free(cache->hash, seq_cache_keyfree, seq_cache_valfree);
   BLI_mempool_destroy(cache->keys_pool);
   BLI_mempool_destroy(cache->items_pool);
-  BLI_mutex_end(&cache->iterator_mutex);
+  BLI_rw_mutex_end(&cache->iterator_mutex);
 
   if (cache->disk_cache != NULL) {
-    BLI_freelistN(&cache->disk_cache->files);
-    BLI_mutex_end(&cache->disk_cache->read_write_mutex);
-    MEM_freeN(cache->disk_cache);
+    seq_disk_cache_free(cache->disk_cache);
   }
 
   MEM_freeN(cache);
@@ -1238,7 +1632,7 @@ struct ImBuf *BKE_sequencer_cache_get(
     seq_cache_create(context->bmain, scene);
   }
 
-  seq_cache_lock(scene);
+  seq_cache_lock_read(scene);
   SeqCache *cache = seq_cache_get_from_scene(scene);
   ImBuf *ibuf = NULL;
   SeqCacheKey key;
@@ -1254,7 +1648,14 @@ struct ImBuf *BKE_sequencer_cache_get(
   }
   seq_cache_unlock(scene);
 
+  /* Lookups with `skip_disk_cache` set are done only to check if item exists in cache before it
+   * is inserted, so they are not counted. */
+  const bool use_stats = cache && !skip_disk_cache;
+
   if (ibuf) {
+    if (use_stats) {
+      atomic_add_and_fetch_uint64(&cache->hits, 1);
+    }
     return ibuf;
   }
 
@@ -1268,6 +1669,7 @@ struct ImBuf *BKE_sequencer_cache_get(
     ibuf = seq_disk_cache_read_file(cache->disk_cache, &key);
     BLI_mutex_unlock(&cache->disk_cache->read_write_mutex);
     if (ibuf) {
+      atomic_add_and_fetch_uint64(&cache->disk_hits, 1);
       if (key.type == SEQ_CACHE_STORE_FINAL_OUT) {
         BKE_sequencer_cache_put_if_possible(context, seq, cfra, type, ibuf, 0.0f, true);
       }
@@ -1277,6 +1679,10 @@ struct ImBuf *BKE_sequencer_cache_get(
     }
   }
 
+  if (ibuf == NULL && use_stats) {
+    atomic_add_and_fetch_uint64(&cache->misses, 1);
+  }
+
   return ibuf;
 }
 
@@ -1409,10 +1815,7 @@ void BKE_sequencer_cache_put(const SeqRenderData *context,
         seq_disk_cache_create(context->bmain, context->scene);
       }
 
-      BLI_mutex_lock(&cache->disk_cache->read_write_mutex);
-      seq_disk_cache_write_file(cache->disk_cache, key, i);
-      BLI_mutex_unlock(&cache->disk_cache->read_write_mutex);
-      seq_disk_cache_enforce_limits(cache->disk_cache);
+      seq_disk_cache_write_file_async(cache->disk_cache, key, i);
     }
   }
 }
@@ -1455,3 +1858,24 @@ bool BKE_sequencer_cache_is_full(Scene *scene)
 
   return memory_total < cache->memory_used;
 }
+
+void BKE_sequencer_cache_stats_get(Scene *scene, SeqCacheStats *r_stats)
+{
+  SeqCache *cache = seq_cache_get_from_scene(scene);
+
+  memset(r_stats, 0, sizeof(*r_stats));
+
+  if (!cache) {
+    return;
+  }
+
+  seq_cache_lock_read(scene);
+  r_stats->item_count = BLI_ghash_len(cache->hash);
+  r_stats->memory_used = cache->memory_used;
+  seq_cache_unlock(scene);
+
+  r_stats->hits = atomic_add_and_fetch_uint64(&cache->hits, 0);
+  r_stats->disk_hits = atomic_add_and_fetch_uint64(&cache->disk_hits, 0);
+  r_stats->misses = atomic_add_and_fetch_uint64(&cache->misses, 0);
+  r_stats->recycled = atomic_add_and_fetch_uint64(&cache->recycled, 0);
+}
@@ -283,7 +283,7 @@ int main(int argc,
 
   /* NOTE: Special exception for guarded allocator type switch:
    *       we need to perform switch from lock-free to fully
-   *       guarded allocator before any allocation happened.
+   *       guarded or thread caching allocator before any allocation happened.
    */
   {
     int i;
@@ -293,6 +293,10 @@ int main(int argc,
         MEM_use_guarded_allocator();
         break;
       }
+      else if (STREQ(argv[i], "--alloc-thread-cache")) {
+        MEM_use_threadcache_allocator();
+        break;
+      }
       else if (STREQ(argv[i], "--")) {
         break;
       }
@@ -40,6 +40,7 @@
 #  include "BLI_string.h"
 #  include "BLI_string_utf8.h"
 #  include "BLI_system.h"
+#  include "BLI_task.h"
 #  include "BLI_threads.h"
 #  include "BLI_utildefines.h"
 
@@ -527,6 +528,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--render-output");
   BLI_argsPrintArgDoc(ba, "--engine");
   BLI_argsPrintArgDoc(ba, "--threads");
+  BLI_argsPrintArgDoc(ba, "--numa-arenas");
 
   printf("\n");
   printf("Format Options:\n");
@@ -620,6 +622,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--app-template");
   BLI_argsPrintArgDoc(ba, "--factory-startup");
   BLI_argsPrintArgDoc(ba, "--enable-event-simulate");
+  BLI_argsPrintArgDoc(ba, "--alloc-thread-cache");
   printf("\n");
   BLI_argsPrintArgDoc(ba, "--env-system-datafiles");
   BLI_argsPrintArgDoc(ba, "--env-system-scripts");
@@ -1150,6 +1153,18 @@ static int arg_handle_enable_event_simulate(int UNUSED(argc),
   return 0;
 }
 
+static const char arg_handle_alloc_thread_cache_doc[] =
+    "\n\t"
+    "Use per-thread caches for small memory allocations, faster for heavily threaded work.\n"
+    "\t(the allocator is chosen on startup, before arguments are parsed).";
+static int arg_handle_alloc_thread_cache(int UNUSED(argc),
+                                         const char **UNUSED(argv),
+                                         void *UNUSED(data))
+{
+  /* Handled in main(), before any memory is allocated. */
+  return 0;
+}
+
 static const char arg_handle_env_system_set_doc_datafiles[] =
     "\n\t"
     "Set the " STRINGIFY_ARG(BLENDER_SYSTEM_DATAFILES) " environment variable.";
@@ -1501,6 +1516,17 @@ static int arg_handle_threads_set(int argc, const char **argv, void *UNUSED(data
   }
 }
 
+static const char arg_handle_numa_arenas_doc[] =
+    "\n\t"
+    "Use a separate task arena per NUMA node, with threads pinned to the processors of the node.";
+static int arg_handle_numa_arenas(int UNUSED(argc),
+                                  const char **UNUSED(argv),
+                                  void *UNUSED(data))
+{
+  BLI_task_scheduler_numa_enable();
+  return 0;
+}
+
 static const char arg_handle_verbosity_set_doc[] =
     "<verbose>\n"
     "\tSet the logging verbosity level for debug messages that support it.";
@@ -2257,6 +2283,7 @@ void main_args_setup(bContext *C, bArgs *ba)
   BLI_argsAdd(ba, 1, NULL, "--app-template", CB(arg_handle_app_template), NULL);
   BLI_argsAdd(ba, 1, NULL, "--factory-startup", CB(arg_handle_factory_startup_set), NULL);
   BLI_argsAdd(ba, 1, NULL, "--enable-event-simulate", CB(arg_handle_enable_event_simulate), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--alloc-thread-cache", CB(arg_handle_alloc_thread_cache), NULL);
 
   /* Pass 2: Custom Window Stuff. */
   BLI_argsAdd(ba, 2, "-p", "--window-geometry", CB(arg_handle_window_geometry), NULL);
@@ -2292,6 +2319,7 @@ void main_args_setup(bContext *C, bArgs *ba)
 
   BLI_argsAdd(ba, 4, "-F", "--render-format", CB(arg_handle_image_type_set), C);
   BLI_argsAdd(ba, 1, "-t", "--threads", CB(arg_handle_threads_set), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--numa-arenas", CB(arg_handle_numa_arenas), NULL);
   BLI_argsAdd(ba, 4, "-x", "--use-extension", CB(arg_handle_extension_set), C);
 
 #  undef CB
@@ -14,6 +14,12 @@ namespace blender::tests {
 const std::string &flags_test_asset_dir();   /* ../lib/tests in the SVN directory. */
 const std::string &flags_test_release_dir(); /* bin/{blender version} in the build directory. */
 
+/* Report the time of a benchmark in a performance test. It's printed and stored as a property of
+ * the test, so it ends up in the report written with `--gtest_output=json:<file>`, which
+ * `tests/python/performance_compare.py` can compare between builds. The name is used as JSON
+ * key, so use snake_case like the benchmarks in `tests/python/bl_performance.py`. */
+void record_performance(const char *name, double seconds);
+
 }  // namespace blender::tests
 
 #define EXPECT_V3_NEAR(a, b, eps) \
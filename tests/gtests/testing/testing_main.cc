@@ -44,6 +44,12 @@ const std::string &flags_test_release_dir()
   return FLAGS_test_release_dir;
 }
 
+void record_performance(const char *name, double seconds)
+{
+  printf("\t%s: %fs\n", name, seconds);
+  ::testing::Test::RecordProperty(name, std::to_string(seconds));
+}
+
 }  // namespace blender::tests
 
 int main(int argc, char **argv)
@@ -73,6 +73,107 @@ class FCurveEvaluationTest(unittest.TestCase):
         self.assertAlmostEqual(1.0, fcurve.evaluate(10))
 
 
+class RNAPathCacheTest(unittest.TestCase):
+    """Evaluated IDs cache resolved RNA paths, these must follow changes to the data."""
+
+    def setUp(self):
+        self.scene = bpy.context.scene
+        self.objects = []
+
+    def tearDown(self):
+        for ob in self.objects:
+            bpy.data.objects.remove(ob)
+
+    def object_add(self, name, data):
+        ob = bpy.data.objects.new(name, data)
+        self.scene.collection.objects.link(ob)
+        self.objects.append(ob)
+        return ob
+
+    def animate(self, ob, data_path, values):
+        action = bpy.data.actions.new(ob.name)
+        fcurve = action.fcurves.new(data_path)
+        for frame, value in values:
+            keyframe = fcurve.keyframe_points.insert(frame, value)
+            keyframe.interpolation = 'LINEAR'
+        ob.animation_data_create().action = action
+
+    def evaluated(self, ob, frame):
+        self.scene.frame_set(frame)
+        return ob.evaluated_get(bpy.context.evaluated_depsgraph_get())
+
+    def test_modifier_replaced(self):
+        ob = self.object_add("CacheModifier", bpy.data.meshes.new("CacheModifier"))
+        modifier = ob.modifiers.new("Displace", 'DISPLACE')
+        self.animate(ob, 'modifiers["Displace"].strength', ((1, 1.0), (10, 10.0)))
+
+        self.assertAlmostEqual(self.evaluated(ob, 1).modifiers["Displace"].strength, 1.0)
+
+        # The evaluated modifier the path resolved to is freed.
+        ob.modifiers.remove(modifier)
+        ob.modifiers.new("Wave", 'WAVE')
+        ob.modifiers.new("Displace", 'DISPLACE')
+
+        self.assertAlmostEqual(self.evaluated(ob, 5).modifiers["Displace"].strength, 5.0)
+
+    def test_bone_renamed(self):
+        armature = bpy.data.armatures.new("CacheBones")
+        ob = self.object_add("CacheBones", armature)
+        bpy.context.view_layer.objects.active = ob
+        bpy.ops.object.mode_set(mode='EDIT')
+        for name in ("A", "B"):
+            bone = armature.edit_bones.new(name)
+            bone.tail = (0.0, 0.0, 1.0)
+        bpy.ops.object.mode_set(mode='OBJECT')
+        self.animate(ob, 'pose.bones["A"].location', ((1, 1.0), (10, 10.0)))
+
+        self.assertAlmostEqual(self.evaluated(ob, 1).pose.bones["A"].location[0], 1.0)
+
+        # Swap the names, renaming updates the F-Curve to keep animating the same bone.
+        armature.bones["A"].name = "C"
+        armature.bones["B"].name = "A"
+        armature.bones["C"].name = "B"
+
+        ob_eval = self.evaluated(ob, 5)
+        self.assertAlmostEqual(ob_eval.pose.bones["B"].location[0], 5.0)
+        self.assertAlmostEqual(ob_eval.pose.bones["A"].location[0], 0.0)
+
+    def test_shared_action(self):
+        # F-Curves of a shared action note the cache slot of one of the objects.
+        ob_a = self.object_add("CacheSharedA", None)
+        ob_b = self.object_add("CacheSharedB", None)
+        self.animate(ob_a, 'location', ((1, 1.0), (10, 10.0)))
+        action = ob_a.animation_data.action
+        action.fcurves.new('scale', index=2).keyframe_points.insert(1, 2.0)
+        action.fcurves.new('location', index=1).keyframe_points.insert(1, 3.0)
+        ob_b.animation_data_create().action = action
+
+        for frame in (1, 5, 10, 5):
+            depsgraph = bpy.context.evaluated_depsgraph_get()
+            self.scene.frame_set(frame)
+            for ob in (ob_a, ob_b):
+                ob_eval = ob.evaluated_get(depsgraph)
+                self.assertAlmostEqual(ob_eval.location[0], float(frame))
+                self.assertAlmostEqual(ob_eval.location[1], 3.0)
+                self.assertAlmostEqual(ob_eval.scale[2], 2.0)
+
+    def test_fcurves_replaced(self):
+        ob = self.object_add("CacheReplaced", None)
+        self.animate(ob, 'location', ((1, 1.0), (10, 10.0)))
+        self.assertAlmostEqual(self.evaluated(ob, 5).location[0], 5.0)
+
+        # The evaluated action is copied again, new F-Curves may reuse the memory of freed ones.
+        action = ob.animation_data.action
+        action.fcurves.remove(action.fcurves[0])
+        fcurve = action.fcurves.new('location', index=2)
+        fcurve.keyframe_points.insert(1, 1.0).interpolation = 'LINEAR'
+        fcurve.keyframe_points.insert(10, 10.0).interpolation = 'LINEAR'
+
+        ob_eval = self.evaluated(ob, 4)
+        self.assertAlmostEqual(ob_eval.location[2], 4.0)
+        self.assertAlmostEqual(ob_eval.location[0], ob.location[0])
+
+
 def main():
     global args
     import argparse
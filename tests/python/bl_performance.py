@@ -0,0 +1,375 @@
+# Apache License, Version 2.0
+
+# Macro benchmarks of Blender, with timings written to a JSON file.
+#
+# ./blender.bin --background -noaudio --factory-startup --python tests/python/bl_performance.py -- \
+#     --output /tmp/performance.json
+#
+# Compare the results of two builds with tests/python/performance_compare.py.
+# Scenes are generated, so no test files are needed and results of builds are comparable.
+
+import bpy
+import bmesh
+import json
+import os
+import statistics
+import sys
+import time
+
+
+def mesh_grid_create(name, segments):
+    bm = bmesh.new()
+    bmesh.ops.create_grid(bm, x_segments=segments, y_segments=segments, size=1.0)
+    # Some displacement, so normals are not all the same.
+    for v in bm.verts:
+        v.co.z = ((v.index * 7919) % 101) * 0.0005
+    mesh = bpy.data.meshes.new(name)
+    bm.to_mesh(mesh)
+    bm.free()
+    return mesh
+
+
+def object_add(scene, name, data):
+    ob = bpy.data.objects.new(name, data)
+    scene.collection.objects.link(ob)
+    return ob
+
+
+def scene_camera_add(scene):
+    camera = object_add(scene, "Camera", bpy.data.cameras.new("Camera"))
+    camera.location = (0.0, -6.0, 4.0)
+    camera.rotation_euler = (0.9, 0.0, 0.0)
+    scene.camera = camera
+
+    light = object_add(scene, "Light", bpy.data.lights.new("Light", 'SUN'))
+    light.rotation_euler = (0.5, 0.2, 0.0)
+
+
+class Benchmarks:
+
+    def __init__(self, args):
+        self.args = args
+        self.results = {}
+
+    def timeit(self, name, func, setup=None):
+        """
+        Run func a number of times after a warm-up run and store the timings. Setup is run
+        before every call of func and not timed.
+        """
+        times = []
+        for i in range(self.args.runs + 1):
+            if setup:
+                setup()
+            start_time = time.perf_counter()
+            func()
+            elapsed = time.perf_counter() - start_time
+            # First run is a warm-up, to fill caches and allocate memory pools.
+            if i > 0:
+                times.append(elapsed)
+
+        self.results[name] = {
+            "times": times,
+            "min": min(times),
+            "median": statistics.median(times),
+        }
+        print("%-32s median %.4fs, min %.4fs" % (name, self.results[name]["median"], min(times)))
+
+    def run_all(self):
+        bpy.ops.wm.read_factory_settings(use_empty=True)
+        scene_camera_add(bpy.context.scene)
+
+        # Run in order, the file benchmarks replace the current file.
+        for name in (
+                "mesh_normals",
+                "bmesh_conversion",
+                "subdivision",
+                "depsgraph_frames",
+                "action",
+                "armature_deform",
+                "compositor",
+                "render",
+                "blendfile",
+        ):
+            if self.args.filter and self.args.filter not in name:
+                continue
+            getattr(self, "benchmark_" + name)()
+
+    def benchmark_mesh_normals(self):
+        mesh = mesh_grid_create("Normals", 512)
+
+        self.timeit("mesh_normals", mesh.calc_normals)
+        mesh.use_auto_smooth = True
+        self.timeit("mesh_normals_split", mesh.calc_normals_split)
+
+        bpy.data.meshes.remove(mesh)
+
+    def benchmark_bmesh_conversion(self):
+        mesh = mesh_grid_create("BMesh", 512)
+        bm = bmesh.new()
+
+        self.timeit("bmesh_from_mesh", lambda: bm.from_mesh(mesh), setup=bm.clear)
+        self.timeit("bmesh_to_mesh", lambda: bm.to_mesh(mesh))
+
+        bm.free()
+        bpy.data.meshes.remove(mesh)
+
+    def benchmark_subdivision(self):
+        scene = bpy.context.scene
+        ob = object_add(scene, "Subdivision", mesh_grid_create("Subdivision", 64))
+        modifier = ob.modifiers.new("Subdivision", 'SUBSURF')
+        modifier.levels = 3
+        view_layer = bpy.context.view_layer
+
+        self.timeit("subdivision", view_layer.update, setup=ob.data.update)
+
+        mesh = ob.data
+        bpy.data.objects.remove(ob)
+        bpy.data.meshes.remove(mesh)
+
+    def benchmark_depsgraph_frames(self):
+        scene = bpy.context.scene
+        mesh = mesh_grid_create("Animated", 32)
+
+        # Animated transforms, with modifiers that depend on the object positions.
+        objects = []
+        for i in range(100):
+            ob = object_add(scene, "Animated%d" % i, mesh)
+            for frame in (1, self.args.frames):
+                ob.location = (i % 10, i // 10, (frame * i) % 7)
+                ob.keyframe_insert("location", frame=frame)
+            modifier = ob.modifiers.new("Displace", 'DISPLACE')
+            modifier.strength = 0.1
+            objects.append(ob)
+        for i in range(0, 100, 10):
+            modifier = objects[i].modifiers.new("Subdivision", 'SUBSURF')
+            modifier.levels = 2
+
+        def frames_step():
+            for frame in range(1, self.args.frames + 1):
+                scene.frame_set(frame)
+
+        self.timeit("depsgraph_frames", frames_step)
+
+        for ob in objects:
+            bpy.data.objects.remove(ob)
+        bpy.data.meshes.remove(mesh)
+
+    def benchmark_action(self):
+        scene = bpy.context.scene
+        view_layer = bpy.context.view_layer
+
+        # Large action on an armature, 10 channels for each of the bones.
+        armature = bpy.data.armatures.new("Action")
+        ob = object_add(scene, "Action", armature)
+        view_layer.objects.active = ob
+        bpy.ops.object.mode_set(mode='EDIT')
+        for i in range(1000):
+            bone = armature.edit_bones.new("Bone%d" % i)
+            bone.head = (i % 32, i // 32, 0.0)
+            bone.tail = (i % 32, i // 32, 1.0)
+        bpy.ops.object.mode_set(mode='OBJECT')
+
+        action = bpy.data.actions.new("Action")
+        frames = range(1, self.args.frames + 1, 4)
+        for bone in armature.bones:
+            for prop, length in (("location", 3), ("rotation_quaternion", 4), ("scale", 3)):
+                data_path = 'pose.bones["%s"].%s' % (bone.name, prop)
+                for index in range(length):
+                    fcurve = action.fcurves.new(data_path, index=index, action_group=bone.name)
+                    fcurve.keyframe_points.add(len(frames))
+                    fcurve.keyframe_points.foreach_set("co", [
+                        value for frame in frames
+                        for value in (frame, ((frame + index) * 7919 % 101) * 0.01)
+                    ])
+                    fcurve.update()
+        ob.animation_data_create().action = action
+
+        def frames_step():
+            for frame in range(1, self.args.frames + 1):
+                scene.frame_set(frame)
+
+        self.timeit("action_frames", frames_step)
+
+        bpy.data.objects.remove(ob)
+        bpy.data.armatures.remove(armature)
+        bpy.data.actions.remove(action)
+
+    def benchmark_armature_deform(self):
+        scene = bpy.context.scene
+        view_layer = bpy.context.view_layer
+
+        # Crowd of characters sharing a skinned mesh, 4 bone weights for each vertex.
+        armature = bpy.data.armatures.new("Skin")
+        arm_ob = object_add(scene, "Skin", armature)
+        view_layer.objects.active = arm_ob
+        bpy.ops.object.mode_set(mode='EDIT')
+        for i in range(64):
+            bone = armature.edit_bones.new("Bone%d" % i)
+            bone.head = ((i % 8) * 0.25 - 1.0, (i // 8) * 0.25 - 1.0, 0.0)
+            bone.tail = ((i % 8) * 0.25 - 1.0, (i // 8) * 0.25 - 1.0, 0.25)
+        bpy.ops.object.mode_set(mode='OBJECT')
+
+        mesh = mesh_grid_create("Skin", 128)
+        objects = []
+        for i in range(20):
+            ob = object_add(scene, "Skin%d" % i, mesh)
+            ob.parent = arm_ob
+            modifier = ob.modifiers.new("Armature", 'ARMATURE')
+            modifier.object = arm_ob
+            objects.append(ob)
+
+        # Group names are stored on the objects, the weights in the shared mesh.
+        for ob in objects:
+            groups = [ob.vertex_groups.new(name=bone.name) for bone in armature.bones]
+        for v in mesh.vertices:
+            for j in range(4):
+                groups[(v.index * 7 + j * 13) % len(groups)].add([v.index], 0.25, 'REPLACE')
+
+        pose_bone = arm_ob.pose.bones[0]
+
+        def pose_change():
+            pose_bone.location.z += 0.01
+
+        for use_quaternion in (False, True):
+            for ob in objects:
+                ob.modifiers["Armature"].use_deform_preserve_volume = use_quaternion
+            name = "armature_deform_dqs" if use_quaternion else "armature_deform"
+            self.timeit(name, view_layer.update, setup=pose_change)
+
+        for ob in objects:
+            bpy.data.objects.remove(ob)
+        bpy.data.meshes.remove(mesh)
+        bpy.data.objects.remove(arm_ob)
+        bpy.data.armatures.remove(armature)
+
+    def benchmark_compositor(self):
+        scene = bpy.context.scene
+        scene.render.resolution_x = 1920
+        scene.render.resolution_y = 1080
+        scene.render.resolution_percentage = 100
+
+        image = bpy.data.images.new("Compositor", 1920, 1080, float_buffer=True)
+        image.generated_type = 'COLOR_GRID'
+
+        # Without render layer nodes only the compositor runs when rendering.
+        scene.use_nodes = True
+        tree = scene.node_tree
+        tree.nodes.clear()
+        node_image = tree.nodes.new('CompositorNodeImage')
+        node_image.image = image
+        node_blur = tree.nodes.new('CompositorNodeBlur')
+        node_blur.size_x = 20
+        node_blur.size_y = 20
+        node_glare = tree.nodes.new('CompositorNodeGlare')
+        node_composite = tree.nodes.new('CompositorNodeComposite')
+        tree.links.new(node_image.outputs["Image"], node_blur.inputs["Image"])
+        tree.links.new(node_blur.outputs["Image"], node_glare.inputs["Image"])
+        tree.links.new(node_glare.outputs["Image"], node_composite.inputs["Image"])
+
+        self.timeit("compositor", bpy.ops.render.render)
+
+        scene.use_nodes = False
+        bpy.data.images.remove(image)
+
+    def benchmark_render(self):
+        scene = bpy.context.scene
+        if not hasattr(scene, "cycles"):
+            print("Cycles not available, skipping render benchmark")
+            return
+
+        ob = object_add(scene, "Render", mesh_grid_create("Render", 128))
+        engine = scene.render.engine
+        scene.render.engine = 'CYCLES'
+        scene.render.resolution_x = 640
+        scene.render.resolution_y = 360
+        scene.cycles.device = 'CPU'
+        scene.cycles.samples = 16
+        scene.cycles.seed = 0
+
+        self.timeit("render", bpy.ops.render.render)
+
+        scene.render.engine = engine
+        mesh = ob.data
+        bpy.data.objects.remove(ob)
+        bpy.data.meshes.remove(mesh)
+
+    def benchmark_blendfile(self):
+        # Add more data to make the file a realistic size.
+        scene = bpy.context.scene
+        for i in range(20):
+            object_add(scene, "File%d" % i, mesh_grid_create("File%d" % i, 128))
+
+        filepath = os.path.join(os.path.dirname(os.path.abspath(self.args.output)),
+                                "bl_performance.blend")
+
+        self.timeit("blendfile_save", lambda: bpy.ops.wm.save_as_mainfile(
+            filepath=filepath, check_existing=False, compress=False))
+        self.timeit("blendfile_load", lambda: bpy.ops.wm.open_mainfile(
+            filepath=filepath, load_ui=False))
+
+        os.remove(filepath)
+
+    def write(self):
+        results = {
+            "version": bpy.app.version_string,
+            "build_hash": bpy.app.build_hash.decode(),
+            "build_date": bpy.app.build_date.decode(),
+            "platform": sys.platform,
+            "runs": self.args.runs,
+            "benchmarks": self.results,
+        }
+        with open(self.args.output, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+def argparse_create():
+    import argparse
+
+    # When --help or no args are given, print this help
+    description = "Run macro benchmarks of Blender and write the timings to JSON."
+    parser = argparse.ArgumentParser(description=description)
+    parser.add_argument(
+        "--output",
+        dest="output",
+        default="bl_performance.json",
+        help="JSON file to write the results to",
+        required=False,
+    )
+    parser.add_argument(
+        "--runs",
+        dest="runs",
+        type=int,
+        default=5,
+        help="Number of timed runs for each benchmark, after a warm-up run",
+        required=False,
+    )
+    parser.add_argument(
+        "--frames",
+        dest="frames",
+        type=int,
+        default=50,
+        help="Number of frames to evaluate in the depsgraph benchmark",
+        required=False,
+    )
+    parser.add_argument(
+        "--filter",
+        dest="filter",
+        default="",
+        help="Only run benchmarks with this text in their name",
+        required=False,
+    )
+
+    return parser
+
+
+def main():
+    args = argparse_create().parse_args()
+
+    benchmarks = Benchmarks(args)
+    benchmarks.run_all()
+    benchmarks.write()
+
+
+if __name__ == '__main__':
+    sys.argv = [__file__] + (sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else [])
+    main()
@@ -0,0 +1,64 @@
+# Apache License, Version 2.0
+
+# ./blender.bin --background -noaudio --python tests/python/bl_pyapi_prop_collection_foreach.py -- --verbose
+import bpy
+import unittest
+import numpy as np
+
+
+class TestPropCollectionForeach(unittest.TestCase):
+    def setUp(self):
+        self.mesh = bpy.data.meshes.new("TestForeach")
+        self.mesh.vertices.add(4)
+
+    def tearDown(self):
+        bpy.data.meshes.remove(self.mesh)
+
+    def test_vertices_co(self):
+        co = np.arange(12, dtype=np.float32)
+        self.mesh.vertices.foreach_set("co", co)
+        self.assertEqual(tuple(self.mesh.vertices[2].co), (6.0, 7.0, 8.0))
+
+        result = np.empty(len(self.mesh.vertices) * 3, dtype=np.float32)
+        self.mesh.vertices.foreach_get("co", result)
+        self.assertEqual(result.tolist(), co.tolist())
+
+        # Vectors are flattened, reshape to work on them.
+        result = result.reshape(-1, 3)
+        result[:, 2] += 1.0
+        self.mesh.vertices.foreach_set("co", result.ravel())
+        self.assertEqual(tuple(self.mesh.vertices[2].co), (6.0, 7.0, 9.0))
+
+    def test_attribute(self):
+        attribute = self.mesh.attributes.new("test", 'FLOAT', 'POINT')
+        values = np.array([1.0, 2.0, 3.0, 4.0], dtype=np.float32)
+        attribute.data.foreach_set("value", values)
+
+        result = np.zeros(4, dtype=np.float32)
+        attribute.data.foreach_get("value", result)
+        self.assertEqual(result.tolist(), values.tolist())
+
+    def test_type_conversion(self):
+        # Buffers of another type than the property are converted through the sequence path.
+        self.mesh.vertices.foreach_set("co", np.arange(12, dtype=np.float64))
+
+        result = np.empty(12, dtype=np.float64)
+        self.mesh.vertices.foreach_get("co", result)
+        self.assertEqual(result.tolist(), list(range(12)))
+
+    def test_size_mismatch(self):
+        with self.assertRaises(RuntimeError):
+            self.mesh.vertices.foreach_set("co", np.zeros(11, dtype=np.float32))
+
+        with self.assertRaises(RuntimeError):
+            self.mesh.vertices.foreach_get("co", np.zeros(13, dtype=np.float32))
+
+    def test_invalid(self):
+        with self.assertRaises(AttributeError):
+            self.mesh.vertices.foreach_get("unknown", np.zeros(4, dtype=np.float32))
+
+
+if __name__ == '__main__':
+    import sys
+    sys.argv = [__file__] + (sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else [])
+    unittest.main()
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+# Apache License, Version 2.0
+
+# Compare the performance results of two builds, and report regressions.
+#
+# Results are JSON files written by:
+# - bl_performance.py, macro benchmarks running in Blender.
+# - Performance tests using BLENDER_TEST_PERFORMANCE, run with --gtest_output=json:<file>.
+#   Timings reported with blender::tests::record_performance() are stored as test properties.
+#
+# ./performance_compare.py --base old/*.json --new new/*.json --threshold 5
+#
+# Exits with code 1 when any benchmark is slower than the threshold.
+
+import argparse
+import json
+import sys
+
+
+# gtest properties that are not timings of the test.
+GTEST_RESERVED = {
+    "name", "file", "line", "status", "result", "timestamp", "time", "classname",
+    "type_param", "value_param", "failures",
+}
+
+
+def results_from_gtest(data):
+    results = {}
+    for testsuite in data["testsuites"]:
+        for test in testsuite["testsuite"]:
+            for key, value in test.items():
+                if key in GTEST_RESERVED:
+                    continue
+                try:
+                    results["%s.%s: %s" % (test["classname"], test["name"], key)] = float(value)
+                except ValueError:
+                    pass
+    return results
+
+
+def results_from_blender(data, statistic):
+    return {name: benchmark[statistic] for name, benchmark in data["benchmarks"].items()}
+
+
+def results_load(filepaths, statistic):
+    results = {}
+    for filepath in filepaths:
+        with open(filepath) as f:
+            data = json.load(f)
+        if "testsuites" in data:
+            results.update(results_from_gtest(data))
+        elif "benchmarks" in data:
+            results.update(results_from_blender(data, statistic))
+        else:
+            print("Unknown results format in %s" % filepath, file=sys.stderr)
+    return results
+
+
+def compare(base, new, threshold, min_time):
+    regressions = []
+
+    print("%-60s %12s %12s %9s" % ("Benchmark", "Base", "New", "Change"))
+    for name in sorted(set(base) | set(new)):
+        if name not in base or name not in new:
+            print("%-60s %12s %12s" % (
+                name,
+                "%.6f" % base[name] if name in base else "-",
+                "%.6f" % new[name] if name in new else "-"))
+            continue
+
+        base_time, new_time = base[name], new[name]
+        change = ((new_time - base_time) / base_time * 100.0) if base_time > 0.0 else 0.0
+
+        # Very short timings are mostly noise.
+        is_regression = change > threshold and new_time >= min_time
+        if is_regression:
+            regressions.append(name)
+
+        print("%-60s %12.6f %12.6f %+8.1f%%%s" % (
+            name, base_time, new_time, change, "  REGRESSION" if is_regression else ""))
+
+    return regressions
+
+
+def argparse_create():
+    parser = argparse.ArgumentParser(
+        description="Compare performance results of two builds and report regressions.")
+    parser.add_argument(
+        "--base",
+        nargs="+",
+        required=True,
+        help="Result files of the reference build",
+    )
+    parser.add_argument(
+        "--new",
+        nargs="+",
+        required=True,
+        help="Result files of the build to check",
+    )
+    parser.add_argument(
+        "--threshold",
+        type=float,
+        default=5.0,
+        help="Percentage a benchmark may be slower before it's a regression",
+    )
+    parser.add_argument(
+        "--min-time",
+        dest="min_time",
+        type=float,
+        default=0.001,
+        help="Don't report regressions for benchmarks faster than this many seconds",
+    )
+    parser.add_argument(
+        "--statistic",
+        choices=("median", "min"),
+        default="median",
+        help="Statistic of the bl_performance.py runs to compare",
+    )
+    return parser
+
+
+def main():
+    args = argparse_create().parse_args()
+
+    base = results_load(args.base, args.statistic)
+    new = results_load(args.new, args.statistic)
+
+    regressions = compare(base, new, args.threshold, args.min_time)
+    if regressions:
+        print("\n%d regression(s) over %.1f%%:" % (len(regressions), args.threshold))
+        for name in regressions:
+            print("  " + name)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()